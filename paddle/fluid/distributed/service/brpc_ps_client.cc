@@ -19,8 +19,10 @@
 
 #include "Eigen/Dense"
 #include "paddle/fluid/distributed/service/brpc_ps_client.h"
+#include "paddle/fluid/distributed/service/grad_codec.h"
 #include "paddle/fluid/distributed/table/table.h"
 #include "paddle/fluid/framework/archive.h"
+#include "paddle/fluid/platform/monitor.h"
 
 const static int max_port = 65535;
 
@@ -55,6 +57,15 @@ DEFINE_int32(pserver_connect_timeout_ms, 10000,
 
 DEFINE_int32(pserver_sparse_merge_thread, 1, "pserver sparse merge thread num");
 
+DEFINE_string(pserver_dense_grad_codec, "none",
+              "codec of pushed dense grads: none/fp16/bf16/topk/int8");
+
+DEFINE_string(pserver_sparse_grad_codec, "none",
+              "codec of pushed sparse grads: none/fp16/bf16/int8");
+
+DEFINE_double(pserver_grad_topk_ratio, 0.01,
+              "ratio of dense grad values kept by the topk codec");
+
 namespace paddle {
 namespace distributed {
 
@@ -133,6 +144,10 @@ int32_t BrpcPsClient::create_client2client_connection(
 
 int32_t BrpcPsClient::initialize() {
   _async_call_num = 0;
+  _dense_grad_codec =
+      GetGradCodec(GradCodecFromString(FLAGS_pserver_dense_grad_codec));
+  _sparse_grad_codec =
+      GetGradCodec(GradCodecFromString(FLAGS_pserver_sparse_grad_codec));
 
   brpc::ChannelOptions options;
   options.protocol = "baidu_std";
@@ -484,6 +499,10 @@ std::future<int32_t> BrpcPsClient::push_sparse_param(
 std::future<int32_t> BrpcPsClient::pull_dense(Region *regions,
                                               size_t region_num,
                                               size_t table_id) {
+  static auto *calls_stat = STAT_COUNTER("ps_client.pull_dense.calls");
+  static auto *latency_stat = STAT_HISTOGRAM("ps_client.pull_dense.us");
+  calls_stat->Add();
+  int64_t start_us = butil::gettimeofday_us();
   auto *accessor = table_accessor(table_id);
   size_t request_call_num = _server_channels.size();
   uint32_t num_per_shard =
@@ -491,7 +510,8 @@ std::future<int32_t> BrpcPsClient::pull_dense(Region *regions,
   // callback 将各shard结果，顺序填入region
   DownpourBrpcClosure *closure = new DownpourBrpcClosure(
       request_call_num, [request_call_num, num_per_shard, regions, region_num,
-                         accessor](void *done) {
+                         accessor, start_us](void *done) {
+        latency_stat->Observe(butil::gettimeofday_us() - start_us);
         int ret = 0;
         size_t region_idx = 0;       // 当前填充的region偏移
         size_t region_data_idx = 0;  // 当前填充的region内data偏移
@@ -634,6 +654,11 @@ std::future<int32_t> BrpcPsClient::push_dense_param(const Region *regions,
 std::future<int32_t> BrpcPsClient::push_sparse_raw_gradient(
     size_t table_id, const uint64_t *keys, const float **update_values,
     size_t num, void *done) {
+  static auto *calls_stat = STAT_COUNTER("ps_client.push_sparse.calls");
+  static auto *keys_stat = STAT_COUNTER("ps_client.push_sparse.keys");
+  static auto *bytes_stat = STAT_COUNTER("ps_client.push_sparse.bytes");
+  calls_stat->Add();
+  keys_stat->Add(num);
   auto *accessor = table_accessor(table_id);
   //发送RPC请求
   DownpourBrpcClosure *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
@@ -653,6 +678,7 @@ std::future<int32_t> BrpcPsClient::push_sparse_raw_gradient(
     value_ptrs[pserver_idx].push_back(update_values[i]);
   }
 
+  auto *codec = _sparse_grad_codec;
   for (size_t shard_idx = 0; shard_idx < request_call_num; ++shard_idx) {
     auto kvs = ids[shard_idx];
     auto value_ptr = value_ptrs[shard_idx];
@@ -667,15 +693,38 @@ std::future<int32_t> BrpcPsClient::push_sparse_raw_gradient(
     push_request->set_client_id(_client_id);
     push_request->add_params((char *)&kv_size, sizeof(uint32_t));
     auto *push_data = push_request->mutable_data();
-    push_data->resize(kv_size * (sizeof(uint64_t) + accessor->update_size()));
-    char *push_data_ptr = const_cast<char *>(push_data->data());
-    memcpy(push_data_ptr, kvs.data(), kv_size * sizeof(uint64_t));
-    push_data_ptr += kv_size * sizeof(uint64_t);
-
-    for (int i = 0; i < kv_size; ++i) {
-      memcpy(push_data_ptr, value_ptr[i], accessor->update_size());
-      push_data_ptr += accessor->update_size();
+    if (codec == nullptr) {
+      push_data->resize(kv_size * (sizeof(uint64_t) + value_size));
+      char *push_data_ptr = const_cast<char *>(push_data->data());
+      memcpy(push_data_ptr, kvs.data(), kv_size * sizeof(uint64_t));
+      push_data_ptr += kv_size * sizeof(uint64_t);
+
+      for (int i = 0; i < kv_size; ++i) {
+        memcpy(push_data_ptr, value_ptr[i], value_size);
+        push_data_ptr += value_size;
+      }
+    } else {
+      /*
+      Push Content:
+      |---keysData---|---encodedValues---|
+      |---8*{num}B---|-------------------|
+      */
+      uint32_t codec_type = codec->type();
+      push_request->add_params((char *)&codec_type, sizeof(uint32_t));
+      size_t value_dim = value_size / sizeof(float);
+      std::vector<float> values(kv_size * value_dim);
+      for (int i = 0; i < kv_size; ++i) {
+        memcpy(values.data() + i * value_dim, value_ptr[i], value_size);
+      }
+      std::string encoded;
+      codec->Encode(values.data(), values.size(), value_dim, &encoded);
+      push_data->resize(kv_size * sizeof(uint64_t) + encoded.size());
+      char *push_data_ptr = const_cast<char *>(push_data->data());
+      memcpy(push_data_ptr, kvs.data(), kv_size * sizeof(uint64_t));
+      memcpy(push_data_ptr + kv_size * sizeof(uint64_t), encoded.data(),
+             encoded.size());
     }
+    bytes_stat->Add(push_data->size());
     PsService_Stub rpc_stub(get_sparse_channel(shard_idx));
     closure->cntl(shard_idx)->set_request_compress_type(
         (brpc::CompressType)FLAGS_pserver_communicate_compress_type);
@@ -688,6 +737,9 @@ std::future<int32_t> BrpcPsClient::push_sparse_raw_gradient(
 std::future<int32_t> BrpcPsClient::push_dense_raw_gradient(
     int table_id, float *total_send_data, size_t total_send_data_size,
     void *done) {
+  static auto *calls_stat = STAT_COUNTER("ps_client.push_dense.calls");
+  static auto *bytes_stat = STAT_COUNTER("ps_client.push_dense.bytes");
+  calls_stat->Add();
   size_t request_call_num = _server_channels.size();
   DownpourBrpcClosure *closure = reinterpret_cast<DownpourBrpcClosure *>(done);
   auto promise = std::make_shared<std::promise<int32_t>>();
@@ -696,17 +748,33 @@ std::future<int32_t> BrpcPsClient::push_dense_raw_gradient(
   auto *accessor = table_accessor(table_id);
   uint32_t num_per_shard =
       dense_dim_per_shard(accessor->fea_dim(), request_call_num);
+  auto *codec = _dense_grad_codec;
   for (size_t i = 0; i < request_call_num; ++i) {
     closure->request(i)->set_cmd_id(PS_PUSH_DENSE_TABLE);
     closure->request(i)->set_table_id(table_id);
     closure->request(i)->set_client_id(_client_id);
     auto *push_data = closure->request(i)->mutable_data();
     push_data->clear();
-    push_data->resize(sizeof(uint32_t) + num_per_shard * sizeof(float));
-    char *push_data_ptr = const_cast<char *>(push_data->data());
-    memcpy(push_data_ptr, &num_per_shard, sizeof(uint32_t));
-    memcpy(push_data_ptr + sizeof(uint32_t),
-           total_send_data + i * num_per_shard, num_per_shard * sizeof(float));
+    if (codec == nullptr) {
+      push_data->resize(sizeof(uint32_t) + num_per_shard * sizeof(float));
+      char *push_data_ptr = const_cast<char *>(push_data->data());
+      memcpy(push_data_ptr, &num_per_shard, sizeof(uint32_t));
+      memcpy(push_data_ptr + sizeof(uint32_t),
+             total_send_data + i * num_per_shard,
+             num_per_shard * sizeof(float));
+    } else {
+      uint32_t codec_type = codec->type();
+      closure->request(i)->add_params((char *)&codec_type, sizeof(uint32_t));
+      std::string encoded;
+      codec->Encode(total_send_data + i * num_per_shard, num_per_shard,
+                    kDenseQuantGroup, &encoded);
+      push_data->resize(sizeof(uint32_t) + encoded.size());
+      char *push_data_ptr = const_cast<char *>(push_data->data());
+      memcpy(push_data_ptr, &num_per_shard, sizeof(uint32_t));
+      memcpy(push_data_ptr + sizeof(uint32_t), encoded.data(),
+             encoded.size());
+    }
+    bytes_stat->Add(push_data->size());
     VLOG(1) << "push_dense_raw_gradient finish memcpy";
     // closure->cntl(i)->set_request_compress_type(
     //     (brpc::CompressType)FLAGS_pserver_communicate_compress_type);
@@ -723,6 +791,12 @@ std::future<int32_t> BrpcPsClient::pull_sparse(float **select_values,
                                                size_t table_id,
                                                const uint64_t *keys,
                                                size_t num) {
+  static auto *calls_stat = STAT_COUNTER("ps_client.pull_sparse.calls");
+  static auto *keys_stat = STAT_COUNTER("ps_client.pull_sparse.keys");
+  static auto *latency_stat = STAT_HISTOGRAM("ps_client.pull_sparse.us");
+  calls_stat->Add();
+  keys_stat->Add(num);
+  int64_t start_us = butil::gettimeofday_us();
   size_t request_call_num = _server_channels.size();
 
   auto shard_sorted_kvs = std::make_shared<
@@ -738,7 +812,8 @@ std::future<int32_t> BrpcPsClient::pull_sparse(float **select_values,
   size_t value_size = accessor->select_size();
 
   DownpourBrpcClosure *closure = new DownpourBrpcClosure(
-      request_call_num, [shard_sorted_kvs, value_size](void *done) {
+      request_call_num, [shard_sorted_kvs, value_size, start_us](void *done) {
+        latency_stat->Observe(butil::gettimeofday_us() - start_us);
         int ret = 0;
         auto *closure = (DownpourBrpcClosure *)done;
         for (size_t i = 0; i < ids.size(); ++i) {
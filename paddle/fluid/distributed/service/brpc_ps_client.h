@@ -21,6 +21,7 @@
 #include "brpc/channel.h"
 #include "brpc/controller.h"
 #include "brpc/server.h"
+#include "paddle/fluid/distributed/service/grad_codec.h"
 #include "paddle/fluid/distributed/service/ps_client.h"
 
 namespace paddle {
@@ -173,6 +174,9 @@ class BrpcPsClient : public PSClient {
   bool _running = false;
   bool _flushing = false;
   std::atomic<uint32_t> _async_call_num;  //异步请求计数
+  // codecs of pushed gradients, nullptr to push raw fp32
+  const GradCodec *_dense_grad_codec = nullptr;
+  const GradCodec *_sparse_grad_codec = nullptr;
 
   std::vector<std::shared_ptr<brpc::Channel>>
       _client_channels;  // client2client
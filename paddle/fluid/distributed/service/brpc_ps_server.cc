@@ -14,13 +14,26 @@
 
 #include "paddle/fluid/distributed/service/brpc_ps_server.h"
 #include <thread>  // NOLINT
+#include <unordered_set>
 #include "Eigen/Dense"
 #include "butil/endpoint.h"
+#include "gflags/gflags.h"
 #include "iomanip"
+#include "paddle/fluid/distributed/service/grad_codec.h"
 #include "paddle/fluid/distributed/table/table.h"
 #include "paddle/fluid/framework/archive.h"
 #include "paddle/fluid/platform/profiler.h"
 
+DEFINE_bool(pserver_batch_sparse_requests, false,
+            "coalesce concurrent pull_sparse/push_sparse requests of a table");
+
+DEFINE_int32(pserver_batch_window_us, 200,
+             "max time a sparse request waits for others to batch with, "
+             "a batch is closed earlier once no other request is arriving");
+
+DEFINE_int32(pserver_batch_max_keys, 1 << 20,
+             "a sparse request batch is executed once it holds this many keys");
+
 namespace paddle {
 namespace distributed {
 
@@ -103,6 +116,7 @@ int32_t PsService::initialize() {
 
   // shard初始化,server启动后才可从env获取到server_list的shard信息
   initialize_shard_info();
+  initialize_batcher();
 
   return 0;
 }
@@ -131,6 +145,58 @@ int32_t PsService::initialize_shard_info() {
   return 0;
 }
 
+int32_t PsService::initialize_batcher() {
+  if (!FLAGS_pserver_batch_sparse_requests) {
+    return 0;
+  }
+  // sync and geo tables count every push of a key, their pushes are batched
+  // without summing the gradients of a key
+  std::unordered_set<uint32_t> unmerged_push_tables;
+  const auto &downpour_param = _server->config()->downpour_server_param();
+  for (int i = 0; i < downpour_param.downpour_table_param_size(); ++i) {
+    const auto &table_param = downpour_param.downpour_table_param(i);
+    if (table_param.common().sync() ||
+        table_param.table_class() == "SparseGeoTable") {
+      unmerged_push_tables.insert(table_param.table_id());
+    }
+  }
+  for (auto &itr : *(_server->table())) {
+    auto table = itr.second;
+    auto *accessor = table->value_accesor();
+    std::string stat_name = "ps_server.table" + std::to_string(itr.first);
+    auto pull_batcher = std::make_shared<SparseRequestBatcher>(
+        accessor->select_size() / sizeof(float), FLAGS_pserver_batch_window_us,
+        FLAGS_pserver_batch_max_keys, stat_name + ".pull_batcher");
+    pull_batcher->set_pull_func(
+        [table](float *values, const uint64_t *keys, size_t num) {
+          return table->pull_sparse(values, keys, num);
+        });
+    _pull_batchers[itr.first] = pull_batcher;
+
+    auto push_batcher = std::make_shared<SparseRequestBatcher>(
+        accessor->update_size() / sizeof(float), FLAGS_pserver_batch_window_us,
+        FLAGS_pserver_batch_max_keys, stat_name + ".push_batcher");
+    push_batcher->set_push_func(
+        [table](const uint64_t *keys, const float *values, size_t num) {
+          return table->push_sparse(keys, values, num);
+        });
+    push_batcher->set_merge_push(unmerged_push_tables.count(itr.first) == 0);
+    _push_batchers[itr.first] = push_batcher;
+  }
+  return 0;
+}
+
+void PsService::print_batcher_stat() {
+  for (auto &itr : _pull_batchers) {
+    LOG(INFO) << "table " << itr.first
+              << " pull_sparse batcher: " << itr.second->StatString();
+  }
+  for (auto &itr : _push_batchers) {
+    LOG(INFO) << "table " << itr.first
+              << " push_sparse batcher: " << itr.second->StatString();
+  }
+}
+
 void PsService::service(google::protobuf::RpcController *cntl_base,
                         const PsRequestMessage *request,
                         PsResponseMessage *response,
@@ -236,6 +302,29 @@ int32_t PsService::push_dense(Table *table, const PsRequestMessage &request,
   uint32_t num = *(const uint32_t *)(request.data().data());
   const float *values =
       (const float *)(request.data().data() + sizeof(uint32_t));
+  /*
+  Encoded Push Content, params(0) is the codec type:
+  |--num--|---encodedValues---|
+  |--4B---|-------------------|
+  */
+  thread_local std::vector<float> decoded;
+  if (request.params_size() > 0) {
+    const GradCodec *codec = nullptr;
+    if (GradCodecFromParam(request.params(0), &codec) != 0) {
+      set_response_code(response, -1, "push_dense with an unknown codec");
+      return 0;
+    }
+    if (codec != nullptr) {
+      decoded.resize(num);
+      if (codec->Decode(request.data().data() + sizeof(uint32_t),
+                        req_buffer_size - sizeof(uint32_t), decoded.data(),
+                        num) != 0) {
+        set_response_code(response, -1, "push_dense decode failed");
+        return 0;
+      }
+      values = decoded.data();
+    }
+  }
   if (table->push_dense(values, num) != 0) {
     set_response_code(response, -1, "push_dense failed");
   }
@@ -346,7 +435,12 @@ int32_t PsService::pull_sparse(Table *table, const PsRequestMessage &request,
   const uint64_t *keys = (const uint64_t *)data;
   std::vector<float> res_data;
   res_data.resize(num * table->value_accesor()->select_size() / sizeof(float));
-  table->pull_sparse(res_data.data(), keys, num);
+  auto batcher = _pull_batchers.find(request.table_id());
+  if (batcher != _pull_batchers.end()) {
+    batcher->second->Pull(keys, num, res_data.data());
+  } else {
+    table->pull_sparse(res_data.data(), keys, num);
+  }
   cntl->response_attachment().append((char *)res_data.data(),
                                      res_data.size() * sizeof(float));
   return 0;
@@ -374,10 +468,52 @@ int32_t PsService::push_sparse(Table *table, const PsRequestMessage &request,
   |---keysData---|---valuesData---|
   |---8*{num}B---|----------------|
   */
+  size_t keys_size = sizeof(uint64_t) * num;
+  if (push_data.size() < keys_size) {
+    set_response_code(response, -1, "push_sparse data is shorter than keys");
+    return 0;
+  }
+  size_t update_numel =
+      static_cast<size_t>(num) * table->value_accesor()->update_size() /
+      sizeof(float);
   const uint64_t *keys = (const uint64_t *)push_data.data();
-  const float *values =
-      (const float *)(push_data.data() + sizeof(uint64_t) * num);
-  if (table->push_sparse(keys, values, num) != 0) {
+  const float *values = (const float *)(push_data.data() + keys_size);
+  size_t values_size = push_data.size() - keys_size;
+  // params(1) is the codec type of encoded values
+  thread_local std::vector<float> decoded;
+  const GradCodec *codec = nullptr;
+  if (request.params_size() > 1 &&
+      GradCodecFromParam(request.params(1), &codec) != 0) {
+    set_response_code(response, -1, "push_sparse with an unknown codec");
+    return 0;
+  }
+  if (codec == nullptr) {
+    if (values_size != update_numel * sizeof(float)) {
+      set_response_code(response, -1,
+                        "push_sparse values size mismatches num * update_dim");
+      return 0;
+    }
+  } else {
+    const char *encoded = push_data.data() + keys_size;
+    size_t numel = GradCodec::DecodedNumel(encoded, values_size);
+    if (numel != update_numel) {
+      set_response_code(
+          response, -1,
+          "push_sparse decoded values size mismatches num * update_dim");
+      return 0;
+    }
+    decoded.resize(numel);
+    if (codec->Decode(encoded, values_size, decoded.data(), numel) != 0) {
+      set_response_code(response, -1, "push_sparse decode failed");
+      return 0;
+    }
+    values = decoded.data();
+  }
+  auto batcher = _push_batchers.find(request.table_id());
+  int32_t ret = batcher != _push_batchers.end()
+                    ? batcher->second->Push(keys, values, num)
+                    : table->push_sparse(keys, values, num);
+  if (ret != 0) {
     set_response_code(response, -1, "push_sparse error");
   }
   return 0;
@@ -502,6 +638,7 @@ int32_t PsService::clear_all_table(Table *table,
 int32_t PsService::stop_server(Table *table, const PsRequestMessage &request,
                                PsResponseMessage &response,
                                brpc::Controller *cntl) {
+  print_batcher_stat();
   auto *p_server = _server;
   std::thread t_stop([p_server]() {
     p_server->stop();
@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <vector>
+#include "paddle/fluid/distributed/service/request_batcher.h"
 #include "paddle/fluid/distributed/service/server.h"
 
 namespace paddle {
@@ -69,6 +70,8 @@ class PsService : public PsBaseService {
 
  private:
   int32_t initialize_shard_info();
+  int32_t initialize_batcher();
+  void print_batcher_stat();
   int32_t pull_dense(Table *table, const PsRequestMessage &request,
                      PsResponseMessage &response, brpc::Controller *cntl);
   int32_t push_dense(Table *table, const PsRequestMessage &request,
@@ -115,6 +118,11 @@ class PsService : public PsBaseService {
   std::unordered_map<int32_t, serviceHandlerFunc> _service_handler_map;
   std::unordered_map<int32_t, serviceHandlerFunc> _msg_handler_map;
   std::vector<float> _ori_values;
+  // request batchers of sparse tables, only with pserver_batch_sparse_requests
+  std::unordered_map<uint32_t, std::shared_ptr<SparseRequestBatcher>>
+      _pull_batchers;
+  std::unordered_map<uint32_t, std::shared_ptr<SparseRequestBatcher>>
+      _push_batchers;
 };
 
 class DownpourPServerBrpcClosure : public PServerClosure {
@@ -14,6 +14,7 @@ limitations under the License. */
 
 #include "paddle/fluid/distributed/service/communicator.h"
 #include <google/protobuf/text_format.h>
+#include "paddle/fluid/distributed/service/grad_codec.h"
 #include "paddle/fluid/distributed/table/table.h"
 
 #include <gflags/gflags.h>
@@ -21,6 +22,7 @@ limitations under the License. */
 
 #include <algorithm>
 #include <chrono>  // NOLINT
+#include <cmath>
 #include <map>
 #include <thread>  // NOLINT
 #include <unordered_set>
@@ -34,6 +36,9 @@ limitations under the License. */
 #include "paddle/fluid/string/printf.h"
 #include "paddle/fluid/string/split.h"
 
+DECLARE_string(pserver_dense_grad_codec);
+DECLARE_double(pserver_grad_topk_ratio);
+
 namespace paddle {
 namespace distributed {
 
@@ -95,6 +100,8 @@ void Communicator::InitBrpcClient(
   if (_worker_ptr.get() == nullptr) {
     google::protobuf::TextFormat::ParseFromString(dist_desc, &_ps_param);
     init_gflag(_ps_param.init_gflags());
+    dense_topk_ = GradCodecFromString(FLAGS_pserver_dense_grad_codec) ==
+                  kGradCodecTopK;
     servers_ = host_sign_list.size();
     _ps_env = paddle::distributed::PaddlePSEnvironment();
     _ps_env.set_ps_servers(&host_sign_list, servers_);
@@ -207,6 +214,8 @@ void Communicator::RpcSendDense(const CommContext &ctx, const Scope &scope) {
                      request_call_num);  // accessor->update_dim() = 1
   float *data = dense_data->data();
   uint32_t pos = 0;
+  std::vector<size_t> numels;
+  numels.reserve(var_names.size());
   for (size_t i = 0; i < var_names.size(); ++i) {
     const LoDTensor tensor = scope.FindVar(var_names[i])->Get<LoDTensor>();
     size_t count = static_cast<size_t>(tensor.numel());
@@ -215,9 +224,17 @@ void Communicator::RpcSendDense(const CommContext &ctx, const Scope &scope) {
         << "invalid dense size, cur pos[" << pos << "]"
         << " data_num[" << count << "] size[" << dense_data->size() << "]";
     memcpy(data + pos, g, count * sizeof(float));
+    numels.push_back(count);
     pos += count;
   }
+  TopKSparsifyDense(var_names, numels, data);
+  RpcPushDenseData(table_id, dense_data.get());
+  return;
+}
 
+void Communicator::RpcPushDenseData(int table_id,
+                                    std::vector<float> *dense_data) {
+  size_t request_call_num = _worker_ptr->get_server_nums();
   ++_async_call_num;
   DownpourBrpcClosure *closure = new DownpourBrpcClosure(
       request_call_num, [this, request_call_num](void *done) {
@@ -233,9 +250,35 @@ void Communicator::RpcSendDense(const CommContext &ctx, const Scope &scope) {
         --_async_call_num;
       });
   auto status = _worker_ptr->push_dense_raw_gradient(
-      table_id, data, dense_data->size(), closure);
+      table_id, dense_data->data(), dense_data->size(), closure);
   status.wait();
-  return;
+}
+
+void Communicator::TopKSparsifyDense(const std::vector<std::string> &var_names,
+                                     const std::vector<size_t> &numels,
+                                     float *data) {
+  // the topk codec only sends the largest values of every var, the rest is
+  // kept as a per-var residual and added to the next send
+  if (!dense_topk_) {
+    return;
+  }
+  double topk_ratio = FLAGS_pserver_grad_topk_ratio;
+  size_t pos = 0;
+  for (size_t i = 0; i < var_names.size(); ++i) {
+    size_t count = numels[i];
+    TopKSparsify(data + pos, TopKResidual(var_names[i], count), count,
+                 std::max<size_t>(1, std::ceil(count * topk_ratio)));
+    pos += count;
+  }
+}
+
+float *Communicator::TopKResidual(const std::string &var_name, size_t numel) {
+  std::lock_guard<std::mutex> lock(topk_residual_mutex_);
+  auto &residual = topk_residuals_[var_name];
+  if (residual.size() != numel) {
+    residual.assign(numel, 0.0f);
+  }
+  return residual.data();
 }
 
 void Communicator::RpcSendSparseParam(const std::string &varname, int table_id,
@@ -431,9 +474,14 @@ void AsyncCommunicator::SendByCommunicator() {
   tasks.reserve(send_varname_to_ctx_.size());
 
   for (auto &iter : send_varname_to_ctx_) {
+    auto &ctx_name = iter.first;
     auto &ctx = iter.second;
 
-    auto send_recv_task = [this, &ctx] {
+    auto send_recv_task = [this, &ctx_name, &ctx] {
+      if (fused_queues_.count(ctx_name)) {
+        SendFusedDense(ctx_name, ctx);
+        return;
+      }
       auto &varnames = ctx.origin_varnames;
       auto &table_id = ctx.table_id;
       size_t var_nums = varnames.size();
@@ -494,6 +542,50 @@ void AsyncCommunicator::SendByCommunicator() {
   return;
 }
 
+void AsyncCommunicator::SendFusedDense(const std::string &ctx_name,
+                                       const CommContext &ctx) {
+  auto &queue = fused_queues_.at(ctx_name);
+  std::vector<std::shared_ptr<std::vector<float>>> buffers;
+  int wait_times = 0;
+  while (static_cast<int>(buffers.size()) < max_merge_var_num_) {
+    if (queue->Size() == 0) {
+      VLOG(4) << "wait_times -> " << wait_times;
+      if (wait_times >= send_wait_times_) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      wait_times++;
+      continue;
+    } else {
+      wait_times = 0;
+      buffers.push_back(queue->Pop());
+    }
+  }
+  if (buffers.empty()) return;
+
+  platform::RecordEvent record_event("Communicator->SendFusedDense");
+  auto &layout = fused_layouts_.at(ctx_name);
+  size_t request_call_num = _worker_ptr->get_server_nums();
+  uint32_t num_per_shard =
+      dense_dim_per_shard(ctx.height_sections[0], request_call_num);
+  std::vector<float> dense_data(num_per_shard * request_call_num, 0.0f);
+  CHECK(layout.total <= dense_data.size())
+      << "invalid fused dense size " << layout.total << ", table size "
+      << dense_data.size();
+  MergeDenseBuffers(buffers, layout.total, dense_data.data());
+  TopKSparsifyDense(layout.varnames, layout.numels, dense_data.data());
+  RpcPushDenseData(ctx.table_id, &dense_data);
+
+  if (!independent_recv_ &&
+      recv_varname_to_ctx_.find(ctx.table_id) != recv_varname_to_ctx_.end()) {
+    auto recv_varnames = recv_varname_to_ctx_.at(ctx.table_id);
+    RpcRecvDense(recv_varnames, ctx.table_id, recv_scope_);
+  }
+  if (independent_recv_) {
+    grad_num_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
 void AsyncCommunicator::MainThread() {
   VLOG(3) << "AsyncCommunicator MainThread start and wait";
 
@@ -538,6 +630,32 @@ void AsyncCommunicator::InitImpl(const RpcCtxMap &send_varname_to_ctx,
   for (auto &iter : send_varname_to_ctx_) {
     auto &ctx = iter.second;
     auto &varnames = ctx.origin_varnames;
+    if (fuse_dense_ && !ctx.is_sparse &&
+        recv_varname_to_ctx_.count(ctx.table_id)) {
+      // grads are laid out like the params pulled from the same table
+      auto &params = recv_varname_to_ctx_.at(ctx.table_id);
+      PADDLE_ENFORCE_EQ(
+          params.size(), varnames.size(),
+          platform::errors::InvalidArgument(
+              "dense table %d has %d params but %d grads", ctx.table_id,
+              params.size(), varnames.size()));
+      auto &layout = fused_layouts_[iter.first];
+      for (size_t i = 0; i < varnames.size(); ++i) {
+        auto *param = recv_scope_->FindVar(params[i]);
+        PADDLE_ENFORCE_NOT_NULL(
+            param, platform::errors::NotFound("param %s is not found",
+                                              params[i]));
+        layout.Add(varnames[i], param->Get<LoDTensor>().numel());
+        fused_varname_to_ctx_[varnames[i]] = iter.first;
+      }
+      fused_stages_[iter.first].reset(new FusedDenseStage(&layout));
+      fused_queues_[iter.first] = std::make_shared<
+          BlockingQueue<std::shared_ptr<std::vector<float>>>>(
+          send_queue_size_);
+      VLOG(1) << "fuse " << varnames.size() << " dense grads of table "
+              << ctx.table_id << " into " << layout.total << " values";
+      continue;
+    }
     for (auto &var_name : varnames) {
       send_varname_to_queue_[var_name] =
           std::make_shared<BlockingQueue<std::shared_ptr<Variable>>>(
@@ -617,6 +735,22 @@ void AsyncCommunicator::Send(const std::vector<std::string> &var_names,
   waiting_ = false;
   for (size_t i = 0; i < var_names.size(); i++) {
     auto *var = scope.FindVar(var_names[i]);
+    auto fused = fused_varname_to_ctx_.find(var_names[i]);
+    if (fused != fused_varname_to_ctx_.end()) {
+      auto &tensor = var->Get<LoDTensor>();
+      const float *data = tensor.data<float>();
+      LoDTensor cpu_tensor;
+      if (!platform::is_cpu_place(tensor.place())) {
+        framework::TensorCopySync(tensor, platform::CPUPlace(), &cpu_tensor);
+        data = cpu_tensor.data<float>();
+      }
+      auto buffer = fused_stages_.at(fused->second)
+                        ->Fill(var_names[i], data, tensor.numel());
+      if (buffer != nullptr) {
+        fused_queues_.at(fused->second)->Push(std::move(buffer));
+      }
+      continue;
+    }
     auto tmp_grad_var = std::make_shared<Variable>();
     framework::CopyVariable(*var, tmp_grad_var.get());
     send_varname_to_queue_[var_names[i]]->Push(tmp_grad_var);
@@ -20,6 +20,7 @@ limitations under the License. */
 #include <deque>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <numeric>
 #include <set>
 #include <string>
@@ -43,6 +44,7 @@ limitations under the License. */
 
 #include "paddle/fluid/distributed/ps.pb.h"
 #include "paddle/fluid/distributed/service/brpc_ps_client.h"
+#include "paddle/fluid/distributed/service/fused_dense.h"
 #include "paddle/fluid/distributed/service/ps_client.h"
 
 DECLARE_bool(communicator_is_sgd_optimizer);
@@ -321,6 +323,21 @@ class Communicator {
   }
 
   void init_gflag(const std::string &gflags);
+
+  // push a flat buffer holding all dense grads of a table
+  void RpcPushDenseData(int table_id, std::vector<float> *dense_data);
+
+  // error feedback residual of a dense var sent with the topk codec
+  float *TopKResidual(const std::string &var_name, size_t numel);
+  void TopKSparsifyDense(const std::vector<std::string> &var_names,
+                         const std::vector<size_t> &numels, float *data);
+
+  // whether dense grads are sent with the topk codec, resolved once when
+  // the client is created
+  bool dense_topk_ = false;
+  std::mutex topk_residual_mutex_;
+  std::unordered_map<std::string, std::vector<float>> topk_residuals_;
+
   paddle::distributed::PSParameter _ps_param;
   paddle::distributed::PaddlePSEnvironment _ps_env;
   int servers_ = 0;
@@ -355,6 +372,10 @@ class AsyncCommunicator : public Communicator {
     send_queue_size_ = std::stoi(envs.at("communicator_send_queue_size"));
     need_global_step_ =
         static_cast<bool>(std::stoi(envs.at("need_global_step")));
+    if (envs.count("communicator_fuse_dense_grads")) {
+      fuse_dense_ = static_cast<bool>(
+          std::stoi(envs.at("communicator_fuse_dense_grads")));
+    }
   }
 
   void Start() override;
@@ -376,6 +397,9 @@ class AsyncCommunicator : public Communicator {
 
   virtual void SendByCommunicator();
 
+  // merge and send the queued flat buffers of a fused dense table
+  void SendFusedDense(const std::string &ctx_name, const CommContext &ctx);
+
   virtual void SendGlobalStep(int batches) {}
 
   virtual void RecvByCommunicator();
@@ -405,6 +429,18 @@ class AsyncCommunicator : public Communicator {
   bool independent_recv_ = true;
   int parallel_task_nums_ = 0;
 
+  // all dense grads of a table are staged in one flat buffer and sent as a
+  // single message, instead of one queue, merge and copy per var
+  bool fuse_dense_ = false;
+  std::unordered_map<std::string, FusedDenseLayout> fused_layouts_;
+  std::unordered_map<std::string, std::string> fused_varname_to_ctx_;
+  std::unordered_map<std::string, std::unique_ptr<FusedDenseStage>>
+      fused_stages_;
+  std::unordered_map<
+      std::string,
+      std::shared_ptr<BlockingQueue<std::shared_ptr<std::vector<float>>>>>
+      fused_queues_;
+
   std::unique_ptr<std::thread> main_thread_{nullptr};
   std::unique_ptr<std::thread> recv_thread_{nullptr};
 
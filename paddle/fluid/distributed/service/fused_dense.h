@@ -0,0 +1,132 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace distributed {
+
+// Layout of all dense grads of one table in a single flat buffer. Vars are
+// laid out in the order the dense table stores them, the same order
+// RpcSendDense concatenates them in.
+struct FusedDenseLayout {
+  std::vector<std::string> varnames;
+  std::vector<size_t> offsets;
+  std::vector<size_t> numels;
+  std::unordered_map<std::string, size_t> index;
+  size_t total = 0;
+
+  void Add(const std::string &varname, size_t numel) {
+    index[varname] = varnames.size();
+    varnames.push_back(varname);
+    offsets.push_back(total);
+    numels.push_back(numel);
+    total += numel;
+  }
+};
+
+// Collects the grads of one step into a flat buffer. A buffer is complete
+// once every var of the layout was filled; a var sent twice before that
+// closes the current buffer early, the missing vars stay zero.
+class FusedDenseStage {
+ public:
+  explicit FusedDenseStage(const FusedDenseLayout *layout) : layout_(layout) {
+    Reset();
+  }
+
+  // returns the finished buffer, or nullptr while vars are missing
+  std::shared_ptr<std::vector<float>> Fill(const std::string &varname,
+                                           const float *data, size_t numel) {
+    auto it = layout_->index.find(varname);
+    PADDLE_ENFORCE_NE(it, layout_->index.end(),
+                      platform::errors::NotFound(
+                          "var %s is not in the fused dense layout", varname));
+    auto idx = it->second;
+    PADDLE_ENFORCE_EQ(numel, layout_->numels[idx],
+                      platform::errors::InvalidArgument(
+                          "var %s has %d values, the fused layout expects %d",
+                          varname, numel, layout_->numels[idx]));
+
+    std::shared_ptr<std::vector<float>> finished = nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (filled_[idx]) {
+      finished = buffer_;
+      Reset();
+    }
+    memcpy(buffer_->data() + layout_->offsets[idx], data,
+           numel * sizeof(float));
+    filled_[idx] = true;
+    if (++filled_num_ == filled_.size()) {
+      finished = buffer_;
+      Reset();
+    }
+    return finished;
+  }
+
+ private:
+  void Reset() {
+    buffer_ = std::make_shared<std::vector<float>>(layout_->total, 0.0f);
+    filled_.assign(layout_->varnames.size(), false);
+    filled_num_ = 0;
+  }
+
+  const FusedDenseLayout *layout_;
+  std::mutex mutex_;
+  std::shared_ptr<std::vector<float>> buffer_;
+  std::vector<bool> filled_;
+  size_t filled_num_;
+};
+
+// Sums `buffers` into `out` in one cache-blocked pass, instead of a zero
+// fill and a separate sum pass per var.
+template <typename T>
+void MergeDenseBuffers(
+    const std::vector<std::shared_ptr<std::vector<T>>> &buffers, size_t numel,
+    T *out, bool merge_add = true) {
+  PADDLE_ENFORCE_NE(
+      buffers.empty(), true,
+      platform::errors::InvalidArgument("dense buffers to merge are empty."));
+  constexpr size_t kBlock = 4096;
+  T scale = merge_add ? 1 : static_cast<T>(1) / buffers.size();
+  for (size_t begin = 0; begin < numel; begin += kBlock) {
+    size_t len = std::min(kBlock, numel - begin);
+    T *dst = out + begin;
+    const T *src0 = buffers[0]->data() + begin;
+    std::copy(src0, src0 + len, dst);
+    for (size_t b = 1; b < buffers.size(); ++b) {
+      const T *src = buffers[b]->data() + begin;
+      for (size_t i = 0; i < len; ++i) {
+        dst[i] += src[i];
+      }
+    }
+    if (!merge_add) {
+      for (size_t i = 0; i < len; ++i) {
+        dst[i] *= scale;
+      }
+    }
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
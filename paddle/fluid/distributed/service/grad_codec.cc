@@ -0,0 +1,281 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/service/grad_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "paddle/fluid/platform/bfloat16.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/float16.h"
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+inline char* AppendHeader(std::string* out, size_t numel, size_t payload) {
+  uint32_t n = static_cast<uint32_t>(numel);
+  out->resize(sizeof(uint32_t) + payload);
+  char* ptr = const_cast<char*>(out->data());
+  memcpy(ptr, &n, sizeof(uint32_t));
+  return ptr + sizeof(uint32_t);
+}
+
+template <typename HalfT>
+class HalfCodec : public GradCodec {
+ public:
+  explicit HalfCodec(GradCodecType type) : type_(type) {}
+
+  GradCodecType type() const override { return type_; }
+
+  void Encode(const float* src, size_t numel, size_t group,
+              std::string* out) const override {
+    auto* dst =
+        reinterpret_cast<HalfT*>(AppendHeader(out, numel, numel * 2));
+    for (size_t i = 0; i < numel; ++i) {
+      dst[i] = HalfT(src[i]);
+    }
+  }
+
+  int32_t Decode(const char* data, size_t size, float* dst,
+                 size_t numel) const override {
+    if (DecodedNumel(data, size) != numel ||
+        size != sizeof(uint32_t) + numel * 2) {
+      return -1;
+    }
+    auto* src = reinterpret_cast<const HalfT*>(data + sizeof(uint32_t));
+    for (size_t i = 0; i < numel; ++i) {
+      dst[i] = static_cast<float>(src[i]);
+    }
+    return 0;
+  }
+
+ private:
+  GradCodecType type_;
+};
+
+class Int8Codec : public GradCodec {
+ public:
+  GradCodecType type() const override { return kGradCodecInt8; }
+
+  void Encode(const float* src, size_t numel, size_t group,
+              std::string* out) const override {
+    PADDLE_ENFORCE_GT(group, 0, platform::errors::InvalidArgument(
+                                    "int8 quantization group must be > 0"));
+    size_t groups = (numel + group - 1) / group;
+    char* ptr = AppendHeader(
+        out, numel, sizeof(uint32_t) + groups * sizeof(float) + numel);
+    uint32_t g = static_cast<uint32_t>(group);
+    memcpy(ptr, &g, sizeof(uint32_t));
+    ptr += sizeof(uint32_t);
+    for (size_t begin = 0; begin < numel; begin += group) {
+      size_t len = std::min(group, numel - begin);
+      float max_abs = 0;
+      for (size_t i = 0; i < len; ++i) {
+        max_abs = std::max(max_abs, std::fabs(src[begin + i]));
+      }
+      float scale = max_abs / 127.0f;
+      memcpy(ptr, &scale, sizeof(float));
+      ptr += sizeof(float);
+      auto* q = reinterpret_cast<int8_t*>(ptr);
+      float inv = scale > 0 ? 1.0f / scale : 0.0f;
+      for (size_t i = 0; i < len; ++i) {
+        q[i] = static_cast<int8_t>(std::lround(src[begin + i] * inv));
+      }
+      ptr += len;
+    }
+  }
+
+  int32_t Decode(const char* data, size_t size, float* dst,
+                 size_t numel) const override {
+    if (DecodedNumel(data, size) != numel ||
+        size < 2 * sizeof(uint32_t)) {
+      return -1;
+    }
+    const char* ptr = data + sizeof(uint32_t);
+    uint32_t group = *reinterpret_cast<const uint32_t*>(ptr);
+    ptr += sizeof(uint32_t);
+    if (group == 0) {
+      return -1;
+    }
+    size_t groups = (numel + group - 1) / group;
+    if (size != 2 * sizeof(uint32_t) + groups * sizeof(float) + numel) {
+      return -1;
+    }
+    for (size_t begin = 0; begin < numel; begin += group) {
+      size_t len = std::min<size_t>(group, numel - begin);
+      float scale = 0;
+      memcpy(&scale, ptr, sizeof(float));
+      ptr += sizeof(float);
+      auto* q = reinterpret_cast<const int8_t*>(ptr);
+      for (size_t i = 0; i < len; ++i) {
+        dst[begin + i] = q[i] * scale;
+      }
+      ptr += len;
+    }
+    return 0;
+  }
+};
+
+// sends the non-zero entries left by TopKSparsify as index/value pairs
+class TopKCodec : public GradCodec {
+ public:
+  GradCodecType type() const override { return kGradCodecTopK; }
+
+  void Encode(const float* src, size_t numel, size_t group,
+              std::string* out) const override {
+    uint32_t nnz = 0;
+    for (size_t i = 0; i < numel; ++i) {
+      nnz += (src[i] != 0);
+    }
+    char* ptr = AppendHeader(out, numel,
+                             sizeof(uint32_t) + nnz * (sizeof(uint32_t) +
+                                                       sizeof(float)));
+    memcpy(ptr, &nnz, sizeof(uint32_t));
+    auto* index = reinterpret_cast<uint32_t*>(ptr + sizeof(uint32_t));
+    auto* value = reinterpret_cast<float*>(index + nnz);
+    for (size_t i = 0, j = 0; i < numel; ++i) {
+      if (src[i] != 0) {
+        index[j] = static_cast<uint32_t>(i);
+        value[j] = src[i];
+        ++j;
+      }
+    }
+  }
+
+  int32_t Decode(const char* data, size_t size, float* dst,
+                 size_t numel) const override {
+    if (DecodedNumel(data, size) != numel ||
+        size < 2 * sizeof(uint32_t)) {
+      return -1;
+    }
+    uint32_t nnz = *reinterpret_cast<const uint32_t*>(data + sizeof(uint32_t));
+    if (size !=
+        2 * sizeof(uint32_t) + nnz * (sizeof(uint32_t) + sizeof(float))) {
+      return -1;
+    }
+    auto* index =
+        reinterpret_cast<const uint32_t*>(data + 2 * sizeof(uint32_t));
+    auto* value = reinterpret_cast<const float*>(index + nnz);
+    std::fill(dst, dst + numel, 0.0f);
+    for (uint32_t j = 0; j < nnz; ++j) {
+      if (index[j] >= numel) {
+        return -1;
+      }
+      dst[index[j]] = value[j];
+    }
+    return 0;
+  }
+};
+
+}  // namespace
+
+size_t GradCodec::DecodedNumel(const char* data, size_t size) {
+  if (size < sizeof(uint32_t)) {
+    return 0;
+  }
+  return *reinterpret_cast<const uint32_t*>(data);
+}
+
+const GradCodec* GetGradCodec(GradCodecType type) {
+  static HalfCodec<platform::float16> fp16_codec(kGradCodecFP16);
+  static HalfCodec<platform::bfloat16> bf16_codec(kGradCodecBF16);
+  static TopKCodec topk_codec;
+  static Int8Codec int8_codec;
+  switch (type) {
+    case kGradCodecNone:
+      return nullptr;
+    case kGradCodecFP16:
+      return &fp16_codec;
+    case kGradCodecBF16:
+      return &bf16_codec;
+    case kGradCodecTopK:
+      return &topk_codec;
+    case kGradCodecInt8:
+      return &int8_codec;
+    default:
+      PADDLE_THROW(platform::errors::InvalidArgument(
+          "unknown gradient codec type %d", static_cast<int>(type)));
+  }
+}
+
+int32_t GradCodecFromParam(const std::string& param, const GradCodec** codec) {
+  if (param.size() != sizeof(uint32_t)) {
+    return -1;
+  }
+  uint32_t type = 0;
+  memcpy(&type, param.data(), sizeof(uint32_t));
+  if (type > kGradCodecInt8) {
+    return -1;
+  }
+  *codec = GetGradCodec(static_cast<GradCodecType>(type));
+  return 0;
+}
+
+GradCodecType GradCodecFromString(const std::string& name) {
+  if (name == "" || name == "none") {
+    return kGradCodecNone;
+  } else if (name == "fp16") {
+    return kGradCodecFP16;
+  } else if (name == "bf16") {
+    return kGradCodecBF16;
+  } else if (name == "topk") {
+    return kGradCodecTopK;
+  } else if (name == "int8") {
+    return kGradCodecInt8;
+  }
+  PADDLE_THROW(platform::errors::InvalidArgument(
+      "gradient codec %s is not supported, expect one of "
+      "none/fp16/bf16/topk/int8",
+      name));
+}
+
+void TopKSparsify(float* grad, float* residual, size_t numel, size_t k) {
+  for (size_t i = 0; i < numel; ++i) {
+    grad[i] += residual[i];
+  }
+  if (k >= numel) {
+    std::fill(residual, residual + numel, 0.0f);
+    return;
+  }
+  std::vector<float> magnitude(grad, grad + numel);
+  for (auto& m : magnitude) {
+    m = std::fabs(m);
+  }
+  std::nth_element(magnitude.begin(), magnitude.begin() + (numel - k),
+                   magnitude.end());
+  float threshold = magnitude[numel - k];
+  // values tied with the threshold fill whatever is left of k
+  size_t ties = k;
+  for (size_t i = 0; i < numel; ++i) {
+    ties -= (std::fabs(grad[i]) > threshold);
+  }
+  for (size_t i = 0; i < numel; ++i) {
+    float m = std::fabs(grad[i]);
+    if (m > threshold || (m == threshold && m != 0 && ties > 0)) {
+      ties -= (m == threshold);
+      residual[i] = 0;
+    } else {
+      residual[i] = grad[i];
+      grad[i] = 0;
+    }
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,83 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+namespace paddle {
+namespace distributed {
+
+// Codecs used to shrink gradients on the worker -> pserver push path.
+// The codec id travels with the request, so servers decode whatever the
+// client chose. kGradCodecNone keeps the original raw fp32 layout.
+enum GradCodecType : uint32_t {
+  kGradCodecNone = 0,
+  kGradCodecFP16 = 1,
+  kGradCodecBF16 = 2,
+  kGradCodecTopK = 3,
+  kGradCodecInt8 = 4,
+};
+
+// dense gradients are quantized by int8 in groups of this many values
+constexpr size_t kDenseQuantGroup = 128;
+
+/*
+Encoded Content (every codec except kGradCodecNone):
+|--numel--|---payload---|
+|---4B----|-------------|
+
+fp16/bf16: numel * 2B
+int8:      |--group--| and per group |--scale(4B)--|--group * 1B--|
+topk:      |--nnz--|--index(nnz * 4B)--|--value(nnz * 4B)--|
+*/
+class GradCodec {
+ public:
+  virtual ~GradCodec() {}
+
+  virtual GradCodecType type() const = 0;
+
+  // encode `numel` floats, `group` is the row width of sparse values and
+  // the quantization group of dense values
+  virtual void Encode(const float* src, size_t numel, size_t group,
+                      std::string* out) const = 0;
+
+  // decode into `dst` holding `numel` floats, return 0 on success
+  virtual int32_t Decode(const char* data, size_t size, float* dst,
+                         size_t numel) const = 0;
+
+  // numel recorded in an encoded buffer, 0 if the buffer is too short
+  static size_t DecodedNumel(const char* data, size_t size);
+};
+
+// returns a shared stateless codec, nullptr for kGradCodecNone
+const GradCodec* GetGradCodec(GradCodecType type);
+
+// Servers read the codec id of a request param with this instead of
+// GetGradCodec: it returns -1, rather than throwing, if the param is not a
+// 4 byte id of a known codec, e.g. from a newer client. `codec` receives
+// nullptr for kGradCodecNone.
+int32_t GradCodecFromParam(const std::string& param, const GradCodec** codec);
+
+// "none", "fp16", "bf16", "topk" or "int8"
+GradCodecType GradCodecFromString(const std::string& name);
+
+// Keeps the k largest magnitudes of `grad + residual` in `grad` and zeroes
+// the rest. What is not sent is accumulated into `residual` (error feedback),
+// so it is sent by a later step instead of being lost.
+void TopKSparsify(float* grad, float* residual, size_t numel, size_t k);
+
+}  // namespace distributed
+}  // namespace paddle
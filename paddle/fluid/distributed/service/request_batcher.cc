@@ -0,0 +1,168 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/service/request_batcher.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+namespace paddle {
+namespace distributed {
+
+SparseRequestBatcher::SparseRequestBatcher(size_t value_dim,
+                                           int64_t window_us,
+                                           size_t max_keys,
+                                           const std::string& stat_name)
+    : value_dim_(value_dim),
+      window_us_(window_us),
+      max_keys_(max_keys),
+      latency_us_(STAT_HISTOGRAM(stat_name + ".us")),
+      batch_requests_(STAT_HISTOGRAM(stat_name + ".requests")),
+      batch_keys_(STAT_HISTOGRAM(stat_name + ".keys")) {}
+
+int32_t SparseRequestBatcher::Pull(const uint64_t* keys, size_t num,
+                                   float* values) {
+  return Submit(keys, nullptr, num, values, true);
+}
+
+int32_t SparseRequestBatcher::Push(const uint64_t* keys, const float* values,
+                                   size_t num) {
+  return Submit(keys, values, num, nullptr, false);
+}
+
+int32_t SparseRequestBatcher::Submit(const uint64_t* keys, const float* values,
+                                     size_t num, float* outputs,
+                                     bool is_pull) {
+  auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<Batch> batch;
+  bool leader = false;
+  arriving_.fetch_add(1);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (open_batch_ == nullptr) {
+      open_batch_ = std::make_shared<Batch>();
+      leader = true;
+    }
+    batch = open_batch_;
+    batch->keys.insert(batch->keys.end(), keys, keys + num);
+    if (is_pull) {
+      batch->outputs.emplace_back(outputs, num);
+    } else {
+      batch->values.insert(batch->values.end(), values,
+                           values + num * value_dim_);
+    }
+    batch->requests++;
+    // under the lock, not to miss the notification below
+    bool idle = arriving_.fetch_sub(1) == 1 && close_when_idle_;
+
+    if (leader) {
+      full_cv_.wait_for(lock, std::chrono::microseconds(window_us_), [&] {
+        return batch->keys.size() >= max_keys_ ||
+               (close_when_idle_ && arriving_.load() == 0);
+      });
+      // later requests start a new batch
+      open_batch_ = nullptr;
+    } else if (batch->keys.size() >= max_keys_ || idle) {
+      full_cv_.notify_all();
+    }
+  }
+
+  if (leader) {
+    Execute(batch.get(), is_pull);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      batch->done = true;
+    }
+    batch->cv.notify_all();
+  } else {
+    std::unique_lock<std::mutex> lock(mutex_);
+    batch->cv.wait(lock, [&] { return batch->done; });
+  }
+
+  latency_us_->Observe(std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count());
+  return batch->ret;
+}
+
+void SparseRequestBatcher::Execute(Batch* batch, bool is_pull) {
+  batch_requests_->Observe(batch->requests);
+  batch_keys_->Observe(batch->keys.size());
+
+  if (!is_pull && !merge_push_) {
+    batch->ret = push_func_(batch->keys.data(), batch->values.data(),
+                            batch->keys.size());
+    return;
+  }
+
+  // dedup keys across requests, `slots[i]` is the unique slot of key i
+  auto& keys = batch->keys;
+  std::vector<uint64_t> unique_keys;
+  std::vector<uint32_t> slots(keys.size());
+  std::unordered_map<uint64_t, uint32_t> key_slot;
+  key_slot.reserve(keys.size());
+  unique_keys.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto it = key_slot.emplace(keys[i], unique_keys.size());
+    if (it.second) {
+      unique_keys.push_back(keys[i]);
+    }
+    slots[i] = it.first->second;
+  }
+
+  std::vector<float> unique_values(unique_keys.size() * value_dim_, 0.0f);
+  if (is_pull) {
+    batch->ret = pull_func_(unique_values.data(), unique_keys.data(),
+                            unique_keys.size());
+    size_t pos = 0;
+    for (auto& output : batch->outputs) {
+      for (size_t i = 0; i < output.second; ++i, ++pos) {
+        memcpy(output.first + i * value_dim_,
+               unique_values.data() + slots[pos] * value_dim_,
+               value_dim_ * sizeof(float));
+      }
+    }
+  } else {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      float* dst = unique_values.data() + slots[i] * value_dim_;
+      const float* src = batch->values.data() + i * value_dim_;
+      for (size_t d = 0; d < value_dim_; ++d) {
+        dst[d] += src[d];
+      }
+    }
+    batch->ret = push_func_(unique_keys.data(), unique_values.data(),
+                            unique_keys.size());
+  }
+}
+
+std::string SparseRequestBatcher::StatString() const {
+  auto latency = latency_us_->Snapshot();
+  auto requests = batch_requests_->Snapshot();
+  auto keys = batch_keys_->Snapshot();
+  std::stringstream ss;
+  ss << "requests: " << latency.count
+     << " latency_us p50: " << latency.Quantile(0.5)
+     << " p99: " << latency.Quantile(0.99) << " batches: " << requests.count
+     << " requests/batch p50: " << requests.Quantile(0.5)
+     << " p99: " << requests.Quantile(0.99)
+     << " keys/batch p50: " << keys.Quantile(0.5)
+     << " p99: " << keys.Quantile(0.99);
+  return ss.str();
+}
+
+}  // namespace distributed
+}  // namespace paddle
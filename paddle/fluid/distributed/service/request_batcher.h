@@ -0,0 +1,118 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/platform/monitor.h"
+
+namespace paddle {
+namespace distributed {
+
+// Coalesces concurrent pull_sparse or push_sparse requests of one table.
+//
+// The first request that finds no open batch becomes the leader: it waits
+// until no other request is on its way into the batch, `max_keys` keys are
+// queued or `window_us` passes, closes the batch, runs one table operation
+// over the deduplicated keys and writes the results straight into every
+// request's output. Other requests only append their keys and wait for the
+// leader. So a request alone is not delayed, and the batches grow with the
+// requests that contend for the batcher. With close_when_idle off, the
+// leader waits the full window for requests to come.
+//
+// The latency in microseconds, requests and keys of the batches are
+// observed in the stat histograms "<stat_name>.us", ".requests" and
+// ".keys".
+//
+// A push batch sums the gradients of a key pushed by several requests into
+// one row, unless merge_push is off: then it pushes the keys and gradients
+// of all the requests as they are, for tables that count every push of a
+// key, like the reservoir of a sync table or the recorder of a geo table.
+class SparseRequestBatcher {
+ public:
+  using PullFunc =
+      std::function<int32_t(float* values, const uint64_t* keys, size_t num)>;
+  using PushFunc = std::function<int32_t(const uint64_t* keys,
+                                         const float* values, size_t num)>;
+
+  SparseRequestBatcher(size_t value_dim, int64_t window_us, size_t max_keys,
+                       const std::string& stat_name);
+
+  void set_pull_func(PullFunc func) { pull_func_ = std::move(func); }
+  void set_push_func(PushFunc func) { push_func_ = std::move(func); }
+  void set_merge_push(bool merge_push) { merge_push_ = merge_push; }
+  void set_close_when_idle(bool close_when_idle) {
+    close_when_idle_ = close_when_idle;
+  }
+
+  // `values` receives num * value_dim floats
+  int32_t Pull(const uint64_t* keys, size_t num, float* values);
+
+  // gradients of keys pushed by several requests of a batch are summed if
+  // merge_push is on
+  int32_t Push(const uint64_t* keys, const float* values, size_t num);
+
+  platform::StatHistogram* latency_us() const { return latency_us_; }
+  platform::StatHistogram* batch_requests() const { return batch_requests_; }
+  platform::StatHistogram* batch_keys() const { return batch_keys_; }
+
+  // p50/p99 latency and batch sizes, for logging
+  std::string StatString() const;
+
+ private:
+  struct Batch {
+    std::vector<uint64_t> keys;
+    std::vector<float> values;
+    // output position of every request, pull only
+    std::vector<std::pair<float*, size_t>> outputs;
+    size_t requests = 0;
+    int32_t ret = 0;
+    bool done = false;
+    std::condition_variable cv;
+  };
+
+  int32_t Submit(const uint64_t* keys, const float* values, size_t num,
+                 float* outputs, bool is_pull);
+  void Execute(Batch* batch, bool is_pull);
+
+  const size_t value_dim_;
+  const int64_t window_us_;
+  const size_t max_keys_;
+  PullFunc pull_func_;
+  PushFunc push_func_;
+  bool merge_push_ = true;
+  bool close_when_idle_ = true;
+
+  std::mutex mutex_;
+  // Notified when the open batch is full or no request is arriving.
+  std::condition_variable full_cv_;
+  std::shared_ptr<Batch> open_batch_;
+  // Requests that entered Submit() but have not joined a batch yet.
+  std::atomic<int> arriving_{0};
+
+  platform::StatHistogram* latency_us_;
+  platform::StatHistogram* batch_requests_;
+  platform::StatHistogram* batch_keys_;
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -251,6 +251,11 @@ int32_t CommonSparseTable::initialize_value() {
     auto shard = std::make_shared<ValueBlock>(common, &initializers_);
     shard_values_.emplace_back(shard);
   }
+
+  pull_reservoir_.reserve(task_pool_size_);
+  for (int x = 0; x < task_pool_size_; ++x) {
+    pull_reservoir_.emplace_back(param_dim_);
+  }
   return 0;
 }
 
@@ -344,22 +349,27 @@ std::pair<int64_t, int64_t> CommonSparseTable::print_table_stat() {
 int32_t CommonSparseTable::pour() {
   rwlock_->RDLock();
 
-  std::vector<float> values;
-  std::vector<uint64_t> keys;
-
-  keys.reserve(pull_reservoir_.size());
-  values.reserve(pull_reservoir_.size() * param_dim_);
+  std::vector<std::future<int>> tasks(task_pool_size_);
 
-  for (auto& val : pull_reservoir_) {
-    keys.push_back(val.first);
-    auto& reservoir = val.second;
-    reservoir.avg();
-    std::copy(reservoir.values.begin(), reservoir.values.end(),
-              std::back_inserter(values));
+  for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+    tasks[shard_id] =
+        _shards_task_pool[shard_id]->enqueue([this, shard_id]() -> int {
+          auto& reservoir = pull_reservoir_[shard_id];
+          if (reservoir.size() == 0) {
+            return 0;
+          }
+          reservoir.avg();
+          optimizer_->update(reservoir.keys.data(), reservoir.values.data(),
+                             reservoir.size(), reservoir.offsets,
+                             shard_values_[shard_id].get());
+          reservoir.reset();
+          return 0;
+        });
   }
-  _push_sparse(keys.data(), values.data(), pull_reservoir_.size());
 
-  pull_reservoir_.clear();
+  for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
+    tasks[shard_id].wait();
+  }
   rwlock_->UNLock();
   return 0;
 }
@@ -442,22 +452,32 @@ int32_t CommonSparseTable::_push_sparse(const uint64_t* keys,
 int32_t CommonSparseTable::push_sparse(const uint64_t* keys,
                                        const float* values, size_t num) {
   if (sync) {
-    std::future<int> task =
-        _shards_task_pool[0]->enqueue([this, &keys, &values, num]() -> int {
-          for (int x = 0; x < num; ++x) {
-            auto id = keys[x];
-            auto has = pull_reservoir_.find(id);
-
-            if (has == pull_reservoir_.end()) {
-              pull_reservoir_[id] = ReservoirValue<float>(param_dim_);
+    rwlock_->RDLock();
+    std::vector<std::vector<uint64_t>> offset_bucket;
+    offset_bucket.resize(task_pool_size_);
+
+    for (int x = 0; x < num; ++x) {
+      auto y = keys[x] % task_pool_size_;
+      offset_bucket[y].push_back(x);
+    }
+
+    std::vector<std::future<int>> tasks(task_pool_size_);
+
+    for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+      tasks[shard_id] = _shards_task_pool[shard_id]->enqueue(
+          [this, shard_id, &keys, &values, &offset_bucket]() -> int {
+            auto& reservoir = pull_reservoir_[shard_id];
+            for (auto offset : offset_bucket[shard_id]) {
+              reservoir.add(keys[offset], values + offset * param_dim_);
             }
+            return 0;
+          });
+    }
 
-            auto& reservoir = pull_reservoir_[id];
-            reservoir.add(values + x * param_dim_, param_dim_);
-          }
-          return 0;
-        });
-    task.wait();
+    for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
+      tasks[shard_id].wait();
+    }
+    rwlock_->UNLock();
   } else {
     _push_sparse(keys, values, num);
   }
@@ -89,7 +89,7 @@ class CommonSparseTable : public SparseTable {
   std::shared_ptr<SparseOptimizer> optimizer_;
   std::unordered_map<std::string, Initializer*> initializers_;
   std::vector<std::shared_ptr<ValueBlock>> shard_values_;
-  std::unordered_map<uint64_t, ReservoirValue<float>> pull_reservoir_;
+  std::vector<ReservoirShard<float>> pull_reservoir_;
   std::unique_ptr<framework::RWLock> rwlock_{nullptr};
 };
 
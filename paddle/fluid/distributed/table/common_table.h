@@ -18,6 +18,8 @@
 #include <condition_variable>  // NOLINT
 #include <mutex>               // NOLINT
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "paddle/fluid/distributed/table/table.h"
 
@@ -65,6 +67,59 @@ struct ReservoirValue {
   }
 };
 
+// ReservoirShard accumulates the sparse gradients of one table shard between
+// two pours. Values of all keys live in one contiguous slab which keeps its
+// capacity across pours, so steady-state pushes do not allocate per key.
+template <typename T>
+struct ReservoirShard {
+  std::unordered_map<uint64_t, size_t> index;
+  std::vector<uint64_t> keys;
+  std::vector<uint64_t> offsets;
+  std::vector<uint32_t> counters;
+  std::vector<T> values;
+  uint32_t dim;
+
+  ReservoirShard() : dim(0) {}
+
+  explicit ReservoirShard(uint32_t dim) : dim(dim) {}
+
+  void add(uint64_t key, const T *value) {
+    size_t slot = 0;
+    auto it = index.find(key);
+    if (it == index.end()) {
+      slot = keys.size();
+      index.emplace(key, slot);
+      keys.push_back(key);
+      offsets.push_back(slot);
+      counters.push_back(0);
+      values.resize(keys.size() * dim, 0);
+    } else {
+      slot = it->second;
+    }
+    T *dst = values.data() + slot * dim;
+    GetBlas<T>().VADD(dim, dst, value, dst);
+    counters[slot]++;
+  }
+
+  size_t size() const { return keys.size(); }
+
+  void avg() {
+    auto blas = GetBlas<T>();
+    for (size_t slot = 0; slot < keys.size(); ++slot) {
+      auto scale = 1 / static_cast<T>(counters[slot]);
+      blas.SCAL(dim, scale, values.data() + slot * dim);
+    }
+  }
+
+  void reset() {
+    index.clear();
+    keys.clear();
+    offsets.clear();
+    counters.clear();
+    values.clear();
+  }
+};
+
 class SparseTable : public Table {
  public:
   SparseTable() {}
@@ -15,54 +15,45 @@
 #pragma once
 
 #include <ThreadPool.h>
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <future>  // NOLINT
 #include <memory>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "paddle/fluid/framework/rw_lock.h"
+
 namespace paddle {
 namespace distributed {
 
-class ConcurrentSet {
- public:
-  ConcurrentSet() : pool_(new ::ThreadPool(1)) {}
-  ~ConcurrentSet() {}
-
-  std::future<void> Update(const std::vector<uint64_t>& rows) {
-    auto task = [this, rows] {
-      for (auto row : rows) {
-        set_.insert(row);
-      }
-    };
-    return pool_->enqueue(std::move(task));
-  }
-
-  std::future<void> GetAndClear(std::vector<uint64_t>* result) {
-    auto task = [this, &result] {
-      result->clear();
-      for (auto& id : set_) {
-        result->push_back(id);
-      }
-      set_.clear();
-    };
-    return pool_->enqueue(std::move(task));
-  }
-
- private:
-  std::unordered_set<uint64_t> set_;
-  std::unique_ptr<::ThreadPool> pool_{nullptr};
-};
-
+// GeoRecorder tracks which rows every trainer has not pulled yet.
+//
+// Instead of keeping one set of dirty rows per trainer, every row remembers
+// the epoch in which it was last modified, and every trainer remembers the
+// epoch up to which it has pulled. A push costs one hash update per row no
+// matter how many trainers there are, and a pull is a parallel scan over the
+// shards that collects rows modified after the trainer's last pull.
+//
+// Rows are partitioned by `id % shard_num`, and each shard is only touched by
+// its own single-threaded task pool, the same way CommonSparseTable shards its
+// values. Rows already delivered to every trainer are dropped during scans,
+// so the recorder only holds rows that some trainer has not pulled yet.
 class GeoRecorder {
  public:
-  explicit GeoRecorder(int trainer_num) : trainer_num_(trainer_num) {
-    trainer_rows_.reserve(trainer_num);
+  explicit GeoRecorder(int trainer_num, int shard_num = 11)
+      : trainer_num_(trainer_num), shard_num_(shard_num) {
+    pulled_epochs_.reset(new std::atomic<uint64_t>[trainer_num]);
     for (auto i = 0; i < trainer_num; ++i) {
-      trainer_rows_.emplace_back(new ConcurrentSet());
+      pulled_epochs_[i].store(0);
+    }
+    shard_epochs_.resize(shard_num);
+    shards_task_pool_.resize(shard_num);
+    for (auto i = 0; i < shard_num; ++i) {
+      shards_task_pool_[i].reset(new ::ThreadPool(1));
     }
   }
 
@@ -70,10 +61,32 @@ class GeoRecorder {
 
   void Update(const std::vector<uint64_t>& update_rows) {
     VLOG(3) << " row size: " << update_rows.size();
+    if (update_rows.empty()) {
+      return;
+    }
+
+    std::vector<std::vector<uint64_t>> row_bucket(shard_num_);
+    for (auto row : update_rows) {
+      row_bucket[row % shard_num_].push_back(row);
+    }
+
+    // hold the epoch in read mode, so that a concurrent GetAndClear can not
+    // advance the epoch before all rows of this update are marked.
+    framework::AutoRDLock epoch_guard(&epoch_lock_);
+    uint64_t epoch = epoch_.load();
 
     std::vector<std::future<void>> fs;
-    for (auto& set : trainer_rows_) {
-      fs.push_back(set->Update(update_rows));
+    for (auto shard_id = 0; shard_id < shard_num_; ++shard_id) {
+      if (row_bucket[shard_id].empty()) {
+        continue;
+      }
+      fs.push_back(shards_task_pool_[shard_id]->enqueue(
+          [this, shard_id, epoch, &row_bucket] {
+            auto& epochs = shard_epochs_[shard_id];
+            for (auto row : row_bucket[shard_id]) {
+              epochs[row] = epoch;
+            }
+          }));
     }
     for (auto& f : fs) {
       f.wait();
@@ -82,12 +95,86 @@ class GeoRecorder {
 
   void GetAndClear(uint32_t trainer_id, std::vector<uint64_t>* result) {
     VLOG(3) << "GetAndClear for trainer: " << trainer_id;
-    trainer_rows_.at(trainer_id)->GetAndClear(result).wait();
+    PADDLE_ENFORCE_LT(trainer_id, static_cast<uint32_t>(trainer_num_),
+                      platform::errors::OutOfRange(
+                          "trainer_id %d is out of range, trainer_num is %d",
+                          trainer_id, trainer_num_));
+
+    // close the current epoch: every row marked with an epoch in
+    // (since, until] is visible to this trainer once the write lock is held.
+    uint64_t until = 0;
+    {
+      framework::AutoWRLock epoch_guard(&epoch_lock_);
+      until = epoch_.fetch_add(1);
+    }
+    uint64_t since = pulled_epochs_[trainer_id].load();
+
+    // rows whose epoch is not newer than every other trainer's pulled epoch
+    // are delivered to the last trainer by this call and can be dropped.
+    uint64_t delivered = until;
+    for (auto i = 0; i < trainer_num_; ++i) {
+      if (i != static_cast<int>(trainer_id)) {
+        delivered = std::min(delivered, pulled_epochs_[i].load());
+      }
+    }
+
+    std::vector<std::vector<uint64_t>> shard_rows(shard_num_);
+    std::vector<std::future<void>> fs;
+    for (auto shard_id = 0; shard_id < shard_num_; ++shard_id) {
+      fs.push_back(shards_task_pool_[shard_id]->enqueue(
+          [this, shard_id, since, until, delivered, &shard_rows] {
+            auto& epochs = shard_epochs_[shard_id];
+            auto& rows = shard_rows[shard_id];
+            for (auto it = epochs.begin(); it != epochs.end();) {
+              if (it->second > since && it->second <= until) {
+                rows.push_back(it->first);
+              }
+              if (it->second <= delivered) {
+                it = epochs.erase(it);
+              } else {
+                ++it;
+              }
+            }
+          }));
+    }
+    for (auto& f : fs) {
+      f.wait();
+    }
+    pulled_epochs_[trainer_id].store(until);
+
+    size_t total = 0;
+    for (auto& rows : shard_rows) {
+      total += rows.size();
+    }
+    result->clear();
+    result->reserve(total);
+    for (auto& rows : shard_rows) {
+      result->insert(result->end(), rows.begin(), rows.end());
+    }
+  }
+
+  // number of rows that are still waiting to be pulled by some trainer
+  size_t PendingSize() {
+    std::vector<std::future<size_t>> fs;
+    for (auto shard_id = 0; shard_id < shard_num_; ++shard_id) {
+      fs.push_back(shards_task_pool_[shard_id]->enqueue(
+          [this, shard_id] { return shard_epochs_[shard_id].size(); }));
+    }
+    size_t total = 0;
+    for (auto& f : fs) {
+      total += f.get();
+    }
+    return total;
   }
 
  private:
   const int trainer_num_;
-  std::vector<std::unique_ptr<ConcurrentSet>> trainer_rows_;
+  const int shard_num_;
+  std::atomic<uint64_t> epoch_{1};
+  framework::RWLock epoch_lock_;
+  std::unique_ptr<std::atomic<uint64_t>[]> pulled_epochs_;
+  std::vector<std::unordered_map<uint64_t, uint64_t>> shard_epochs_;
+  std::vector<std::shared_ptr<::ThreadPool>> shards_task_pool_;
 };
 
 }  // namespace distributed
@@ -0,0 +1,148 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/service/fused_dense.h"
+#include "paddle/fluid/framework/eigen.h"
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/operators/math/math_function.h"
+
+namespace paddle {
+namespace distributed {
+
+TEST(FusedDense, StageAndMerge) {
+  FusedDenseLayout layout;
+  layout.Add("a@GRAD", 3);
+  layout.Add("b@GRAD", 5);
+  ASSERT_EQ(layout.total, 8UL);
+
+  FusedDenseStage stage(&layout);
+  std::vector<float> a = {1, 2, 3};
+  std::vector<float> b = {4, 5, 6, 7, 8};
+  ASSERT_TRUE(stage.Fill("b@GRAD", b.data(), b.size()) == nullptr);
+  auto step0 = stage.Fill("a@GRAD", a.data(), a.size());
+  ASSERT_TRUE(step0 != nullptr);
+  ASSERT_EQ(*step0, std::vector<float>({1, 2, 3, 4, 5, 6, 7, 8}));
+
+  // a var sent twice closes the step, missing vars stay zero
+  ASSERT_TRUE(stage.Fill("a@GRAD", a.data(), a.size()) == nullptr);
+  auto step1 = stage.Fill("a@GRAD", a.data(), a.size());
+  ASSERT_TRUE(step1 != nullptr);
+  ASSERT_EQ(*step1, std::vector<float>({1, 2, 3, 0, 0, 0, 0, 0}));
+
+  std::vector<float> merged(layout.total);
+  MergeDenseBuffers<float>({step0, step1}, layout.total, merged.data());
+  ASSERT_EQ(merged, std::vector<float>({2, 4, 6, 4, 5, 6, 7, 8}));
+  MergeDenseBuffers<float>({step0, step1}, layout.total, merged.data(), false);
+  ASSERT_EQ(merged, std::vector<float>({1, 2, 3, 2, 2.5, 3, 3.5, 4}));
+}
+
+// 500 small dense vars merged over 8 steps, the per-var path mirrors the
+// dense branch of MergeVars: one zero fill and one Eigen sum pass per var.
+// Run with --gtest_also_run_disabled_tests.
+TEST(FusedDense, DISABLED_Benchmark) {
+  int var_num = 500;
+  int64_t var_numel = 64;
+  int steps = 8;
+  int repeat = 20;
+  platform::CPUPlace place;
+  platform::CPUDeviceContext ctx(place);
+
+  FusedDenseLayout layout;
+  std::vector<std::vector<std::shared_ptr<framework::Variable>>> vars(var_num);
+  for (int v = 0; v < var_num; ++v) {
+    auto name = "fc_" + std::to_string(v) + ".w_0@GRAD";
+    layout.Add(name, var_numel);
+    for (int s = 0; s < steps; ++s) {
+      auto var = std::make_shared<framework::Variable>();
+      auto *t = var->GetMutable<framework::LoDTensor>();
+      float *data = t->mutable_data<float>({var_numel}, place);
+      for (int64_t i = 0; i < var_numel; ++i) {
+        data[i] = s + v * 0.001f + i;
+      }
+      vars[v].push_back(var);
+    }
+  }
+
+  // per-var path
+  framework::Scope scope;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r) {
+    for (int v = 0; v < var_num; ++v) {
+      auto *out_t =
+          scope.Var(layout.varnames[v])->GetMutable<framework::LoDTensor>();
+      out_t->mutable_data<float>({var_numel}, place);
+      operators::math::SetConstant<platform::CPUDeviceContext, float>
+          constant_functor;
+      constant_functor(ctx, out_t, 0.0f);
+      auto result = framework::EigenVector<float>::Flatten(*out_t);
+      for (auto &var : vars[v]) {
+        auto in = framework::EigenVector<float>::Flatten(
+            var->Get<framework::LoDTensor>());
+        result.device(*ctx.eigen_device()) = result + in;
+      }
+    }
+  }
+  auto per_var_end = std::chrono::steady_clock::now();
+
+  // fused path
+  FusedDenseStage stage(&layout);
+  std::vector<std::shared_ptr<std::vector<float>>> buffers;
+  for (int s = 0; s < steps; ++s) {
+    for (int v = 0; v < var_num; ++v) {
+      auto &t = vars[v][s]->Get<framework::LoDTensor>();
+      auto buffer = stage.Fill(layout.varnames[v], t.data<float>(), var_numel);
+      if (buffer != nullptr) {
+        buffers.push_back(buffer);
+      }
+    }
+  }
+  ASSERT_EQ(buffers.size(), static_cast<size_t>(steps));
+  std::vector<float> merged(layout.total);
+  auto fused_start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r) {
+    MergeDenseBuffers(buffers, layout.total, merged.data());
+  }
+  auto fused_end = std::chrono::steady_clock::now();
+
+  for (int v = 0; v < var_num; ++v) {
+    auto &out_t =
+        scope.FindVar(layout.varnames[v])->Get<framework::LoDTensor>();
+    for (int64_t i = 0; i < var_numel; ++i) {
+      ASSERT_FLOAT_EQ(out_t.data<float>()[i],
+                      merged[layout.offsets[v] + i]);
+    }
+  }
+
+  LOG(INFO) << "merge " << var_num << " vars x " << steps
+            << " steps, per-var: "
+            << std::chrono::duration<double, std::micro>(per_var_end - start)
+                       .count() /
+                   repeat
+            << " us, fused: "
+            << std::chrono::duration<double, std::micro>(fused_end -
+                                                          fused_start)
+                       .count() /
+                   repeat
+            << " us";
+}
+
+}  // namespace distributed
+}  // namespace paddle
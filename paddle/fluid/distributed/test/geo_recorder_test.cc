@@ -0,0 +1,125 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/table/depends/geo_recorder.h"
+
+namespace paddle {
+namespace distributed {
+
+TEST(GeoRecorder, GetAndClear) {
+  int trainers = 3;
+  GeoRecorder recorder(trainers);
+
+  std::vector<uint64_t> rows = {0, 1, 2, 3, 4, 15, 26};
+  recorder.Update(rows);
+  recorder.Update({3, 4, 100});
+
+  std::vector<uint64_t> result;
+  recorder.GetAndClear(0, &result);
+  std::sort(result.begin(), result.end());
+  std::vector<uint64_t> expect = {0, 1, 2, 3, 4, 15, 26, 100};
+  ASSERT_EQ(result, expect);
+
+  // nothing new for trainer 0
+  recorder.GetAndClear(0, &result);
+  ASSERT_TRUE(result.empty());
+
+  recorder.Update({7, 0});
+  recorder.GetAndClear(0, &result);
+  std::sort(result.begin(), result.end());
+  ASSERT_EQ(result, std::vector<uint64_t>({0, 7}));
+
+  // trainer 1 still sees every row once
+  recorder.GetAndClear(1, &result);
+  std::sort(result.begin(), result.end());
+  expect = {0, 1, 2, 3, 4, 7, 15, 26, 100};
+  ASSERT_EQ(result, expect);
+
+  // rows are kept until the last trainer pulls them
+  ASSERT_EQ(recorder.PendingSize(), expect.size());
+  recorder.GetAndClear(2, &result);
+  ASSERT_EQ(result.size(), expect.size());
+  recorder.GetAndClear(0, &result);
+  recorder.GetAndClear(1, &result);
+  recorder.GetAndClear(2, &result);
+  ASSERT_EQ(recorder.PendingSize(), 0UL);
+}
+
+TEST(GeoRecorder, ManyTrainers) {
+  int trainers = 128;
+  int pushes = 20;
+  size_t rows_per_push = 10000;
+  GeoRecorder recorder(trainers);
+
+  std::vector<std::vector<uint64_t>> push_rows(pushes);
+  for (int i = 0; i < pushes; ++i) {
+    for (size_t j = 0; j < rows_per_push; ++j) {
+      push_rows[i].push_back(i * rows_per_push / 2 + j);
+    }
+  }
+  uint64_t distinct = (pushes - 1) * rows_per_push / 2 + rows_per_push;
+
+  ::ThreadPool pool(16);
+  std::vector<std::future<void>> fs;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < pushes; ++i) {
+    fs.push_back(
+        pool.enqueue([&recorder, &push_rows, i] {
+          recorder.Update(push_rows[i]);
+        }));
+  }
+  for (auto& f : fs) {
+    f.wait();
+  }
+  auto update_end = std::chrono::steady_clock::now();
+
+  fs.clear();
+  std::vector<std::vector<uint64_t>> results(trainers);
+  for (int i = 0; i < trainers; ++i) {
+    fs.push_back(pool.enqueue(
+        [&recorder, &results, i] { recorder.GetAndClear(i, &results[i]); }));
+  }
+  for (auto& f : fs) {
+    f.wait();
+  }
+  auto pull_end = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < trainers; ++i) {
+    ASSERT_EQ(results[i].size(), distinct);
+  }
+  // concurrent pulls keep rows conservatively, the next pull drops them
+  recorder.GetAndClear(0, &results[0]);
+  ASSERT_TRUE(results[0].empty());
+  ASSERT_EQ(recorder.PendingSize(), 0UL);
+
+  LOG(INFO) << "GeoRecorder with " << trainers << " trainers, " << pushes
+            << " pushes of " << rows_per_push << " rows: update "
+            << std::chrono::duration<double, std::milli>(update_end - start)
+                   .count()
+            << " ms, pull "
+            << std::chrono::duration<double, std::milli>(pull_end - update_end)
+                   .count()
+            << " ms";
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,211 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/service/grad_codec.h"
+
+namespace paddle {
+namespace distributed {
+
+std::vector<float> RandomGrad(size_t numel, int seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> dist(0.0, 1.0);
+  std::vector<float> grad(numel);
+  for (auto& g : grad) {
+    g = dist(rng);
+  }
+  return grad;
+}
+
+TEST(GradCodec, FromString) {
+  ASSERT_EQ(GradCodecFromString("none"), kGradCodecNone);
+  ASSERT_EQ(GradCodecFromString("fp16"), kGradCodecFP16);
+  ASSERT_EQ(GradCodecFromString("bf16"), kGradCodecBF16);
+  ASSERT_EQ(GradCodecFromString("topk"), kGradCodecTopK);
+  ASSERT_EQ(GradCodecFromString("int8"), kGradCodecInt8);
+  ASSERT_TRUE(GetGradCodec(kGradCodecNone) == nullptr);
+}
+
+TEST(GradCodec, FromParam) {
+  const GradCodec* codec = nullptr;
+  uint32_t type = kGradCodecInt8;
+  std::string param(reinterpret_cast<const char*>(&type), sizeof(uint32_t));
+  ASSERT_EQ(GradCodecFromParam(param, &codec), 0);
+  ASSERT_EQ(codec->type(), kGradCodecInt8);
+  type = kGradCodecNone;
+  param.assign(reinterpret_cast<const char*>(&type), sizeof(uint32_t));
+  ASSERT_EQ(GradCodecFromParam(param, &codec), 0);
+  ASSERT_TRUE(codec == nullptr);
+  // a short param and an unknown id are rejected without throwing
+  ASSERT_EQ(GradCodecFromParam(param.substr(0, 3), &codec), -1);
+  type = kGradCodecInt8 + 1;
+  param.assign(reinterpret_cast<const char*>(&type), sizeof(uint32_t));
+  ASSERT_EQ(GradCodecFromParam(param, &codec), -1);
+}
+
+TEST(GradCodec, RoundTrip) {
+  size_t numel = 1000;
+  size_t dim = 8;
+  auto grad = RandomGrad(numel, 0);
+  size_t raw_bytes = numel * sizeof(float);
+
+  struct Case {
+    GradCodecType type;
+    float max_rel_err;
+    float max_bytes_ratio;
+  };
+  std::vector<Case> cases = {{kGradCodecFP16, 1e-3, 0.51},
+                             {kGradCodecBF16, 1e-2, 0.51},
+                             {kGradCodecInt8, 2e-2, 0.40},
+                             {kGradCodecTopK, 0.0, 2.01}};
+
+  for (auto& c : cases) {
+    auto* codec = GetGradCodec(c.type);
+    ASSERT_EQ(codec->type(), c.type);
+    std::string encoded;
+    codec->Encode(grad.data(), numel, dim, &encoded);
+    ASSERT_EQ(GradCodec::DecodedNumel(encoded.data(), encoded.size()), numel);
+    ASSERT_LE(encoded.size(), raw_bytes * c.max_bytes_ratio);
+
+    std::vector<float> decoded(numel);
+    ASSERT_EQ(codec->Decode(encoded.data(), encoded.size(), decoded.data(),
+                            numel),
+              0);
+    for (size_t i = 0; i < numel; ++i) {
+      // int8 error is bounded by the scale of its group
+      float bound = c.max_rel_err * std::max(1.0f, std::fabs(grad[i]));
+      ASSERT_LE(std::fabs(decoded[i] - grad[i]), bound) << c.type;
+    }
+
+    // a truncated buffer is rejected
+    ASSERT_NE(codec->Decode(encoded.data(), encoded.size() - 1,
+                            decoded.data(), numel),
+              0);
+  }
+}
+
+TEST(GradCodec, TopKErrorFeedback) {
+  size_t numel = 1000;
+  size_t k = 10;
+  int steps = 50;
+  std::vector<float> residual(numel, 0.0f);
+  std::vector<float> total_grad(numel, 0.0f);
+  std::vector<float> total_sent(numel, 0.0f);
+  auto* codec = GetGradCodec(kGradCodecTopK);
+
+  size_t sent_bytes = 0;
+  for (int step = 0; step < steps; ++step) {
+    auto grad = RandomGrad(numel, step);
+    for (size_t i = 0; i < numel; ++i) {
+      total_grad[i] += grad[i];
+    }
+    TopKSparsify(grad.data(), residual.data(), numel, k);
+    size_t nnz = 0;
+    for (auto g : grad) {
+      nnz += (g != 0);
+    }
+    ASSERT_EQ(nnz, k);
+
+    std::string encoded;
+    codec->Encode(grad.data(), numel, 1, &encoded);
+    sent_bytes += encoded.size();
+    std::vector<float> decoded(numel);
+    ASSERT_EQ(
+        codec->Decode(encoded.data(), encoded.size(), decoded.data(), numel),
+        0);
+    for (size_t i = 0; i < numel; ++i) {
+      total_sent[i] += decoded[i];
+    }
+  }
+
+  // nothing is lost: what was not sent is still in the residual
+  for (size_t i = 0; i < numel; ++i) {
+    ASSERT_NEAR(total_sent[i] + residual[i], total_grad[i], 1e-3);
+  }
+  ASSERT_LT(sent_bytes, steps * numel * sizeof(float) / 40);
+}
+
+// Linear regression trained by a worker that pushes encoded grads to an
+// in-process "server" applying SGD, compared with the raw fp32 push.
+float TrainLinearRegression(GradCodecType type) {
+  size_t dim = 256;
+  size_t samples = 512;
+  int epochs = 300;
+  float lr = 0.1;
+
+  auto truth = RandomGrad(dim, 100);
+  std::vector<std::vector<float>> x(samples);
+  std::vector<float> y(samples, 0.0f);
+  for (size_t s = 0; s < samples; ++s) {
+    x[s] = RandomGrad(dim, 200 + s);
+    for (size_t d = 0; d < dim; ++d) {
+      y[s] += x[s][d] * truth[d];
+    }
+  }
+
+  auto* codec = GetGradCodec(type);
+  std::vector<float> param(dim, 0.0f);
+  std::vector<float> residual(dim, 0.0f);
+  std::vector<float> decoded(dim);
+  float loss = 0;
+  for (int epoch = 0; epoch < epochs; ++epoch) {
+    std::vector<float> grad(dim, 0.0f);
+    loss = 0;
+    for (size_t s = 0; s < samples; ++s) {
+      float pred = 0;
+      for (size_t d = 0; d < dim; ++d) {
+        pred += x[s][d] * param[d];
+      }
+      float err = pred - y[s];
+      loss += err * err / samples;
+      for (size_t d = 0; d < dim; ++d) {
+        grad[d] += err * x[s][d] / samples;
+      }
+    }
+    const float* push = grad.data();
+    if (codec != nullptr) {
+      if (type == kGradCodecTopK) {
+        TopKSparsify(grad.data(), residual.data(), dim, dim / 8);
+      }
+      std::string encoded;
+      codec->Encode(grad.data(), dim, kDenseQuantGroup, &encoded);
+      codec->Decode(encoded.data(), encoded.size(), decoded.data(), dim);
+      push = decoded.data();
+    }
+    for (size_t d = 0; d < dim; ++d) {
+      param[d] -= lr * push[d];
+    }
+  }
+  return loss;
+}
+
+TEST(GradCodec, ConvergenceNeutral) {
+  float base = TrainLinearRegression(kGradCodecNone);
+  ASSERT_LT(base, 1e-2);
+  for (auto type :
+       {kGradCodecFP16, kGradCodecBF16, kGradCodecInt8, kGradCodecTopK}) {
+    float loss = TrainLinearRegression(type);
+    LOG(INFO) << "codec " << type << " loss " << loss << " fp32 loss " << base;
+    ASSERT_LT(loss, std::max(10 * base, 1e-2f)) << type;
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
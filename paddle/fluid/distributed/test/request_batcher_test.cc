@@ -0,0 +1,226 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps.pb.h"
+#include "paddle/fluid/distributed/service/request_batcher.h"
+#include "paddle/fluid/distributed/table/common_sparse_table.h"
+
+namespace paddle {
+namespace distributed {
+
+TEST(SparseRequestBatcher, PullAndPush) {
+  size_t dim = 4;
+  int threads = 16;
+  int rounds = 50;
+  size_t keys_per_request = 64;
+  SparseRequestBatcher batcher(dim, 2000, 1 << 20, "test.pull_and_push");
+
+  std::atomic<int> pull_calls{0};
+  std::atomic<int> push_calls{0};
+  std::mutex table_mutex;
+  std::unordered_map<uint64_t, float> table;
+  batcher.set_pull_func([&](float *values, const uint64_t *keys, size_t num) {
+    pull_calls++;
+    std::unordered_map<uint64_t, int> seen;
+    for (size_t i = 0; i < num; ++i) {
+      // keys of a batch are deduplicated
+      EXPECT_EQ(seen[keys[i]]++, 0);
+      for (size_t d = 0; d < dim; ++d) {
+        values[i * dim + d] = keys[i] * 10.0f + d;
+      }
+    }
+    return 0;
+  });
+  batcher.set_push_func([&](const uint64_t *keys, const float *values,
+                            size_t num) {
+    push_calls++;
+    std::lock_guard<std::mutex> lock(table_mutex);
+    for (size_t i = 0; i < num; ++i) {
+      table[keys[i]] += values[i * dim];
+    }
+    return 0;
+  });
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      std::vector<uint64_t> keys(keys_per_request);
+      std::vector<float> values(keys_per_request * dim);
+      std::vector<float> grads(keys_per_request * dim, 1.0f);
+      for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < keys_per_request; ++i) {
+          // half of the keys are shared by every worker
+          keys[i] = i % 2 == 0 ? i : 1000 * (t + 1) + i;
+        }
+        ASSERT_EQ(batcher.Pull(keys.data(), keys.size(), values.data()), 0);
+        for (size_t i = 0; i < keys_per_request; ++i) {
+          for (size_t d = 0; d < dim; ++d) {
+            ASSERT_EQ(values[i * dim + d], keys[i] * 10.0f + d);
+          }
+        }
+        ASSERT_EQ(batcher.Push(keys.data(), grads.data(), keys.size()), 0);
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+
+  // every pushed gradient is applied exactly once
+  float total = 0;
+  for (auto &kv : table) {
+    total += kv.second;
+  }
+  ASSERT_EQ(total, static_cast<float>(threads * rounds * keys_per_request));
+  ASSERT_EQ(table[0], static_cast<float>(threads * rounds));
+
+  ASSERT_EQ(batcher.latency_us()->Snapshot().count, 2 * threads * rounds);
+  ASSERT_LE(pull_calls.load() + push_calls.load(), 2 * threads * rounds);
+  LOG(INFO) << "pull calls " << pull_calls.load() << ", push calls "
+            << push_calls.load() << " for " << threads * rounds
+            << " requests each; " << batcher.StatString();
+}
+
+TEST(SparseRequestBatcher, MaxKeysClosesBatch) {
+  size_t dim = 1;
+  // a long window, batches are closed by size
+  SparseRequestBatcher batcher(dim, 10 * 1000 * 1000, 8, "test.max_keys");
+  batcher.set_close_when_idle(false);
+  batcher.set_pull_func([&](float *values, const uint64_t *keys, size_t num) {
+    for (size_t i = 0; i < num; ++i) {
+      values[i] = keys[i];
+    }
+    return 0;
+  });
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 2; ++t) {
+    workers.emplace_back([&, t] {
+      std::vector<uint64_t> keys(4, t);
+      std::vector<float> values(4);
+      ASSERT_EQ(batcher.Pull(keys.data(), keys.size(), values.data()), 0);
+      ASSERT_EQ(values[3], static_cast<float>(t));
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  ASSERT_EQ(batcher.batch_requests()->Snapshot().count, 1);
+  ASSERT_LT(batcher.latency_us()->Snapshot().Quantile(1.0), 10 * 1000 * 1000);
+}
+
+TEST(SparseRequestBatcher, IdleClosesBatch) {
+  // a long window, a request alone closes its batch at once
+  SparseRequestBatcher batcher(1, 10 * 1000 * 1000, 1 << 20, "test.idle");
+  batcher.set_pull_func([&](float *values, const uint64_t *keys, size_t num) {
+    for (size_t i = 0; i < num; ++i) {
+      values[i] = keys[i];
+    }
+    return 0;
+  });
+  std::vector<uint64_t> keys = {1, 2};
+  std::vector<float> values(2);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(batcher.Pull(keys.data(), keys.size(), values.data()), 0);
+    ASSERT_EQ(values[1], 2.0f);
+  }
+  ASSERT_EQ(batcher.batch_requests()->Snapshot().count, 3);
+  ASSERT_LT(batcher.latency_us()->Snapshot().Quantile(1.0), 1000 * 1000);
+}
+
+// A sync sgd table holding key, whose params are all 1.
+static std::unique_ptr<Table> SyncSGDTable(int emb_dim, uint64_t key) {
+  TableParameter table_config;
+  table_config.set_table_class("CommonSparseTable");
+  FsClientParameter fs_config;
+  std::unique_ptr<Table> table(new CommonSparseTable());
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CommMergeAccessor");
+  CommonAccessorParameter *common_config = table_config.mutable_common();
+  common_config->set_name("sgd");
+  common_config->set_table_name("batcher_sync_sgd_test_table");
+  common_config->set_trainer_num(2);
+  common_config->set_sync(true);
+  common_config->add_params("Param");
+  common_config->add_dims(emb_dim);
+  common_config->add_initializers("fill_constant&1.0");  // param
+  common_config->add_params("LearningRate");
+  common_config->add_dims(1);
+  common_config->add_initializers("fill_constant&1.0");  // learning_rate
+  EXPECT_EQ(table->initialize(table_config, fs_config), 0);
+  // pull to create the keys
+  std::vector<float> values(emb_dim);
+  table->pull_sparse(values.data(), &key, 1);
+  return table;
+}
+
+// Two requests push the same key of a sync table in one batch. The table
+// averages the gradients of a key by the number of pushes, so the batch
+// must apply as the two pushes without the batcher.
+TEST(SparseRequestBatcher, UnmergedPushToSyncTable) {
+  int emb_dim = 4;
+  uint64_t key = 7;
+  std::vector<std::vector<float>> grads = {std::vector<float>(emb_dim, 1.0f),
+                                           std::vector<float>(emb_dim, 3.0f)};
+
+  auto unbatched = SyncSGDTable(emb_dim, key);
+  for (auto &grad : grads) {
+    ASSERT_EQ(unbatched->push_sparse(&key, grad.data(), 1), 0);
+  }
+  unbatched->pour();
+
+  auto batched = SyncSGDTable(emb_dim, key);
+  auto *table = batched.get();
+  // a long window, the batch is closed by the two keys
+  SparseRequestBatcher batcher(emb_dim, 10 * 1000 * 1000, 2,
+                               "test.unmerged_push");
+  batcher.set_close_when_idle(false);
+  batcher.set_push_func(
+      [table](const uint64_t *keys, const float *values, size_t num) {
+        return table->push_sparse(keys, values, num);
+      });
+  batcher.set_merge_push(false);
+  std::vector<std::thread> workers;
+  for (auto &grad : grads) {
+    workers.emplace_back([&batcher, &key, &grad] {
+      ASSERT_EQ(batcher.Push(&key, grad.data(), 1), 0);
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  ASSERT_EQ(batcher.batch_requests()->Snapshot().count, 1);
+  batched->pour();
+
+  std::vector<float> expected(emb_dim);
+  std::vector<float> values(emb_dim);
+  unbatched->pull_sparse(expected.data(), &key, 1);
+  batched->pull_sparse(values.data(), &key, 1);
+  for (int d = 0; d < emb_dim; ++d) {
+    // the mean of the two gradients is 2
+    ASSERT_LT(std::fabs(expected[d] - (1.0f - 2.0f)), 1e-6);
+    ASSERT_EQ(values[d], expected[d]);
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -107,6 +107,96 @@ TEST(CommonSparseTable, SGD) {
   }
 }
 
+// CommonSparseTable + SSGD in sync mode
+TEST(CommonSparseTable, SyncSGD) {
+  int emb_dim = 10;
+  int trainers = 4;
+
+  TableParameter table_config;
+  table_config.set_table_class("CommonSparseTable");
+  FsClientParameter fs_config;
+  Table *table = new CommonSparseTable();
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CommMergeAccessor");
+  CommonAccessorParameter *common_config = table_config.mutable_common();
+  common_config->set_name("sgd");
+  common_config->set_table_name("sync_sgd_test_table");
+  common_config->set_trainer_num(trainers);
+  common_config->set_sync(true);
+  common_config->add_params("Param");
+  common_config->add_dims(emb_dim);
+  common_config->add_initializers("uniform_random&0&-1.0&1.0");  // param
+  common_config->add_params("LearningRate");
+  common_config->add_dims(1);
+  common_config->add_initializers("fill_constant&1.0");  // learning_rate
+  auto ret = table->initialize(table_config, fs_config);
+  ASSERT_EQ(ret, 0);
+
+  // keys cover every local shard
+  std::vector<uint64_t> init_keys;
+  for (uint64_t key = 0; key < 40; ++key) {
+    init_keys.push_back(key);
+  }
+  std::vector<float> init_values;
+  init_values.resize(init_keys.size() * emb_dim);
+  table->pull_sparse(init_values.data(), init_keys.data(), init_keys.size());
+
+  // trainer i pushes every key that is a multiple of (i + 1)
+  std::vector<float> total_gradients(init_keys.size() * emb_dim, 0.0);
+  std::vector<int> counts(init_keys.size(), 0);
+  std::vector<std::vector<uint64_t>> trainer_keys(trainers);
+  std::vector<std::vector<float>> trainer_gradient_values(trainers);
+  float start = 0.0;
+  for (int i = 0; i < trainers; i++) {
+    for (auto id : init_keys) {
+      if (id % (i + 1) != 0) {
+        continue;
+      }
+      trainer_keys[i].push_back(id);
+      counts[id]++;
+      for (int k = 0; k < emb_dim; k++) {
+        trainer_gradient_values[i].push_back(start);
+        total_gradients[id * emb_dim + k] += start;
+        start += 0.01;
+      }
+    }
+  }
+
+  std::shared_ptr<::ThreadPool> pool_ =
+      std::make_shared<::ThreadPool>(trainers);
+  std::vector<std::future<void>> task_status;
+  for (int i = 0; i < trainers; i++) {
+    auto &push_keys = trainer_keys[i];
+    auto &push_values = trainer_gradient_values[i];
+    auto task = [table, &push_keys, &push_values] {
+      table->push_sparse(push_keys.data(), push_values.data(),
+                         push_keys.size());
+    };
+    task_status.push_back(pool_->enqueue(std::move(task)));
+  }
+  for (auto &status : task_status) {
+    status.wait();
+  }
+
+  // nothing is applied before pour
+  std::vector<float> pull_values;
+  pull_values.resize(init_keys.size() * emb_dim);
+  table->pull_sparse(pull_values.data(), init_keys.data(), init_keys.size());
+  for (size_t i = 0; i < init_values.size(); ++i) {
+    ASSERT_TRUE(abs(init_values[i] - pull_values[i]) < 1e-6);
+  }
+
+  // pour applies the averaged gradients, a second pour is a no-op
+  table->pour();
+  table->pour();
+  table->pull_sparse(pull_values.data(), init_keys.data(), init_keys.size());
+  for (size_t i = 0; i < init_values.size(); ++i) {
+    auto update_val =
+        init_values[i] - 1.0 * total_gradients[i] / counts[i / emb_dim];
+    ASSERT_TRUE(abs(update_val - pull_values[i]) < 1e-5);
+  }
+}
+
 // CommonSparseTable + Adam
 TEST(CommonSparseTable, Adam) {
   int emb_dim = 10;
@@ -95,9 +95,11 @@ std::string BoxPSTrainer::GetDumpPath(int tid) {
 
 void BoxPSTrainer::InitDumpEnv() {
   queue_ = paddle::framework::MakeChannel<std::string>();
+  InitDumpBlockQueue(4 * thread_num_);
   // Only set dump channel on the last section
   for (int i = 0; i < thread_num_; ++i) {
     workers_[i]->SetChannelWriter(queue_.get());
+    workers_[i]->SetDumpBlockQueue(dump_block_queue_.get());
   }
   // TODO(hutuxian): should make it as a config
   for (int i = 0; i < dump_thread_num_; i++) {
@@ -31,6 +31,7 @@ limitations under the License. */
 
 DECLARE_bool(enable_sync_dense_moment);
 DECLARE_bool(check_nan_inf);
+DECLARE_bool(device_worker_compiled_plan);
 namespace paddle {
 namespace framework {
 
@@ -477,6 +478,14 @@ void BoxPSWorker::CreateDeviceResource(const ProgramDesc& main_prog) {
     CHECK(offset <= param_async_.numel());
     CHECK(grad_offset <= grad_async_.numel());
   }
+
+  if (FLAGS_device_worker_compiled_plan) {
+    std::vector<OperatorBase*> ops;
+    for (auto& op : ops_) {
+      ops.push_back(op.get());
+    }
+    op_plan_.reset(new CompiledOpPlan(ops, {}, *thread_scope_, place_));
+  }
 }
 void BoxPSWorker::SyncParam(void) {
   if (sync_mode_ == DenseKStepNode && node_size_ == 1) {
@@ -560,8 +569,12 @@ void BoxPSWorker::TrainFiles() {
       dense_table_->PullDense(place_, &param_async_);
     }
 
-    for (auto& op : ops_) {
-      op->Run(*thread_scope_, place_);
+    if (op_plan_) {
+      op_plan_->Run();
+    } else {
+      for (auto& op : ops_) {
+        op->Run(*thread_scope_, place_);
+      }
     }
 
     if (dense_table_) {
@@ -0,0 +1,112 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/compiled_op_plan.h"
+
+#include <utility>
+
+#include "gflags/gflags.h"
+#include "paddle/fluid/framework/op_call_stack.h"
+#include "paddle/fluid/platform/device_context.h"
+#include "paddle/fluid/platform/profiler.h"
+#include "paddle/fluid/platform/sampling_profiler.h"
+
+DEFINE_bool(device_worker_compiled_plan, false,
+            "Whether HogwildWorker and BoxPSWorker run their ops through a "
+            "CompiledOpPlan, which resolves the skipped ops, kernels, "
+            "variables and device contexts once per thread scope.");
+
+namespace paddle {
+namespace framework {
+
+constexpr int CompiledOpPlan::kWarmUpRuns;
+
+CompiledOpPlan::CompiledOpPlan(const std::vector<OperatorBase*>& ops,
+                               const std::vector<std::string>& skip_ops,
+                               const Scope& scope,
+                               const platform::Place& place)
+    : scope_(scope), place_(place) {
+  for (size_t i = 0; i < ops.size(); ++i) {
+    auto* op = ops[i];
+    bool need_skip = false;
+    for (auto& skip_op : skip_ops) {
+      if (op->Type().find(skip_op) != std::string::npos) {
+        need_skip = true;
+        break;
+      }
+    }
+    if (need_skip) {
+      VLOG(3) << "Skip op " << op->Type() << " in compiled plan";
+      continue;
+    }
+    const Scope* scope_ptr = &scope_;
+    platform::Place place = place_;
+    steps_.push_back(
+        Step{op, i, [op, scope_ptr, place] { op->Run(*scope_ptr, place); }});
+  }
+}
+
+void CompiledOpPlan::Compile() {
+  auto& pool = platform::DeviceContextPool::Instance();
+  for (auto& step : steps_) {
+    auto* kernel_op = dynamic_cast<OperatorWithKernel*>(step.op);
+    if (kernel_op == nullptr || !kernel_op->CanRunPrepared()) {
+      VLOG(3) << "Op " << step.op->Type() << " is not run prepared";
+      continue;
+    }
+    runtime_ctxs_.emplace_back(
+        new RuntimeContext(kernel_op->Inputs(), kernel_op->Outputs(), scope_));
+    auto* runtime_ctx = runtime_ctxs_.back().get();
+    auto* dev_ctx = pool.Get(kernel_op->GetExecutionPlace(place_));
+    const Scope* scope_ptr = &scope_;
+    platform::Place place = place_;
+    step.func = [kernel_op, runtime_ctx, dev_ctx, scope_ptr, place] {
+      try {
+        platform::RecordEvent record_event(kernel_op->Type());
+        platform::SampledOpTimer sampled_timer(kernel_op->Type());
+        kernel_op->RunPrepared(*scope_ptr, place, runtime_ctx, dev_ctx);
+      } catch (platform::EnforceNotMet& exception) {
+        framework::InsertCallStackInfo(kernel_op->Type(), kernel_op->Attrs(),
+                                       &exception);
+        throw std::move(exception);
+      }
+    };
+    ++prepared_op_num_;
+  }
+  compiled_ = true;
+  VLOG(3) << "Compiled " << prepared_op_num_ << " of " << steps_.size()
+          << " ops to run prepared";
+}
+
+void CompiledOpPlan::Run(const std::function<void(size_t)>& post_op_run) {
+  if (!compiled_ && run_num_ >= kWarmUpRuns) {
+    Compile();
+  }
+  if (post_op_run) {
+    for (auto& step : steps_) {
+      step.func();
+      post_op_run(step.op_idx);
+    }
+  } else {
+    for (auto& step : steps_) {
+      step.func();
+    }
+  }
+  if (!compiled_) {
+    ++run_num_;
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
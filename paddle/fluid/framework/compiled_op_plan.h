@@ -0,0 +1,78 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/framework/operator.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/platform/place.h"
+
+namespace paddle {
+namespace framework {
+
+// The ops of a device worker bound to its thread scope and place.
+//
+// The skip list is applied once when the plan is built. The first
+// kWarmUpRuns runs go through OperatorBase::Run, which chooses the kernels
+// and finds out which inputs need data transform. After that, every
+// OperatorWithKernel that can run prepared gets its RuntimeContext (the
+// Variable* of its inputs and outputs) and its DeviceContext resolved once,
+// and a run is a walk over a flat array of closures. Other ops, like the ops
+// running sub-blocks, are still run through OperatorBase::Run.
+//
+// The scope must keep its variables for the lifetime of the plan, which is
+// the case for the thread scope of a device worker.
+class CompiledOpPlan {
+ public:
+  static constexpr int kWarmUpRuns = 2;
+
+  // Ops whose type contains any of skip_ops are left out, like HogwildWorker
+  // does.
+  CompiledOpPlan(const std::vector<OperatorBase*>& ops,
+                 const std::vector<std::string>& skip_ops, const Scope& scope,
+                 const platform::Place& place);
+
+  // Run the ops, calling post_op_run with the index of every op in ops after
+  // it runs, if given.
+  void Run(const std::function<void(size_t)>& post_op_run = nullptr);
+
+  bool Compiled() const { return compiled_; }
+  // number of ops run prepared, valid once compiled
+  size_t PreparedOpNum() const { return prepared_op_num_; }
+
+ private:
+  struct Step {
+    OperatorBase* op;
+    size_t op_idx;
+    std::function<void()> func;
+  };
+
+  void Compile();
+
+  const Scope& scope_;
+  platform::Place place_;
+  std::vector<Step> steps_;
+  std::vector<std::unique_ptr<RuntimeContext>> runtime_ctxs_;
+  int run_num_{0};
+  bool compiled_{false};
+  size_t prepared_op_num_{0};
+};
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,256 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/compiled_op_plan.h"
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/platform/init.h"
+#include "paddle/fluid/platform/sampling_profiler.h"
+
+DECLARE_int32(op_sampling_profiler_interval);
+
+namespace paddle {
+namespace framework {
+
+static int skipped_op_run_num = 0;
+
+class PlanTestAddOneOp : public OperatorWithKernel {
+ public:
+  using OperatorWithKernel::OperatorWithKernel;
+
+ protected:
+  void InferShape(framework::InferShapeContext* ctx) const override {
+    ctx->SetOutputDim("Out", ctx->GetInputDim("X"));
+  }
+  OpKernelType GetExpectedKernelType(
+      const ExecutionContext& ctx) const override {
+    return OpKernelType(proto::VarType::FP32, ctx.GetPlace());
+  }
+};
+
+class PlanTestOpMaker : public OpProtoAndCheckerMaker {
+ public:
+  void Make() {
+    AddInput("X", "input of test op");
+    AddOutput("Out", "output of test op");
+    AddComment("This is test op");
+  }
+};
+
+// Out = X + 1
+class PlanTestAddOneKernel : public OpKernel<float> {
+ public:
+  void Compute(const ExecutionContext& ctx) const {
+    auto* x = ctx.Input<LoDTensor>("X");
+    auto* out = ctx.Output<LoDTensor>("Out");
+    const float* x_data = x->data<float>();
+    float* out_data = out->mutable_data<float>(ctx.GetPlace());
+    for (int64_t i = 0; i < x->numel(); ++i) {
+      out_data[i] = x_data[i] + 1.f;
+    }
+  }
+};
+
+class PlanTestSkippedOp : public OperatorBase {
+ public:
+  using OperatorBase::OperatorBase;
+
+ private:
+  void RunImpl(const Scope& scope,
+               const platform::Place& place) const override {
+    ++skipped_op_run_num;
+  }
+};
+
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_OP_WITHOUT_GRADIENT(plan_test_add_one,
+                             paddle::framework::PlanTestAddOneOp,
+                             paddle::framework::PlanTestOpMaker);
+REGISTER_OP_CPU_KERNEL(plan_test_add_one,
+                       paddle::framework::PlanTestAddOneKernel);
+REGISTER_OP_WITHOUT_GRADIENT(plan_test_skipped_op,
+                             paddle::framework::PlanTestSkippedOp,
+                             paddle::framework::PlanTestOpMaker);
+
+namespace paddle {
+namespace framework {
+
+// A chain of op_num add_one ops with a skipped op after every tenth one.
+static std::vector<std::unique_ptr<OperatorBase>> BuildChain(int op_num,
+                                                             Scope* scope) {
+  std::vector<std::unique_ptr<OperatorBase>> ops;
+  for (int i = 0; i < op_num; ++i) {
+    std::string x = "v" + std::to_string(i);
+    std::string out = "v" + std::to_string(i + 1);
+    ops.emplace_back(OpRegistry::CreateOp("plan_test_add_one", {{"X", {x}}},
+                                          {{"Out", {out}}}, {}));
+    if (i % 10 == 0) {
+      ops.emplace_back(OpRegistry::CreateOp(
+          "plan_test_skipped_op", {{"X", {x}}}, {{"Out", {out}}}, {}));
+    }
+  }
+  for (int i = 0; i <= op_num; ++i) {
+    scope->Var("v" + std::to_string(i))->GetMutable<LoDTensor>();
+  }
+  auto* v0 = scope->FindVar("v0")->GetMutable<LoDTensor>();
+  v0->Resize({4});
+  float* v0_data = v0->mutable_data<float>(platform::CPUPlace());
+  for (int i = 0; i < 4; ++i) {
+    v0_data[i] = static_cast<float>(i);
+  }
+  return ops;
+}
+
+static std::vector<OperatorBase*> RawOps(
+    const std::vector<std::unique_ptr<OperatorBase>>& ops) {
+  std::vector<OperatorBase*> raw_ops;
+  for (auto& op : ops) {
+    raw_ops.push_back(op.get());
+  }
+  return raw_ops;
+}
+
+TEST(CompiledOpPlan, Run) {
+  paddle::framework::InitDevices();
+  Scope scope;
+  int op_num = 50;
+  auto ops = BuildChain(op_num, &scope);
+  platform::CPUPlace place;
+  CompiledOpPlan plan(RawOps(ops), {"skipped"}, scope, place);
+
+  std::vector<size_t> op_indices;
+  for (int run = 0; run < 5; ++run) {
+    op_indices.clear();
+    plan.Run([&](size_t op_idx) { op_indices.push_back(op_idx); });
+    ASSERT_EQ(plan.Compiled(), run >= CompiledOpPlan::kWarmUpRuns);
+    ASSERT_EQ(op_indices.size(), static_cast<size_t>(op_num));
+    auto& out = scope.FindVar("v" + std::to_string(op_num))->Get<LoDTensor>();
+    ASSERT_EQ(out.numel(), 4);
+    ASSERT_EQ(out.data<float>()[3], 3.f + op_num);
+  }
+  ASSERT_EQ(plan.PreparedOpNum(), static_cast<size_t>(op_num));
+  ASSERT_EQ(skipped_op_run_num, 0);
+  // the indices are the indices in ops, skipped ops included
+  ASSERT_EQ(op_indices[0], 0UL);
+  ASSERT_EQ(op_indices[1], 2UL);
+  ASSERT_EQ(ops[op_indices.back()]->Type(), "plan_test_add_one");
+
+  // the shapes are still inferred every run
+  auto* v0 = scope.FindVar("v0")->GetMutable<LoDTensor>();
+  v0->Resize({8});
+  v0->mutable_data<float>(place)[7] = 7.f;
+  plan.Run();
+  auto& out = scope.FindVar("v" + std::to_string(op_num))->Get<LoDTensor>();
+  ASSERT_EQ(out.numel(), 8);
+  ASSERT_EQ(out.data<float>()[7], 7.f + op_num);
+}
+
+// The prepared ops of a compiled plan are sampled like OperatorBase::Run.
+TEST(CompiledOpPlan, SampledOpTimer) {
+  paddle::framework::InitDevices();
+  Scope scope;
+  int op_num = 50;
+  auto ops = BuildChain(op_num, &scope);
+  platform::CPUPlace place;
+  CompiledOpPlan plan(RawOps(ops), {"skipped"}, scope, place);
+  for (int run = 0; run < CompiledOpPlan::kWarmUpRuns; ++run) {
+    plan.Run();
+  }
+
+  FLAGS_op_sampling_profiler_interval = 0;
+  int old_rate = FLAGS_op_sampling_profiler_rate;
+  FLAGS_op_sampling_profiler_rate = 1;
+  FLAGS_op_sampling_profiler = true;
+  auto& profiler = platform::OpSamplingProfiler::Instance();
+  profiler.Report(true);
+  int run_num = 4;
+  for (int run = 0; run < run_num; ++run) {
+    plan.Run();
+  }
+  FLAGS_op_sampling_profiler = false;
+  FLAGS_op_sampling_profiler_rate = old_rate;
+  ASSERT_TRUE(plan.Compiled());
+
+  // Lines of "type count mean_us p50_us p99_us".
+  std::istringstream report(profiler.Report(true));
+  std::string type;
+  uint64_t count = 0;
+  while (report >> type >> count && type != "plan_test_add_one") {
+    report.ignore(1024, '\n');
+  }
+  ASSERT_EQ(type, "plan_test_add_one");
+  // A rate of 1 samples one of every one or two runs.
+  EXPECT_GE(count, static_cast<uint64_t>(op_num * run_num / 2));
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(CompiledOpPlan, DISABLED_DispatchOverhead) {
+  paddle::framework::InitDevices();
+  Scope scope;
+  int op_num = 500;
+  int batch_num = 200;
+  auto ops = BuildChain(op_num, &scope);
+  platform::CPUPlace place;
+  std::vector<std::string> skip_ops = {"skipped"};
+
+  auto run_ops = [&] {
+    for (auto& op : ops) {
+      bool need_skip = false;
+      for (auto& skip_op : skip_ops) {
+        if (op->Type().find(skip_op) != std::string::npos) {
+          need_skip = true;
+          break;
+        }
+      }
+      if (!need_skip) {
+        op->Run(scope, place);
+      }
+    }
+  };
+  run_ops();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < batch_num; ++i) {
+    run_ops();
+  }
+  double run_ns = std::chrono::duration<double, std::nano>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+  CompiledOpPlan plan(RawOps(ops), skip_ops, scope, place);
+  for (int i = 0; i < CompiledOpPlan::kWarmUpRuns + 1; ++i) {
+    plan.Run();
+  }
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < batch_num; ++i) {
+    plan.Run();
+  }
+  double plan_ns = std::chrono::duration<double, std::nano>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  LOG(INFO) << op_num << " cheap ops, per op: OperatorBase::Run "
+            << run_ns / batch_num / op_num << " ns, CompiledOpPlan "
+            << plan_ns / batch_num / op_num << " ns";
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -264,6 +264,9 @@ void DatasetImpl<T>::LoadIntoMemory() {
   input_channel_->SetBlockSize(in_chan_size / thread_num_ + 1);
 
   timeline.Pause();
+  STAT_COUNTER("dataset.load_into_memory.records")->Add(in_chan_size);
+  STAT_HISTOGRAM("dataset.load_into_memory.us")
+      ->Observe(static_cast<int64_t>(timeline.ElapsedUS()));
   VLOG(3) << "DatasetImpl<T>::LoadIntoMemory() end"
           << ", memory data size=" << input_channel_->Size()
           << ", cost time=" << timeline.ElapsedSec() << " seconds";
@@ -1729,6 +1732,8 @@ void PadBoxSlotDataset::PreLoadIntoMemory() {
       timer.Start();
       readers_[i]->LoadIntoMemory();
       timer.Pause();
+      STAT_HISTOGRAM("dataset.load_into_memory.thread_us")
+          ->Observe(static_cast<int64_t>(timer.ElapsedUS()));
       double span = timer.ElapsedSec();
       if (max_read_ins_span_ < span) {
         max_read_ins_span_ = span;
@@ -1795,10 +1800,12 @@ void PadBoxSlotDataset::MergeInsKeys(const Channel<SlotRecord>& in) {
       auto feed_obj =
           reinterpret_cast<SlotPaddleBoxDataFeed*>(readers_[0].get());
       CHECK(feed_obj != nullptr && in != nullptr);
+      auto* records_stat = STAT_COUNTER("dataset.merge_ins_keys.records");
       size_t num = 0;
       std::vector<SlotRecord> datas;
       while (in->ReadOnce(datas, OBJPOOL_BLOCK_SIZE)) {
         timer.Resume();
+        records_stat->Add(datas.size());
         for (auto& rec : datas) {
           for (auto& idx : used_fea_index_) {
             uint64_t* feas = rec->slot_uint64_feasigns_.get_values(idx, &num);
@@ -1818,6 +1825,8 @@ void PadBoxSlotDataset::MergeInsKeys(const Channel<SlotRecord>& in) {
         timer.Pause();
       }
       datas.shrink_to_fit();
+      STAT_HISTOGRAM("dataset.merge_ins_keys.thread_us")
+          ->Observe(static_cast<int64_t>(timer.ElapsedUS()));
 
       double span = timer.ElapsedSec();
       if (max_merge_ins_span_ < span) {
@@ -1928,6 +1937,9 @@ void PadBoxSlotDataset::ShuffleData(int thread_num) {
       PadBoxSlotDataConsumer* handler =
           reinterpret_cast<PadBoxSlotDataConsumer*>(data_consumer_);
       ShuffleResultWaitGroup wg;
+      auto* local_stat = STAT_COUNTER("dataset.shuffle.local_records");
+      auto* remote_stat = STAT_COUNTER("dataset.shuffle.remote_records");
+      auto* bytes_stat = STAT_COUNTER("dataset.shuffle.send_bytes");
       while (input_channel_->Read(data)) {
         timer.Resume();
         for (auto& t : data) {
@@ -1948,6 +1960,8 @@ void PadBoxSlotDataset::ShuffleData(int thread_num) {
           ars[client_id] << t;
           releases.push_back(t);
         }
+        local_stat->Add(loc_datas.size());
+        remote_stat->Add(releases.size());
         slot_pool_->put(&releases);
         releases.clear();
         size_t loc_len = loc_datas.size();
@@ -1965,6 +1979,7 @@ void PadBoxSlotDataset::ShuffleData(int thread_num) {
             wg.done();
             continue;
           }
+          bytes_stat->Add(ar.Length());
           handler->send_message_callback(i, ar.Buffer(), ar.Length(), &wg);
           ar.Clear();
         }
@@ -1980,6 +1995,8 @@ void PadBoxSlotDataset::ShuffleData(int thread_num) {
       data.shrink_to_fit();
       loc_datas.shrink_to_fit();
       releases.shrink_to_fit();
+      STAT_HISTOGRAM("dataset.shuffle.thread_us")
+          ->Observe(static_cast<int64_t>(timer.ElapsedUS()));
 
       double span = timer.ElapsedSec();
       if (span > max_shuffle_span_) {
@@ -2384,6 +2401,8 @@ void InputTableDataset::LoadIndexIntoMemory() {
   for (auto& f : wait_futures) {
     f.wait();
   }
+  BoxWrapper::GetInstance()->input_table_deque_.back().BuildIndex(
+      thread_num_);
   timer.Pause();
   VLOG(1) << "end LoadIndexIntoMemory() cost: " << timer.ElapsedSec();
 }
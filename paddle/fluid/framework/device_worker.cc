@@ -99,6 +99,12 @@ bool CheckValidOutput(LoDTensor* tensor, size_t batch_size) {
 
 void DeviceWorker::DumpParam(const Scope& scope, const int batch_id) {
   std::ostringstream os;
+  DumpBlock* block = nullptr;
+  if (dump_block_queue_ != nullptr) {
+    block = dump_block_queue_->Acquire();
+    block->Reset(DumpBlock::kParam, batch_id);
+    block->AddRow("");
+  }
   for (auto& param : *dump_param_) {
     os.str("");
     Variable* var = scope.FindVar(param);
@@ -112,10 +118,18 @@ void DeviceWorker::DumpParam(const Scope& scope, const int batch_id) {
       tensor = &cpu_tensor;
     }
     int64_t len = tensor->numel();
+    if (block != nullptr) {
+      block->Append(block->AddColumn(param, tensor->type()),
+                    tensor->data<void>(), len);
+      continue;
+    }
     os << "(" << batch_id << "," << param << ")";
     PrintLodTensor(tensor, 0, len, &os);
     writer_ << os.str();
   }
+  if (block != nullptr) {
+    dump_block_queue_->Put(block);
+  }
 }
 
 void DeviceWorker::InitRandomDumpConfig(const TrainerDesc& desc) {
@@ -132,28 +146,92 @@ void DeviceWorker::InitRandomDumpConfig(const TrainerDesc& desc) {
   dump_interval_ = desc.dump_interval();
 }
 
-void DeviceWorker::DumpField(const Scope& scope, int dump_mode,
-                             int dump_interval) {  // dump_mode: 0: no random,
-                                                   // 1: random with insid hash,
-                                                   // 2: random with random
-                                                   // number
+void DeviceWorker::SampleDumpRows(int dump_mode, int dump_interval,
+                                  std::vector<size_t>* rows) {
   size_t batch_size = device_reader_->GetCurBatchSize();
-  std::vector<std::ostringstream> ars(batch_size);
-  std::vector<bool> hit(batch_size, false);
-
+  rows->clear();
   std::default_random_engine engine(0);
   std::uniform_int_distribution<size_t> dist(0U, INT_MAX);
   for (size_t i = 0; i < batch_size; i++) {
     size_t r = 0;
-    const std::string& lineid = device_reader_->GetLineId(i);
     if (dump_mode == 1) {
+      const std::string& lineid = device_reader_->GetLineId(i);
       r = XXH64(lineid.data(), lineid.length(), 0);
     } else if (dump_mode == 2) {
       r = dist(engine);
     }
-    if (r % dump_interval != 0) {
+    if (r % dump_interval == 0) {
+      rows->push_back(i);
+    }
+  }
+}
+
+// Copy the rows of the fields into a block, DumpFileWriter formats them.
+void DeviceWorker::DumpFieldBlock(const Scope& scope,
+                                  const std::vector<size_t>& rows) {
+  if (rows.empty()) {
+    return;
+  }
+  size_t batch_size = device_reader_->GetCurBatchSize();
+  DumpBlock* block = dump_block_queue_->Acquire();
+  block->Reset(DumpBlock::kField, 0);
+  for (size_t i : rows) {
+    block->AddRow(device_reader_->GetLineId(i));
+  }
+  for (auto& field : *dump_fields_) {
+    Variable* var = scope.FindVar(field);
+    if (var == nullptr) {
+      VLOG(0) << "Note: field[" << field
+              << "] cannot be find in scope, so it was skipped.";
+      continue;
+    }
+    LoDTensor* tensor = var->GetMutable<LoDTensor>();
+    if (!tensor->IsInitialized()) {
+      VLOG(0) << "Note: field[" << field
+              << "] is not initialized, so it was skipped.";
+      continue;
+    }
+    framework::LoDTensor cpu_tensor;
+    if (platform::is_gpu_place(tensor->place())) {
+      TensorCopySync(*tensor, platform::CPUPlace(), &cpu_tensor);
+      cpu_tensor.set_lod(tensor->lod());
+      tensor = &cpu_tensor;
+    }
+    if (!CheckValidOutput(tensor, batch_size)) {
+      VLOG(0) << "Note: field[" << field << "] cannot pass check, so it was "
+                                            "skipped. Maybe the dimension is "
+                                            "wrong ";
       continue;
     }
+    auto* column = block->AddColumn(field, tensor->type());
+    const char* data = static_cast<const char*>(tensor->data<void>());
+    size_t element_size = SizeOfType(tensor->type());
+    for (size_t i : rows) {
+      auto bound = GetTensorBound(tensor, i);
+      block->Append(column, data + bound.first * element_size,
+                    bound.second - bound.first);
+    }
+  }
+  dump_block_queue_->Put(block);
+}
+
+void DeviceWorker::DumpField(const Scope& scope, int dump_mode,
+                             int dump_interval) {  // dump_mode: 0: no random,
+                                                   // 1: random with insid hash,
+                                                   // 2: random with random
+                                                   // number
+  size_t batch_size = device_reader_->GetCurBatchSize();
+  std::vector<size_t> rows;
+  SampleDumpRows(dump_mode, dump_interval, &rows);
+  if (dump_block_queue_ != nullptr) {
+    DumpFieldBlock(scope, rows);
+    return;
+  }
+  std::vector<std::ostringstream> ars(batch_size);
+  std::vector<bool> hit(batch_size, false);
+
+  for (size_t i : rows) {
+    const std::string& lineid = device_reader_->GetLineId(i);
     hit[i] = true;
     if (FLAGS_lineid_have_extend_info) {
       size_t pos = lineid.find(" ");
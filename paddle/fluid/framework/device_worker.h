@@ -27,9 +27,12 @@ limitations under the License. */
 #include <utility>        // NOLINT
 #include <vector>
 
+#include "paddle/fluid/framework/compiled_op_plan.h"
 #include "paddle/fluid/framework/data_feed.h"
+#include "paddle/fluid/framework/dump_block.h"
 #include "paddle/fluid/framework/heter_service.h"
 #include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/framework/memory_planner.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/program_desc.h"
 #include "paddle/fluid/framework/reader.h"
@@ -186,6 +189,10 @@ class DeviceWorker {
   virtual void SetChannelWriter(ChannelObject<std::string>* queue) {
     writer_.Reset(queue);
   }
+  // Dump raw blocks to queue instead of text to the channel writer.
+  virtual void SetDumpBlockQueue(DumpBlockQueue* queue) {
+    dump_block_queue_ = queue;
+  }
   virtual void SetPlace(const paddle::platform::Place& place) {
     place_ = place;
   }
@@ -199,6 +206,10 @@ class DeviceWorker {
   virtual void DumpParam(const Scope& scope, const int batch_id);
   virtual void DumpField(const Scope& scope, int dump_mode,
                          int dump_interval = 10000);
+  // The indices of the instances of the current batch to dump.
+  void SampleDumpRows(int dump_mode, int dump_interval,
+                      std::vector<size_t>* rows);
+  void DumpFieldBlock(const Scope& scope, const std::vector<size_t>& rows);
   Scope* root_scope_ = nullptr;
   Scope* thread_scope_;
   paddle::platform::Place place_;
@@ -218,6 +229,7 @@ class DeviceWorker {
   int dump_mode_ = 0;
   int dump_interval_ = 10000;
   ChannelWriter<std::string> writer_;
+  DumpBlockQueue* dump_block_queue_ = nullptr;
 };
 
 class CPUWorkerBase : public DeviceWorker {
@@ -263,6 +275,10 @@ class HogwildWorker : public CPUWorkerBase {
   HogwildWorkerParameter param_;
   std::vector<std::string> skip_ops_;
   std::map<std::string, int> stat_var_name_map_;
+  // Only used when FLAGS_executor_memory_plan is set.
+  std::unique_ptr<MemoryPlanner> memory_planner_;
+  // Only used when FLAGS_device_worker_compiled_plan is set.
+  std::unique_ptr<CompiledOpPlan> op_plan_;
 };
 
 class DownpourWorker : public HogwildWorker {
@@ -665,6 +681,8 @@ class BoxPSWorker : public DeviceWorker {
 
   std::shared_ptr<framework::ProgramDesc> program_;
   std::vector<std::unique_ptr<OperatorBase>> ops_;
+  // Only used when FLAGS_device_worker_compiled_plan is set.
+  std::unique_ptr<CompiledOpPlan> op_plan_;
   platform::DeviceContext* dev_ctx_ = nullptr;
 
   // dense async table
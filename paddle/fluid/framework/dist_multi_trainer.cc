@@ -75,8 +75,10 @@ void DistMultiTrainer::RegisterHeterCallback() {
 
 void DistMultiTrainer::InitDumpEnv() {
   queue_ = paddle::framework::MakeChannel<std::string>();
+  InitDumpBlockQueue(4 * thread_num_);
   for (int i = 0; i < thread_num_; ++i) {
     workers_[i]->SetChannelWriter(queue_.get());
+    workers_[i]->SetDumpBlockQueue(dump_block_queue_.get());
   }
   dump_thread_num_ = 1;
   if (dump_file_num_ > mpi_size_) {
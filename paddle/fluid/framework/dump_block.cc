@@ -0,0 +1,278 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/framework/dump_block.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "paddle/fluid/framework/data_type.h"
+#include "paddle/fluid/framework/io/fs.h"
+#include "paddle/fluid/string/string_helper.h"
+
+DECLARE_bool(lineid_have_extend_info);
+DECLARE_bool(dump_filed_same_as_aibox);
+
+namespace paddle {
+namespace framework {
+
+void DumpBlock::Reset(Kind kind, int64_t batch_id) {
+  kind_ = kind;
+  batch_id_ = batch_id;
+  row_num_ = 0;
+  column_num_ = 0;
+}
+
+void DumpBlock::AddRow(const std::string& lineid) {
+  if (row_num_ == lineids_.size()) {
+    lineids_.emplace_back();
+  }
+  lineids_[row_num_++].assign(lineid);
+}
+
+DumpBlock::Column* DumpBlock::AddColumn(const std::string& name,
+                                        proto::VarType::Type type) {
+  if (column_num_ == columns_.size()) {
+    columns_.emplace_back();
+  }
+  Column* column = &columns_[column_num_++];
+  column->name.assign(name);
+  column->type = type;
+  column->offsets.assign(1, 0);
+  column->bytes = 0;
+  return column;
+}
+
+void DumpBlock::Append(Column* column, const void* data, size_t numel) {
+  size_t size = numel * SizeOfType(column->type);
+  if (column->bytes + size > column->capacity) {
+    size_t capacity = std::max(column->bytes + size, column->capacity * 2);
+    std::unique_ptr<char[]> buffer(new char[capacity]);
+    if (column->bytes > 0) {
+      std::memcpy(buffer.get(), column->data.get(), column->bytes);
+    }
+    column->data = std::move(buffer);
+    column->capacity = capacity;
+  }
+  if (size > 0) {
+    std::memcpy(column->data.get() + column->bytes, data, size);
+  }
+  column->bytes += size;
+  column->offsets.push_back(column->offsets.back() + numel);
+}
+
+DumpBlockQueue::DumpBlockQueue(size_t capacity)
+    : queue_(MakeChannel<DumpBlock*>()) {
+  queue_->SetCapacity(capacity);
+}
+
+DumpBlock* DumpBlockQueue::Acquire() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (free_blocks_.empty()) {
+    blocks_.emplace_back(new DumpBlock());
+    return blocks_.back().get();
+  }
+  DumpBlock* block = free_blocks_.back();
+  free_blocks_.pop_back();
+  return block;
+}
+
+void DumpBlockQueue::Put(DumpBlock* block) {
+  if (!queue_->Put(block)) {
+    Release(block);
+  }
+}
+
+bool DumpBlockQueue::Get(DumpBlock** block) { return queue_->Get(*block); }
+
+void DumpBlockQueue::Release(DumpBlock* block) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_blocks_.push_back(block);
+}
+
+void DumpBlockQueue::Close() { queue_->Close(); }
+
+static const char kDumpMagic[8] = {'P', 'D', 'D', 'U', 'M', 'P', '0', '1'};
+// Flush the formatted bytes to the file once the buffer is this large.
+static const size_t kDumpFlushBytes = 1 << 20;
+
+template <typename T>
+static void AppendBinary(std::string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T, typename U = T>
+static void PrintValues(const char* data, uint64_t start, uint64_t end,
+                        std::ostringstream* os) {
+  const T* values = reinterpret_cast<const T*>(data);
+  for (uint64_t i = start; i < end; ++i) {
+    (*os) << ":" << static_cast<U>(values[i]);
+  }
+}
+
+// The same as PrintLodTensor in device_worker.cc.
+static void PrintColumn(const DumpBlock::Column& column, size_t row,
+                        std::ostringstream* os) {
+  const char* data = column.data.get();
+  uint64_t start = column.offsets[row];
+  uint64_t end = column.offsets[row + 1];
+  switch (column.type) {
+    case proto::VarType::FP32:
+      PrintValues<float>(data, start, end, os);
+      break;
+    case proto::VarType::INT64:
+      PrintValues<int64_t, uint64_t>(data, start, end, os);
+      break;
+    case proto::VarType::FP64:
+      PrintValues<double>(data, start, end, os);
+      break;
+    case proto::VarType::INT32:
+      PrintValues<int>(data, start, end, os);
+      break;
+    case proto::VarType::INT16:
+      PrintValues<int16_t>(data, start, end, os);
+      break;
+    default:
+      (*os) << "unsupported type";
+  }
+}
+
+DumpFileWriter::DumpFileWriter(const std::string& path,
+                               const std::string& converter, bool binary,
+                               int64_t max_bytes)
+    : path_(path),
+      converter_(converter),
+      binary_(binary),
+      max_bytes_(max_bytes) {
+  Open();
+}
+
+DumpFileWriter::~DumpFileWriter() { Flush(); }
+
+void DumpFileWriter::Open() {
+  std::string path = path_;
+  if (max_bytes_ > 0) {
+    path = string::format_string("%s-%05d", path_.c_str(), file_index_++);
+  }
+  int err_no = 0;
+  fp_ = fs_open_write(path, &err_no, converter_);
+  file_bytes_ = 0;
+  if (binary_) {
+    file_bytes_ += fwrite(kDumpMagic, 1, sizeof(kDumpMagic), fp_.get());
+  }
+}
+
+void DumpFileWriter::Write(const DumpBlock& block) {
+  if (binary_) {
+    FormatBinary(block);
+  } else {
+    FormatText(block);
+  }
+  if (buffer_.size() >= kDumpFlushBytes ||
+      (max_bytes_ > 0 &&
+       file_bytes_ + static_cast<int64_t>(buffer_.size()) >= max_bytes_)) {
+    Flush();
+  }
+  // The next file is opened by the next Flush().
+  if (max_bytes_ > 0 && file_bytes_ >= max_bytes_) {
+    fp_.reset();
+  }
+}
+
+void DumpFileWriter::Flush() {
+  if (buffer_.empty()) {
+    return;
+  }
+  if (fp_ == nullptr) {
+    Open();
+  }
+  size_t write_count = fwrite(buffer_.data(), 1, buffer_.size(), fp_.get());
+  if (write_count != buffer_.size()) {
+    VLOG(3) << "dump failed";
+  }
+  file_bytes_ += write_count;
+  buffer_.clear();
+}
+
+void DumpFileWriter::FormatText(const DumpBlock& block) {
+  std::ostringstream os;
+  if (block.kind() == DumpBlock::kParam) {
+    for (size_t i = 0; i < block.column_num(); ++i) {
+      auto& column = block.column(i);
+      os.str("");
+      os << "(" << block.batch_id() << "," << column.name << ")";
+      PrintColumn(column, 0, &os);
+      buffer_.append(os.str());
+      buffer_.append("\n");
+    }
+    return;
+  }
+  for (size_t row = 0; row < block.row_num(); ++row) {
+    const std::string& lineid = block.lineid(row);
+    size_t pos = std::string::npos;
+    if (FLAGS_lineid_have_extend_info) {
+      pos = lineid.find(" ");
+    }
+    os.str("");
+    os << lineid.substr(0, pos);
+    for (size_t i = 0; i < block.column_num(); ++i) {
+      auto& column = block.column(i);
+      if (FLAGS_dump_filed_same_as_aibox) {
+        os << "\t" << column.name.substr(0, column.name.find("."));
+      } else {
+        os << "\t" << column.name << ":"
+           << column.offsets[row + 1] - column.offsets[row];
+      }
+      PrintColumn(column, row, &os);
+    }
+    if (os.tellp() <= 0) {
+      continue;
+    }
+    if (pos != std::string::npos) {
+      os << "\t" << lineid.substr(pos + 1);
+    }
+    buffer_.append(os.str());
+    buffer_.append("\n");
+  }
+}
+
+void DumpFileWriter::FormatBinary(const DumpBlock& block) {
+  AppendBinary<uint32_t>(&buffer_, block.kind());
+  AppendBinary<int64_t>(&buffer_, block.batch_id());
+  AppendBinary<uint64_t>(&buffer_, block.row_num());
+  AppendBinary<uint64_t>(&buffer_, block.column_num());
+  for (size_t row = 0; row < block.row_num(); ++row) {
+    auto& lineid = block.lineid(row);
+    AppendBinary<uint32_t>(&buffer_, lineid.size());
+    buffer_.append(lineid);
+  }
+  for (size_t i = 0; i < block.column_num(); ++i) {
+    auto& column = block.column(i);
+    AppendBinary<uint32_t>(&buffer_, column.name.size());
+    buffer_.append(column.name);
+    AppendBinary<int32_t>(&buffer_, column.type);
+    buffer_.append(reinterpret_cast<const char*>(column.offsets.data()),
+                   column.offsets.size() * sizeof(uint64_t));
+    if (column.bytes > 0) {
+      buffer_.append(column.data.get(), column.bytes);
+    }
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,133 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <stdio.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/framework/channel.h"
+#include "paddle/fluid/framework/framework.pb.h"
+
+namespace paddle {
+namespace framework {
+
+// The raw bytes of dumped fields or params of one batch. The training thread
+// only copies the dumped rows in, formatting is left to the dump threads.
+// Blocks are pooled by DumpBlockQueue, Reset() keeps their buffers.
+class DumpBlock {
+ public:
+  enum Kind { kField = 0, kParam = 1 };
+
+  struct Column {
+    std::string name;
+    proto::VarType::Type type;
+    // Element offsets of the rows in data, row num + 1 of them.
+    std::vector<uint64_t> offsets;
+    std::unique_ptr<char[]> data;
+    size_t bytes = 0;
+    size_t capacity = 0;
+  };
+
+  void Reset(Kind kind, int64_t batch_id);
+  void AddRow(const std::string& lineid);
+  Column* AddColumn(const std::string& name, proto::VarType::Type type);
+  // Append numel elements as the next row of column.
+  void Append(Column* column, const void* data, size_t numel);
+
+  Kind kind() const { return kind_; }
+  int64_t batch_id() const { return batch_id_; }
+  size_t row_num() const { return row_num_; }
+  const std::string& lineid(size_t row) const { return lineids_[row]; }
+  size_t column_num() const { return column_num_; }
+  const Column& column(size_t i) const { return columns_[i]; }
+
+ private:
+  Kind kind_ = kField;
+  int64_t batch_id_ = 0;
+  size_t row_num_ = 0;
+  size_t column_num_ = 0;
+  // Only the first row_num_ and column_num_ are used, the others are kept
+  // for their buffers.
+  std::vector<std::string> lineids_;
+  std::vector<Column> columns_;
+};
+
+// A bounded queue of filled blocks from the training threads to the dump
+// threads, with a pool of the free ones.
+class DumpBlockQueue {
+ public:
+  explicit DumpBlockQueue(size_t capacity);
+
+  // A free block, new if the pool is empty.
+  DumpBlock* Acquire();
+  // Send a filled block to the dump threads, blocking when the queue is full.
+  void Put(DumpBlock* block);
+  // Receive a filled block, false when the queue is closed and drained.
+  bool Get(DumpBlock** block);
+  // Return a block to the pool.
+  void Release(DumpBlock* block);
+  void Close();
+
+ private:
+  std::shared_ptr<ChannelObject<DumpBlock*>> queue_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<DumpBlock>> blocks_;
+  std::vector<DumpBlock*> free_blocks_;
+};
+
+// Writes dump blocks to files, formatting them as text lines, which are the
+// same as those of DeviceWorker::DumpField and DumpParam, or as binary.
+//
+// The binary file starts with the magic "PDDUMP01", then every block is
+//   uint32 kind, int64 batch id of params or 0, uint64 row num,
+//   uint64 column num,
+//   for every row: uint32 lineid size, lineid,
+//   for every column: uint32 name size, name, int32 data type,
+//     uint64 offsets[row num + 1], then offsets[row num] raw elements.
+// A param block has one row with an empty lineid.
+//
+// The files are opened by fs_open_write with converter, e.g. a compressor.
+// If max_bytes is positive, a new file is opened once max_bytes are written
+// to the current one, the files are named path-00000, path-00001 and so on.
+class DumpFileWriter {
+ public:
+  DumpFileWriter(const std::string& path, const std::string& converter,
+                 bool binary, int64_t max_bytes);
+  ~DumpFileWriter();
+
+  void Write(const DumpBlock& block);
+
+ private:
+  void FormatText(const DumpBlock& block);
+  void FormatBinary(const DumpBlock& block);
+  void Flush();
+  void Open();
+
+  std::string path_;
+  std::string converter_;
+  bool binary_;
+  int64_t max_bytes_;
+  int file_index_ = 0;
+  int64_t file_bytes_ = 0;
+  std::shared_ptr<FILE> fp_;
+  std::string buffer_;
+};
+
+}  // namespace framework
+}  // namespace paddle
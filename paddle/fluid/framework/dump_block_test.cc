@@ -0,0 +1,174 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/framework/dump_block.h"
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+static std::string ReadFile(const std::string& path) {
+  std::ifstream fin(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(fin),
+                     std::istreambuf_iterator<char>());
+}
+
+// Two instances, a float field of 2 and 1 values and an int64 field.
+static void FillFieldBlock(DumpBlock* block) {
+  block->Reset(DumpBlock::kField, 0);
+  block->AddRow("ins0");
+  block->AddRow("ins1");
+  float scores[] = {0.5f, 1.5f, 2.5f};
+  auto* score = block->AddColumn("score", proto::VarType::FP32);
+  block->Append(score, scores, 2);
+  block->Append(score, scores + 2, 1);
+  int64_t ids[] = {7, 8};
+  auto* id = block->AddColumn("id", proto::VarType::INT64);
+  block->Append(id, ids, 1);
+  block->Append(id, ids + 1, 1);
+}
+
+TEST(DumpBlock, Reuse) {
+  DumpBlockQueue queue(4);
+  DumpBlock* block = queue.Acquire();
+  FillFieldBlock(block);
+  EXPECT_EQ(block->row_num(), 2UL);
+  ASSERT_EQ(block->column_num(), 2UL);
+  EXPECT_EQ(block->column(0).offsets, std::vector<uint64_t>({0, 2, 3}));
+  EXPECT_EQ(block->column(0).bytes, 3 * sizeof(float));
+  const char* data = block->column(0).data.get();
+  queue.Release(block);
+
+  // The pooled block and its buffers are reused.
+  DumpBlock* reused = queue.Acquire();
+  EXPECT_EQ(reused, block);
+  FillFieldBlock(reused);
+  EXPECT_EQ(reused->column(0).data.get(), data);
+  queue.Release(reused);
+}
+
+TEST(DumpBlock, QueueThreads) {
+  DumpBlockQueue queue(2);
+  std::thread producer([&queue] {
+    for (int i = 0; i < 100; ++i) {
+      DumpBlock* block = queue.Acquire();
+      block->Reset(DumpBlock::kParam, i);
+      queue.Put(block);
+    }
+    queue.Close();
+  });
+  int64_t sum = 0;
+  DumpBlock* block = nullptr;
+  while (queue.Get(&block)) {
+    sum += block->batch_id();
+    queue.Release(block);
+  }
+  producer.join();
+  EXPECT_EQ(sum, 99 * 100 / 2);
+}
+
+TEST(DumpFileWriter, Text) {
+  DumpBlock block;
+  FillFieldBlock(&block);
+  DumpBlock param;
+  param.Reset(DumpBlock::kParam, 3);
+  param.AddRow("");
+  int w[] = {1, 2};
+  param.Append(param.AddColumn("w", proto::VarType::INT32), w, 2);
+  {
+    DumpFileWriter writer("dump_block_test.txt", "", false, 0);
+    writer.Write(block);
+    writer.Write(param);
+  }
+  EXPECT_EQ(ReadFile("dump_block_test.txt"),
+            "ins0\tscore:2:0.5:1.5\tid:1:7\n"
+            "ins1\tscore:1:2.5\tid:1:8\n"
+            "(3,w):1:2\n");
+}
+
+TEST(DumpFileWriter, Binary) {
+  DumpBlock block;
+  FillFieldBlock(&block);
+  {
+    DumpFileWriter writer("dump_block_test.bin", "", true, 0);
+    writer.Write(block);
+  }
+  std::string content = ReadFile("dump_block_test.bin");
+  ASSERT_EQ(content.substr(0, 8), "PDDUMP01");
+  const char* p = content.data() + 8;
+  auto read_u64 = [&p] {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return v;
+  };
+  auto read_u32 = [&p] {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return v;
+  };
+  EXPECT_EQ(read_u32(), static_cast<uint32_t>(DumpBlock::kField));
+  EXPECT_EQ(read_u64(), 0UL);  // batch id
+  EXPECT_EQ(read_u64(), 2UL);
+  EXPECT_EQ(read_u64(), 2UL);
+  for (auto lineid : {"ins0", "ins1"}) {
+    ASSERT_EQ(read_u32(), 4U);
+    EXPECT_EQ(std::string(p, 4), lineid);
+    p += 4;
+  }
+  ASSERT_EQ(read_u32(), 5U);
+  EXPECT_EQ(std::string(p, 5), "score");
+  p += 5;
+  EXPECT_EQ(static_cast<int32_t>(read_u32()), proto::VarType::FP32);
+  EXPECT_EQ(read_u64(), 0UL);
+  EXPECT_EQ(read_u64(), 2UL);
+  EXPECT_EQ(read_u64(), 3UL);
+  float scores[3];
+  std::memcpy(scores, p, sizeof(scores));
+  p += sizeof(scores);
+  EXPECT_EQ(scores[2], 2.5f);
+  ASSERT_EQ(read_u32(), 2U);
+  p += 2 + sizeof(int32_t) + 3 * sizeof(uint64_t) + 2 * sizeof(int64_t);
+  EXPECT_EQ(p, content.data() + content.size());
+}
+
+TEST(DumpFileWriter, Rotate) {
+  DumpBlock block;
+  FillFieldBlock(&block);
+  {
+    DumpFileWriter writer("dump_block_rotate", "", false, 40);
+    for (int i = 0; i < 3; ++i) {
+      writer.Write(block);
+    }
+  }
+  // Every block is 52 bytes of text, more than a file holds.
+  for (auto path : {"dump_block_rotate-00000", "dump_block_rotate-00001",
+                    "dump_block_rotate-00002"}) {
+    EXPECT_EQ(ReadFile(path), "ins0\tscore:2:0.5:1.5\tid:1:7\n"
+                              "ins1\tscore:1:2.5\tid:1:8\n");
+  }
+  std::ifstream next("dump_block_rotate-00003");
+  EXPECT_FALSE(next.is_open());
+}
+
+}  // namespace framework
+}  // namespace paddle
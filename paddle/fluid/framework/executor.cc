@@ -42,6 +42,7 @@ limitations under the License. */
 #endif
 
 DECLARE_bool(benchmark);
+DECLARE_bool(executor_memory_plan);
 DECLARE_bool(use_mkldnn);
 
 namespace paddle {
@@ -68,6 +69,15 @@ void ExecutorPrepareContext::PrepareUnusedVars(
         prog_, block_id_, ops_);
   }
 
+  if (FLAGS_executor_memory_plan) {
+    std::vector<OperatorBase*> ops;
+    for (auto& op : ops_) {
+      ops.push_back(op.get());
+    }
+    memory_planner_.reset(
+        new MemoryPlanner(prog_.Block(block_id_), ops, keep_vars));
+  }
+
   force_disable_gc_ = force_disable_gc;
   if (GetEagerDeletionThreshold() < 0 || force_disable_gc_) {
     return;
@@ -471,9 +481,21 @@ void Executor::RunPartialPreparedContext(ExecutorPrepareContext* ctx,
     }
   }
 
+  // The plan covers the whole block, partial runs allocate as usual.
+  MemoryPlanner* memory_planner = nullptr;
+  if (ctx->memory_planner_ && ctx->memory_planner_->Enabled() &&
+      platform::is_cpu_place(place_) && start_op_index == 0 &&
+      end_op_index == static_cast<int64_t>(ctx->ops_.size())) {
+    memory_planner = ctx->memory_planner_.get();
+    memory_planner->PreRun(*local_scope, place_);
+  }
+
   for (int64_t i = start_op_index; i < end_op_index; ++i) {
     auto& op = ctx->ops_[i];
     op->Run(*local_scope, place_);
+    if (memory_planner) {
+      memory_planner->PostOpRun(*local_scope, i);
+    }
     if (gc) {
       DeleteUnusedTensors(*local_scope, op.get(), ctx->unused_vars_, gc.get());
     }
@@ -481,6 +503,10 @@ void Executor::RunPartialPreparedContext(ExecutorPrepareContext* ctx,
 
   platform::DeviceContextPool::Instance().Get(place_)->Wait();
 
+  if (memory_planner) {
+    memory_planner->PostRun(*local_scope);
+  }
+
   if (local_scope != scope) {
     scope->DeleteScope(local_scope);
   } else {
@@ -0,0 +1,231 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/framework/fleet/auc_histogram.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>  // NOLINT
+#include <unordered_map>
+
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace framework {
+
+struct ThreadAucHistograms::Histogram {
+  Histogram() : samples(new uint32_t[kBufferSize]) {}
+
+  // 32 KB, flushed when a chunk of samples may not fit.
+  static constexpr int kBufferSize = 8192;
+
+  // Whether a live thread owns it.
+  std::atomic<bool> in_use{true};
+  // The bucket of a sample times 2 plus its label.
+  std::unique_ptr<uint32_t[]> samples;
+  int sample_num = 0;
+  double err[3] = {0, 0, 0};
+};
+
+constexpr int ThreadAucHistograms::Histogram::kBufferSize;
+
+namespace {
+
+std::atomic<uint64_t> g_histograms_serial{0};
+
+// The buffers of a thread, released for other threads when it exits. The
+// ThreadAucHistograms own the buffers, the entries of the destroyed ones are
+// dropped when the thread caches a new buffer.
+struct ThreadHistogramCache {
+  struct Entry {
+    ThreadAucHistograms::Histogram* hist;
+    std::weak_ptr<ThreadAucHistograms::Histogram> owned;
+  };
+
+  ~ThreadHistogramCache() {
+    for (auto& item : hists) {
+      auto hist = item.second.owned.lock();
+      if (hist != nullptr) {
+        hist->in_use = false;
+      }
+    }
+  }
+
+  void Insert(uint64_t serial,
+              const std::shared_ptr<ThreadAucHistograms::Histogram>& hist) {
+    for (auto iter = hists.begin(); iter != hists.end();) {
+      if (iter->second.owned.expired()) {
+        iter = hists.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    hists.emplace(serial, Entry{hist.get(), hist});
+  }
+
+  std::unordered_map<uint64_t, Entry> hists;
+};
+
+thread_local ThreadHistogramCache g_thread_histograms;
+
+// Samples are bucketed and checked in chunks of this size.
+constexpr int kChunkSize = 256;
+
+}  // namespace
+
+ThreadAucHistograms::ThreadAucHistograms(int table_size)
+    : table_size_(table_size), serial_(g_histograms_serial++) {
+  PADDLE_ENFORCE_GT(table_size, 0,
+                    platform::errors::InvalidArgument(
+                        "The AUC table size should be greater than 0, but "
+                        "got %d.",
+                        table_size));
+  table_[0].assign(table_size_, 0.0);
+  table_[1].assign(table_size_, 0.0);
+}
+
+ThreadAucHistograms::~ThreadAucHistograms() {}
+
+ThreadAucHistograms::Histogram* ThreadAucHistograms::ThreadHistogram() {
+  auto& cache = g_thread_histograms;
+  auto iter = cache.hists.find(serial_);
+  if (iter != cache.hists.end()) {
+    // The entry is alive as long as this object.
+    return iter->second.hist;
+  }
+  std::shared_ptr<Histogram> hist;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& free_hist : hists_) {
+      bool in_use = false;
+      if (free_hist->in_use.compare_exchange_strong(in_use, true)) {
+        hist = free_hist;
+        break;
+      }
+    }
+    if (hist == nullptr) {
+      hist = std::make_shared<Histogram>();
+      hists_.push_back(hist);
+    }
+  }
+  cache.Insert(serial_, hist);
+  return hist.get();
+}
+
+void ThreadAucHistograms::Add(const float* pred, const int64_t* label,
+                              const int64_t* mask, int n) {
+  Histogram* hist = ThreadHistogram();
+  uint32_t pos[kChunkSize];
+  double abserr = 0, sqrerr = 0, pred_sum = 0;
+  for (int begin = 0; begin < n; begin += kChunkSize) {
+    int end = std::min(begin + kChunkSize, n);
+    // Bucket and check the chunk first, the loop has no branch. The samples
+    // masked out are not checked, and an invalid pred is bucketed as 0.
+    int bad = 0;
+    for (int i = begin; i < end; ++i) {
+      float p = pred[i];
+      int64_t l = label[i];
+      int invalid = static_cast<int>(!(p >= 0.f && p <= 1.f)) |
+                    static_cast<int>((l & ~1LL) != 0);
+      bad |= static_cast<int>(mask == nullptr || mask[i] != 0) & invalid;
+      p = invalid ? 0.f : p;
+      // In double as add_unlock_data does, not to move boundary samples.
+      int bucket = std::min(
+          static_cast<int>(static_cast<double>(p) * table_size_),
+          table_size_ - 1);
+      pos[i - begin] = static_cast<uint32_t>(bucket) * 2 + (l & 1);
+    }
+    PADDLE_ENFORCE_EQ(
+        bad, 0,
+        platform::errors::PreconditionNotMet(
+            "pred should be in [0, 1] and label should be 0 or 1."));
+    if (hist->sample_num + kChunkSize > Histogram::kBufferSize) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      FlushLocked(hist);
+    }
+    uint32_t* samples = hist->samples.get();
+    for (int i = begin; i < end; ++i) {
+      if (mask != nullptr && mask[i] == 0) {
+        continue;
+      }
+      double p = pred[i];
+      int64_t l = label[i];
+      samples[hist->sample_num++] = pos[i - begin];
+      abserr += std::fabs(p - l);
+      sqrerr += (p - l) * (p - l);
+      pred_sum += p;
+    }
+  }
+  hist->err[0] += abserr;
+  hist->err[1] += sqrerr;
+  hist->err[2] += pred_sum;
+}
+
+void ThreadAucHistograms::FlushLocked(Histogram* hist) {
+  double* table[2] = {table_[0].data(), table_[1].data()};
+  const uint32_t* samples = hist->samples.get();
+  for (int i = 0; i < hist->sample_num; ++i) {
+    ++table[samples[i] & 1][samples[i] >> 1];
+  }
+  hist->sample_num = 0;
+}
+
+void ThreadAucHistograms::Merge(double* table[2], double err[3],
+                                int thread_num) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& hist : hists_) {
+    FlushLocked(hist.get());
+    for (int i = 0; i < 3; ++i) {
+      err[i] += hist->err[i];
+      hist->err[i] = 0;
+    }
+  }
+  thread_num = std::max(1, std::min(thread_num, table_size_));
+  int chunk = (table_size_ + thread_num - 1) / thread_num;
+  auto merge = [this, table, chunk](int tid) {
+    int begin = tid * chunk;
+    int end = std::min(begin + chunk, table_size_);
+    for (int label = 0; label < 2; ++label) {
+      double* out = table[label];
+      double* counts = table_[label].data();
+      for (int i = begin; i < end; ++i) {
+        out[i] += counts[i];
+        counts[i] = 0;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int tid = 1; tid < thread_num; ++tid) {
+    threads.emplace_back(merge, tid);
+  }
+  merge(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void ThreadAucHistograms::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int label = 0; label < 2; ++label) {
+    std::fill(table_[label].begin(), table_[label].end(), 0.0);
+  }
+  for (auto& hist : hists_) {
+    hist->sample_num = 0;
+    std::fill(hist->err, hist->err + 3, 0.0);
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,69 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// AUC samples collected in a buffer per thread, so that threads add samples
+// without locking. A buffer keeps the buckets of up to a few thousand
+// samples and is flushed into a shared table when full, so a thread takes
+// the lock once for many batches and its memory does not grow with the
+// table size. The buffers of exited threads are reused by new threads.
+//
+// Add() may run concurrently, Merge() and Reset() may not run concurrently
+// with anything.
+class ThreadAucHistograms {
+ public:
+  explicit ThreadAucHistograms(int table_size);
+  ~ThreadAucHistograms();
+
+  // Add pred[i] with label[i] for the i with mask[i] != 0, or all i if mask
+  // is null. pred should be in [0, 1] and label be 0 or 1, they are checked
+  // once for every few hundreds of samples.
+  void Add(const float* pred, const int64_t* label, const int64_t* mask,
+           int n);
+
+  // Add the counts and errors of all threads to table[0] (negative),
+  // table[1] (positive) and err (abserr, sqrerr, pred), with thread_num
+  // threads, then clear them.
+  void Merge(double* table[2], double err[3], int thread_num);
+  void Reset();
+
+  int table_size() const { return table_size_; }
+
+  // The buffer of a thread.
+  struct Histogram;
+
+ private:
+  Histogram* ThreadHistogram();
+  // Add the buffered samples to table_, with mutex_ held.
+  void FlushLocked(Histogram* hist);
+
+  const int table_size_;
+  // Identifies this object in the thread local caches.
+  const uint64_t serial_;
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Histogram>> hists_;
+  // The counts of the flushed samples.
+  std::vector<double> table_[2];
+};
+
+}  // namespace framework
+}  // namespace paddle
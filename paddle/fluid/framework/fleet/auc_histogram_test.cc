@@ -0,0 +1,246 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/framework/fleet/auc_histogram.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace paddle {
+namespace framework {
+
+struct AucBatch {
+  std::vector<float> pred;
+  std::vector<int64_t> label;
+  std::vector<int64_t> mask;
+};
+
+static AucBatch RandomBatch(int n, int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(0.f, 1.f);
+  AucBatch batch;
+  for (int i = 0; i < n; ++i) {
+    float p = dist(rng);
+    batch.pred.push_back(p);
+    batch.label.push_back(dist(rng) < p ? 1 : 0);
+    batch.mask.push_back(i % 3 != 0);
+  }
+  batch.pred[0] = 0.f;
+  batch.pred[1] = 1.f;
+  return batch;
+}
+
+// What BasicAucCalculator::add_unlock_data does.
+static void AddReference(const AucBatch& batch, bool use_mask,
+                         int table_size, std::vector<double> table[2],
+                         double err[3]) {
+  for (size_t i = 0; i < batch.pred.size(); ++i) {
+    if (use_mask && batch.mask[i] == 0) continue;
+    double pred = batch.pred[i];
+    int label = batch.label[i];
+    int pos = std::min(static_cast<int>(pred * table_size), table_size - 1);
+    err[0] += std::fabs(pred - label);
+    err[1] += (pred - label) * (pred - label);
+    err[2] += pred;
+    ++table[label][pos];
+  }
+}
+
+TEST(ThreadAucHistograms, Merge) {
+  const int table_size = 1000;
+  const int thread_num = 8;
+  std::vector<double> ref_table[2] = {std::vector<double>(table_size),
+                                      std::vector<double>(table_size)};
+  double ref_err[3] = {0, 0, 0};
+  std::vector<AucBatch> batches;
+  for (int i = 0; i < thread_num * 4; ++i) {
+    batches.push_back(RandomBatch(1000, i));
+    AddReference(batches.back(), i % 2 == 1, table_size, ref_table, ref_err);
+  }
+
+  ThreadAucHistograms hists(table_size);
+  // Two rounds of threads, the second reuses the histograms of the first.
+  for (int round = 0; round < 2; ++round) {
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < thread_num; ++tid) {
+      threads.emplace_back([&, tid, round] {
+        for (int i = 0; i < 2; ++i) {
+          int idx = round * thread_num * 2 + tid * 2 + i;
+          auto& batch = batches[idx];
+          hists.Add(batch.pred.data(), batch.label.data(),
+                    idx % 2 == 1 ? batch.mask.data() : nullptr,
+                    batch.pred.size());
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  std::vector<double> table[2] = {std::vector<double>(table_size),
+                                  std::vector<double>(table_size)};
+  double* table_ptr[2] = {table[0].data(), table[1].data()};
+  double err[3] = {0, 0, 0};
+  hists.Merge(table_ptr, err, 3);
+  EXPECT_EQ(table[0], ref_table[0]);
+  EXPECT_EQ(table[1], ref_table[1]);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_NEAR(err[i], ref_err[i], 1e-6 * ref_err[i]);
+  }
+
+  // Merge cleared the histograms.
+  hists.Merge(table_ptr, err, 3);
+  EXPECT_EQ(table[0], ref_table[0]);
+
+  hists.Add(batches[0].pred.data(), batches[0].label.data(), nullptr, 1000);
+  hists.Reset();
+  hists.Merge(table_ptr, err, 1);
+  EXPECT_EQ(table[1], ref_table[1]);
+}
+
+TEST(ThreadAucHistograms, Flush) {
+  const int table_size = 1 << 16;
+  std::vector<double> ref_table[2] = {std::vector<double>(table_size),
+                                      std::vector<double>(table_size)};
+  double ref_err[3] = {0, 0, 0};
+  std::vector<double> table[2] = {std::vector<double>(table_size),
+                                  std::vector<double>(table_size)};
+  double* table_ptr[2] = {table[0].data(), table[1].data()};
+  double err[3] = {0, 0, 0};
+  // Batches larger than a thread buffer, in a thread that also keeps the
+  // buffers of destroyed objects in its cache.
+  std::thread thread([&] {
+    for (int round = 0; round < 3; ++round) {
+      ThreadAucHistograms hists(table_size);
+      for (int i = 0; i < 3; ++i) {
+        AucBatch batch = RandomBatch(20000, round * 3 + i);
+        AddReference(batch, i == 1, table_size, ref_table, ref_err);
+        hists.Add(batch.pred.data(), batch.label.data(),
+                  i == 1 ? batch.mask.data() : nullptr, batch.pred.size());
+      }
+      hists.Merge(table_ptr, err, 2);
+    }
+  });
+  thread.join();
+  EXPECT_EQ(table[0], ref_table[0]);
+  EXPECT_EQ(table[1], ref_table[1]);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_NEAR(err[i], ref_err[i], 1e-6 * ref_err[i]);
+  }
+}
+
+TEST(ThreadAucHistograms, Check) {
+  ThreadAucHistograms hists(100);
+  std::vector<float> pred = {0.5f, 1.5f};
+  std::vector<int64_t> label = {0, 1};
+  EXPECT_ANY_THROW(hists.Add(pred.data(), label.data(), nullptr, 2));
+  pred[1] = NAN;
+  EXPECT_ANY_THROW(hists.Add(pred.data(), label.data(), nullptr, 2));
+  pred[1] = 0.5f;
+  label[1] = 2;
+  EXPECT_ANY_THROW(hists.Add(pred.data(), label.data(), nullptr, 2));
+}
+
+TEST(ThreadAucHistograms, CheckMasked) {
+  ThreadAucHistograms hists(100);
+  std::vector<float> pred = {0.25f, 1.5f, NAN, 0.5f, 0.75f};
+  std::vector<int64_t> label = {0, 1, 0, 2, 1};
+  std::vector<int64_t> mask = {1, 0, 0, 0, 1};
+  // The invalid samples are masked out.
+  EXPECT_NO_THROW(hists.Add(pred.data(), label.data(), mask.data(), 5));
+  mask[3] = 1;
+  EXPECT_ANY_THROW(hists.Add(pred.data(), label.data(), mask.data(), 5));
+
+  hists.Reset();
+  mask[3] = 0;
+  hists.Add(pred.data(), label.data(), mask.data(), 5);
+  std::vector<double> table[2] = {std::vector<double>(100),
+                                  std::vector<double>(100)};
+  double* table_ptr[2] = {table[0].data(), table[1].data()};
+  double err[3] = {0, 0, 0};
+  hists.Merge(table_ptr, err, 1);
+  EXPECT_EQ(table[0][25], 1.0);
+  EXPECT_EQ(table[1][75], 1.0);
+  EXPECT_DOUBLE_EQ(err[0], 0.25 + 0.25);
+  EXPECT_DOUBLE_EQ(err[2], 0.25 + 0.75);
+}
+
+// 64 threads adding batches with a locked shared table, as add_data does
+// without thread local buffers, and with them. Run with
+// --gtest_also_run_disabled_tests.
+TEST(ThreadAucHistograms, DISABLED_Benchmark) {
+  const int table_size = 1 << 16;
+  const int thread_num = 64;
+  const int batch_num = 50;
+  const int batch_size = 2048;
+  AucBatch batch = RandomBatch(batch_size, 0);
+
+  auto run = [&](std::function<void()> add_batch) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < thread_num; ++tid) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < batch_num; ++i) add_batch();
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+
+  std::mutex mutex;
+  std::vector<double> table[2] = {std::vector<double>(table_size),
+                                  std::vector<double>(table_size)};
+  double err[3] = {0, 0, 0};
+  double locked_ms = run([&] {
+    std::lock_guard<std::mutex> lock(mutex);
+    AddReference(batch, false, table_size, table, err);
+  });
+
+  ThreadAucHistograms hists(table_size);
+  double hists_ms = run([&] {
+    hists.Add(batch.pred.data(), batch.label.data(), nullptr, batch_size);
+  });
+  std::vector<double> merged[2] = {std::vector<double>(table_size),
+                                   std::vector<double>(table_size)};
+  double* merged_ptr[2] = {merged[0].data(), merged[1].data()};
+  double merged_err[3] = {0, 0, 0};
+  auto start = std::chrono::steady_clock::now();
+  hists.Merge(merged_ptr, merged_err, 16);
+  double merge_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+  LOG(INFO) << thread_num << " threads, " << batch_num << " batches of "
+            << batch_size << ": locked table " << locked_ms
+            << " ms, thread local buffers " << hists_ms << " ms, merge "
+            << merge_ms << " ms";
+  EXPECT_EQ(merged[0], table[0]);
+  EXPECT_EQ(merged[1], table[1]);
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -29,6 +29,10 @@ DECLARE_int32(gpu_replica_cache_dim);
 DECLARE_bool(enable_force_hbm_recyle);
 DECLARE_bool(enable_force_mem_recyle);
 DECLARE_bool(enbale_slotpool_auto_clear);
+DECLARE_bool(padbox_auc_thread_local_hist);
+DECLARE_int32(padbox_auc_merge_thread_num);
+DECLARE_int32(padbox_auc_sketch_max_buckets);
+DECLARE_int32(padbox_uauc_sketch_max_buckets);
 namespace paddle {
 namespace framework {
 
@@ -57,7 +61,11 @@ void BasicAucCalculator::add_unlock_data(double pred, int label) {
   _local_abserr += fabs(pred - label);
   _local_sqrerr += (pred - label) * (pred - label);
   _local_pred += pred;
-  ++_table[label][pos];
+  if (_sketch != nullptr) {
+    _sketch->Add(pred, label);
+  } else {
+    ++_table[label][pos];
+  }
 }
 
 void BasicAucCalculator::add_unlock_data(double pred, int label,
@@ -83,7 +91,19 @@ void BasicAucCalculator::add_unlock_data(double pred, int label,
   _local_sqrerr += (pred - label) * (pred - label);
 
   _local_pred += pred * sample_scale;
-  _table[label][pos] += sample_scale;
+  if (_sketch != nullptr) {
+    _sketch->Add(pred, label, sample_scale);
+  } else {
+    _table[label][pos] += sample_scale;
+  }
+}
+
+void BasicAucCalculator::add_unlock_user_data(double pred, int label,
+                                              uint64_t uid) {
+  add_unlock_data(pred, label);
+  if (_user_sketch != nullptr) {
+    _user_sketch->Add(uid, pred, label);
+  }
 }
 
 void BasicAucCalculator::add_data(const float* d_pred, const int64_t* d_label,
@@ -101,6 +121,10 @@ void BasicAucCalculator::add_data(const float* d_pred, const int64_t* d_label,
     cudaMemcpy(h_label.data(), d_label, sizeof(int64_t) * batch_size,
                cudaMemcpyDeviceToHost);
 
+    if (_thread_hists != nullptr) {
+      _thread_hists->Add(h_pred.data(), h_label.data(), nullptr, batch_size);
+      return;
+    }
     std::lock_guard<std::mutex> lock(_table_mutex);
     for (int i = 0; i < batch_size; ++i) {
       add_unlock_data(h_pred[i], h_label[i]);
@@ -149,6 +173,11 @@ void BasicAucCalculator::add_mask_data(const float* d_pred,
     cudaMemcpy(h_mask.data(), d_mask, sizeof(int64_t) * batch_size,
                cudaMemcpyDeviceToHost);
 
+    if (_thread_hists != nullptr) {
+      _thread_hists->Add(h_pred.data(), h_label.data(), h_mask.data(),
+                         batch_size);
+      return;
+    }
     std::lock_guard<std::mutex> lock(_table_mutex);
     for (int i = 0; i < batch_size; ++i) {
       if (h_mask[i]) {
@@ -171,6 +200,9 @@ void BasicAucCalculator::init(int table_size, int max_batch_size) {
   for (int i = 0; i < 2; i++) {
     _table[i] = std::vector<double>();
   }
+  if (FLAGS_padbox_auc_thread_local_hist && !_mode_collect_in_gpu) {
+    _thread_hists.reset(new ThreadAucHistograms(_table_size));
+  }
   // init GPU memory
   if (_mode_collect_in_gpu) {
     for (int i = 0; i < platform::GetCUDADeviceCount(); ++i) {
@@ -191,14 +223,40 @@ void BasicAucCalculator::init(int table_size, int max_batch_size) {
   reset();
 }
 
+void BasicAucCalculator::init_sketch(int max_buckets) {
+  PADDLE_ENFORCE_EQ(_mode_collect_in_gpu, false,
+                    platform::errors::Unimplemented(
+                        "The sketch backend does not support "
+                        "mode_collect_in_gpu."));
+  _sketch.reset(new AucSketch(_table_size, max_buckets));
+  _thread_hists.reset();
+  for (int i = 0; i < 2; i++) {
+    std::vector<double>().swap(_table[i]);
+  }
+}
+
+void BasicAucCalculator::init_user_sketch(int max_buckets_per_user) {
+  _user_sketch.reset(new UserAucSketch(_table_size, max_buckets_per_user));
+}
+
 void BasicAucCalculator::reset() {
   // reset CPU counter
-  for (int i = 0; i < 2; i++) {
-    _table[i].assign(_table_size, 0.0);
+  if (_sketch != nullptr) {
+    _sketch->Reset();
+  } else {
+    for (int i = 0; i < 2; i++) {
+      _table[i].assign(_table_size, 0.0);
+    }
+  }
+  if (_user_sketch != nullptr) {
+    _user_sketch->Reset();
   }
   _local_abserr = 0;
   _local_sqrerr = 0;
   _local_pred = 0;
+  if (_thread_hists != nullptr) {
+    _thread_hists->Reset();
+  }
   // reset GPU counter
   if (_mode_collect_in_gpu) {
     // backup orginal device
@@ -318,30 +376,70 @@ void BasicAucCalculator::copy_data_d2h(int device) {
   cudaSetDevice(ori_device);
 }
 
+void BasicAucCalculator::merge_thread_hists() {
+  double* table[2] = {&_table[0][0], &_table[1][0]};
+  double err[3] = {_local_abserr, _local_sqrerr, _local_pred};
+  _thread_hists->Merge(table, err, FLAGS_padbox_auc_merge_thread_num);
+  _local_abserr = err[0];
+  _local_sqrerr = err[1];
+  _local_pred = err[2];
+}
+
+void BasicAucCalculator::allreduce_sketch() {
+  // Sum the sketches on a common grid, see AucSketch::GridRange. The grid
+  // buffer holds the buckets non-empty on some worker, its size does not
+  // grow with the worker num.
+  auto& mpi = boxps::MPICluster::Ins();
+  int rank = mpi.rank();
+  int size = mpi.size();
+  std::vector<double> headers(size * AucSketch::kGridHeaderSize, 0.0);
+  _sketch->GridHeader(headers.data() + rank * AucSketch::kGridHeaderSize);
+  mpi.allreduce_sum(headers.data(), headers.size());
+  int shift = 0;
+  int64_t begin = 0;
+  int64_t end = 0;
+  if (!AucSketch::GridRange(headers.data(), size, &shift, &begin, &end)) {
+    return;
+  }
+  std::vector<double> counts(2 * (end - begin), 0.0);
+  _sketch->FillGrid(shift, begin, counts.data());
+  mpi.allreduce_sum(counts.data(), counts.size());
+  _sketch->SetGrid(shift, begin, end, counts.data());
+}
+
 void BasicAucCalculator::compute() {
   if (_mode_collect_in_gpu) {
     // collect data
     collect_data_nccl();
     // copy from GPU0
     copy_data_d2h(0);
-  }
-
-  double* table[2] = {&_table[0][0], &_table[1][0]};
-  if (boxps::MPICluster::Ins().size() > 1) {
-    boxps::MPICluster::Ins().allreduce_sum(table[0], _table_size);
-    boxps::MPICluster::Ins().allreduce_sum(table[1], _table_size);
+  } else if (_thread_hists != nullptr) {
+    merge_thread_hists();
   }
 
   double area = 0;
   double fp = 0;
   double tp = 0;
 
-  for (int i = _table_size - 1; i >= 0; i--) {
-    double newfp = fp + table[0][i];
-    double newtp = tp + table[1][i];
-    area += (newfp - fp) * (tp + newtp) / 2;
-    fp = newfp;
-    tp = newtp;
+  if (_sketch != nullptr) {
+    if (boxps::MPICluster::Ins().size() > 1) {
+      allreduce_sketch();
+    }
+    _sketch->Area(&area, &fp, &tp);
+  } else {
+    double* table[2] = {&_table[0][0], &_table[1][0]};
+    if (boxps::MPICluster::Ins().size() > 1) {
+      boxps::MPICluster::Ins().allreduce_sum(table[0], _table_size);
+      boxps::MPICluster::Ins().allreduce_sum(table[1], _table_size);
+    }
+
+    for (int i = _table_size - 1; i >= 0; i--) {
+      double newfp = fp + table[0][i];
+      double newtp = tp + table[1][i];
+      area += (newfp - fp) * (tp + newtp) / 2;
+      fp = newfp;
+      tp = newtp;
+    }
   }
 
   if (fp < 1e-3 || tp < 1e-3) {
@@ -367,7 +465,21 @@ void BasicAucCalculator::compute() {
 
   _size = fp + tp;
 
-  calculate_bucket_error();
+  if (_sketch != nullptr) {
+    _bucket_error = _sketch->BucketError(kMaxSpan, kRelativeErrorBound);
+  } else {
+    calculate_bucket_error();
+  }
+
+  if (_user_sketch != nullptr) {
+    // Every user is expected on one worker, e.g. by shuffling by uid.
+    double user_auc[3];
+    _user_sketch->Compute(user_auc);
+    if (boxps::MPICluster::Ins().size() > 1) {
+      boxps::MPICluster::Ins().allreduce_sum(user_auc, 3);
+    }
+    _uauc = user_auc[1] > 0 ? user_auc[0] / user_auc[1] : 0.0;
+  }
 }
 
 void BoxWrapper::CheckEmbedSizeIsValid(int embedx_dim, int expand_embed_dim) {
@@ -688,12 +800,16 @@ void BoxWrapper::RecordReplace(std::vector<SlotRecord>* records,
   platform::Timer timer;
   timer.Start();
 
-  std::vector<std::thread> threads;
+  std::vector<uint16_t> slot_vec(slots.begin(), slots.end());
+  // all the pools replace the same slots
+  std::vector<size_t> positions = random_ins_pool_list[0].SlotPositions(slots);
+  std::vector<std::future<void>> wait_futures;
   std::valarray<int> del_num(0, auc_runner_thread_num_);
   std::valarray<int> add_num(0, auc_runner_thread_num_);
   for (int tid = 0; tid < auc_runner_thread_num_; ++tid) {
-    threads.push_back(std::thread([this, records, tid, &slots, &del_num,
-                                   &add_num]() {
+    wait_futures.emplace_back(auc_runner_pool_->Run([this, records, tid,
+                                                     &slot_vec, &positions,
+                                                     &del_num, &add_num]() {
       size_t ins_num = records->size();
       int start = tid * ins_num / auc_runner_thread_num_;
       int end = (tid + 1) * ins_num / auc_runner_thread_num_;
@@ -703,18 +819,21 @@ void BoxWrapper::RecordReplace(std::vector<SlotRecord>* records,
         auto record = records->at(j);
         auto info = get_auc_runner_info(record);
         auto& random_pool = random_ins_pool_list[info->pool_id_];
-        FeasignValuesCandidate& candidate =
-            random_pool.GetUseReplaceId(info->replaced_id_);
+        const FeasignSlotArena* candidates = nullptr;
+        size_t item = 0;
+        random_pool.GetUseReplaceId(info->replaced_id_, &candidates, &item);
         record_replacers_[info->record_id_].replace(
-            &record->slot_uint64_feasigns_, candidate.feasign_values_, slots,
-            &del_num[tid], &add_num[tid]);
+            slot_vec, *candidates, item, positions,
+            &record->slot_uint64_feasigns_.slot_values,
+            &record->slot_uint64_feasigns_.slot_offsets, &del_num[tid],
+            &add_num[tid]);
       }
       VLOG(3) << "thread[" << tid << "]: erase feasign num: " << del_num[tid]
               << " repush feasign num: " << add_num[tid];
     }));
   }
-  for (int tid = 0; tid < auc_runner_thread_num_; ++tid) {
-    threads[tid].join();
+  for (auto& f : wait_futures) {
+    f.get();
   }
 
   timer.Pause();
@@ -730,12 +849,13 @@ void BoxWrapper::RecordReplaceBack(std::vector<SlotRecord>* records,
   platform::Timer timer;
   timer.Start();
 
-  std::vector<std::thread> threads;
+  std::vector<uint16_t> slot_vec(slots.begin(), slots.end());
+  std::vector<std::future<void>> wait_futures;
   std::valarray<int> del_num(0, auc_runner_thread_num_);
   std::valarray<int> add_num(0, auc_runner_thread_num_);
   for (int tid = 0; tid < auc_runner_thread_num_; ++tid) {
-    threads.push_back(
-        std::thread([this, records, tid, &slots, &del_num, &add_num]() {
+    wait_futures.emplace_back(auc_runner_pool_->Run(
+        [this, records, tid, &slot_vec, &del_num, &add_num]() {
           size_t ins_num = records->size();
           int start = tid * ins_num / auc_runner_thread_num_;
           int end = (tid + 1) * ins_num / auc_runner_thread_num_;
@@ -746,7 +866,8 @@ void BoxWrapper::RecordReplaceBack(std::vector<SlotRecord>* records,
             auto record = records->at(j);
             auto info = get_auc_runner_info(record);
             record_replacers_[info->record_id_].replace_back(
-                &record->slot_uint64_feasigns_, slots, &del_num[tid],
+                slot_vec, &record->slot_uint64_feasigns_.slot_values,
+                &record->slot_uint64_feasigns_.slot_offsets, &del_num[tid],
                 &add_num[tid]);
           }
           VLOG(3) << "thread[" << tid
@@ -754,8 +875,8 @@ void BoxWrapper::RecordReplaceBack(std::vector<SlotRecord>* records,
                   << " repush feasign num: " << add_num[tid];
         }));
   }
-  for (int tid = 0; tid < auc_runner_thread_num_; ++tid) {
-    threads[tid].join();
+  for (auto& f : wait_futures) {
+    f.get();
   }
   timer.Pause();
   VLOG(0) << "End RecordReplaceBack: " << timer.ElapsedMS() << std::endl
@@ -770,28 +891,31 @@ void BoxWrapper::GetRandomReplace(std::vector<SlotRecord>* records) {
 
   std::lock_guard<std::mutex> lock(mutex4random_pool_);
   size_t ins_num = records->size();
-  std::vector<std::thread> threads;
+  std::vector<std::future<void>> wait_futures;
   for (int tid = 0; tid < auc_runner_thread_num_; ++tid) {
-    threads.push_back(std::thread([this, records, tid, ins_num]() {
-      int start = tid * ins_num / auc_runner_thread_num_;
-      int end = (tid + 1) * ins_num / auc_runner_thread_num_;
-      VLOG(3) << "GetRandomReplace begin for thread[" << tid
-              << "], and process [" << start << ", " << end
-              << "), total ins: " << ins_num;
-      auto& random_pool = random_ins_pool_list[tid];
-      for (int i = start; i < end; ++i) {
-        auto record = records->at(i);
-        auto info = get_auc_runner_info(record);
-        info->record_id_ = i;
-        info->pool_id_ = tid;
-        info->replaced_id_ =
-            random_pool.AddAndGet(record->slot_uint64_feasigns_);
-      }
-    }));
+    wait_futures.emplace_back(
+        auc_runner_pool_->Run([this, records, tid, ins_num]() {
+          int start = tid * ins_num / auc_runner_thread_num_;
+          int end = (tid + 1) * ins_num / auc_runner_thread_num_;
+          VLOG(3) << "GetRandomReplace begin for thread[" << tid
+                  << "], and process [" << start << ", " << end
+                  << "), total ins: " << ins_num;
+          auto& random_pool = random_ins_pool_list[tid];
+          auto& random = FleetWrapper::GetInstance()->LocalRandomEngine();
+          for (int i = start; i < end; ++i) {
+            auto record = records->at(i);
+            auto info = get_auc_runner_info(record);
+            info->record_id_ = i;
+            info->pool_id_ = tid;
+            info->replaced_id_ = random_pool.AddAndGet(
+                record->slot_uint64_feasigns_.slot_values,
+                record->slot_uint64_feasigns_.slot_offsets, &random);
+          }
+        }));
   }
 
-  for (int tid = 0; tid < auc_runner_thread_num_; ++tid) {
-    threads[tid].join();
+  for (auto& f : wait_futures) {
+    f.get();
   }
   timer.Pause();
 
@@ -805,27 +929,30 @@ void BoxWrapper::AddReplaceFeasign(boxps::PSAgentBase* p_agent,
   timer.Start();
 
   std::lock_guard<std::mutex> lock(mutex4random_pool_);
-  std::vector<std::thread> threads;
+  std::vector<std::future<void>> wait_futures;
   for (int tid = 0; tid < feed_pass_thread_num; ++tid) {
-    threads.push_back(std::thread([this, tid, p_agent, feed_pass_thread_num]() {
-      VLOG(3) << "AddReplaceFeasign begin for thread[" << tid << "]";
-      for (size_t pool_id = tid; pool_id < random_ins_pool_list.size();
-           pool_id += feed_pass_thread_num) {
-        auto& random_pool = random_ins_pool_list[pool_id];
-        for (size_t i = 0; i < random_pool.Size(); ++i) {
-          auto& candidate = random_pool.GetUseId(i);
-          for (const auto& pair : candidate.feasign_values_) {
-            for (const auto feasign : pair.second) {
-              p_agent->AddKey(feasign, tid);
+    wait_futures.emplace_back(
+        auc_runner_pool_->Run([this, tid, p_agent, feed_pass_thread_num]() {
+          VLOG(3) << "AddReplaceFeasign begin for thread[" << tid << "]";
+          for (size_t pool_id = tid; pool_id < random_ins_pool_list.size();
+               pool_id += feed_pass_thread_num) {
+            auto& random_pool = random_ins_pool_list[pool_id];
+            for (size_t i = 0; i < random_pool.Size(); ++i) {
+              const FeasignSlotArena* candidates = nullptr;
+              size_t item = 0;
+              random_pool.GetUseId(i, &candidates, &item);
+              size_t num = 0;
+              const uint64_t* feasigns = candidates->ItemValues(item, &num);
+              for (size_t k = 0; k < num; ++k) {
+                p_agent->AddKey(feasigns[k], tid);
+              }
             }
           }
-        }
-      }
-    }));
+        }));
   }
 
-  for (int tid = 0; tid < feed_pass_thread_num; ++tid) {
-    threads[tid].join();
+  for (auto& f : wait_futures) {
+    f.get();
   }
   timer.Pause();
 
@@ -1193,6 +1320,52 @@ class CmatchRankMaskMetricMsg : public MetricMsg {
   std::string mask_varname_;
 };
 
+// AUC and UAUC, the AUC of the samples grouped by uid.
+class UserAucMetricMsg : public MetricMsg {
+ public:
+  UserAucMetricMsg(const std::string& label_varname,
+                   const std::string& pred_varname, int metric_phase,
+                   const std::string& uid_varname, int bucket_size = 1000000) {
+    label_varname_ = label_varname;
+    pred_varname_ = pred_varname;
+    uid_varname_ = uid_varname;
+    metric_phase_ = metric_phase;
+    calculator = new BasicAucCalculator();
+    calculator->init(bucket_size);
+    calculator->init_user_sketch(FLAGS_padbox_uauc_sketch_max_buckets);
+  }
+  virtual ~UserAucMetricMsg() {}
+  void add_data(const Scope* exe_scope,
+                const paddle::platform::Place& place) override {
+    std::vector<int64_t> uid_data;
+    get_data<int64_t>(exe_scope, uid_varname_, &uid_data);
+    std::vector<int64_t> label_data;
+    get_data<int64_t>(exe_scope, label_varname_, &label_data);
+    std::vector<float> pred_data;
+    get_data<float>(exe_scope, pred_varname_, &pred_data);
+    size_t batch_size = uid_data.size();
+    PADDLE_ENFORCE_EQ(
+        batch_size, label_data.size(),
+        platform::errors::PreconditionNotMet(
+            "illegal batch size: uid[%lu] and label_data[%lu]", batch_size,
+            label_data.size()));
+    PADDLE_ENFORCE_EQ(
+        batch_size, pred_data.size(),
+        platform::errors::PreconditionNotMet(
+            "illegal batch size: uid[%lu] and pred_data[%lu]", batch_size,
+            pred_data.size()));
+    auto cal = GetCalculator();
+    std::lock_guard<std::mutex> lock(cal->table_mutex());
+    for (size_t i = 0; i < batch_size; ++i) {
+      cal->add_unlock_user_data(pred_data[i], label_data[i],
+                                static_cast<uint64_t>(uid_data[i]));
+    }
+  }
+
+ protected:
+  std::string uid_varname_;
+};
+
 const std::vector<std::string> BoxWrapper::GetMetricNameList(
     int metric_phase) const {
   VLOG(0) << "Want to Get metric phase: " << metric_phase;
@@ -1227,7 +1400,8 @@ void BoxWrapper::InitMetric(const std::string& method, const std::string& name,
                             const std::string& cmatch_rank_group,
                             bool ignore_rank, int bucket_size,
                             bool mode_collect_in_gpu, int max_batch_size,
-                            const std::string& sample_scale_varname) {
+                            const std::string& sample_scale_varname,
+                            bool use_sketch, const std::string& uid_varname) {
   if (method == "AucCalculator") {
     metric_lists_.emplace(
         name, new MetricMsg(label_varname, pred_varname, metric_phase,
@@ -1259,11 +1433,19 @@ void BoxWrapper::InitMetric(const std::string& method, const std::string& name,
         name, new CmatchRankMaskMetricMsg(
                   label_varname, pred_varname, metric_phase, cmatch_rank_group,
                   cmatch_rank_varname, ignore_rank, mask_varname, bucket_size));
+  } else if (method == "UserAucCalculator") {
+    metric_lists_.emplace(
+        name, new UserAucMetricMsg(label_varname, pred_varname, metric_phase,
+                                   uid_varname, bucket_size));
   } else {
     PADDLE_THROW(platform::errors::Unimplemented(
         "PaddleBox only support AucCalculator, MultiTaskAucCalculator, "
-        "CmatchRankAucCalculator, MaskAucCalculator and "
-        "CmatchRankMaskAucCalculator"));
+        "CmatchRankAucCalculator, MaskAucCalculator, "
+        "CmatchRankMaskAucCalculator and UserAucCalculator"));
+  }
+  if (use_sketch) {
+    metric_lists_[name]->GetCalculator()->init_sketch(
+        FLAGS_padbox_auc_sketch_max_buckets);
   }
   metric_name_list_.emplace_back(name);
 }
@@ -1284,6 +1466,11 @@ const std::vector<double> BoxWrapper::GetMetricMsg(const std::string& name) {
   metric_return_values_[5] = auc_cal_->predicted_ctr();
   metric_return_values_[6] = auc_cal_->actual_ctr() / auc_cal_->predicted_ctr();
   metric_return_values_[7] = auc_cal_->size();
+  // UAUC is a 9th value of the metrics that compute it only, the others
+  // keep the 8 values their callers unpack.
+  if (auc_cal_->has_uauc()) {
+    metric_return_values_.push_back(auc_cal_->uauc());
+  }
   auc_cal_->reset();
   return metric_return_values_;
 }
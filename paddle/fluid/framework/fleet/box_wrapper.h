@@ -39,19 +39,25 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/data_feed.h"
 #include "paddle/fluid/framework/data_set.h"
+#include "paddle/fluid/framework/fleet/auc_histogram.h"
+#include "paddle/fluid/framework/fleet/metric_sketch.h"
+#include "paddle/fluid/framework/fleet/perfect_hash.h"
 #include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/framework/threadpool.h"
 #include "paddle/fluid/platform/gpu_info.h"
 #include "paddle/fluid/platform/monitor.h"
 #include "paddle/fluid/platform/place.h"
 #include "paddle/fluid/platform/timer.h"
 #include "paddle/fluid/string/string_helper.h"
+#include "xxhash.h"  // NOLINT
 #define BUF_SIZE 1024 * 1024
 
 DECLARE_int32(fix_dayid);
 DECLARE_bool(padbox_auc_runner_mode);
 DECLARE_bool(enable_dense_nccl_barrier);
 DECLARE_int32(padbox_dataset_shuffle_thread_num);
+DECLARE_bool(padbox_input_table_perfect_hash);
 
 namespace paddle {
 namespace framework {
@@ -63,10 +69,16 @@ class BasicAucCalculator {
   explicit BasicAucCalculator(bool mode_collect_in_gpu = false)
       : _mode_collect_in_gpu(mode_collect_in_gpu) {}
   void init(int table_size, int max_batch_size = 0);
+  // Count in an AucSketch of at most max_buckets non-empty buckets instead of
+  // the dense tables, and allreduce only the non-empty buckets in compute.
+  void init_sketch(int max_buckets);
+  // Compute UAUC of the samples added by add_unlock_user_data.
+  void init_user_sketch(int max_buckets_per_user);
   void reset();
   // add single data in CPU with LOCK, deprecated
   void add_unlock_data(double pred, int label);
   void add_unlock_data(double pred, int label, float sample_scale);
+  void add_unlock_user_data(double pred, int label, uint64_t uid);
   // add batch data
   void add_data(const float* d_pred, const int64_t* d_label, int batch_size,
                 const paddle::platform::Place& place);
@@ -87,6 +99,9 @@ class BasicAucCalculator {
   double predicted_ctr() const { return _predicted_ctr; }
   double size() const { return _size; }
   double rmse() const { return _rmse; }
+  double uauc() const { return _uauc; }
+  // Whether uauc() is computed, by init_user_sketch.
+  bool has_uauc() const { return _user_sketch != nullptr; }
   std::vector<double>& get_negative() { return _table[0]; }
   std::vector<double>& get_postive() { return _table[1]; }
   double& local_abserr() { return _local_abserr; }
@@ -102,6 +117,10 @@ class BasicAucCalculator {
                           const int64_t* label, const float* pred,
                           const int64_t* mask, int len);
   void calculate_bucket_error();
+  // Merge _thread_hists into _table and the local errors.
+  void merge_thread_hists();
+  // Merge the sketches of all the workers into _sketch.
+  void allreduce_sketch();
 
  protected:
   double _local_abserr = 0;
@@ -114,6 +133,7 @@ class BasicAucCalculator {
   double _predicted_ctr = 0;
   double _size;
   double _bucket_error = 0;
+  double _uauc = 0;
 
   std::vector<std::shared_ptr<memory::Allocation>> _d_positive;
   std::vector<std::shared_ptr<memory::Allocation>> _d_negative;
@@ -132,6 +152,12 @@ class BasicAucCalculator {
   int _max_batch_size;
   bool _mode_collect_in_gpu;
   std::vector<double> _table[2];
+  // Used by add_data and add_mask_data in CPU instead of locking _table if
+  // FLAGS_padbox_auc_thread_local_hist.
+  std::unique_ptr<ThreadAucHistograms> _thread_hists;
+  // Used instead of _table if not null.
+  std::unique_ptr<AucSketch> _sketch;
+  std::unique_ptr<UserAucSketch> _user_sketch;
   static constexpr double kRelativeErrorBound = 0.05;
   static constexpr double kMaxSpan = 0.01;
   std::mutex _table_mutex;
@@ -185,9 +211,15 @@ class GpuReplicaCache {
   std::vector<float> h_emb_;
 };
 
+// With FLAGS_padbox_input_table_perfect_hash, the keys added are kept as
+// 64 bit hashes in the order of their rows, and BuildIndex() turns them
+// into a PerfectHashTable once all keys are added.
 class InputTable {
  public:
-  explicit InputTable(uint64_t dim) : dim_(dim), miss_(0) {
+  explicit InputTable(uint64_t dim)
+      : dim_(dim),
+        miss_(0),
+        use_perfect_hash_(FLAGS_padbox_input_table_perfect_hash) {
     // add default vec 0 => [0, 0, ...]
     std::vector<float> vec(dim_, 0);
     AddIndexData("-", vec);
@@ -197,12 +229,42 @@ class InputTable {
     PADDLE_ENFORCE_EQ(vec.size(), dim_);
 
     table_mutex_.lock();
-    key_offset_.emplace(key, table_.size());
+    if (use_perfect_hash_) {
+      PADDLE_ENFORCE_EQ(index_built_, false,
+                        platform::errors::PreconditionNotMet(
+                            "Can not add keys to the input table after "
+                            "its index is built."));
+      key_hashes_.push_back(HashKey(key));
+    } else {
+      key_offset_.emplace(key, table_.size());
+    }
     table_.insert(table_.end(), vec.begin(), vec.end());
     table_mutex_.unlock();
   }
 
+  // Build the perfect hash index of the keys added, and drop the hashes.
+  void BuildIndex(int thread_num) {
+    if (!use_perfect_hash_) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(table_mutex_);
+    index_.Build(key_hashes_, thread_num);
+    std::vector<uint64_t>().swap(key_hashes_);
+    index_built_ = true;
+  }
+
   uint64_t GetIndexOffset(const std::string& key) {
+    if (use_perfect_hash_) {
+      PADDLE_ENFORCE_EQ(index_built_, true,
+                        platform::errors::PreconditionNotMet(
+                            "The index of the input table is not built."));
+      uint32_t row = index_.Find(HashKey(key));
+      if (row == PerfectHashTable::kMiss) {
+        ++miss_;
+        return 0;
+      }
+      return row * dim_;
+    }
     auto it = key_offset_.find(key);
     if (it == key_offset_.end()) {
       ++miss_;
@@ -229,22 +291,36 @@ class InputTable {
                cudaMemcpyHostToDevice);
   }
 
-  size_t size() const { return key_offset_.size(); }
+  size_t size() const {
+    if (use_perfect_hash_) {
+      return index_built_ ? index_.size() : key_hashes_.size();
+    }
+    return key_offset_.size();
+  }
 
   size_t miss() const { return miss_; }
 
   size_t dim() const { return dim_; }
 
   double CpuMemUsed(void) {
-    return (key_offset_.size() * dim_ * sizeof(float)) / 1024.0 / 1024.0;
+    return (size() * dim_ * sizeof(float) + index_.MemoryBytes()) / 1024.0 /
+           1024.0;
   }
 
  protected:
+  static uint64_t HashKey(const std::string& key) {
+    return XXH64(key.data(), key.length(), 0);
+  }
+
   uint64_t dim_;
   std::mutex table_mutex_;
   std::unordered_map<std::string, uint64_t> key_offset_;
   std::vector<float> table_;
   std::atomic<size_t> miss_;
+  const bool use_perfect_hash_;
+  bool index_built_ = false;
+  std::vector<uint64_t> key_hashes_;
+  PerfectHashTable index_;
 };
 class DCacheBuffer {
  public:
@@ -639,7 +715,9 @@ class BoxWrapper {
                   const std::string& cmatch_rank_group, bool ignore_rank,
                   int bucket_size = 1000000, bool mode_collect_in_gpu = false,
                   int max_batch_size = 0,
-                  const std::string& sample_scale_varname = "");
+                  const std::string& sample_scale_varname = "",
+                  bool use_sketch = false,
+                  const std::string& uid_varname = "");
   const std::vector<double> GetMetricMsg(const std::string& name);
   // pcoc qvalue tensor
   LoDTensor& GetQTensor(int device) { return device_caches_[device].qvalue; }
@@ -699,6 +777,7 @@ class BoxWrapper {
     phase_ = phase_num_ - 1;
     auc_runner_thread_num_ = thread_num;
     pass_done_semi_ = paddle::framework::MakeChannel<int>();
+    auc_runner_pool_.reset(new ThreadPool(thread_num));
     random_ins_pool_list.resize(thread_num);
     for (size_t i = 0; i < random_ins_pool_list.size(); ++i) {
       random_ins_pool_list[i].Resize(pool_size);
@@ -778,6 +857,8 @@ class BoxWrapper {
 
   std::vector<FeasignValuesCandidateList> random_ins_pool_list;
   std::mutex mutex4random_pool_;
+  // runs the tasks of the auc runner, sized by auc_runner_thread_num_
+  std::unique_ptr<ThreadPool> auc_runner_pool_;
   std::set<std::string> slot_eval_set_;
   std::atomic<uint16_t> dataset_id_{0};
   std::atomic<uint16_t> round_id_{0};
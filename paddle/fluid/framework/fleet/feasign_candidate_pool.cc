@@ -0,0 +1,334 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/framework/fleet/feasign_candidate_pool.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace framework {
+
+void FeasignSlotArena::Reset(size_t slot_num) {
+  slot_num_ = slot_num;
+  offsets_.assign(1, 0);
+  values_.clear();
+}
+
+void FeasignSlotArena::Swap(FeasignSlotArena* other) {
+  std::swap(slot_num_, other->slot_num_);
+  offsets_.swap(other->offsets_);
+  values_.swap(other->values_);
+}
+
+void FeasignSlotArena::CheckOverflow(size_t value_num) const {
+  PADDLE_ENFORCE_LE(
+      values_.size() + value_num,
+      static_cast<size_t>(std::numeric_limits<uint32_t>::max()),
+      platform::errors::ResourceExhausted(
+          "The feasign slot arena holds at most %u values, but got %u.",
+          std::numeric_limits<uint32_t>::max(), values_.size() + value_num));
+}
+
+size_t FeasignSlotArena::Add(const std::vector<uint64_t>& slot_values,
+                             const std::vector<uint32_t>& slot_offsets,
+                             const std::vector<uint16_t>& slots) {
+  size_t id = Size();
+  for (uint16_t slot : slots) {
+    uint32_t begin = slot_offsets[slot];
+    uint32_t end = slot_offsets[slot + 1];
+    CheckOverflow(end - begin);
+    values_.insert(values_.end(), slot_values.begin() + begin,
+                   slot_values.begin() + end);
+    offsets_.push_back(static_cast<uint32_t>(values_.size()));
+  }
+  return id;
+}
+
+size_t FeasignSlotArena::Append(const FeasignSlotArena& other, size_t id) {
+  size_t new_id = Size();
+  const uint32_t* offset = &other.offsets_[id * slot_num_];
+  CheckOverflow(offset[slot_num_] - offset[0]);
+  uint32_t shift = static_cast<uint32_t>(values_.size()) - offset[0];
+  values_.insert(values_.end(), other.values_.begin() + offset[0],
+                 other.values_.begin() + offset[slot_num_]);
+  for (size_t j = 1; j <= slot_num_; ++j) {
+    offsets_.push_back(offset[j] + shift);
+  }
+  return new_id;
+}
+
+// Splice the values of slots[i] given by get_values(i) into a record in
+// place. The values between two replaced slots move by the size change of
+// the slots replaced before them: the runs moving right are moved from the
+// back and those moving left from the front, so that every value is moved
+// at most once and none is overwritten before it is moved.
+template <typename GetValues>
+static void SpliceSlots(const std::vector<uint16_t>& slots,
+                        GetValues get_values,
+                        std::vector<uint64_t>* slot_values,
+                        std::vector<uint32_t>* slot_offsets, int* del_num,
+                        int* add_num) {
+  if (slots.empty() || slot_offsets->empty()) {
+    return;
+  }
+  std::vector<uint32_t>& offsets = *slot_offsets;
+  const size_t slot_num = offsets.size() - 1;
+  auto change = [&](size_t k) {
+    size_t num = 0;
+    get_values(k, &num);
+    return static_cast<int64_t>(num) -
+           (offsets[slots[k] + 1] - offsets[slots[k]]);
+  };
+  auto run_end = [&](size_t k) {
+    return k + 1 < slots.size() ? offsets[slots[k + 1]] : offsets[slot_num];
+  };
+
+  int64_t delta = 0;
+  for (size_t k = 0; k < slots.size(); ++k) {
+    delta += change(k);
+  }
+  const size_t old_size = offsets[slot_num];
+  if (delta > 0) {
+    slot_values->resize(old_size + delta);
+  }
+  uint64_t* values = slot_values->data();
+  int64_t shift = delta;
+  for (size_t k = slots.size(); k-- > 0;) {
+    if (shift > 0) {
+      uint32_t begin = offsets[slots[k] + 1];
+      memmove(values + begin + shift, values + begin,
+              (run_end(k) - begin) * sizeof(uint64_t));
+    }
+    shift -= change(k);
+  }
+  shift = 0;
+  for (size_t k = 0; k < slots.size(); ++k) {
+    shift += change(k);
+    if (shift < 0) {
+      uint32_t begin = offsets[slots[k] + 1];
+      memmove(values + begin + shift, values + begin,
+              (run_end(k) - begin) * sizeof(uint64_t));
+    }
+  }
+
+  shift = 0;
+  for (size_t k = 0; k < slots.size(); ++k) {
+    size_t slot = slots[k];
+    // offsets[slot] is moved already, offsets[slot + 1] not yet.
+    uint32_t old_num = offsets[slot + 1] - (offsets[slot] - shift);
+    size_t num = 0;
+    const uint64_t* replaced = get_values(k, &num);
+    std::copy(replaced, replaced + num, values + offsets[slot]);
+    *del_num += old_num;
+    *add_num += num;
+    shift += static_cast<int64_t>(num) - old_num;
+    size_t end = k + 1 < slots.size() ? slots[k + 1] : slot_num;
+    for (size_t j = slot + 1; j <= end; ++j) {
+      offsets[j] += shift;
+    }
+  }
+  if (delta < 0) {
+    slot_values->resize(old_size + delta);
+  }
+}
+
+void FeasignValuesReplacer::replace(const std::vector<uint16_t>& slots,
+                                    const FeasignSlotArena& candidates,
+                                    size_t id,
+                                    const std::vector<size_t>& positions,
+                                    std::vector<uint64_t>* slot_values,
+                                    std::vector<uint32_t>* slot_offsets,
+                                    int* del_num, int* add_num) {
+  replaced_.Reset(slots.size());
+  replaced_.Add(*slot_values, *slot_offsets, slots);
+  SpliceSlots(slots,
+              [&candidates, id, &positions](size_t i, size_t* num) {
+                return candidates.Values(id, positions[i], num);
+              },
+              slot_values, slot_offsets, del_num, add_num);
+}
+
+void FeasignValuesReplacer::replace_back(const std::vector<uint16_t>& slots,
+                                         std::vector<uint64_t>* slot_values,
+                                         std::vector<uint32_t>* slot_offsets,
+                                         int* del_num, int* add_num) {
+  if (replaced_.Size() == 0) {
+    return;
+  }
+  SpliceSlots(slots,
+              [this](size_t i, size_t* num) {
+                return replaced_.Values(0, i, num);
+              },
+              slot_values, slot_offsets, del_num, add_num);
+  replaced_.Reset(0);
+}
+
+void FeasignValuesCandidateList::Resize(size_t len) {
+  capacity_ = len;
+  id_ = 0;
+  size_ = 0;
+
+  candidates_.Reset(replaced_slots_.size());
+  redirects_.assign(capacity_, std::make_pair(nullptr, 0));
+
+  new_candidates_q_.clear();
+  candidates_cache_.clear();
+}
+
+void FeasignValuesCandidateList::SetReplacedSlots(
+    const std::set<uint16_t>& replaced_slots) {
+  PADDLE_ENFORCE_EQ(size_, 0UL,
+                    platform::errors::PreconditionNotMet(
+                        "The replaced slots should be set before any record "
+                        "is added to the candidate list."));
+  replaced_slots_.assign(replaced_slots.begin(), replaced_slots.end());
+  candidates_.Reset(replaced_slots_.size());
+}
+
+std::vector<size_t> FeasignValuesCandidateList::SlotPositions(
+    const std::set<uint16_t>& slots) const {
+  std::vector<size_t> positions;
+  for (uint16_t slot : slots) {
+    auto iter =
+        std::lower_bound(replaced_slots_.begin(), replaced_slots_.end(), slot);
+    PADDLE_ENFORCE_EQ(iter != replaced_slots_.end() && *iter == slot, true,
+                      platform::errors::InvalidArgument(
+                          "Slot %d is not a replaced slot of the candidates.",
+                          slot));
+    positions.push_back(iter - replaced_slots_.begin());
+  }
+  return positions;
+}
+
+size_t FeasignValuesCandidateList::AddAndGet(
+    const std::vector<uint64_t>& slot_values,
+    const std::vector<uint32_t>& slot_offsets,
+    std::default_random_engine* random) {
+  size_t replaced_id = 0;
+
+  ++id_;
+  if (!Full()) {
+    candidates_.Add(slot_values, slot_offsets, replaced_slots_);
+    ++size_;
+  } else {
+    replaced_id = (*random)() % id_;
+    if (replaced_id < capacity_) {
+      Batch& batch = new_candidates_q_.back();
+      size_t item = batch.arena.Add(slot_values, slot_offsets, replaced_slots_);
+      batch.replaced_idx.push_back(replaced_id);
+      redirects_[replaced_id] = std::make_pair(&batch, item);
+    }
+  }
+
+  replaced_id = (*random)() % size_;
+  if (redirects_[replaced_id].first == &new_candidates_q_.back()) {
+    replaced_id = size_ + redirects_[replaced_id].second;
+  }
+
+  return replaced_id;
+}
+
+void FeasignValuesCandidateList::GetUseId(size_t id,
+                                          const FeasignSlotArena** arena,
+                                          size_t* item) const {
+  PADDLE_ENFORCE_LT(id, size_, platform::errors::OutOfRange(
+                                   "Candidate id %u is out of range %u.", id,
+                                   size_));
+  if (redirects_[id].first == nullptr) {
+    *arena = &candidates_;
+    *item = id;
+  } else {
+    *arena = &redirects_[id].first->arena;
+    *item = redirects_[id].second;
+  }
+}
+
+void FeasignValuesCandidateList::GetUseReplaceId(
+    size_t replaced_id, const FeasignSlotArena** arena, size_t* item) const {
+  if (replaced_id >= capacity_) {
+    const FeasignSlotArena& front = new_candidates_q_.front().arena;
+    PADDLE_ENFORCE_LT(replaced_id - capacity_, front.Size(),
+                      platform::errors::OutOfRange(
+                          "Candidate id %u is out of range %u.",
+                          replaced_id - capacity_, front.Size()));
+    *arena = &front;
+    *item = replaced_id - capacity_;
+    return;
+  }
+  *arena = &candidates_;
+  *item = replaced_id;
+}
+
+void FeasignValuesCandidateList::Push() {
+  std::lock_guard<std::mutex> lock(mutex4cache_);
+
+  if (!candidates_cache_.empty()) {
+    new_candidates_q_.push_back(std::move(candidates_cache_.front()));
+    candidates_cache_.pop_front();
+  } else {
+    new_candidates_q_.emplace_back();
+  }
+  Batch& batch = new_candidates_q_.back();
+  batch.arena.Reset(replaced_slots_.size());
+  batch.replaced_idx.clear();
+}
+
+void FeasignValuesCandidateList::Pop() {
+  if (new_candidates_q_.empty()) {
+    return;
+  }
+  Batch& front = new_candidates_q_.front();
+  // The last item of the batch that replaces every candidate.
+  std::vector<size_t> latest(size_, front.replaced_idx.size());
+  for (size_t i = 0; i < front.replaced_idx.size(); ++i) {
+    latest[front.replaced_idx[i]] = i;
+  }
+  merged_.Reset(replaced_slots_.size());
+  for (size_t id = 0; id < size_; ++id) {
+    if (latest[id] < front.replaced_idx.size()) {
+      merged_.Append(front.arena, latest[id]);
+    } else {
+      merged_.Append(candidates_, id);
+    }
+    if (redirects_[id].first == &front) {
+      redirects_[id] = std::make_pair(nullptr, 0);
+    }
+  }
+  candidates_.Swap(&merged_);
+
+  std::lock_guard<std::mutex> lock(mutex4cache_);
+  candidates_cache_.push_back(std::move(front));
+  new_candidates_q_.pop_front();
+}
+
+size_t FeasignValuesCandidateList::MemoryBytes() const {
+  size_t bytes = candidates_.MemoryBytes() + merged_.MemoryBytes() +
+                 redirects_.capacity() * sizeof(redirects_[0]);
+  for (auto& batch : new_candidates_q_) {
+    bytes += batch.arena.MemoryBytes() +
+             batch.replaced_idx.capacity() * sizeof(size_t);
+  }
+  for (auto& batch : candidates_cache_) {
+    bytes += batch.arena.MemoryBytes() +
+             batch.replaced_idx.capacity() * sizeof(size_t);
+  }
+  return bytes;
+}
+
+}  // namespace framework
+}  // namespace paddle
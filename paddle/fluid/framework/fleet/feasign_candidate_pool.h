@@ -0,0 +1,160 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// The values of a few slots of many records packed in one arena: the
+// values of the j-th slot of item i are
+// values_[offsets_[i * slot_num + j], offsets_[i * slot_num + j + 1]).
+// The records are read in the layout of SlotValues, slot_values and
+// slot_offsets.
+class FeasignSlotArena {
+ public:
+  FeasignSlotArena() = default;
+
+  // Remove all items, keeping the memory.
+  void Reset(size_t slot_num);
+  void Swap(FeasignSlotArena* other);
+
+  // Add the values of slots of a record, and return the item id.
+  size_t Add(const std::vector<uint64_t>& slot_values,
+             const std::vector<uint32_t>& slot_offsets,
+             const std::vector<uint16_t>& slots);
+  // Add a copy of an item of another arena with the same slots.
+  size_t Append(const FeasignSlotArena& other, size_t id);
+
+  const uint64_t* Values(size_t id, size_t j, size_t* num) const {
+    const uint32_t* offset = &offsets_[id * slot_num_ + j];
+    *num = offset[1] - offset[0];
+    return values_.data() + offset[0];
+  }
+  // The values of all slots of an item.
+  const uint64_t* ItemValues(size_t id, size_t* num) const {
+    uint32_t begin = offsets_[id * slot_num_];
+    *num = offsets_[(id + 1) * slot_num_] - begin;
+    return values_.data() + begin;
+  }
+
+  size_t Size() const {
+    return slot_num_ > 0 ? (offsets_.size() - 1) / slot_num_ : 0;
+  }
+  size_t slot_num() const { return slot_num_; }
+  size_t MemoryBytes() const {
+    return offsets_.capacity() * sizeof(uint32_t) +
+           values_.capacity() * sizeof(uint64_t);
+  }
+
+ private:
+  void CheckOverflow(size_t value_num) const;
+
+  size_t slot_num_ = 0;
+  std::vector<uint32_t> offsets_ = {0};
+  std::vector<uint64_t> values_;
+};
+
+// Replaces the values of slots of a record with those of a candidate and
+// keeps the values replaced to put them back. The values are spliced in
+// place, moving the values after the first replaced slot at most once.
+class FeasignValuesReplacer {
+ public:
+  // slots should be sorted, the values of slots[i] are taken from the
+  // positions[i]-th slot of item id of candidates.
+  void replace(const std::vector<uint16_t>& slots,
+               const FeasignSlotArena& candidates, size_t id,
+               const std::vector<size_t>& positions,
+               std::vector<uint64_t>* slot_values,
+               std::vector<uint32_t>* slot_offsets, int* del_num,
+               int* add_num);
+  // Put back the values replaced by replace() with the same slots.
+  void replace_back(const std::vector<uint16_t>& slots,
+                    std::vector<uint64_t>* slot_values,
+                    std::vector<uint32_t>* slot_offsets, int* del_num,
+                    int* add_num);
+
+ private:
+  FeasignSlotArena replaced_;
+};
+
+// A reservoir sample of the records of the passes, of the values of the
+// replaced slots only. The candidates sampled in a pass are added to a
+// batch queued by Push(), which replace their candidates in Pop().
+class FeasignValuesCandidateList {
+ public:
+  FeasignValuesCandidateList() = default;
+  FeasignValuesCandidateList(const FeasignValuesCandidateList&) {}
+
+  size_t Size() const { return size_; }
+  bool Full() const { return size_ == capacity_; }
+
+  void Resize(size_t len);
+  // Should be set before any record is added.
+  void SetReplacedSlots(const std::set<uint16_t>& replaced_slots);
+  // The positions of slots in the replaced slots, slots should all be
+  // replaced.
+  std::vector<size_t> SlotPositions(const std::set<uint16_t>& slots) const;
+
+  // Sample a record, and return the id of the candidate to replace it with.
+  size_t AddAndGet(const std::vector<uint64_t>& slot_values,
+                   const std::vector<uint32_t>& slot_offsets,
+                   std::default_random_engine* random);
+
+  // The arena and item of candidate id in use.
+  void GetUseId(size_t id, const FeasignSlotArena** arena,
+                size_t* item) const;
+  // The arena and item of an id returned by AddAndGet().
+  void GetUseReplaceId(size_t replaced_id, const FeasignSlotArena** arena,
+                       size_t* item) const;
+
+  void Push();
+  void Pop();
+
+  size_t MemoryBytes() const;
+
+ private:
+  struct Batch {
+    FeasignSlotArena arena;
+    // The candidate replaced by every item.
+    std::vector<size_t> replaced_idx;
+  };
+
+  size_t capacity_ = 0;
+  size_t id_ = 0;
+  size_t size_ = 0;
+
+  std::vector<uint16_t> replaced_slots_;
+
+  FeasignSlotArena candidates_;
+  // To rebuild candidates_ in Pop().
+  FeasignSlotArena merged_;
+  // The items of the last batch that replace the candidates, or null.
+  std::vector<std::pair<const Batch*, size_t>> redirects_;
+  std::deque<Batch> new_candidates_q_;
+  std::deque<Batch> candidates_cache_;
+
+  std::mutex mutex4cache_;
+};
+
+}  // namespace framework
+}  // namespace paddle
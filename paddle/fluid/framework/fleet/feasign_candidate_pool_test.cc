@@ -0,0 +1,343 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/framework/fleet/feasign_candidate_pool.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <chrono>  // NOLINT
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// The slot_values and slot_offsets of SlotValues.
+struct TestRecord {
+  std::vector<uint64_t> values;
+  std::vector<uint32_t> offsets;
+
+  std::vector<uint64_t> Slot(uint16_t slot) const {
+    return std::vector<uint64_t>(values.begin() + offsets[slot],
+                                 values.begin() + offsets[slot + 1]);
+  }
+};
+
+static std::vector<TestRecord> MakeRecords(size_t record_num, int slot_num,
+                                           std::mt19937_64* rng) {
+  std::vector<TestRecord> records(record_num);
+  for (auto& record : records) {
+    record.offsets.push_back(0);
+    for (int slot = 0; slot < slot_num; ++slot) {
+      int num = (*rng)() % 7;
+      for (int i = 0; i < num; ++i) {
+        record.values.push_back((*rng)());
+      }
+      record.offsets.push_back(record.values.size());
+    }
+  }
+  return records;
+}
+
+static std::vector<uint64_t> ArenaSlot(const FeasignSlotArena& arena,
+                                       size_t id, size_t j) {
+  size_t num = 0;
+  const uint64_t* values = arena.Values(id, j, &num);
+  return std::vector<uint64_t>(values, values + num);
+}
+
+TEST(FeasignSlotArena, AddAndAppend) {
+  std::mt19937_64 rng(0);
+  auto records = MakeRecords(10, 8, &rng);
+  std::vector<uint16_t> slots = {1, 4, 7};
+  FeasignSlotArena arena;
+  arena.Reset(slots.size());
+  for (auto& record : records) {
+    arena.Add(record.values, record.offsets, slots);
+  }
+  FeasignSlotArena copy;
+  copy.Reset(slots.size());
+  EXPECT_EQ(copy.Append(arena, 3), 0UL);
+  ASSERT_EQ(arena.Size(), records.size());
+  for (size_t i = 0; i < records.size(); ++i) {
+    size_t total = 0;
+    for (size_t j = 0; j < slots.size(); ++j) {
+      EXPECT_EQ(ArenaSlot(arena, i, j), records[i].Slot(slots[j]));
+      total += records[i].Slot(slots[j]).size();
+    }
+    size_t num = 0;
+    arena.ItemValues(i, &num);
+    EXPECT_EQ(num, total);
+  }
+  for (size_t j = 0; j < slots.size(); ++j) {
+    EXPECT_EQ(ArenaSlot(copy, 0, j), records[3].Slot(slots[j]));
+  }
+}
+
+TEST(FeasignValuesReplacer, ReplaceBack) {
+  std::mt19937_64 rng(0);
+  auto records = MakeRecords(100, 12, &rng);
+  auto candidates = MakeRecords(5, 12, &rng);
+  std::vector<uint16_t> replaced_slots = {0, 2, 3, 6, 11};
+  FeasignSlotArena arena;
+  arena.Reset(replaced_slots.size());
+  for (auto& candidate : candidates) {
+    arena.Add(candidate.values, candidate.offsets, replaced_slots);
+  }
+  // A subset of the replaced slots.
+  std::vector<uint16_t> slots = {0, 3, 11};
+  std::vector<size_t> positions = {0, 2, 4};
+
+  for (size_t i = 0; i < records.size(); ++i) {
+    TestRecord record = records[i];
+    size_t id = i % candidates.size();
+    FeasignValuesReplacer replacer;
+    int del_num = 0;
+    int add_num = 0;
+    replacer.replace(slots, arena, id, positions, &record.values,
+                     &record.offsets, &del_num, &add_num);
+    int expected_del = 0;
+    int expected_add = 0;
+    for (uint16_t slot = 0; slot < 12; ++slot) {
+      bool replaced = slot == 0 || slot == 3 || slot == 11;
+      EXPECT_EQ(record.Slot(slot), replaced ? candidates[id].Slot(slot)
+                                            : records[i].Slot(slot));
+      if (replaced) {
+        expected_del += records[i].Slot(slot).size();
+        expected_add += candidates[id].Slot(slot).size();
+      }
+    }
+    EXPECT_EQ(del_num, expected_del);
+    EXPECT_EQ(add_num, expected_add);
+
+    replacer.replace_back(slots, &record.values, &record.offsets, &del_num,
+                          &add_num);
+    EXPECT_EQ(record.values, records[i].values);
+    EXPECT_EQ(record.offsets, records[i].offsets);
+  }
+}
+
+TEST(FeasignValuesCandidateList, Passes) {
+  std::mt19937_64 rng(0);
+  std::default_random_engine random(0);
+  const size_t capacity = 50;
+  std::set<uint16_t> replaced_slots = {1, 5};
+  FeasignValuesCandidateList list;
+  list.Resize(capacity);
+  list.SetReplacedSlots(replaced_slots);
+  std::vector<size_t> positions = list.SlotPositions({5});
+  ASSERT_EQ(positions.size(), 1UL);
+  EXPECT_EQ(positions[0], 1UL);
+
+  // The slot 5 of every record sampled, to check the candidates.
+  std::set<std::vector<uint64_t>> sampled;
+  for (int pass = 0; pass < 3; ++pass) {
+    auto records = MakeRecords(200, 8, &rng);
+    list.Push();
+    for (auto& record : records) {
+      sampled.insert(record.Slot(5));
+      size_t replaced_id = list.AddAndGet(record.values, record.offsets,
+                                          &random);
+      const FeasignSlotArena* arena = nullptr;
+      size_t item = 0;
+      list.GetUseReplaceId(replaced_id, &arena, &item);
+      EXPECT_EQ(sampled.count(ArenaSlot(*arena, item, 1)), 1UL);
+    }
+    EXPECT_TRUE(list.Full());
+    list.Pop();
+    for (size_t id = 0; id < list.Size(); ++id) {
+      const FeasignSlotArena* arena = nullptr;
+      size_t item = 0;
+      list.GetUseId(id, &arena, &item);
+      EXPECT_EQ(sampled.count(ArenaSlot(*arena, item, 1)), 1UL);
+    }
+  }
+}
+
+// The representation the candidate pool replaces, for the benchmark.
+struct LegacyCandidate {
+  std::unordered_map<uint16_t, std::vector<uint64_t>> feasign_values_;
+
+  LegacyCandidate(const TestRecord& record,
+                  const std::set<uint16_t>& slots_idx) {
+    for (auto idx : slots_idx) {
+      feasign_values_.emplace(idx, record.Slot(idx));
+    }
+  }
+};
+
+struct LegacyReplacer {
+  std::vector<std::vector<uint64_t>> feasign_values_;
+
+  void replace(TestRecord* fea,
+               const std::unordered_map<uint16_t, std::vector<uint64_t>>& vals,
+               const std::set<uint16_t>& slot_idxs) {
+    size_t i = 0;
+    feasign_values_.resize(slot_idxs.size());
+    for (auto idx : slot_idxs) {
+      const auto& begin = fea->values.begin() + fea->offsets[idx];
+      const auto& end = fea->values.begin() + fea->offsets[idx + 1];
+      feasign_values_[i].insert(feasign_values_[i].begin(), begin, end);
+      fea->values.erase(begin, end);
+      fea->values.insert(begin, vals.at(idx).begin(), vals.at(idx).end());
+      int diff = static_cast<int>(vals.at(idx).size()) -
+                 static_cast<int>(feasign_values_[i].size());
+      for (size_t j = idx + 1; j < fea->offsets.size(); ++j) {
+        fea->offsets[j] += diff;
+      }
+      ++i;
+    }
+  }
+
+  void replace_back(TestRecord* fea, const std::set<uint16_t>& slot_idxs) {
+    size_t i = 0;
+    for (auto idx : slot_idxs) {
+      const auto& begin = fea->values.begin() + fea->offsets[idx];
+      const auto& end = fea->values.begin() + fea->offsets[idx + 1];
+      int diff = static_cast<int>(feasign_values_[i].size()) -
+                 static_cast<int>(std::distance(begin, end));
+      fea->values.erase(begin, end);
+      fea->values.insert(begin, feasign_values_[i].begin(),
+                         feasign_values_[i].end());
+      for (size_t j = idx + 1; j < fea->offsets.size(); ++j) {
+        fea->offsets[j] += diff;
+      }
+      ++i;
+    }
+    feasign_values_.clear();
+  }
+};
+
+static double ResidentMB() {
+  std::ifstream statm("/proc/self/statm");
+  size_t size = 0;
+  size_t resident = 0;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE) / 1048576.0;
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// A pass of the auc runner: sample the records into the pool, then replace
+// the slots of every phase and put them back. Run with
+// --gtest_also_run_disabled_tests.
+TEST(FeasignValuesCandidateList, DISABLED_Benchmark) {
+  const size_t record_num = 100000;
+  const int slot_num = 60;
+  const size_t capacity = 30000;
+  std::set<uint16_t> replaced_slots;
+  for (uint16_t slot = 0; slot < 40; ++slot) {
+    replaced_slots.insert(slot);
+  }
+  std::vector<std::set<uint16_t>> phases;
+  for (uint16_t slot = 0; slot < 40; slot += 4) {
+    phases.push_back({slot, static_cast<uint16_t>(slot + 1),
+                      static_cast<uint16_t>(slot + 2),
+                      static_cast<uint16_t>(slot + 3)});
+  }
+  std::mt19937_64 rng(0);
+  auto records = MakeRecords(record_num, slot_num, &rng);
+  auto origin = records;
+
+  {
+    double rss = ResidentMB();
+    auto start = std::chrono::steady_clock::now();
+    std::default_random_engine random(0);
+    std::unique_ptr<FeasignValuesCandidateList> list(
+        new FeasignValuesCandidateList());
+    list->Resize(capacity);
+    list->SetReplacedSlots(replaced_slots);
+    list->Push();
+    std::vector<size_t> replaced_ids(record_num);
+    for (size_t i = 0; i < record_num; ++i) {
+      replaced_ids[i] =
+          list->AddAndGet(records[i].values, records[i].offsets, &random);
+    }
+    std::vector<FeasignValuesReplacer> replacers(record_num);
+    int del_num = 0;
+    int add_num = 0;
+    for (auto& phase : phases) {
+      std::vector<uint16_t> slots(phase.begin(), phase.end());
+      std::vector<size_t> positions = list->SlotPositions(phase);
+      for (size_t i = 0; i < record_num; ++i) {
+        const FeasignSlotArena* arena = nullptr;
+        size_t item = 0;
+        list->GetUseReplaceId(replaced_ids[i], &arena, &item);
+        replacers[i].replace(slots, *arena, item, positions,
+                             &records[i].values, &records[i].offsets,
+                             &del_num, &add_num);
+      }
+      for (size_t i = 0; i < record_num; ++i) {
+        replacers[i].replace_back(slots, &records[i].values,
+                                  &records[i].offsets, &del_num, &add_num);
+      }
+    }
+    double seconds = SecondsSince(start);
+    LOG(INFO) << "csr candidate pool pass: " << seconds
+              << " s, rss: " << ResidentMB() - rss
+              << " MB, pool: " << list->MemoryBytes() / 1048576.0 << " MB";
+    list->Pop();
+  }
+  for (size_t i = 0; i < record_num; ++i) {
+    ASSERT_EQ(records[i].values, origin[i].values);
+  }
+
+  {
+    double rss = ResidentMB();
+    auto start = std::chrono::steady_clock::now();
+    std::default_random_engine random(0);
+    std::vector<LegacyCandidate> candidates;
+    std::vector<LegacyCandidate> new_candidates;
+    std::vector<std::pair<size_t, bool>> replaced_ids(record_num);
+    for (size_t i = 0; i < record_num; ++i) {
+      if (candidates.size() < capacity) {
+        candidates.emplace_back(records[i], replaced_slots);
+      } else if (random() % (i + 1) < capacity) {
+        new_candidates.emplace_back(records[i], replaced_slots);
+      }
+      replaced_ids[i] =
+          std::make_pair(random() % candidates.size(), random() % 2 == 0);
+    }
+    std::vector<LegacyReplacer> replacers(record_num);
+    for (auto& phase : phases) {
+      for (size_t i = 0; i < record_num; ++i) {
+        auto& candidate = replaced_ids[i].second && !new_candidates.empty()
+                              ? new_candidates[replaced_ids[i].first %
+                                               new_candidates.size()]
+                              : candidates[replaced_ids[i].first];
+        replacers[i].replace(&records[i], candidate.feasign_values_, phase);
+      }
+      for (size_t i = 0; i < record_num; ++i) {
+        replacers[i].replace_back(&records[i], phase);
+      }
+    }
+    double seconds = SecondsSince(start);
+    LOG(INFO) << "map candidate pool pass: " << seconds
+              << " s, rss: " << ResidentMB() - rss << " MB";
+  }
+  for (size_t i = 0; i < record_num; ++i) {
+    ASSERT_EQ(records[i].values, origin[i].values);
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,277 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/framework/fleet/metric_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace framework {
+
+constexpr int AucSketch::kGridHeaderSize;
+
+AucSketch::AucSketch(int table_size, int max_buckets)
+    : table_size_(table_size), max_buckets_(max_buckets) {
+  PADDLE_ENFORCE_GT(table_size, 0,
+                    platform::errors::InvalidArgument(
+                        "The AUC table size should be greater than 0, but "
+                        "got %d.",
+                        table_size));
+  PADDLE_ENFORCE_GT(max_buckets, 0,
+                    platform::errors::InvalidArgument(
+                        "The max bucket num of AUC sketch should be greater "
+                        "than 0, but got %d.",
+                        max_buckets));
+}
+
+void AucSketch::Add(double pred, int label, double weight) {
+  int64_t pos = std::min(static_cast<int>(pred * table_size_), table_size_ - 1);
+  buckets_[pos >> shift_].count[label] += weight;
+  if (buckets_.size() > max_buckets_) {
+    Coarsen(shift_ + 1);
+  }
+}
+
+void AucSketch::AddBucket(int64_t bucket, int shift, double neg,
+                          double pos) {
+  if (shift > shift_) {
+    Coarsen(shift);
+  }
+  Bucket& item = buckets_[bucket >> (shift_ - shift)];
+  item.count[0] += neg;
+  item.count[1] += pos;
+}
+
+void AucSketch::Coarsen(int shift) {
+  // Halve until the buckets fit, a single bucket always does.
+  while (shift_ < shift || buckets_.size() > max_buckets_) {
+    int delta = std::max(shift - shift_, 1);
+    std::unordered_map<int64_t, Bucket> buckets;
+    buckets.reserve(buckets_.size());
+    for (auto& item : buckets_) {
+      Bucket& bucket = buckets[item.first >> delta];
+      bucket.count[0] += item.second.count[0];
+      bucket.count[1] += item.second.count[1];
+    }
+    buckets_.swap(buckets);
+    shift_ += delta;
+  }
+}
+
+void AucSketch::Merge(const AucSketch& other) {
+  PADDLE_ENFORCE_EQ(table_size_, other.table_size_,
+                    platform::errors::InvalidArgument(
+                        "Only AUC sketches of the same table size can be "
+                        "merged, but got %d and %d.",
+                        table_size_, other.table_size_));
+  for (auto& item : other.buckets_) {
+    AddBucket(item.first, other.shift_, item.second.count[0],
+              item.second.count[1]);
+  }
+  if (buckets_.size() > max_buckets_) {
+    Coarsen(shift_ + 1);
+  }
+}
+
+void AucSketch::Reset() {
+  buckets_.clear();
+  shift_ = 0;
+}
+
+void AucSketch::GridHeader(double* header) const {
+  int64_t first = std::numeric_limits<int64_t>::max();
+  int64_t last = 0;
+  for (auto& item : buckets_) {
+    first = std::min(first, item.first);
+    last = std::max(last, item.first + 1);
+  }
+  header[0] = shift_;
+  header[1] = buckets_.size();
+  header[2] = buckets_.empty() ? 0 : first;
+  header[3] = last;
+}
+
+bool AucSketch::GridRange(const double* headers, int worker_num, int* shift,
+                          int64_t* begin, int64_t* end) {
+  *shift = 0;
+  for (int i = 0; i < worker_num; ++i) {
+    *shift = std::max(*shift, static_cast<int>(headers[i * kGridHeaderSize]));
+  }
+  bool found = false;
+  for (int i = 0; i < worker_num; ++i) {
+    const double* header = headers + i * kGridHeaderSize;
+    if (header[1] == 0) {
+      continue;
+    }
+    int delta = *shift - static_cast<int>(header[0]);
+    int64_t first = static_cast<int64_t>(header[2]) >> delta;
+    int64_t last = ((static_cast<int64_t>(header[3]) - 1) >> delta) + 1;
+    *begin = found ? std::min(*begin, first) : first;
+    *end = found ? std::max(*end, last) : last;
+    found = true;
+  }
+  return found;
+}
+
+void AucSketch::FillGrid(int shift, int64_t begin, double* counts) {
+  Coarsen(shift);
+  for (auto& item : buckets_) {
+    double* count = counts + 2 * (item.first - begin);
+    count[0] = item.second.count[0];
+    count[1] = item.second.count[1];
+  }
+}
+
+void AucSketch::SetGrid(int shift, int64_t begin, int64_t end,
+                        const double* counts) {
+  buckets_.clear();
+  shift_ = shift;
+  for (int64_t bucket = begin; bucket < end; ++bucket) {
+    const double* count = counts + 2 * (bucket - begin);
+    if (count[0] != 0 || count[1] != 0) {
+      Bucket& item = buckets_[bucket];
+      item.count[0] = count[0];
+      item.count[1] = count[1];
+    }
+  }
+  if (buckets_.size() > max_buckets_) {
+    Coarsen(shift_ + 1);
+  }
+}
+
+std::vector<std::pair<int64_t, AucSketch::Bucket>> AucSketch::SortedBuckets()
+    const {
+  std::vector<std::pair<int64_t, Bucket>> buckets(buckets_.begin(),
+                                                  buckets_.end());
+  std::sort(buckets.begin(), buckets.end(),
+            [](const std::pair<int64_t, Bucket>& a,
+               const std::pair<int64_t, Bucket>& b) {
+              return a.first < b.first;
+            });
+  return buckets;
+}
+
+void AucSketch::Area(double* area, double* neg, double* pos) const {
+  auto buckets = SortedBuckets();
+  double fp = 0;
+  double tp = 0;
+  *area = 0;
+  for (auto iter = buckets.rbegin(); iter != buckets.rend(); ++iter) {
+    double newfp = fp + iter->second.count[0];
+    double newtp = tp + iter->second.count[1];
+    *area += (newfp - fp) * (tp + newtp) / 2;
+    fp = newfp;
+    tp = newtp;
+  }
+  *neg = fp;
+  *pos = tp;
+}
+
+double AucSketch::BucketError(double max_span,
+                              double relative_error_bound) const {
+  auto buckets = SortedBuckets();
+  const int64_t width = int64_t(1) << shift_;
+  auto bucket_ctr = [this, width](int64_t bucket) {
+    return static_cast<double>(bucket * width) / table_size_;
+  };
+  double last_ctr = -1;
+  double impression_sum = 0;
+  double ctr_sum = 0.0;
+  double click_sum = 0.0;
+  double error_sum = 0.0;
+  double error_count = 0;
+  int64_t next = 0;
+  for (auto& item : buckets) {
+    // The empty buckets before only restart the span when it gets too wide,
+    // jump from restart to restart instead of visiting them.
+    for (int64_t i = next; i < item.first;) {
+      double ctr = bucket_ctr(i);
+      if (fabs(ctr - last_ctr) > max_span) {
+        last_ctr = ctr;
+        impression_sum = 0.0;
+        ctr_sum = 0.0;
+        click_sum = 0.0;
+        ++i;
+      } else {
+        int64_t restart =
+            static_cast<int64_t>((last_ctr + max_span) * table_size_ / width);
+        i = std::max(i + 1, restart - 1);
+      }
+    }
+    next = item.first + 1;
+
+    double click = item.second.count[1];
+    double show = item.second.count[0] + item.second.count[1];
+    double ctr = bucket_ctr(item.first);
+    if (fabs(ctr - last_ctr) > max_span) {
+      last_ctr = ctr;
+      impression_sum = 0.0;
+      ctr_sum = 0.0;
+      click_sum = 0.0;
+    }
+    impression_sum += show;
+    ctr_sum += ctr * show;
+    click_sum += click;
+    double adjust_ctr = ctr_sum / impression_sum;
+    double relative_error =
+        sqrt((1 - adjust_ctr) / (adjust_ctr * impression_sum));
+    if (relative_error < relative_error_bound) {
+      double actual_ctr = click_sum / impression_sum;
+      double relative_ctr_error = fabs(actual_ctr / adjust_ctr - 1);
+      error_sum += relative_ctr_error * impression_sum;
+      error_count += impression_sum;
+      last_ctr = -1;
+    }
+  }
+  return error_count > 0 ? error_sum / error_count : 0.0;
+}
+
+UserAucSketch::UserAucSketch(int table_size, int max_buckets_per_user)
+    : table_size_(table_size), max_buckets_per_user_(max_buckets_per_user) {}
+
+void UserAucSketch::Add(uint64_t uid, double pred, int label) {
+  auto iter = users_.find(uid);
+  if (iter == users_.end()) {
+    iter = users_
+               .emplace(uid, AucSketch(table_size_, max_buckets_per_user_))
+               .first;
+  }
+  iter->second.Add(pred, label);
+}
+
+void UserAucSketch::Reset() { users_.clear(); }
+
+void UserAucSketch::Compute(double result[3]) const {
+  result[0] = 0;
+  result[1] = 0;
+  result[2] = 0;
+  for (auto& item : users_) {
+    double area = 0;
+    double neg = 0;
+    double pos = 0;
+    item.second.Area(&area, &neg, &pos);
+    if (neg < 1e-3 || pos < 1e-3) {
+      continue;
+    }
+    result[0] += area / (neg * pos) * (neg + pos);
+    result[1] += neg + pos;
+    result[2] += 1;
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
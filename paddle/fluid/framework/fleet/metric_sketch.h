@@ -0,0 +1,111 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// The negative and positive counts of preds in [0, 1] over table_size
+// buckets, like the tables of BasicAucCalculator, but only the non-empty
+// buckets are stored. Once more than max_buckets are non-empty, adjacent
+// buckets are merged in pairs, halving the resolution, so the memory is
+// bounded. Sketches of the same table size are mergeable, the result has the
+// coarser resolution of the two.
+//
+// Not thread safe.
+class AucSketch {
+ public:
+  AucSketch(int table_size, int max_buckets);
+
+  // pred should be in [0, 1] and label be 0 or 1, they are not checked.
+  void Add(double pred, int label, double weight = 1.0);
+  void Merge(const AucSketch& other);
+  void Reset();
+
+  // The sketches of several workers are summed on a common grid by two
+  // element-wise sums over the workers:
+  //   1. every worker writes GridHeader() to its own kGridHeaderSize slot of
+  //      a zeroed buffer, and the buffers are summed;
+  //   2. GridRange() gives the coarsest shift of all and the range of
+  //      buckets non-empty on some worker at that shift; every worker writes
+  //      FillGrid() into a zeroed buffer of 2 * (end - begin) doubles, the
+  //      buffers are summed and SetGrid() loads the sum.
+  // The second sum takes at most the doubles of the dense tables, however
+  // many workers there are.
+  static constexpr int kGridHeaderSize = 4;
+  void GridHeader(double* header) const;
+  // Return false if all the sketches are empty.
+  static bool GridRange(const double* headers, int worker_num, int* shift,
+                        int64_t* begin, int64_t* end);
+  // Coarsen to shift and write the negative and positive counts of bucket
+  // begin + i to counts[2 * i] and counts[2 * i + 1].
+  void FillGrid(int shift, int64_t begin, double* counts);
+  void SetGrid(int shift, int64_t begin, int64_t end, const double* counts);
+
+  // The area under the ROC curve, not normalized, and the total negative
+  // and positive counts. The same as BasicAucCalculator::compute() on the
+  // dense tables when shift() is 0.
+  void Area(double* area, double* neg, double* pos) const;
+  // The same as BasicAucCalculator::calculate_bucket_error() on the dense
+  // tables when shift() is 0.
+  double BucketError(double max_span, double relative_error_bound) const;
+
+  int table_size() const { return table_size_; }
+  // Every bucket covers 2^shift buckets of the table.
+  int shift() const { return shift_; }
+  size_t bucket_num() const { return buckets_.size(); }
+
+ private:
+  struct Bucket {
+    double count[2] = {0, 0};
+  };
+
+  void AddBucket(int64_t bucket, int shift, double neg, double pos);
+  void Coarsen(int shift);
+  std::vector<std::pair<int64_t, Bucket>> SortedBuckets() const;
+
+  int table_size_;
+  size_t max_buckets_;
+  int shift_ = 0;
+  std::unordered_map<int64_t, Bucket> buckets_;
+};
+
+// An AucSketch per user for UAUC, the mean AUC of the users that have both
+// negative and positive samples, weighted by their sample numbers.
+class UserAucSketch {
+ public:
+  UserAucSketch(int table_size, int max_buckets_per_user);
+
+  void Add(uint64_t uid, double pred, int label);
+  void Reset();
+  // result[0] is the sum of AUC times sample num of the users counted,
+  // result[1] the sum of their sample nums and result[2] their number. The
+  // results of workers can be summed up if every user is on one worker.
+  void Compute(double result[3]) const;
+
+  size_t user_num() const { return users_.size(); }
+
+ private:
+  int table_size_;
+  int max_buckets_per_user_;
+  std::unordered_map<uint64_t, AucSketch> users_;
+};
+
+}  // namespace framework
+}  // namespace paddle
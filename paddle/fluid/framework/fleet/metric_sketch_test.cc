@@ -0,0 +1,255 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/framework/fleet/metric_sketch.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+static const double kRelativeErrorBound = 0.05;
+static const double kMaxSpan = 0.01;
+
+// The dense tables of BasicAucCalculator.
+struct DenseTable {
+  explicit DenseTable(int size) : size(size) {
+    table[0].assign(size, 0);
+    table[1].assign(size, 0);
+  }
+
+  void Add(double pred, int label) {
+    int pos = std::min(static_cast<int>(pred * size), size - 1);
+    ++table[label][pos];
+  }
+
+  // BasicAucCalculator::compute()
+  double Auc() const {
+    double area = 0;
+    double fp = 0;
+    double tp = 0;
+    for (int i = size - 1; i >= 0; i--) {
+      double newfp = fp + table[0][i];
+      double newtp = tp + table[1][i];
+      area += (newfp - fp) * (tp + newtp) / 2;
+      fp = newfp;
+      tp = newtp;
+    }
+    return area / (fp * tp);
+  }
+
+  // BasicAucCalculator::calculate_bucket_error()
+  double BucketError() const {
+    double last_ctr = -1;
+    double impression_sum = 0;
+    double ctr_sum = 0.0;
+    double click_sum = 0.0;
+    double error_sum = 0.0;
+    double error_count = 0;
+    for (int i = 0; i < size; i++) {
+      double click = table[1][i];
+      double show = table[0][i] + table[1][i];
+      double ctr = static_cast<double>(i) / size;
+      if (fabs(ctr - last_ctr) > kMaxSpan) {
+        last_ctr = ctr;
+        impression_sum = 0.0;
+        ctr_sum = 0.0;
+        click_sum = 0.0;
+      }
+      impression_sum += show;
+      ctr_sum += ctr * show;
+      click_sum += click;
+      double adjust_ctr = ctr_sum / impression_sum;
+      double relative_error =
+          sqrt((1 - adjust_ctr) / (adjust_ctr * impression_sum));
+      if (relative_error < kRelativeErrorBound) {
+        double actual_ctr = click_sum / impression_sum;
+        double relative_ctr_error = fabs(actual_ctr / adjust_ctr - 1);
+        error_sum += relative_ctr_error * impression_sum;
+        error_count += impression_sum;
+        last_ctr = -1;
+      }
+    }
+    return error_count > 0 ? error_sum / error_count : 0.0;
+  }
+
+  int size;
+  std::vector<double> table[2];
+};
+
+static double SketchAuc(const AucSketch& sketch) {
+  double area = 0;
+  double neg = 0;
+  double pos = 0;
+  sketch.Area(&area, &neg, &pos);
+  return area / (neg * pos);
+}
+
+TEST(AucSketch, SameAsDenseTable) {
+  const int table_size = 100000;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(0, 1);
+  // Skewed preds, so that most of the table stays empty.
+  for (int sample_num : {1000, 100000}) {
+    DenseTable dense(table_size);
+    AucSketch sketch(table_size, table_size);
+    for (int i = 0; i < sample_num; ++i) {
+      double pred = std::pow(dist(rng), 3);
+      int label = dist(rng) < pred ? 1 : 0;
+      dense.Add(pred, label);
+      sketch.Add(pred, label);
+    }
+    EXPECT_EQ(sketch.shift(), 0);
+    EXPECT_EQ(SketchAuc(sketch), dense.Auc());
+    EXPECT_EQ(sketch.BucketError(kMaxSpan, kRelativeErrorBound),
+              dense.BucketError());
+    EXPECT_GT(dense.BucketError(), 0);
+  }
+}
+
+TEST(AucSketch, BoundedMerge) {
+  const int table_size = 1 << 20;
+  const int max_buckets = 4096;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(0, 1);
+  DenseTable dense(table_size);
+  AucSketch all(table_size, max_buckets);
+  std::vector<AucSketch> parts(4, AucSketch(table_size, max_buckets));
+  for (int i = 0; i < 400000; ++i) {
+    double pred = dist(rng);
+    int label = dist(rng) < pred ? 1 : 0;
+    dense.Add(pred, label);
+    all.Add(pred, label);
+    parts[i % 4].Add(pred, label);
+  }
+  EXPECT_LE(all.bucket_num(), static_cast<size_t>(max_buckets));
+  EXPECT_GT(all.shift(), 0);
+  // Coarser buckets only lose the order inside them.
+  EXPECT_NEAR(SketchAuc(all), dense.Auc(), 1e-3);
+
+  AucSketch merged(table_size, max_buckets);
+  for (auto& part : parts) {
+    merged.Merge(part);
+  }
+  EXPECT_EQ(merged.shift(), all.shift());
+  EXPECT_NEAR(SketchAuc(merged), SketchAuc(all), 1e-12);
+  EXPECT_NEAR(merged.BucketError(kMaxSpan, kRelativeErrorBound),
+              all.BucketError(kMaxSpan, kRelativeErrorBound), 1e-12);
+
+  merged.Reset();
+  EXPECT_EQ(merged.bucket_num(), 0UL);
+  EXPECT_EQ(merged.shift(), 0);
+}
+
+// The element-wise sums of allreduce_sum, done in turn for the workers.
+static void GridAllreduce(std::vector<AucSketch>* workers) {
+  int worker_num = workers->size();
+  std::vector<double> headers(worker_num * AucSketch::kGridHeaderSize, 0.0);
+  for (int i = 0; i < worker_num; ++i) {
+    (*workers)[i].GridHeader(headers.data() + i * AucSketch::kGridHeaderSize);
+  }
+  int shift = 0;
+  int64_t begin = 0;
+  int64_t end = 0;
+  ASSERT_TRUE(
+      AucSketch::GridRange(headers.data(), worker_num, &shift, &begin, &end));
+  std::vector<double> sum(2 * (end - begin), 0.0);
+  for (auto& worker : *workers) {
+    std::vector<double> counts(sum.size(), 0.0);
+    worker.FillGrid(shift, begin, counts.data());
+    for (size_t i = 0; i < sum.size(); ++i) {
+      sum[i] += counts[i];
+    }
+  }
+  for (auto& worker : *workers) {
+    worker.SetGrid(shift, begin, end, sum.data());
+  }
+}
+
+TEST(AucSketch, GridAllreduce) {
+  const int table_size = 1 << 20;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(0, 1);
+  // Workers of different resolutions and pred ranges, one empty.
+  std::vector<int> max_buckets = {1 << 20, 4096, 256, 1 << 20};
+  std::vector<AucSketch> workers;
+  for (int max_bucket : max_buckets) {
+    workers.emplace_back(table_size, max_bucket);
+  }
+  for (int i = 0; i < 300000; ++i) {
+    int worker = i % 3;
+    double pred = dist(rng) * (worker + 1) / 3;
+    int label = dist(rng) < pred ? 1 : 0;
+    workers[worker].Add(pred, label);
+  }
+  // Every worker ends up as if it had merged all the others.
+  std::vector<AucSketch> expected = workers;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    for (size_t j = 0; j < workers.size(); ++j) {
+      if (i != j) {
+        expected[i].Merge(workers[j]);
+      }
+    }
+  }
+  GridAllreduce(&workers);
+  for (size_t i = 0; i < workers.size(); ++i) {
+    EXPECT_EQ(workers[i].shift(), expected[i].shift());
+    EXPECT_EQ(workers[i].bucket_num(), expected[i].bucket_num());
+    EXPECT_NEAR(SketchAuc(workers[i]), SketchAuc(expected[i]), 1e-12);
+  }
+}
+
+TEST(UserAucSketch, Compute) {
+  const int table_size = 1000;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(0, 1);
+  UserAucSketch sketch(table_size, table_size);
+  std::map<uint64_t, DenseTable> users;
+  for (int i = 0; i < 20000; ++i) {
+    uint64_t uid = rng() % 300;
+    double pred = dist(rng);
+    int label = dist(rng) < pred ? 1 : 0;
+    sketch.Add(uid, pred, label);
+    users.emplace(uid, DenseTable(table_size)).first->second.Add(pred, label);
+  }
+  // A user with only negative samples is not counted.
+  sketch.Add(1000, 0.5, 0);
+
+  double expected[3] = {0, 0, 0};
+  for (auto& user : users) {
+    double num = 0;
+    for (int i = 0; i < table_size; ++i) {
+      num += user.second.table[0][i] + user.second.table[1][i];
+    }
+    expected[0] += user.second.Auc() * num;
+    expected[1] += num;
+    expected[2] += 1;
+  }
+  double result[3];
+  sketch.Compute(result);
+  EXPECT_NEAR(result[0] / result[1], expected[0] / expected[1], 1e-9);
+  EXPECT_EQ(result[1], expected[1]);
+  EXPECT_EQ(result[2], expected[2]);
+  EXPECT_EQ(sketch.user_num(), users.size() + 1);
+
+  sketch.Reset();
+  EXPECT_EQ(sketch.user_num(), 0UL);
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,244 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/framework/fleet/perfect_hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <functional>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace framework {
+
+// Bits of a level per key left, more bits place more keys in a level.
+static const uint64_t kLevelBitsPerKey = 2;
+static const size_t kMaxLevelNum = 32;
+// The keys of a shard, small enough for the bit arrays of the build to stay
+// in cache.
+static const size_t kShardKeyNum = 16384;
+static const int kMaxShardBits = 16;
+
+static int PopCount(uint64_t word) {
+  return static_cast<int>(std::bitset<64>(word).count());
+}
+
+static void RunInThreads(int thread_num,
+                         const std::function<void(int)>& func) {
+  std::vector<std::thread> threads;
+  for (int tid = 1; tid < thread_num; ++tid) {
+    threads.emplace_back(func, tid);
+  }
+  func(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+constexpr uint32_t PerfectHashTable::kMiss;
+
+uint32_t PerfectHashTable::Locate(const Shard& shard, uint64_t key) {
+  for (size_t level = 0; level + 1 < shard.levels.size(); ++level) {
+    uint64_t size = shard.levels[level + 1] - shard.levels[level];
+    uint64_t bit = shard.levels[level] + LevelHash(key, level) % size;
+    const Block& block = shard.blocks[bit / 192];
+    int word = static_cast<int>(bit % 192 / 64);
+    uint64_t mask = uint64_t(1) << (bit % 64);
+    if (block.bits[word] & mask) {
+      uint64_t rank = block.rank + PopCount(block.bits[word] & (mask - 1));
+      for (int i = 0; i < word; ++i) {
+        rank += PopCount(block.bits[i]);
+      }
+      return static_cast<uint32_t>(rank);
+    }
+  }
+  auto iter =
+      std::lower_bound(shard.fallback.begin(), shard.fallback.end(), key);
+  if (iter == shard.fallback.end() || *iter != key) {
+    return kMiss;
+  }
+  return static_cast<uint32_t>(shard.bit_num +
+                               (iter - shard.fallback.begin()));
+}
+
+// keys should be distinct, they are left in the fallback if not placed.
+void PerfectHashTable::BuildShard(std::vector<uint64_t>* keys, Shard* shard) {
+  std::vector<std::vector<uint64_t>> level_bits;
+  shard->levels.assign(1, 0);
+  for (size_t level = 0; level < kMaxLevelNum && !keys->empty(); ++level) {
+    uint64_t size = std::max<uint64_t>(64, keys->size() * kLevelBitsPerKey);
+    std::vector<uint64_t> seen((size + 63) / 64, 0);
+    std::vector<uint64_t> collided(seen.size(), 0);
+    for (uint64_t key : *keys) {
+      uint64_t pos = LevelHash(key, level) % size;
+      uint64_t mask = uint64_t(1) << (pos % 64);
+      if (seen[pos / 64] & mask) {
+        collided[pos / 64] |= mask;
+      } else {
+        seen[pos / 64] |= mask;
+      }
+    }
+    size_t left = 0;
+    for (uint64_t key : *keys) {
+      uint64_t pos = LevelHash(key, level) % size;
+      if (collided[pos / 64] & (uint64_t(1) << (pos % 64))) {
+        (*keys)[left++] = key;
+      }
+    }
+    keys->resize(left);
+    for (size_t i = 0; i < seen.size(); ++i) {
+      seen[i] &= ~collided[i];
+    }
+    level_bits.push_back(std::move(seen));
+    shard->levels.push_back(shard->levels.back() + size);
+  }
+  // The keys stay sorted.
+  shard->fallback.assign(keys->begin(), keys->end());
+
+  shard->blocks.assign((shard->levels.back() + 191) / 192, Block{0, {0}});
+  for (size_t level = 0; level < level_bits.size(); ++level) {
+    const auto& bits = level_bits[level];
+    for (size_t i = 0; i < bits.size(); ++i) {
+      for (int j = 0; j < 64 && (bits[i] >> j) != 0; ++j) {
+        if ((bits[i] >> j) & 1) {
+          uint64_t bit = shard->levels[level] + i * 64 + j;
+          shard->blocks[bit / 192].bits[bit % 192 / 64] |= uint64_t(1)
+                                                           << (bit % 64);
+        }
+      }
+    }
+  }
+  uint64_t rank = 0;
+  for (auto& block : shard->blocks) {
+    block.rank = rank;
+    rank += PopCount(block.bits[0]) + PopCount(block.bits[1]) +
+            PopCount(block.bits[2]);
+  }
+  shard->bit_num = rank;
+}
+
+void PerfectHashTable::Build(const std::vector<uint64_t>& keys,
+                             int thread_num) {
+  PADDLE_ENFORCE_LT(keys.size(), static_cast<size_t>(kMiss),
+                    platform::errors::InvalidArgument(
+                        "The perfect hash table holds less than %u keys, but "
+                        "got %u keys.",
+                        kMiss, keys.size()));
+  Clear();
+  const size_t key_num = keys.size();
+  int shard_bits = 0;
+  while (shard_bits < kMaxShardBits && (key_num >> shard_bits) > kShardKeyNum) {
+    ++shard_bits;
+  }
+  shard_shift_ = 64 - shard_bits;
+  const size_t shard_num = size_t(1) << shard_bits;
+  shards_.resize(shard_num);
+  thread_num = std::max(1, thread_num);
+  auto shard_of = [this](uint64_t key) -> size_t {
+    return shard_shift_ < 64 ? key >> shard_shift_ : 0;
+  };
+
+  // Partition the keys by shard, a thread scatters a range of keys.
+  size_t chunk = (key_num + thread_num - 1) / thread_num;
+  std::vector<std::vector<size_t>> offsets(
+      thread_num, std::vector<size_t>(shard_num, 0));
+  RunInThreads(thread_num, [&](int tid) {
+    size_t end = std::min(key_num, (tid + 1) * chunk);
+    for (size_t i = tid * chunk; i < end; ++i) {
+      ++offsets[tid][shard_of(keys[i])];
+    }
+  });
+  std::vector<size_t> shard_begin(shard_num + 1, 0);
+  size_t offset = 0;
+  for (size_t s = 0; s < shard_num; ++s) {
+    shard_begin[s] = offset;
+    for (int tid = 0; tid < thread_num; ++tid) {
+      size_t count = offsets[tid][s];
+      offsets[tid][s] = offset;
+      offset += count;
+    }
+  }
+  shard_begin[shard_num] = offset;
+  std::vector<std::pair<uint64_t, uint32_t>> entries(key_num);
+  RunInThreads(thread_num, [&](int tid) {
+    size_t end = std::min(key_num, (tid + 1) * chunk);
+    for (size_t i = tid * chunk; i < end; ++i) {
+      entries[offsets[tid][shard_of(keys[i])]++] =
+          std::make_pair(keys[i], static_cast<uint32_t>(i));
+    }
+  });
+
+  // Build the shards, the equal keys are sorted by value to keep the first.
+  std::vector<size_t> shard_end(shard_num, 0);
+  std::atomic<size_t> next_shard{0};
+  RunInThreads(thread_num, [&](int tid) {
+    std::vector<uint64_t> shard_keys;
+    size_t s = 0;
+    while ((s = next_shard.fetch_add(1)) < shard_num) {
+      auto begin = entries.begin() + shard_begin[s];
+      auto end = entries.begin() + shard_begin[s + 1];
+      std::sort(begin, end);
+      end = std::unique(begin, end, [](const std::pair<uint64_t, uint32_t>& a,
+                                       const std::pair<uint64_t, uint32_t>& b) {
+        return a.first == b.first;
+      });
+      shard_end[s] = end - entries.begin();
+      shard_keys.clear();
+      for (auto iter = begin; iter != end; ++iter) {
+        shard_keys.push_back(iter->first);
+      }
+      BuildShard(&shard_keys, &shards_[s]);
+    }
+  });
+
+  uint32_t slot_num = 0;
+  for (size_t s = 0; s < shard_num; ++s) {
+    shards_[s].base = slot_num;
+    slot_num += static_cast<uint32_t>(shard_end[s] - shard_begin[s]);
+  }
+  slots_.resize(slot_num);
+  RunInThreads(thread_num, [&](int tid) {
+    for (size_t s = tid; s < shard_num; s += thread_num) {
+      const Shard& shard = shards_[s];
+      for (size_t i = shard_begin[s]; i < shard_end[s]; ++i) {
+        Slot& slot = slots_[shard.base + Locate(shard, entries[i].first)];
+        slot.fingerprint = Fingerprint(entries[i].first);
+        slot.value = entries[i].second;
+      }
+    }
+  });
+}
+
+void PerfectHashTable::Clear() {
+  shard_shift_ = 64;
+  std::vector<Shard>().swap(shards_);
+  std::vector<Slot>().swap(slots_);
+}
+
+size_t PerfectHashTable::MemoryBytes() const {
+  size_t bytes = slots_.capacity() * sizeof(Slot) +
+                 shards_.capacity() * sizeof(Shard);
+  for (auto& shard : shards_) {
+    bytes += shard.blocks.capacity() * sizeof(Block) +
+             shard.levels.capacity() * sizeof(uint64_t) +
+             shard.fallback.capacity() * sizeof(uint64_t);
+  }
+  return bytes;
+}
+
+}  // namespace framework
+}  // namespace paddle
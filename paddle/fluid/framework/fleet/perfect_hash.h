@@ -0,0 +1,101 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// A read only map of 64 bit key hashes to 32 bit values, built once from
+// all keys. The keys are partitioned into shards by their high bits, every
+// shard has a minimal perfect hash in levels of bit arrays (BBHash), which
+// gives every key of the shard a distinct slot. A slot keeps a fingerprint
+// of its key to tell the keys not in the map, and the value. The map takes
+// about 9 bytes per key, a lookup touches a bit block of about 1.6 levels
+// on average and a slot.
+//
+// The keys should be well mixed hashes. Of the keys not in the map, one in
+// 2^32 is taken for a key in the map.
+class PerfectHashTable {
+ public:
+  static constexpr uint32_t kMiss = UINT32_MAX;
+
+  // Map keys[i] to i with thread_num threads. Of the equal keys the first
+  // one is kept.
+  void Build(const std::vector<uint64_t>& keys, int thread_num);
+  void Clear();
+
+  uint32_t Find(uint64_t key) const {
+    if (shards_.empty()) {
+      return kMiss;
+    }
+    const Shard& shard = shards_[shard_shift_ < 64 ? key >> shard_shift_ : 0];
+    uint32_t local = Locate(shard, key);
+    if (local == kMiss) {
+      return kMiss;
+    }
+    const Slot& slot = slots_[shard.base + local];
+    return slot.fingerprint == Fingerprint(key) ? slot.value : kMiss;
+  }
+
+  size_t size() const { return slots_.size(); }
+  size_t MemoryBytes() const;
+
+ private:
+  // 192 bits of a level and the number of set bits in the shard before.
+  struct Block {
+    uint64_t rank;
+    uint64_t bits[3];
+  };
+  struct Shard {
+    std::vector<Block> blocks;
+    // The first bit of every level, and the end of the last.
+    std::vector<uint64_t> levels;
+    // Keys left after all levels, sorted, their slots follow those of the
+    // bits.
+    std::vector<uint64_t> fallback;
+    uint64_t bit_num = 0;
+    uint32_t base = 0;
+  };
+  struct Slot {
+    uint32_t fingerprint;
+    uint32_t value;
+  };
+
+  static uint64_t LevelHash(uint64_t key, size_t level) {
+    key += (level + 1) * 0x9e3779b97f4a7c15ULL;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+  // The shard is taken from the high bits, the level hashes mix all bits.
+  static uint32_t Fingerprint(uint64_t key) {
+    return static_cast<uint32_t>(key);
+  }
+  static uint32_t Locate(const Shard& shard, uint64_t key);
+  static void BuildShard(std::vector<uint64_t>* keys, Shard* shard);
+
+  int shard_shift_ = 64;
+  std::vector<Shard> shards_;
+  std::vector<Slot> slots_;
+};
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,142 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/framework/fleet/perfect_hash.h"
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>  // NOLINT
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+TEST(PerfectHashTable, Empty) {
+  PerfectHashTable table;
+  EXPECT_EQ(table.Find(1), PerfectHashTable::kMiss);
+  table.Build({}, 4);
+  EXPECT_EQ(table.size(), 0UL);
+  EXPECT_EQ(table.Find(1), PerfectHashTable::kMiss);
+  table.Build({42}, 4);
+  EXPECT_EQ(table.size(), 1UL);
+  EXPECT_EQ(table.Find(42), 0U);
+  EXPECT_EQ(table.Find(43), PerfectHashTable::kMiss);
+}
+
+TEST(PerfectHashTable, Find) {
+  std::mt19937_64 rng(0);
+  for (size_t key_num : {1000UL, 300000UL}) {
+    std::vector<uint64_t> keys;
+    std::unordered_map<uint64_t, uint32_t> expected;
+    for (size_t i = 0; i < key_num; ++i) {
+      // Every tenth key repeats an earlier one.
+      uint64_t key = (i % 10 == 9) ? keys[rng() % keys.size()] : rng();
+      expected.emplace(key, static_cast<uint32_t>(keys.size()));
+      keys.push_back(key);
+    }
+    PerfectHashTable table;
+    table.Build(keys, 8);
+    EXPECT_EQ(table.size(), expected.size());
+    for (auto& item : expected) {
+      ASSERT_EQ(table.Find(item.first), item.second);
+    }
+    size_t found = 0;
+    for (size_t i = 0; i < key_num; ++i) {
+      uint64_t key = rng();
+      if (expected.count(key) == 0 &&
+          table.Find(key) != PerfectHashTable::kMiss) {
+        ++found;
+      }
+    }
+    EXPECT_EQ(found, 0UL);
+    EXPECT_LT(table.MemoryBytes(), expected.size() * 10);
+
+    table.Clear();
+    EXPECT_EQ(table.size(), 0UL);
+    EXPECT_EQ(table.Find(keys[0]), PerfectHashTable::kMiss);
+  }
+}
+
+// The index of InputTable by strings, against the map it replaces.
+// Run with --gtest_also_run_disabled_tests.
+TEST(PerfectHashTable, DISABLED_Benchmark) {
+  const size_t key_num = 2000000;
+  const int thread_num = 8;
+  std::vector<std::string> strings;
+  strings.reserve(key_num);
+  for (size_t i = 0; i < key_num; ++i) {
+    strings.push_back("input_table_key_" + std::to_string(i * 7919));
+  }
+  std::hash<std::string> hash;
+
+  auto start = std::chrono::steady_clock::now();
+  std::unordered_map<std::string, uint64_t> map;
+  for (size_t i = 0; i < key_num; ++i) {
+    map.emplace(strings[i], i);
+  }
+  double map_build = SecondsSince(start);
+  // The nodes with the strings and the buckets.
+  size_t map_bytes =
+      map.size() * (sizeof(void*) + sizeof(size_t) +
+                    sizeof(std::pair<const std::string, uint64_t>)) +
+      map.bucket_count() * sizeof(void*);
+
+  start = std::chrono::steady_clock::now();
+  std::vector<uint64_t> keys(key_num);
+  for (size_t i = 0; i < key_num; ++i) {
+    keys[i] = hash(strings[i]);
+  }
+  PerfectHashTable table;
+  table.Build(keys, thread_num);
+  double table_build = SecondsSince(start);
+
+  std::mt19937 rng(0);
+  std::vector<size_t> queries(key_num);
+  for (auto& query : queries) {
+    query = rng() % key_num;
+  }
+  uint64_t sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t query : queries) {
+    sum += map.find(strings[query])->second;
+  }
+  double map_lookup = SecondsSince(start);
+  uint64_t table_sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t query : queries) {
+    table_sum += table.Find(hash(strings[query]));
+  }
+  double table_lookup = SecondsSince(start);
+  EXPECT_EQ(table_sum, sum);
+
+  LOG(INFO) << key_num << " keys, unordered_map build: " << map_build
+            << " s, memory: " << map_bytes / 1048576.0
+            << " MB, lookups: " << key_num / map_lookup / 1e6 << " M/s";
+  LOG(INFO) << key_num << " keys, perfect hash build with " << thread_num
+            << " threads: " << table_build
+            << " s, memory: " << table.MemoryBytes() / 1048576.0
+            << " MB, lookups: " << key_num / table_lookup / 1e6 << " M/s";
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -20,6 +20,9 @@ limitations under the License. */
 #include "paddle/fluid/platform/cpu_helper.h"
 #include "paddle/fluid/platform/lodtensor_printer.h"
 
+DECLARE_bool(device_worker_compiled_plan);
+DECLARE_bool(executor_memory_plan);
+
 namespace paddle {
 namespace framework {
 
@@ -50,6 +53,26 @@ void HogwildWorker::CreateThreadOperators(const ProgramDesc &program) {
   }
   operators::PrepareSafeEagerDeletionOnConditionalOpAndConditionalGradOp(
       program, 0, ops_);
+
+  if (FLAGS_executor_memory_plan && platform::is_cpu_place(place_)) {
+    // vars read after the ops run keep their own memory
+    std::vector<std::string> skip_vars;
+    for (int i = 0; i < fetch_config_.fetch_var_names_size(); ++i) {
+      skip_vars.push_back(fetch_config_.fetch_var_names(i));
+    }
+    if (need_dump_field_ && dump_fields_ != nullptr) {
+      skip_vars.insert(skip_vars.end(), dump_fields_->begin(),
+                       dump_fields_->end());
+    }
+    for (auto &pair : stat_var_name_map_) {
+      skip_vars.push_back(pair.first);
+    }
+    memory_planner_.reset(new MemoryPlanner(block, ops_, skip_vars));
+  }
+  if (FLAGS_device_worker_compiled_plan) {
+    op_plan_.reset(
+        new CompiledOpPlan(ops_, skip_ops_, *thread_scope_, place_));
+  }
 }
 
 void HogwildWorker::CreateThreadScope(const ProgramDesc &program) {
@@ -135,6 +158,9 @@ void HogwildWorker::TrainFilesWithProfiler() {
     timeline.Pause();
     read_time += timeline.ElapsedSec();
     total_time += timeline.ElapsedSec();
+    if (memory_planner_) {
+      memory_planner_->PreRun(*thread_scope_, place_);
+    }
     for (size_t i = 0; i < ops_.size(); ++i) {
       bool need_skip = false;
       for (auto t = 0u; t < skip_ops_.size(); ++t) {
@@ -147,12 +173,18 @@ void HogwildWorker::TrainFilesWithProfiler() {
       VLOG(3) << "Going to run op " << op_name[i];
       if (!need_skip) {
         ops_[i]->Run(*thread_scope_, place_);
+        if (memory_planner_) {
+          memory_planner_->PostOpRun(*thread_scope_, i);
+        }
       }
       VLOG(3) << "Op " << op_name[i] << " Finished";
       timeline.Pause();
       op_total_time[i] += timeline.ElapsedSec();
       total_time += timeline.ElapsedSec();
     }
+    if (memory_planner_) {
+      memory_planner_->PostRun(*thread_scope_);
+    }
 
     if (need_dump_field_) {
       DumpField(*thread_scope_, dump_mode_, dump_interval_);
@@ -198,17 +230,35 @@ void HogwildWorker::TrainFiles() {
   device_reader_->Start();
   int cur_batch;
   while ((cur_batch = device_reader_->Next()) > 0) {
-    for (auto &op : ops_) {
-      bool need_skip = false;
-      for (auto t = 0u; t < skip_ops_.size(); ++t) {
-        if (op->Type().find(skip_ops_[t]) != std::string::npos) {
-          need_skip = true;
-          break;
+    if (memory_planner_) {
+      memory_planner_->PreRun(*thread_scope_, place_);
+    }
+    if (op_plan_ && memory_planner_) {
+      op_plan_->Run([this](size_t op_idx) {
+        memory_planner_->PostOpRun(*thread_scope_, op_idx);
+      });
+    } else if (op_plan_) {
+      op_plan_->Run();
+    } else {
+      for (size_t i = 0; i < ops_.size(); ++i) {
+        auto *op = ops_[i];
+        bool need_skip = false;
+        for (auto t = 0u; t < skip_ops_.size(); ++t) {
+          if (op->Type().find(skip_ops_[t]) != std::string::npos) {
+            need_skip = true;
+            break;
+          }
+        }
+        if (!need_skip) {
+          op->Run(*thread_scope_, place_);
+          if (memory_planner_) {
+            memory_planner_->PostOpRun(*thread_scope_, i);
+          }
         }
       }
-      if (!need_skip) {
-        op->Run(*thread_scope_, place_);
-      }
+    }
+    if (memory_planner_) {
+      memory_planner_->PostRun(*thread_scope_);
     }
 
     PrintFetchVars();
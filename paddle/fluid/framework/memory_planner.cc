@@ -0,0 +1,352 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/memory_planner.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+#include <utility>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/framework/var_desc.h"
+#include "paddle/fluid/memory/malloc.h"
+
+DEFINE_bool(executor_memory_plan, false,
+            "Whether to plan the memory of the temporary tensors of the CPU "
+            "Executor and HogwildWorker ahead of time, so that they are bound "
+            "to slices of one arena instead of being allocated every batch.");
+
+namespace paddle {
+namespace framework {
+
+static constexpr size_t kPlanAlignment = 64;
+
+class MemoryPlanner::ArenaAllocation : public memory::Allocation {
+ public:
+  ArenaAllocation(const std::shared_ptr<memory::Allocation> &arena,
+                  size_t offset, size_t size)
+      : Allocation(static_cast<uint8_t *>(arena->ptr()) + offset, size,
+                   arena->place()),
+        arena_(arena) {}
+
+ private:
+  std::shared_ptr<memory::Allocation> arena_;
+};
+
+size_t MemoryPlanner::AssignOffsets(std::vector<Buffer> *buffers) {
+  std::vector<size_t> order(buffers->size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  // Place large buffers first, they are the hardest to fit into gaps.
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    auto &x = (*buffers)[a];
+    auto &y = (*buffers)[b];
+    return x.size != y.size ? x.size > y.size : x.first_op < y.first_op;
+  });
+
+  size_t arena_size = 0;
+  std::vector<size_t> placed;
+  std::vector<std::pair<size_t, size_t>> used;
+  for (size_t idx : order) {
+    auto &buffer = (*buffers)[idx];
+    size_t size = memory::allocation::AlignedSize(buffer.size, kPlanAlignment);
+    used.clear();
+    for (size_t other_idx : placed) {
+      auto &other = (*buffers)[other_idx];
+      if (other.first_op <= buffer.last_op &&
+          buffer.first_op <= other.last_op) {
+        used.emplace_back(other.offset,
+                          other.offset + memory::allocation::AlignedSize(
+                                             other.size, kPlanAlignment));
+      }
+    }
+    std::sort(used.begin(), used.end());
+    // the lowest gap between the buffers alive at the same time
+    size_t offset = 0;
+    for (auto &range : used) {
+      if (offset + size <= range.first) {
+        break;
+      }
+      offset = std::max(offset, range.second);
+    }
+    buffer.offset = offset;
+    arena_size = std::max(arena_size, offset + size);
+    placed.push_back(idx);
+  }
+  return arena_size;
+}
+
+MemoryPlanner::MemoryPlanner(const BlockDesc &block,
+                             const std::vector<OperatorBase *> &ops,
+                             const std::vector<std::string> &skip_vars) {
+  for (auto *op : ops) {
+    if (op->HasAttr("sub_block") || op->HasAttr("sub_blocks")) {
+      VLOG(3) << "Op " << op->Type() << " has sub-blocks, skip memory plan";
+      return;
+    }
+  }
+
+  std::unordered_set<std::string> skip_set(skip_vars.begin(),
+                                           skip_vars.end());
+  std::unordered_set<std::string> read_first;
+  op_inputs_.resize(ops.size());
+  op_outputs_.resize(ops.size());
+  for (size_t i = 0; i < ops.size(); ++i) {
+    auto *op = ops[i];
+    for (auto &pair : op->Inputs()) {
+      for (auto &name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        op_inputs_[i].push_back(name);
+        auto iter = var_index_.find(name);
+        if (iter == var_index_.end()) {
+          read_first.insert(name);
+        } else {
+          vars_[iter->second].last_op = i;
+        }
+      }
+    }
+    for (auto &pair : op->Outputs()) {
+      for (auto &name : pair.second) {
+        if (name == kEmptyVarName) continue;
+        op_outputs_[i].push_back(name);
+        auto iter = var_index_.find(name);
+        if (iter != var_index_.end()) {
+          vars_[iter->second].last_op = i;
+          continue;
+        }
+        // feed shares the memory of the tensors given by the user
+        if (read_first.count(name) || skip_set.count(name) ||
+            op->Type() == "feed") {
+          continue;
+        }
+        auto *var_desc = block.FindVarRecursive(name);
+        if (var_desc == nullptr || var_desc->Persistable() ||
+            var_desc->GetType() != proto::VarType::LOD_TENSOR) {
+          continue;
+        }
+        int idx = static_cast<int>(vars_.size());
+        var_index_[name] = idx;
+        vars_.push_back(VarPlan{name, i, i, 0, idx, false});
+      }
+    }
+  }
+  VLOG(3) << "Memory plan candidates: " << vars_.size() << " vars";
+}
+
+std::unique_ptr<MemoryPlanner> MemoryPlanner::Clone() const {
+  std::unique_ptr<MemoryPlanner> planner(new MemoryPlanner());
+  planner->vars_ = vars_;
+  planner->var_index_ = var_index_;
+  planner->op_inputs_ = op_inputs_;
+  planner->op_outputs_ = op_outputs_;
+  planner->profiling_ = profiling_;
+  planner->arena_size_ = arena_size_;
+  planner->eager_peak_size_ = eager_peak_size_;
+  return planner;
+}
+
+int MemoryPlanner::Find(int idx) {
+  while (vars_[idx].parent != idx) {
+    vars_[idx].parent = vars_[vars_[idx].parent].parent;
+    idx = vars_[idx].parent;
+  }
+  return idx;
+}
+
+void MemoryPlanner::Union(int a, int b) {
+  a = Find(a);
+  b = Find(b);
+  if (a != b) {
+    vars_[b].parent = a;
+    vars_[a].excluded = vars_[a].excluded || vars_[b].excluded;
+  }
+}
+
+LoDTensor *MemoryPlanner::GetTensor(const Scope &scope,
+                                    const std::string &name) const {
+  auto *var = scope.FindVar(name);
+  if (var == nullptr || !var->IsType<LoDTensor>()) {
+    return nullptr;
+  }
+  return var->GetMutable<LoDTensor>();
+}
+
+void MemoryPlanner::PreRun(const Scope &scope, const platform::Place &place) {
+  if (!Enabled()) {
+    return;
+  }
+  if (profiling_) {
+    // Give the old arena back before the tensors allocate on their own.
+    for (size_t i = 0; i < slices_.size(); ++i) {
+      auto *tensor = GetTensor(scope, vars_[i].name);
+      if (slices_[i] != nullptr && tensor != nullptr &&
+          tensor->Holder() == slices_[i]) {
+        tensor->clear();
+      }
+    }
+    slices_.clear();
+    arena_.reset();
+    owners_.clear();
+    place_ = place;
+    return;
+  }
+  // a cloned plan
+  if (slices_.empty()) {
+    BuildPlan(place);
+  }
+  for (size_t i = 0; i < slices_.size(); ++i) {
+    if (slices_[i] == nullptr) continue;
+    auto *tensor = GetTensor(scope, vars_[i].name);
+    if (tensor != nullptr && tensor->Holder() != slices_[i]) {
+      tensor->clear();
+      tensor->ResetHolder(slices_[i]);
+    }
+  }
+}
+
+void MemoryPlanner::PostOpRun(const Scope &scope, size_t op_idx) {
+  if (!profiling_ || !Enabled()) {
+    return;
+  }
+  // Memory of vars out of the plan, a planned var sharing it can not be
+  // planned.
+  for (auto &name : op_inputs_[op_idx]) {
+    if (var_index_.count(name)) continue;
+    auto *tensor = GetTensor(scope, name);
+    if (tensor != nullptr && tensor->Holder() != nullptr) {
+      owners_.emplace(tensor->Holder().get(),
+                      std::make_pair(-1, tensor->Holder()));
+    }
+  }
+  for (auto &name : op_outputs_[op_idx]) {
+    auto *tensor = GetTensor(scope, name);
+    if (tensor == nullptr || tensor->Holder() == nullptr) continue;
+    auto &holder = tensor->Holder();
+    auto iter = var_index_.find(name);
+    int idx = iter == var_index_.end() ? -1 : iter->second;
+    // The holders are kept until the plan is built, so that an address can
+    // not be reused by another tensor and be taken for sharing.
+    auto owner = owners_.emplace(holder.get(), std::make_pair(idx, holder));
+    if (!owner.second) {
+      int owner_idx = owner.first->second.first;
+      if (owner_idx >= 0 && idx >= 0) {
+        Union(owner_idx, idx);
+      } else if (owner_idx >= 0) {
+        vars_[Find(owner_idx)].excluded = true;
+      } else if (idx >= 0) {
+        vars_[Find(idx)].excluded = true;
+      }
+    }
+    if (idx >= 0) {
+      vars_[idx].size = std::max(vars_[idx].size, holder->size());
+    }
+  }
+}
+
+void MemoryPlanner::PostRun(const Scope &scope) {
+  if (!Enabled()) {
+    return;
+  }
+  if (profiling_) {
+    owners_.clear();
+    BuildPlan(place_);
+    profiling_ = false;
+    return;
+  }
+  bool replan = false;
+  for (size_t i = 0; i < slices_.size(); ++i) {
+    if (slices_[i] == nullptr) continue;
+    auto *tensor = GetTensor(scope, vars_[i].name);
+    if (tensor == nullptr || tensor->Holder() == nullptr ||
+        tensor->Holder() == slices_[i]) {
+      continue;
+    }
+    if (tensor->Holder()->size() > slices_[i]->size()) {
+      VLOG(3) << vars_[i].name << " grows to " << tensor->Holder()->size()
+              << " bytes, plan the memory again";
+      vars_[i].size = tensor->Holder()->size();
+    } else {
+      VLOG(3) << vars_[i].name << " shares memory out of the plan";
+      vars_[Find(i)].excluded = true;
+    }
+    replan = true;
+  }
+  profiling_ = replan;
+}
+
+void MemoryPlanner::BuildPlan(const platform::Place &place) {
+  std::vector<Buffer> buffers;
+  std::unordered_map<int, size_t> buffer_of_root;
+  size_t total_size = 0;
+  for (size_t i = 0; i < vars_.size(); ++i) {
+    int root = Find(i);
+    if (vars_[i].size == 0 || vars_[root].excluded) continue;
+    auto iter = buffer_of_root.find(root);
+    if (iter == buffer_of_root.end()) {
+      buffer_of_root[root] = buffers.size();
+      buffers.push_back(
+          Buffer{vars_[i].first_op, vars_[i].last_op, vars_[i].size, 0});
+    } else {
+      auto &buffer = buffers[iter->second];
+      buffer.first_op = std::min(buffer.first_op, vars_[i].first_op);
+      buffer.last_op = std::max(buffer.last_op, vars_[i].last_op);
+      buffer.size = std::max(buffer.size, vars_[i].size);
+    }
+  }
+
+  // every buffer is freed after its last use under eager deletion
+  std::map<size_t, int64_t> size_deltas;
+  for (auto &buffer : buffers) {
+    total_size += buffer.size;
+    size_deltas[buffer.first_op] += buffer.size;
+    size_deltas[buffer.last_op + 1] -= buffer.size;
+  }
+  int64_t live_size = 0;
+  eager_peak_size_ = 0;
+  for (auto &pair : size_deltas) {
+    live_size += pair.second;
+    eager_peak_size_ =
+        std::max(eager_peak_size_, static_cast<size_t>(live_size));
+  }
+
+  arena_size_ = AssignOffsets(&buffers);
+  slices_.assign(vars_.size(), nullptr);
+  if (arena_size_ == 0) {
+    return;
+  }
+  arena_ = memory::AllocShared(place, arena_size_);
+  std::vector<std::shared_ptr<memory::Allocation>> buffer_slices;
+  for (auto &buffer : buffers) {
+    buffer_slices.emplace_back(
+        std::make_shared<ArenaAllocation>(arena_, buffer.offset, buffer.size));
+  }
+  size_t planned_num = 0;
+  for (size_t i = 0; i < vars_.size(); ++i) {
+    auto iter = buffer_of_root.find(Find(i));
+    if (vars_[i].size == 0 || iter == buffer_of_root.end()) continue;
+    slices_[i] = buffer_slices[iter->second];
+    ++planned_num;
+  }
+  LOG(INFO) << "Memory plan of " << planned_num << " vars in "
+            << buffers.size() << " buffers, arena " << arena_size_
+            << " bytes, eager deletion peak " << eager_peak_size_
+            << " bytes, no reuse " << total_size << " bytes";
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,129 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/framework/block_desc.h"
+#include "paddle/fluid/framework/operator.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace framework {
+
+// Static buffer reuse for a block that is run batch after batch in the same
+// kind of scope, such as the thread scope of a HogwildWorker.
+//
+// The lifetime of a temporary LoDTensor is the range of ops between its first
+// output and its last use. The first run of the block is profiled: the size
+// of every tensor is recorded after the op writing it, and tensors sharing an
+// allocation (ShareDataWith, Slice) are merged into one buffer. The buffers
+// are then given non-overlapping offsets in one arena wherever their
+// lifetimes overlap, and before every later run each tensor is bound to its
+// slice of the arena, so that mutable_data finds enough memory and allocates
+// nothing.
+//
+// A tensor that outgrows its slice is allocated as usual and the block is
+// profiled again in the next run with the larger size. A tensor that ends up
+// sharing memory owned outside of the plan is dropped from the plan.
+//
+// Only vars written by the block before being read are planned, skip_vars
+// (vars read after the run, like fetch targets or dump fields) and
+// persistable vars are not. Blocks with sub-blocks are not planned.
+// A MemoryPlanner must not be used by two concurrent runs.
+class MemoryPlanner {
+ public:
+  struct Buffer {
+    size_t first_op;
+    size_t last_op;
+    size_t size;
+    size_t offset;
+  };
+
+  // Assign an offset to every buffer so that buffers with overlapping
+  // [first_op, last_op] ranges do not overlap in memory. Return the arena
+  // size.
+  static size_t AssignOffsets(std::vector<Buffer>* buffers);
+
+  MemoryPlanner(const BlockDesc& block, const std::vector<OperatorBase*>& ops,
+                const std::vector<std::string>& skip_vars);
+  MemoryPlanner(const MemoryPlanner&) = delete;
+  MemoryPlanner& operator=(const MemoryPlanner&) = delete;
+
+  bool Enabled() const { return !vars_.empty(); }
+  // Whether a plan is built, false while profiling.
+  bool Planned() const { return !profiling_; }
+
+  // A planner for another scope running the same ops, starting from the plan
+  // of this one if built. It allocates its own arena at its first run.
+  std::unique_ptr<MemoryPlanner> Clone() const;
+
+  // Bind the planned tensors in scope before the ops run.
+  void PreRun(const Scope& scope, const platform::Place& place);
+  // Record the outputs of ops[op_idx] after it runs, cheap unless profiling.
+  void PostOpRun(const Scope& scope, size_t op_idx);
+  // Build the plan after a profiled run, or check the bound tensors.
+  void PostRun(const Scope& scope);
+
+  size_t ArenaSize() const { return arena_size_; }
+  // The peak of the planned tensors if every one of them was freed after its
+  // last use, as eager deletion does.
+  size_t EagerDeletionPeakSize() const { return eager_peak_size_; }
+
+ private:
+  struct VarPlan {
+    std::string name;
+    size_t first_op;
+    size_t last_op;
+    size_t size;
+    int parent;
+    bool excluded;
+  };
+
+  class ArenaAllocation;
+
+  MemoryPlanner() = default;
+  int Find(int idx);
+  void Union(int a, int b);
+  LoDTensor* GetTensor(const Scope& scope, const std::string& name) const;
+  void BuildPlan(const platform::Place& place);
+
+  std::vector<VarPlan> vars_;
+  std::unordered_map<std::string, int> var_index_;
+  std::vector<std::vector<std::string>> op_inputs_;
+  std::vector<std::vector<std::string>> op_outputs_;
+
+  bool profiling_{true};
+  // Allocation -> index of the planned var owning it, or -1 for a var out of
+  // the plan, while profiling.
+  std::unordered_map<const memory::Allocation*,
+                     std::pair<int, std::shared_ptr<memory::Allocation>>>
+      owners_;
+
+  platform::Place place_;
+  std::shared_ptr<memory::Allocation> arena_;
+  // slice of the arena bound to each planned var, empty if not planned
+  std::vector<std::shared_ptr<memory::Allocation>> slices_;
+  size_t arena_size_{0};
+  size_t eager_peak_size_{0};
+};
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,260 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/memory_planner.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+namespace paddle {
+namespace framework {
+
+// overrides the numel attr of memory_plan_test_op if positive
+static int test_numel = 0;
+
+// Out = X + 1, or 1 without X, with numel elements.
+class MemoryPlanTestOp : public OperatorBase {
+ public:
+  MemoryPlanTestOp(const std::string& type, const VariableNameMap& inputs,
+                   const VariableNameMap& outputs, const AttributeMap& attrs)
+      : OperatorBase(type, inputs, outputs, attrs) {}
+
+ private:
+  void RunImpl(const Scope& scope,
+               const platform::Place& place) const override {
+    int numel = test_numel > 0 ? test_numel : Attr<int>("numel");
+    auto* out = scope.FindVar(Output("Out"))->GetMutable<LoDTensor>();
+    out->Resize({numel});
+    float* out_data = out->mutable_data<float>(place);
+    const float* x_data = nullptr;
+    auto iter = Inputs().find("X");
+    if (iter != Inputs().end() && !iter->second.empty()) {
+      x_data = scope.FindVar(Input("X"))->Get<LoDTensor>().data<float>();
+    }
+    for (int i = 0; i < numel; ++i) {
+      out_data[i] = (x_data ? x_data[i] : 0.f) + 1.f;
+    }
+  }
+};
+
+class MemoryPlanTestOpMaker : public OpProtoAndCheckerMaker {
+ public:
+  void Make() {
+    AddInput("X", "input of test op").AsDispensable();
+    AddOutput("Out", "output of test op");
+    AddAttr<int>("numel", "numel of Out");
+    AddComment("This is test op");
+  }
+};
+
+}  // namespace framework
+}  // namespace paddle
+
+REGISTER_OP_WITHOUT_GRADIENT(memory_plan_test_op,
+                             paddle::framework::MemoryPlanTestOp,
+                             paddle::framework::MemoryPlanTestOpMaker);
+
+namespace paddle {
+namespace framework {
+
+TEST(MemoryPlanner, AssignOffsets) {
+  std::vector<MemoryPlanner::Buffer> buffers = {
+      {0, 1, 1000, 0}, {1, 2, 2000, 0}, {2, 3, 1000, 0}, {3, 4, 500, 0}};
+  size_t arena_size = MemoryPlanner::AssignOffsets(&buffers);
+  // buffers alive at the same time do not overlap
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    for (size_t j = i + 1; j < buffers.size(); ++j) {
+      auto& a = buffers[i];
+      auto& b = buffers[j];
+      if (a.first_op <= b.last_op && b.first_op <= a.last_op) {
+        ASSERT_TRUE(a.offset + a.size <= b.offset ||
+                    b.offset + b.size <= a.offset);
+      }
+    }
+    ASSERT_EQ(buffers[i].offset % 64, 0UL);
+  }
+  // two buffers are alive at most, the largest pair is 2000 + 1000
+  ASSERT_EQ(arena_size, 2048UL + 1024UL);
+}
+
+static void AppendOp(BlockDesc* block, const std::string& x,
+                     const std::string& out, int numel) {
+  auto* op = block->AppendOp();
+  op->SetType("memory_plan_test_op");
+  if (!x.empty()) {
+    op->SetInput("X", {x});
+  }
+  op->SetOutput("Out", {out});
+  op->SetAttr("numel", numel);
+}
+
+static void RunOps(const std::vector<std::unique_ptr<OperatorBase>>& ops,
+                   MemoryPlanner* planner, const Scope& scope) {
+  platform::CPUPlace place;
+  planner->PreRun(scope, place);
+  for (size_t i = 0; i < ops.size(); ++i) {
+    ops[i]->Run(scope, place);
+    planner->PostOpRun(scope, i);
+  }
+  planner->PostRun(scope);
+}
+
+TEST(MemoryPlanner, Chain) {
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  std::vector<std::string> names = {"t0", "t1", "t2", "t3", "out"};
+  for (auto& name : names) {
+    block->Var(name)->SetType(proto::VarType::LOD_TENSOR);
+  }
+  AppendOp(block, "", "t0", 256);
+  for (size_t i = 1; i < names.size(); ++i) {
+    AppendOp(block, names[i - 1], names[i], 256);
+  }
+
+  std::vector<std::unique_ptr<OperatorBase>> ops;
+  std::vector<OperatorBase*> op_ptrs;
+  for (auto* op_desc : block->AllOps()) {
+    ops.emplace_back(OpRegistry::CreateOp(*op_desc));
+    op_ptrs.push_back(ops.back().get());
+  }
+  MemoryPlanner planner(*block, op_ptrs, {"out"});
+  ASSERT_TRUE(planner.Enabled());
+
+  Scope scope;
+  for (auto& name : names) {
+    scope.Var(name)->GetMutable<LoDTensor>();
+  }
+  RunOps(ops, &planner, scope);
+  // t0..t3 are 1KB each and at most two of them are alive at once
+  ASSERT_EQ(planner.EagerDeletionPeakSize(), 2048UL);
+  ASSERT_EQ(planner.ArenaSize(), 2048UL);
+
+  RunOps(ops, &planner, scope);
+  std::vector<const void*> holders;
+  for (auto& name : names) {
+    holders.push_back(scope.FindVar(name)->Get<LoDTensor>().Holder().get());
+  }
+  for (int run = 0; run < 3; ++run) {
+    RunOps(ops, &planner, scope);
+    // the planned tensors stay bound to their slices
+    for (size_t i = 0; i < names.size(); ++i) {
+      ASSERT_EQ(scope.FindVar(names[i])->Get<LoDTensor>().Holder().get(),
+                holders[i]);
+    }
+    auto& out = scope.FindVar("out")->Get<LoDTensor>();
+    ASSERT_EQ(out.data<float>()[0], 5.f);
+    ASSERT_EQ(out.data<float>()[255], 5.f);
+  }
+  auto& t0 = scope.FindVar("t0")->Get<LoDTensor>();
+  auto& t1 = scope.FindVar("t1")->Get<LoDTensor>();
+  auto& t2 = scope.FindVar("t2")->Get<LoDTensor>();
+  ASSERT_NE(t0.data<float>(), t1.data<float>());
+  ASSERT_EQ(t0.data<float>(), t2.data<float>());
+}
+
+TEST(MemoryPlanner, Clone) {
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  std::vector<std::string> names = {"t0", "t1", "t2", "out"};
+  for (auto& name : names) {
+    block->Var(name)->SetType(proto::VarType::LOD_TENSOR);
+  }
+  AppendOp(block, "", "t0", 256);
+  for (size_t i = 1; i < names.size(); ++i) {
+    AppendOp(block, names[i - 1], names[i], 256);
+  }
+
+  std::vector<std::unique_ptr<OperatorBase>> ops;
+  std::vector<OperatorBase*> op_ptrs;
+  for (auto* op_desc : block->AllOps()) {
+    ops.emplace_back(OpRegistry::CreateOp(*op_desc));
+    op_ptrs.push_back(ops.back().get());
+  }
+  MemoryPlanner planner(*block, op_ptrs, {"out"});
+  auto profiling_clone = planner.Clone();
+  ASSERT_FALSE(profiling_clone->Planned());
+
+  Scope scope;
+  for (auto& name : names) {
+    scope.Var(name)->GetMutable<LoDTensor>();
+  }
+  RunOps(ops, &planner, scope);
+  ASSERT_TRUE(planner.Planned());
+  RunOps(ops, &planner, scope);
+
+  // the clone runs in its own scope with its own arena, without profiling
+  auto clone = planner.Clone();
+  ASSERT_TRUE(clone->Planned());
+  Scope clone_scope;
+  for (auto& name : names) {
+    clone_scope.Var(name)->GetMutable<LoDTensor>();
+  }
+  RunOps(ops, clone.get(), clone_scope);
+  ASSERT_TRUE(clone->Planned());
+  ASSERT_EQ(clone->ArenaSize(), planner.ArenaSize());
+  auto& t0 = clone_scope.FindVar("t0")->Get<LoDTensor>();
+  auto& t2 = clone_scope.FindVar("t2")->Get<LoDTensor>();
+  ASSERT_EQ(t0.data<float>(), t2.data<float>());
+  ASSERT_NE(t0.data<float>(),
+            scope.FindVar("t0")->Get<LoDTensor>().data<float>());
+  ASSERT_EQ(clone_scope.FindVar("out")->Get<LoDTensor>().data<float>()[0],
+            4.f);
+}
+
+TEST(MemoryPlanner, Growth) {
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  for (auto name : {"t0", "t1", "out"}) {
+    block->Var(name)->SetType(proto::VarType::LOD_TENSOR);
+  }
+  AppendOp(block, "", "t0", 16);
+  AppendOp(block, "t0", "t1", 16);
+  AppendOp(block, "t1", "out", 16);
+
+  std::vector<std::unique_ptr<OperatorBase>> ops;
+  std::vector<OperatorBase*> op_ptrs;
+  for (auto* op_desc : block->AllOps()) {
+    ops.emplace_back(OpRegistry::CreateOp(*op_desc));
+    op_ptrs.push_back(ops.back().get());
+  }
+  MemoryPlanner planner(*block, op_ptrs, {"out"});
+  Scope scope;
+  for (auto name : {"t0", "t1", "out"}) {
+    scope.Var(name)->GetMutable<LoDTensor>();
+  }
+  RunOps(ops, &planner, scope);
+  size_t arena_size = planner.ArenaSize();
+  ASSERT_EQ(arena_size, 128UL);
+
+  // the tensors outgrow their slices, the next run is profiled again
+  test_numel = 4096;
+  RunOps(ops, &planner, scope);
+  ASSERT_EQ(scope.FindVar("out")->Get<LoDTensor>().data<float>()[4095], 3.f);
+  RunOps(ops, &planner, scope);
+  ASSERT_EQ(planner.ArenaSize(), 2 * 4096 * sizeof(float));
+  RunOps(ops, &planner, scope);
+  auto* t0_holder = scope.FindVar("t0")->Get<LoDTensor>().Holder().get();
+  RunOps(ops, &planner, scope);
+  ASSERT_EQ(scope.FindVar("t0")->Get<LoDTensor>().Holder().get(), t0_holder);
+  ASSERT_EQ(scope.FindVar("out")->Get<LoDTensor>().data<float>()[4095], 3.f);
+  test_numel = 0;
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,285 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/mmap_params.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "paddle/fluid/framework/data_type.h"
+#include "paddle/fluid/memory/malloc.h"
+
+namespace paddle {
+namespace framework {
+
+constexpr size_t MmapParamsFile::kAlignment;
+
+static const char kMmapParamsMagic[8] = {'P', 'D', 'M', 'M',
+                                         'A', 'P', '0', '1'};
+
+#ifndef _WIN32
+// A private mapping of a whole file.
+class MappedFileAllocation : public memory::Allocation {
+ public:
+  MappedFileAllocation(void* ptr, size_t size)
+      : Allocation(ptr, size, platform::CPUPlace()) {}
+  ~MappedFileAllocation() override {
+    if (size() > 0) {
+      munmap(ptr(), size());
+    }
+  }
+};
+#endif
+
+// A payload in a file, keeping the file mapped while a tensor uses it.
+class MappedPayloadAllocation : public memory::Allocation {
+ public:
+  MappedPayloadAllocation(const std::shared_ptr<memory::Allocation>& file,
+                          size_t offset, size_t size)
+      : Allocation(static_cast<uint8_t*>(file->ptr()) + offset, size,
+                   platform::CPUPlace()),
+        file_(file) {}
+
+ private:
+  std::shared_ptr<memory::Allocation> file_;
+};
+
+static std::shared_ptr<memory::Allocation> MapFile(
+    const std::string& file_name) {
+#ifndef _WIN32
+  int fd = open(file_name.c_str(), O_RDONLY);
+  PADDLE_ENFORCE_NE(fd, -1,
+                    platform::errors::Unavailable(
+                        "Failed to open parameter file %s.", file_name));
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    PADDLE_THROW(platform::errors::Unavailable(
+        "Failed to get the size of parameter file %s.", file_name));
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  void* ptr = nullptr;
+  if (size > 0) {
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  PADDLE_ENFORCE_NE(ptr, MAP_FAILED,
+                    platform::errors::Unavailable(
+                        "Failed to map parameter file %s.", file_name));
+  return std::make_shared<MappedFileAllocation>(ptr, size);
+#else
+  std::ifstream fin(file_name, std::ios::binary | std::ios::ate);
+  PADDLE_ENFORCE_EQ(static_cast<bool>(fin), true,
+                    platform::errors::Unavailable(
+                        "Failed to open parameter file %s.", file_name));
+  size_t size = static_cast<size_t>(fin.tellg());
+  fin.seekg(0);
+  auto buffer = memory::AllocShared(platform::CPUPlace(), size);
+  fin.read(static_cast<char*>(buffer->ptr()), size);
+  PADDLE_ENFORCE_EQ(static_cast<bool>(fin), true,
+                    platform::errors::Unavailable(
+                        "Failed to read parameter file %s.", file_name));
+  return buffer;
+#endif
+}
+
+template <typename T>
+static void Append(std::string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void MmapParamsFile::Save(const std::string& file_name,
+                          const std::vector<std::string>& names,
+                          const std::vector<const LoDTensor*>& tensors) {
+  PADDLE_ENFORCE_EQ(names.size(), tensors.size(),
+                    platform::errors::InvalidArgument(
+                        "The number of names (%d) and tensors (%d) to save "
+                        "should be equal.",
+                        names.size(), tensors.size()));
+  std::string index;
+  Append<uint64_t>(&index, tensors.size());
+  size_t payload_size = 0;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    auto& tensor = *tensors[i];
+    PADDLE_ENFORCE_EQ(
+        platform::is_cpu_place(tensor.place()), true,
+        platform::errors::InvalidArgument(
+            "Tensor %s to save should be on CPU, but it is on %s.", names[i],
+            tensor.place()));
+    Append<uint64_t>(&index, names[i].size());
+    index.append(names[i]);
+    Append<int32_t>(&index, static_cast<int32_t>(tensor.type()));
+    Append<int32_t>(&index, tensor.dims().size());
+    for (int j = 0; j < tensor.dims().size(); ++j) {
+      Append<int64_t>(&index, tensor.dims()[j]);
+    }
+    Append<uint64_t>(&index, tensor.lod().size());
+    for (auto& level : tensor.lod()) {
+      Append<uint64_t>(&index, level.size());
+      for (auto offset : level) {
+        Append<uint64_t>(&index, offset);
+      }
+    }
+    size_t size = tensor.numel() * SizeOfType(tensor.type());
+    Append<uint64_t>(&index, payload_size);
+    Append<uint64_t>(&index, size);
+    payload_size += memory::allocation::AlignedSize(size, kAlignment);
+  }
+
+  std::ofstream fout(file_name, std::ios::binary);
+  PADDLE_ENFORCE_EQ(static_cast<bool>(fout), true,
+                    platform::errors::Unavailable(
+                        "Failed to open parameter file %s.", file_name));
+  std::string head(kMmapParamsMagic, sizeof(kMmapParamsMagic));
+  Append<uint64_t>(&head, index.size());
+  head.append(index);
+  head.resize(memory::allocation::AlignedSize(head.size(), kAlignment), 0);
+  fout.write(head.data(), head.size());
+  std::vector<char> padding(kAlignment, 0);
+  for (auto* tensor : tensors) {
+    size_t size = tensor->numel() * SizeOfType(tensor->type());
+    if (size > 0) {
+      fout.write(static_cast<const char*>(tensor->data<void>()), size);
+    }
+    fout.write(padding.data(),
+               memory::allocation::AlignedSize(size, kAlignment) - size);
+  }
+  PADDLE_ENFORCE_EQ(static_cast<bool>(fout), true,
+                    platform::errors::Unavailable(
+                        "Failed to write parameter file %s.", file_name));
+}
+
+bool MmapParamsFile::IsMmapParamsFile(const std::string& file_name) {
+  std::ifstream fin(file_name, std::ios::binary);
+  char magic[sizeof(kMmapParamsMagic)];
+  fin.read(magic, sizeof(magic));
+  return static_cast<bool>(fin) &&
+         std::memcmp(magic, kMmapParamsMagic, sizeof(magic)) == 0;
+}
+
+// Reads the index with bounds checks.
+class IndexReader {
+ public:
+  IndexReader(const char* begin, size_t size, const std::string& file_name)
+      : pos_(begin), end_(begin + size), file_name_(file_name) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string ReadString(size_t size) {
+    const char* data = Take(size);
+    return std::string(data, size);
+  }
+
+ private:
+  const char* Take(size_t size) {
+    PADDLE_ENFORCE_LE(size, static_cast<size_t>(end_ - pos_),
+                      platform::errors::InvalidArgument(
+                          "The index of parameter file %s is damaged.",
+                          file_name_));
+    const char* data = pos_;
+    pos_ += size;
+    return data;
+  }
+
+  const char* pos_;
+  const char* end_;
+  const std::string& file_name_;
+};
+
+MmapParamsFile::MmapParamsFile(const std::string& file_name)
+    : file_name_(file_name), file_(MapFile(file_name)) {
+  const char* base = static_cast<const char*>(file_->ptr());
+  IndexReader head(base, file_->size(), file_name_);
+  PADDLE_ENFORCE_EQ(
+      head.ReadString(sizeof(kMmapParamsMagic)),
+      std::string(kMmapParamsMagic, sizeof(kMmapParamsMagic)),
+      platform::errors::InvalidArgument(
+          "%s is not a memory mapped parameter file.", file_name_));
+  size_t index_size = head.Read<uint64_t>();
+  size_t index_begin = sizeof(kMmapParamsMagic) + sizeof(uint64_t);
+  PADDLE_ENFORCE_LE(index_begin + index_size, file_->size(),
+                    platform::errors::InvalidArgument(
+                        "The index of parameter file %s is damaged.",
+                        file_name_));
+  size_t payload_begin =
+      memory::allocation::AlignedSize(index_begin + index_size, kAlignment);
+
+  IndexReader reader(base + index_begin, index_size, file_name_);
+  size_t tensor_num = reader.Read<uint64_t>();
+  for (size_t i = 0; i < tensor_num; ++i) {
+    std::string name = reader.ReadString(reader.Read<uint64_t>());
+    Entry entry;
+    entry.type = static_cast<proto::VarType::Type>(reader.Read<int32_t>());
+    std::vector<int64_t> dims(reader.Read<int32_t>());
+    for (auto& dim : dims) {
+      dim = reader.Read<int64_t>();
+    }
+    entry.dims = make_ddim(dims);
+    entry.lod.resize(reader.Read<uint64_t>());
+    for (auto& level : entry.lod) {
+      level.resize(reader.Read<uint64_t>());
+      for (auto& offset : level) {
+        offset = reader.Read<uint64_t>();
+      }
+    }
+    entry.offset = payload_begin + reader.Read<uint64_t>();
+    entry.size = reader.Read<uint64_t>();
+    PADDLE_ENFORCE_EQ(
+        entry.size,
+        static_cast<size_t>(product(entry.dims)) * SizeOfType(entry.type),
+        platform::errors::InvalidArgument(
+            "The size of %s in parameter file %s does not match its shape.",
+            name, file_name_));
+    PADDLE_ENFORCE_LE(entry.offset + entry.size, file_->size(),
+                      platform::errors::InvalidArgument(
+                          "Parameter file %s is truncated at %s.", file_name_,
+                          name));
+    names_.push_back(name);
+    index_.emplace(std::move(name), std::move(entry));
+  }
+  VLOG(3) << "Mapped " << names_.size() << " tensors of " << file_->size()
+          << " bytes from " << file_name_;
+}
+
+void MmapParamsFile::Load(const std::string& name, LoDTensor* tensor) const {
+  auto iter = index_.find(name);
+  PADDLE_ENFORCE_NE(iter, index_.end(),
+                    platform::errors::NotFound(
+                        "Tensor %s is not found in parameter file %s.", name,
+                        file_name_));
+  auto& entry = iter->second;
+  tensor->clear();
+  tensor->Resize(entry.dims);
+  tensor->ResetHolderWithType(
+      std::make_shared<MappedPayloadAllocation>(file_, entry.offset,
+                                                entry.size),
+      entry.type);
+  tensor->set_lod(entry.lod);
+}
+
+}  // namespace framework
+}  // namespace paddle
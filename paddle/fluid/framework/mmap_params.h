@@ -0,0 +1,83 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace framework {
+
+// A combined parameter file which is memory mapped instead of being read.
+//
+// Layout:
+//   char[8]  magic "PDMMAP01"
+//   uint64   index size in bytes
+//   index    uint64 tensor number, then for every tensor:
+//              uint64 name size, name, int32 data type, int32 rank,
+//              int64 dims[rank], uint64 lod levels, then for every level
+//              uint64 size, uint64 offsets[size], and at last
+//              uint64 payload offset, uint64 payload size
+//   payloads from the first kAlignment aligned offset after the index, every
+//            payload kAlignment aligned, offsets are relative to the first
+//
+// The loaded tensors alias the mapped payloads through an Allocation which
+// keeps the file mapped. The mapping is private, so the pages are shared
+// with the page cache and every process mapping the file until they are
+// written, which copies the written pages. On Windows the file is read into
+// one buffer instead.
+class MmapParamsFile {
+ public:
+  static constexpr size_t kAlignment = 64;
+
+  // Save tensors[i] as names[i], CPU tensors only.
+  static void Save(const std::string& file_name,
+                   const std::vector<std::string>& names,
+                   const std::vector<const LoDTensor*>& tensors);
+
+  // Whether file_name starts with the magic of this format.
+  static bool IsMmapParamsFile(const std::string& file_name);
+
+  explicit MmapParamsFile(const std::string& file_name);
+
+  // The names in the order they are saved.
+  const std::vector<std::string>& Names() const { return names_; }
+  bool Has(const std::string& name) const { return index_.count(name) > 0; }
+
+  // Make tensor alias the payload of name on CPU, without copying it.
+  void Load(const std::string& name, LoDTensor* tensor) const;
+
+ private:
+  struct Entry {
+    proto::VarType::Type type;
+    DDim dims;
+    LoD lod;
+    size_t offset;
+    size_t size;
+  };
+
+  std::string file_name_;
+  std::shared_ptr<memory::Allocation> file_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, Entry> index_;
+};
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,125 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/mmap_params.h"
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+static void SaveTestFile(const std::string& file_name) {
+  platform::CPUPlace place;
+  LoDTensor t1;
+  t1.Resize({3, 5});
+  t1.set_lod({{0, 1, 3}});
+  float* d1 = t1.mutable_data<float>(place);
+  for (int i = 0; i < 15; ++i) d1[i] = 0.5f * i;
+  LoDTensor t2;
+  t2.Resize({7});
+  int64_t* d2 = t2.mutable_data<int64_t>(place);
+  for (int i = 0; i < 7; ++i) d2[i] = i * 1000;
+  LoDTensor t3;
+  t3.Resize({0, 4});
+  t3.mutable_data<float>(place);
+  MmapParamsFile::Save(file_name, {"w", "ids", "empty"}, {&t1, &t2, &t3});
+}
+
+TEST(MmapParamsFile, SaveLoad) {
+  std::string file_name = "mmap_params_test.bin";
+  SaveTestFile(file_name);
+  ASSERT_TRUE(MmapParamsFile::IsMmapParamsFile(file_name));
+
+  MmapParamsFile file(file_name);
+  ASSERT_EQ(file.Names(), std::vector<std::string>({"w", "ids", "empty"}));
+  EXPECT_TRUE(file.Has("ids"));
+  EXPECT_FALSE(file.Has("b"));
+
+  LoDTensor w;
+  file.Load("w", &w);
+  EXPECT_EQ(w.type(), proto::VarType::FP32);
+  EXPECT_EQ(w.dims(), make_ddim({3, 5}));
+  EXPECT_EQ(w.lod(), LoD({{0, 1, 3}}));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(w.data<float>()) %
+                MmapParamsFile::kAlignment,
+            0UL);
+  for (int i = 0; i < 15; ++i) EXPECT_EQ(w.data<float>()[i], 0.5f * i);
+
+  LoDTensor ids;
+  file.Load("ids", &ids);
+  EXPECT_EQ(ids.type(), proto::VarType::INT64);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(ids.data<int64_t>()) %
+                MmapParamsFile::kAlignment,
+            0UL);
+  for (int i = 0; i < 7; ++i) EXPECT_EQ(ids.data<int64_t>()[i], i * 1000);
+
+  LoDTensor empty;
+  file.Load("empty", &empty);
+  EXPECT_EQ(empty.numel(), 0);
+  EXPECT_EQ(empty.dims(), make_ddim({0, 4}));
+
+  LoDTensor missing;
+  EXPECT_ANY_THROW(file.Load("b", &missing));
+}
+
+TEST(MmapParamsFile, Alias) {
+  std::string file_name = "mmap_params_alias_test.bin";
+  SaveTestFile(file_name);
+  LoDTensor w1, w2;
+  {
+    MmapParamsFile file(file_name);
+    file.Load("w", &w1);
+    file.Load("w", &w2);
+  }
+  // The tensors keep the mapping after the file object is gone.
+  EXPECT_EQ(w1.data<float>(), w2.data<float>());
+  EXPECT_EQ(w1.data<float>()[14], 7.f);
+
+  // Writes are private to this mapping.
+  w1.data<float>()[0] = 42.f;
+  MmapParamsFile file(file_name);
+  LoDTensor w3;
+  file.Load("w", &w3);
+  EXPECT_EQ(w3.data<float>()[0], 0.f);
+}
+
+TEST(MmapParamsFile, Damaged) {
+  std::string file_name = "mmap_params_damaged_test.bin";
+  SaveTestFile(file_name);
+  std::string content;
+  {
+    std::ifstream fin(file_name, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(fin),
+                   std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream fout(file_name, std::ios::binary);
+    fout.write(content.data(), content.size() / 2);
+  }
+  EXPECT_TRUE(MmapParamsFile::IsMmapParamsFile(file_name));
+  EXPECT_ANY_THROW(MmapParamsFile file(file_name));
+
+  {
+    std::ofstream fout(file_name, std::ios::binary);
+    fout << "not a mapped file";
+  }
+  EXPECT_FALSE(MmapParamsFile::IsMmapParamsFile(file_name));
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -47,12 +47,37 @@ void NaiveExecutor::Run() {
 #ifdef PADDLE_WITH_MKLDNN
   platform::AttachPointerHashToMKLDNNKey(this, place_);
 #endif
-  for (auto &op : ops_) {
+  if (memory_planner_) {
+    memory_planner_->PreRun(*scope_, place_);
+  }
+  for (size_t i = 0; i < ops_.size(); ++i) {
+    auto &op = ops_[i];
     VLOG(4) << std::this_thread::get_id() << " run "
             << op->DebugStringEx(scope_) << " on scope " << scope_;
     op->SetIsCalledByExecutor(false);
     op->Run(*scope_, place_);
+    if (memory_planner_) {
+      memory_planner_->PostOpRun(*scope_, i);
+    }
+  }
+  if (memory_planner_) {
+    memory_planner_->PostRun(*scope_);
+  }
+}
+
+void NaiveExecutor::EnableMemoryPlan(
+    const ProgramDesc &desc, int block_id,
+    const std::vector<std::string> &skip_vars) {
+  if (!platform::is_cpu_place(place_)) {
+    VLOG(3) << "Memory plan is only supported on CPU";
+    return;
+  }
+  std::vector<OperatorBase *> ops;
+  for (auto &op : ops_) {
+    ops.push_back(op.get());
   }
+  memory_planner_.reset(
+      new MemoryPlanner(desc.Block(block_id), ops, skip_vars));
 }
 
 void NaiveExecutor::CreateVariables(const ProgramDesc &desc, int block_id,
@@ -122,6 +147,8 @@ LoDTensor *NaiveExecutor::FindTensor(const std::string &name) {
 }
 
 void NaiveExecutor::CleanFeedFetchOps() {
+  // the planned op indices change
+  memory_planner_.reset();
   std::vector<std::unique_ptr<OperatorBase>> ops;
   for (auto &op : ops_) {
     if (op->Type() != "feed" && op->Type() != "fetch") {
@@ -16,8 +16,10 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "paddle/fluid/framework/memory_planner.h"
 #include "paddle/fluid/framework/operator.h"
 #include "paddle/fluid/framework/program_desc.h"
 #include "paddle/fluid/framework/scope.h"
@@ -52,6 +54,16 @@ class NaiveExecutor {
   void CreateVariables(const ProgramDesc& desc, int block_id, bool persistable,
                        Scope* scope);
 
+  // Plan the memory of the temporary tensors of the ops, see MemoryPlanner.
+  // skip_vars are read after Run, like the fetch targets. CPU only.
+  void EnableMemoryPlan(const ProgramDesc& desc, int block_id,
+                        const std::vector<std::string>& skip_vars);
+  // Use a planner cloned from an executor running the same program.
+  void SetMemoryPlanner(std::unique_ptr<MemoryPlanner> planner) {
+    memory_planner_ = std::move(planner);
+  }
+  const MemoryPlanner* memory_planner() const { return memory_planner_.get(); }
+
   // Run all the operators.
   void Run();
 
@@ -71,6 +83,7 @@ class NaiveExecutor {
   // Catch the required resource to avoid recreate.
   std::vector<std::unique_ptr<OperatorBase>> ops_;
   Scope* scope_;
+  std::unique_ptr<MemoryPlanner> memory_planner_;
 };
 
 }  // namespace framework
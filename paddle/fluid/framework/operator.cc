@@ -34,6 +34,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/unused_var_check.h"
 #include "paddle/fluid/framework/var_type.h"
 #include "paddle/fluid/platform/profiler.h"
+#include "paddle/fluid/platform/sampling_profiler.h"
 #ifdef PADDLE_WITH_XPU
 #include "paddle/fluid/platform/xpu_info.h"
 #endif
@@ -192,6 +193,7 @@ void OperatorBase::Run(const Scope& scope, const platform::Place& place) {
       auto op_name = platform::OpName(outputs_, Type());
       platform::RecordEvent op_name_record_event(
           op_name, platform::EventRole::kUniqueOp);
+      platform::SampledOpTimer op_sampled_timer(Type());
       RunImpl(scope, place);
     }
 
@@ -1062,9 +1064,12 @@ void OperatorWithKernel::RunImpl(const Scope& scope,
 }
 void OperatorWithKernel::RunImpl(const Scope& scope,
                                  const platform::Place& place,
-                                 RuntimeContext* runtime_ctx) const {
+                                 RuntimeContext* runtime_ctx,
+                                 platform::DeviceContext* dev_ctx) const {
   platform::DeviceContextPool& pool = platform::DeviceContextPool::Instance();
-  auto* dev_ctx = pool.Get(place);
+  if (dev_ctx == nullptr) {
+    dev_ctx = pool.Get(place);
+  }
 
   if (kernel_type_.get() == nullptr || kernel_func_.get() == nullptr) {
     ChooseKernel(*runtime_ctx, scope, place);
@@ -521,10 +521,26 @@ class OperatorWithKernel : public OperatorBase {
     return kernel_type_->place_;
   }
 
+  // Whether the kernel has been chosen and the inputs need no data transform
+  // on the scope of the previous runs, so that a RuntimeContext built once
+  // can be reused by RunPrepared.
+  bool CanRunPrepared() const {
+    return kernel_func_ != nullptr && !need_prepare_data_;
+  }
+
+  // Run the kernel on a RuntimeContext and a DeviceContext resolved once by
+  // the caller, e.g. CompiledOpPlan, without the per-run scope lookups of Run.
+  void RunPrepared(const Scope& scope, const platform::Place& place,
+                   RuntimeContext* runtime_ctx,
+                   platform::DeviceContext* dev_ctx) const {
+    RunImpl(scope, place, runtime_ctx, dev_ctx);
+  }
+
  private:
   void RunImpl(const Scope& scope, const platform::Place& place) const final;
   void RunImpl(const Scope& scope, const platform::Place& place,
-               RuntimeContext* runtime_ctx) const;
+               RuntimeContext* runtime_ctx,
+               platform::DeviceContext* dev_ctx = nullptr) const;
 
   /**
    * Transfer data from scope to a transferred scope. If there is no data need
@@ -19,6 +19,7 @@
 #include <iostream>
 #include <memory>
 
+#include "paddle/fluid/framework/mmap_params.h"
 #include "paddle/fluid/imperative/layer.h"
 
 namespace paddle {
@@ -327,6 +328,16 @@ bool SaveTensorToDisk(const std::string& file_name,
 bool LoadTensorFromDisk(
     const std::string& file_name,
     std::map<std::string, std::shared_ptr<Tensor>>* map_tensor) {
+  if (MmapParamsFile::IsMmapParamsFile(file_name)) {
+    MmapParamsFile file(file_name);
+    for (auto& name : file.Names()) {
+      auto tensor = std::make_shared<LoDTensor>();
+      file.Load(name, tensor.get());
+      (*map_tensor)[name] = tensor;
+    }
+    return true;
+  }
+
   std::ifstream fin(file_name, std::ios::binary);
 
   PADDLE_ENFORCE_EQ(
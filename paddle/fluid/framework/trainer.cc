@@ -35,6 +35,14 @@ void TrainerBase::ParseDumpConfig(const TrainerDesc& desc) {
   }
 
   dump_converter_ = desc.dump_converter();
+  dump_format_ = desc.dump_format();
+  PADDLE_ENFORCE_EQ(
+      dump_format_.empty() || dump_format_ == "text" ||
+          dump_format_ == "binary",
+      true, platform::errors::InvalidArgument(
+                "dump_format should be empty, text or binary, but got %s.",
+                dump_format_));
+  dump_file_max_bytes_ = desc.dump_file_max_bytes();
   if (desc.dump_fields_size() != 0) {
     need_dump_field_ = true;
     dump_fields_.resize(desc.dump_fields_size());
@@ -52,12 +60,29 @@ void TrainerBase::ParseDumpConfig(const TrainerDesc& desc) {
   }
 }
 
+void TrainerBase::InitDumpBlockQueue(size_t block_capacity) {
+  if (!dump_format_.empty()) {
+    dump_block_queue_ = std::make_shared<DumpBlockQueue>(block_capacity);
+  }
+}
+
 void TrainerBase::DumpWork(int tid) {
 #ifdef _LINUX
   int err_no = 0;
   // GetDumpPath is implemented in each Trainer
   std::string path = GetDumpPath(tid);
 
+  if (dump_block_queue_ != nullptr) {
+    DumpFileWriter writer(path, dump_converter_, dump_format_ == "binary",
+                          dump_file_max_bytes_);
+    DumpBlock* block = nullptr;
+    while (dump_block_queue_->Get(&block)) {
+      writer.Write(*block);
+      dump_block_queue_->Release(block);
+    }
+    return;
+  }
+
   std::shared_ptr<FILE> fp = fs_open_write(path, &err_no, dump_converter_);
   while (1) {
     std::string out_str;
@@ -77,10 +102,14 @@ void TrainerBase::DumpWork(int tid) {
 
 void TrainerBase::FinalizeDumpEnv() {
   queue_->Close();
+  if (dump_block_queue_ != nullptr) {
+    dump_block_queue_->Close();
+  }
   for (auto& th : dump_thread_) {
     th.join();
   }
   queue_.reset();
+  dump_block_queue_.reset();
 }
 
 }  // end namespace framework
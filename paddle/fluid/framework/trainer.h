@@ -71,6 +71,9 @@ class TrainerBase {
   virtual std::string GetDumpPath(int tid) = 0;
   virtual void ParseDumpConfig(const TrainerDesc& trainer_desc);
   virtual void FinalizeDumpEnv();
+  // Create dump_block_queue_ for dump_format_, blocks of up to
+  // block_capacity batches wait for the dump threads.
+  void InitDumpBlockQueue(size_t block_capacity);
 
   Scope* root_scope_;
   bool debug_;
@@ -88,6 +91,10 @@ class TrainerBase {
   int dump_thread_num_;
   std::vector<std::thread> dump_thread_;
   std::shared_ptr<paddle::framework::ChannelObject<std::string>> queue_;
+  std::string dump_format_;
+  int64_t dump_file_max_bytes_ = 0;
+  // Set if dump_format_ is not empty, used instead of queue_.
+  std::shared_ptr<DumpBlockQueue> dump_block_queue_;
 };
 
 // general trainer for async execution
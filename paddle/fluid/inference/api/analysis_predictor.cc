@@ -161,6 +161,8 @@ bool AnalysisPredictor::Init(
   // Get the feed_target_names and fetch_target_names
   PrepareFeedFetch();
 
+  PrepareMemoryPlan();
+
   return true;
 }
 
@@ -247,6 +249,26 @@ bool AnalysisPredictor::PrepareExecutor() {
   return true;
 }
 
+void AnalysisPredictor::PrepareMemoryPlan() {
+  if (!config_.enable_memory_plan()) {
+    return;
+  }
+  std::vector<std::string> skip_vars;
+  for (auto &item : idx2fetches_) {
+    skip_vars.push_back(item.second);
+  }
+  executor_->EnableMemoryPlan(*inference_program_, 0, skip_vars);
+}
+
+void AnalysisPredictor::SaveMemoryPlan() {
+  auto *planner = executor_->memory_planner();
+  if (memory_plan_ || planner == nullptr || !planner->Planned()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lk(clone_mutex_);
+  memory_plan_ = planner->Clone();
+}
+
 void AnalysisPredictor::MkldnnPreSet(const std::vector<PaddleTensor> &inputs) {
 #ifdef PADDLE_WITH_MKLDNN
   std::vector<std::vector<int>> inputs_shape;
@@ -325,6 +347,7 @@ bool AnalysisPredictor::Run(const std::vector<PaddleTensor> &inputs,
   // Run the inference program
   // if share variables, we need not create variables
   executor_->Run();
+  SaveMemoryPlan();
 
   // get fetch variable
   if (!GetFetch(output_data, scope)) {
@@ -774,6 +797,7 @@ bool AnalysisPredictor::ZeroCopyRun() {
 #endif
 
   executor_->Run();
+  SaveMemoryPlan();
   // Fix TensorArray reuse not cleaned bug.
   tensor_array_batch_cleaner_.CollectTensorArrays(sub_scope_);
   tensor_array_batch_cleaner_.ResetTensorArray();
@@ -1006,6 +1030,12 @@ std::unique_ptr<PaddlePredictor> AnalysisPredictor::Clone() {
   std::lock_guard<std::mutex> lk(clone_mutex_);
   auto *x = new AnalysisPredictor(config_);
   x->Init(scope_, inference_program_);
+  // The clone shares the parameters in scope_ and the program, and starts
+  // from the memory plan instead of profiling its first run.
+  if (memory_plan_) {
+    x->executor_->SetMemoryPlanner(memory_plan_->Clone());
+    x->memory_plan_ = memory_plan_;
+  }
   return std::unique_ptr<PaddlePredictor>(x);
 }
 
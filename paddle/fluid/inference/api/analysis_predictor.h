@@ -278,6 +278,16 @@ class AnalysisPredictor : public PaddlePredictor {
   /// \return Whether the function executed successfully
   ///
   bool PrepareExecutor();
+  ///
+  /// \brief Plan the memory of the temporary tensors if enabled by config,
+  /// the fetch targets are left out.
+  ///
+  void PrepareMemoryPlan();
+  ///
+  /// \brief Keep the first memory plan built by the executor, for the clones
+  /// to start from.
+  ///
+  void SaveMemoryPlan();
 
   ///
   /// \brief Load model program.
@@ -405,6 +415,9 @@ class AnalysisPredictor : public PaddlePredictor {
   details::TensorArrayBatchCleaner tensor_array_batch_cleaner_;
   // A mutex help to make Clone thread safe.
   std::mutex clone_mutex_;
+  // The first memory plan built by this predictor or the one it is cloned
+  // from, never run itself. Guarded by clone_mutex_.
+  std::shared_ptr<const framework::MemoryPlanner> memory_plan_;
 
   // For memory optimization.
   const size_t max_shape_collect_count_{1000};
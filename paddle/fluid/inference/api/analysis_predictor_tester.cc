@@ -15,6 +15,10 @@
 #include "paddle/fluid/inference/api/analysis_predictor.h"
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+#include <fstream>
 #include <thread>  // NOLINT
 #include "paddle/fluid/framework/ir/pass.h"
 #include "paddle/fluid/framework/tensor.h"
@@ -194,6 +198,76 @@ TEST(AnalysisPredictor, Clone) {
   }
 }
 
+static double RSSMB() {
+  double rss = 0.;
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0, rss_pages = 0;
+  statm >> total_pages >> rss_pages;
+  rss = static_cast<double>(rss_pages) * sysconf(_SC_PAGESIZE) / (1 << 20);
+#endif
+  return rss;
+}
+
+TEST(AnalysisPredictor, clone_memory_plan) {
+  const int num_threads = 64;
+  int64_t data[4] = {1, 2, 3, 4};
+  PaddleTensor tensor;
+  tensor.shape = std::vector<int>({4, 1});
+  tensor.data.Reset(data, sizeof(data));
+  tensor.dtype = PaddleDType::INT64;
+  std::vector<PaddleTensor> inputs(4, tensor);
+
+  for (bool memory_plan : {false, true}) {
+    AnalysisConfig config;
+    config.SetModel(FLAGS_dirname);
+    config.SwitchIrOptim(true);
+    if (memory_plan) {
+      config.EnableMemoryPlan();
+    }
+    auto main_predictor = CreatePaddlePredictor(config);
+    std::vector<PaddleTensor> ref_outputs;
+    ASSERT_TRUE(main_predictor->Run(inputs, &ref_outputs));
+    ASSERT_TRUE(main_predictor->Run(inputs, &ref_outputs));
+
+    double rss_before = RSSMB();
+    inference::Timer timer;
+    timer.tic();
+    std::vector<std::unique_ptr<PaddlePredictor>> predictors;
+    for (int i = 0; i < num_threads; ++i) {
+      predictors.emplace_back(main_predictor->Clone());
+    }
+    double clone_ms = timer.toc();
+    double rss_cloned = RSSMB();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i] {
+        std::vector<PaddleTensor> outputs;
+        for (int j = 0; j < 3; ++j) {
+          ASSERT_TRUE(predictors[i]->Run(inputs, &outputs));
+        }
+        ASSERT_EQ(outputs.size(), ref_outputs.size());
+        ASSERT_EQ(outputs[0].data.length(), ref_outputs[0].data.length());
+        auto* out_data = static_cast<float*>(outputs[0].data.data());
+        auto* ref_data = static_cast<float*>(ref_outputs[0].data.data());
+        for (size_t k = 0; k < outputs[0].data.length() / sizeof(float); ++k) {
+          EXPECT_NEAR(out_data[k], ref_data[k], 1e-5);
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    double rss_run = RSSMB();
+    LOG(INFO) << "memory plan " << memory_plan << ": " << num_threads
+              << " clones in " << clone_ms << " ms, "
+              << clone_ms / num_threads << " ms per clone, RSS +"
+              << rss_cloned - rss_before << " MB after cloning, +"
+              << rss_run - rss_before << " MB after running";
+  }
+}
+
 // This function is not released yet, will fail on some machine.
 // TODO(Superjomn) Turn on it latter.
 /*
@@ -0,0 +1,401 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/inference/api/paddle_batching_predictor.h"
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>  // NOLINT
+#include <utility>
+
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/monitor.h"
+
+namespace paddle {
+
+constexpr size_t BatchingPredictor::kLatencyBucketNum;
+static_assert(BatchingPredictor::kLatencyBucketNum ==
+                  platform::StatHistogram::kBucketNum,
+              "The latency buckets are those of StatHistogram.");
+
+struct BatchingPredictor::Request {
+  // the inputs in the order of input_names_
+  std::vector<const PaddleTensor*> feeds;
+  std::vector<PaddleTensor>* outputs;
+  int batch_size;
+  std::chrono::steady_clock::time_point enqueue_time;
+  std::promise<bool> done;
+};
+
+static int SampleNum(const PaddleTensor& tensor) {
+  if (!tensor.lod.empty()) {
+    return static_cast<int>(tensor.lod[0].size()) - 1;
+  }
+  return tensor.shape.empty() ? 0 : tensor.shape[0];
+}
+
+static size_t ByteSize(const std::vector<int>& shape, PaddleDType dtype) {
+  size_t numel = 1;
+  for (int dim : shape) {
+    numel *= dim;
+  }
+  return numel * PaddleDtypeSize(dtype);
+}
+
+// Whether two requests can be in one batch.
+static bool Compatible(const std::vector<const PaddleTensor*>& a,
+                       const std::vector<const PaddleTensor*>& b) {
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i]->dtype != b[i]->dtype || a[i]->lod.size() != b[i]->lod.size() ||
+        a[i]->shape.size() != b[i]->shape.size() ||
+        !std::equal(a[i]->shape.begin() + 1, a[i]->shape.end(),
+                    b[i]->shape.begin() + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static char* MutableData(ZeroCopyTensor* tensor, PaddleDType dtype) {
+  switch (dtype) {
+    case PaddleDType::FLOAT32:
+      return reinterpret_cast<char*>(
+          tensor->mutable_data<float>(PaddlePlace::kCPU));
+    case PaddleDType::INT64:
+      return reinterpret_cast<char*>(
+          tensor->mutable_data<int64_t>(PaddlePlace::kCPU));
+    case PaddleDType::INT32:
+      return reinterpret_cast<char*>(
+          tensor->mutable_data<int32_t>(PaddlePlace::kCPU));
+    case PaddleDType::UINT8:
+      return reinterpret_cast<char*>(
+          tensor->mutable_data<uint8_t>(PaddlePlace::kCPU));
+  }
+  return nullptr;
+}
+
+static const char* Data(const ZeroCopyTensor& tensor, PaddlePlace* place,
+                        int* numel) {
+  switch (tensor.type()) {
+    case PaddleDType::FLOAT32:
+      return reinterpret_cast<const char*>(tensor.data<float>(place, numel));
+    case PaddleDType::INT64:
+      return reinterpret_cast<const char*>(tensor.data<int64_t>(place, numel));
+    case PaddleDType::INT32:
+      return reinterpret_cast<const char*>(tensor.data<int32_t>(place, numel));
+    case PaddleDType::UINT8:
+      return reinterpret_cast<const char*>(tensor.data<uint8_t>(place, numel));
+  }
+  return nullptr;
+}
+
+BatchingPredictor::BatchingPredictor(std::unique_ptr<PaddlePredictor> predictor,
+                                     const BatchingConfig& config)
+    : config_(config),
+      latency_us_(new platform::StatHistogram()),
+      batch_size_hist_(std::max(config.max_batch_size, 0) + 1, 0) {
+  PADDLE_ENFORCE_NOT_NULL(predictor,
+                          platform::errors::InvalidArgument(
+                              "The predictor of BatchingPredictor is null."));
+  PADDLE_ENFORCE_GT(config.max_batch_size, 0,
+                    platform::errors::InvalidArgument(
+                        "The max_batch_size of BatchingConfig should be "
+                        "positive, but got %d.",
+                        config.max_batch_size));
+  PADDLE_ENFORCE_GE(config.max_wait_us, 0,
+                    platform::errors::InvalidArgument(
+                        "The max_wait_us of BatchingConfig should not be "
+                        "negative, but got %d.",
+                        config.max_wait_us));
+  PADDLE_ENFORCE_GT(config.thread_num, 0,
+                    platform::errors::InvalidArgument(
+                        "The thread_num of BatchingConfig should be positive, "
+                        "but got %d.",
+                        config.thread_num));
+  input_names_ = predictor->GetInputNames();
+  output_names_ = predictor->GetOutputNames();
+  predictors_.emplace_back(std::move(predictor));
+  for (int i = 1; i < config.thread_num; ++i) {
+    predictors_.emplace_back(predictors_[0]->Clone());
+  }
+  for (auto& p : predictors_) {
+    threads_.emplace_back(&BatchingPredictor::Loop, this, p.get());
+  }
+}
+
+BatchingPredictor::~BatchingPredictor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+bool BatchingPredictor::Run(const std::vector<PaddleTensor>& inputs,
+                            std::vector<PaddleTensor>* outputs) {
+  if (inputs.size() != input_names_.size()) {
+    LOG(ERROR) << "BatchingPredictor expects " << input_names_.size()
+               << " inputs, but got " << inputs.size();
+    return false;
+  }
+  Request request;
+  request.outputs = outputs;
+  request.feeds.resize(input_names_.size(), nullptr);
+  for (auto& input : inputs) {
+    auto iter = std::find(input_names_.begin(), input_names_.end(), input.name);
+    if (iter == input_names_.end()) {
+      LOG(ERROR) << "Input " << input.name << " is not an input of the model";
+      return false;
+    }
+    request.feeds[iter - input_names_.begin()] = &input;
+  }
+  for (size_t i = 0; i < request.feeds.size(); ++i) {
+    if (request.feeds[i] == nullptr) {
+      LOG(ERROR) << "Input " << input_names_[i] << " is not fed";
+      return false;
+    }
+  }
+  request.batch_size = SampleNum(*request.feeds[0]);
+  for (auto* feed : request.feeds) {
+    if (feed->shape.empty() || SampleNum(*feed) != request.batch_size) {
+      LOG(ERROR) << "Input " << feed->name << " has " << SampleNum(*feed)
+                 << " samples, but input " << request.feeds[0]->name
+                 << " has " << request.batch_size;
+      return false;
+    }
+    if (feed->data.length() < ByteSize(feed->shape, feed->dtype)) {
+      LOG(ERROR) << "The data of input " << feed->name
+                 << " is smaller than its shape";
+      return false;
+    }
+  }
+
+  auto done = request.done.get_future();
+  request.enqueue_time = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(&request);
+  }
+  cv_.notify_one();
+  bool success = done.get();
+  RecordRequest(std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - request.enqueue_time)
+                    .count());
+  return success;
+}
+
+void BatchingPredictor::TakeRequests(std::vector<Request*>* batch,
+                                     int* batch_size) {
+  for (auto iter = queue_.begin(); iter != queue_.end();) {
+    auto* request = *iter;
+    if (!batch->empty()) {
+      if (!Compatible(batch->front()->feeds, request->feeds)) {
+        ++iter;
+        continue;
+      }
+      // keep the requests in order
+      if (*batch_size + request->batch_size > config_.max_batch_size) {
+        break;
+      }
+    }
+    batch->push_back(request);
+    *batch_size += request->batch_size;
+    iter = queue_.erase(iter);
+    if (*batch_size >= config_.max_batch_size) {
+      break;
+    }
+  }
+}
+
+void BatchingPredictor::Loop(PaddlePredictor* predictor) {
+  std::vector<Request*> batch;
+  while (true) {
+    batch.clear();
+    int batch_size = 0;
+    {
+      std::lock_guard<std::mutex> collect_lock(collect_mutex_);
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      auto deadline = queue_.front()->enqueue_time +
+                      std::chrono::microseconds(config_.max_wait_us);
+      while (true) {
+        TakeRequests(&batch, &batch_size);
+        if (batch_size >= config_.max_batch_size || stop_ ||
+            cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+          TakeRequests(&batch, &batch_size);
+          break;
+        }
+      }
+    }
+    bool success = false;
+    try {
+      success = RunBatch(predictor, batch);
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "BatchingPredictor failed to run a batch: " << e.what();
+    }
+    RecordBatch(batch_size);
+    for (auto* request : batch) {
+      request->done.set_value(success);
+    }
+  }
+}
+
+bool BatchingPredictor::RunBatch(PaddlePredictor* predictor,
+                                 const std::vector<Request*>& batch) {
+  for (size_t i = 0; i < input_names_.size(); ++i) {
+    auto& head = *batch.front()->feeds[i];
+    std::vector<int> shape = head.shape;
+    shape[0] = 0;
+    std::vector<std::vector<size_t>> lod(head.lod.size(),
+                                         std::vector<size_t>(1, 0));
+    for (auto* request : batch) {
+      auto& feed = *request->feeds[i];
+      shape[0] += feed.shape[0];
+      for (size_t level = 0; level < lod.size(); ++level) {
+        auto& merged = lod[level];
+        auto& offsets = feed.lod[level];
+        size_t base = merged.back();
+        for (size_t j = 1; j < offsets.size(); ++j) {
+          merged.push_back(base + offsets[j] - offsets[0]);
+        }
+      }
+    }
+    auto tensor = predictor->GetInputTensor(input_names_[i]);
+    tensor->Reshape(shape);
+    tensor->SetLoD(lod);
+    char* data = MutableData(tensor.get(), head.dtype);
+    for (auto* request : batch) {
+      auto& feed = *request->feeds[i];
+      size_t size = ByteSize(feed.shape, feed.dtype);
+      if (size > 0) {
+        std::memcpy(data, feed.data.data(), size);
+        data += size;
+      }
+    }
+  }
+
+  if (!predictor->ZeroCopyRun()) {
+    LOG(ERROR) << "ZeroCopyRun of a batch of " << batch.size()
+               << " requests failed";
+    return false;
+  }
+
+  int sample_num = 0;
+  for (auto* request : batch) {
+    request->outputs->resize(output_names_.size());
+    sample_num += request->batch_size;
+  }
+  for (size_t i = 0; i < output_names_.size(); ++i) {
+    auto tensor = predictor->GetOutputTensor(output_names_[i]);
+    auto shape = tensor->shape();
+    auto lod = tensor->lod();
+    PaddlePlace place;
+    int numel = 0;
+    const char* data = Data(*tensor, &place, &numel);
+    bool split_by_lod =
+        !lod.empty() && static_cast<int>(lod[0].size()) - 1 == sample_num;
+    if (!split_by_lod && (shape.empty() || shape[0] != sample_num)) {
+      LOG(ERROR) << "Output " << output_names_[i]
+                 << " can not be split into requests, it has " << sample_num
+                 << " samples but its first dim is "
+                 << (shape.empty() ? 0 : shape[0]);
+      return false;
+    }
+    size_t row_size =
+        shape[0] == 0 ? 0 : numel / shape[0] * PaddleDtypeSize(tensor->type());
+    int sample_begin = 0;
+    for (auto* request : batch) {
+      int sample_end = sample_begin + request->batch_size;
+      // the samples are the rows, or the sequences of the first LoD level
+      size_t row_begin = sample_begin;
+      size_t row_end = sample_end;
+      auto& out = (*request->outputs)[i];
+      out.name = output_names_[i];
+      out.dtype = tensor->type();
+      out.lod.clear();
+      if (split_by_lod) {
+        for (auto& offsets : lod) {
+          std::vector<size_t> request_offsets(offsets.begin() + row_begin,
+                                              offsets.begin() + row_end + 1);
+          for (auto& offset : request_offsets) {
+            offset -= offsets[row_begin];
+          }
+          out.lod.emplace_back(std::move(request_offsets));
+          row_begin = offsets[row_begin];
+          row_end = offsets[row_end];
+        }
+      }
+      out.shape = shape;
+      out.shape[0] = static_cast<int>(row_end - row_begin);
+      size_t size = (row_end - row_begin) * row_size;
+      out.data.Resize(size);
+      if (size > 0) {
+        std::memcpy(out.data.data(), data + row_begin * row_size, size);
+      }
+      sample_begin = sample_end;
+    }
+  }
+  return true;
+}
+
+double BatchingPredictor::LatencyBucketBound(size_t i) {
+  return platform::StatHistogram::BucketBound(i);
+}
+
+void BatchingPredictor::RecordRequest(double latency_us) {
+  latency_us_->Observe(static_cast<int64_t>(std::ceil(latency_us)));
+}
+
+void BatchingPredictor::RecordBatch(int batch_size) {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  ++batch_num_;
+  batch_sample_num_ += batch_size;
+  ++batch_size_hist_[std::min(batch_size, config_.max_batch_size)];
+}
+
+BatchingStats BatchingPredictor::GetStats() const {
+  BatchingStats stats;
+  auto latency = latency_us_->Snapshot();
+  stats.latency_hist = latency.buckets;
+  stats.request_num = latency.count;
+  if (latency.count > 0) {
+    stats.latency_p50_us = latency.Quantile(0.5);
+    stats.latency_p99_us = latency.Quantile(0.99);
+  }
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats.batch_size_hist = batch_size_hist_;
+  stats.batch_num = batch_num_;
+  if (batch_num_ > 0) {
+    stats.avg_batch_size = static_cast<double>(batch_sample_num_) / batch_num_;
+  }
+  return stats;
+}
+
+void BatchingPredictor::ResetStats() {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  batch_num_ = 0;
+  batch_sample_num_ = 0;
+  latency_us_->Snapshot(true);
+  std::fill(batch_size_hist_.begin(), batch_size_hist_.end(), 0);
+}
+
+}  // namespace paddle
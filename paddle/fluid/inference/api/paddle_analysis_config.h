@@ -490,6 +490,23 @@ struct PD_INFER_DECL AnalysisConfig {
   ///
   bool enable_memory_optim() const;
 
+  ///
+  /// \brief Turn on the memory plan of the temporary tensors on CPU.
+  ///
+  /// The first run records the size and lifetime of every temporary tensor,
+  /// and later runs bind them to slices of one arena instead of allocating
+  /// them. The clones of a predictor which has run start from its plan, so
+  /// that every clone only allocates one arena for its activations and
+  /// shares the parameters with the others.
+  ///
+  void EnableMemoryPlan();
+  ///
+  /// \brief A boolean state telling whether the memory plan is activated.
+  ///
+  /// \return bool Whether the memory plan is activated.
+  ///
+  bool enable_memory_plan() const { return enable_memory_plan_; }
+
   ///
   /// \brief Turn on profiling report.
   /// If not turned on, no profiling report will be generated.
@@ -591,6 +608,7 @@ struct PD_INFER_DECL AnalysisConfig {
 
   // memory reuse related.
   bool enable_memory_optim_{false};
+  bool enable_memory_plan_{false};
 
   bool use_mkldnn_{false};
   std::unordered_set<std::string> mkldnn_enabled_op_types_;
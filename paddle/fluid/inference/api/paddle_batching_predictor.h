@@ -0,0 +1,160 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "paddle_api.h"            // NOLINT
+#include "paddle_infer_declare.h"  // NOLINT
+
+///
+/// \file paddle_batching_predictor.h
+///
+/// \brief A front end which merges concurrent requests into one batch.
+///
+
+namespace paddle {
+
+namespace platform {
+class StatHistogram;
+}  // namespace platform
+
+///
+/// \brief Config of BatchingPredictor.
+///
+/// A sample is a sequence of the first LoD level of the inputs, or a row of
+/// the inputs without LoD.
+///
+struct PD_INFER_DECL BatchingConfig {
+  /// Max number of samples in one batch. A request larger than this runs
+  /// alone.
+  int max_batch_size{64};
+  /// Max microseconds the first request of a batch waits for others to join.
+  int max_wait_us{1000};
+  /// Number of threads running batches, each with a clone of the predictor.
+  int thread_num{1};
+};
+
+///
+/// \brief Latency and batch size statistics of a BatchingPredictor.
+///
+struct PD_INFER_DECL BatchingStats {
+  int64_t request_num{0};
+  int64_t batch_num{0};
+  double avg_batch_size{0.};
+  /// Latencies from Run() to its return, as the upper bounds of the
+  /// histogram buckets they fall in.
+  double latency_p50_us{0.};
+  double latency_p99_us{0.};
+  /// latency_hist[i] counts the requests with a latency in
+  /// (LatencyBucketBound(i - 1), LatencyBucketBound(i)].
+  std::vector<int64_t> latency_hist;
+  /// batch_size_hist[i] counts the batches of i samples, the last bucket
+  /// counts the batches of max_batch_size samples or more.
+  std::vector<int64_t> batch_size_hist;
+};
+
+///
+/// \class BatchingPredictor
+///
+/// \brief Runs the requests of many threads through one ZeroCopyRun.
+///
+/// Run() queues the request and blocks until it is done. A batching thread
+/// takes the queued requests whose inputs have the same dtypes and trailing
+/// dims as the first one, up to max_batch_size samples or until the first
+/// one has waited max_wait_us. Their inputs are concatenated along the first
+/// dim with their LoD merged, run through one ZeroCopyRun, and the outputs
+/// are split back by the first LoD level, or by rows if the outputs have no
+/// LoD.
+///
+/// The predictor must be created with SwitchUseFeedFetchOps(false), and
+/// every input and output must have one sample per row or per sequence of
+/// the first LoD level.
+///
+/// Usage:
+///
+/// \code{cpp}
+/// AnalysisConfig config;
+/// config.SetModel(model_dir);
+/// config.SwitchUseFeedFetchOps(false);
+/// BatchingPredictor predictor(CreatePaddlePredictor(config), {});
+/// // in every serving thread
+/// predictor.Run(inputs, &outputs);
+/// \endcode
+///
+class PD_INFER_DECL BatchingPredictor {
+ public:
+  static constexpr size_t kLatencyBucketNum = 64;
+
+  BatchingPredictor(std::unique_ptr<PaddlePredictor> predictor,
+                    const BatchingConfig& config);
+  /// Runs the queued requests and joins the batching threads.
+  ~BatchingPredictor();
+
+  ///
+  /// \brief Run one request, thread safe.
+  ///
+  /// \param[in] inputs Named input tensors, one for every input of the model.
+  /// \param[out] outputs The output tensors of this request, in the order of
+  /// GetOutputNames() of the predictor.
+  /// \return Whether the request succeeded.
+  ///
+  bool Run(const std::vector<PaddleTensor>& inputs,
+           std::vector<PaddleTensor>* outputs);
+
+  BatchingStats GetStats() const;
+  void ResetStats();
+
+  /// The upper bound in microseconds of latency bucket i, the log2 buckets
+  /// of platform::StatHistogram: 0 for bucket 0 and 2^i - 1 for bucket i.
+  static double LatencyBucketBound(size_t i);
+
+ private:
+  struct Request;
+
+  void Loop(PaddlePredictor* predictor);
+  void TakeRequests(std::vector<Request*>* batch, int* batch_size);
+  bool RunBatch(PaddlePredictor* predictor, const std::vector<Request*>& batch);
+  void RecordRequest(double latency_us);
+  void RecordBatch(int batch_size);
+
+  BatchingConfig config_;
+  std::vector<std::unique_ptr<PaddlePredictor>> predictors_;
+  std::vector<std::string> input_names_;
+  std::vector<std::string> output_names_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request*> queue_;
+  bool stop_{false};
+  // Only one thread collects a batch at a time, the others run theirs.
+  std::mutex collect_mutex_;
+  std::vector<std::thread> threads_;
+
+  mutable std::mutex stats_mutex_;
+  int64_t batch_num_{0};
+  int64_t batch_sample_num_{0};
+  std::unique_ptr<platform::StatHistogram> latency_us_;
+  std::vector<int64_t> batch_size_hist_;
+};
+
+}  // namespace paddle
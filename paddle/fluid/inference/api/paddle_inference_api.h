@@ -28,8 +28,9 @@ limitations under the License. */
 #include <utility>
 #include <vector>
 
-#include "paddle_analysis_config.h"  // NOLINT
-#include "paddle_api.h"              // NOLINT
+#include "paddle_analysis_config.h"     // NOLINT
+#include "paddle_api.h"                 // NOLINT
+#include "paddle_batching_predictor.h"  // NOLINT
 
 ///
 /// \file paddle_inference_api.h
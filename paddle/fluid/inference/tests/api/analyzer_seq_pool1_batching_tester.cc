@@ -0,0 +1,194 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "paddle/fluid/inference/api/paddle_batching_predictor.h"
+#include "paddle/fluid/inference/tests/api/analyzer_seq_pool1_tester_helper.h"
+#include "paddle/fluid/inference/tests/api/tester_helper.h"
+
+DEFINE_int32(batching_clients, 8, "number of threads sending requests");
+DEFINE_int32(batching_requests, 100, "number of requests of every thread");
+DEFINE_int32(batching_max_batch_size, 32, "max batch size of batching");
+DEFINE_int32(batching_max_wait_us, 1000, "max wait of batching in us");
+
+namespace paddle {
+namespace inference {
+namespace analysis {
+namespace seq_pool1_tester {
+
+static std::unique_ptr<PaddlePredictor> CreateZeroCopyPredictor() {
+  AnalysisConfig cfg;
+  SetConfig(&cfg);
+  cfg.SwitchUseFeedFetchOps(false);
+  return CreatePaddlePredictor<AnalysisConfig>(cfg);
+}
+
+// Different requests of FLAGS_batch_size samples each.
+static std::vector<std::vector<PaddleTensor>> LoadRequests(size_t max_num) {
+  DataRecord data(FLAGS_infer_data, FLAGS_batch_size);
+  size_t num = std::min(max_num, data.batched_data.size());
+  std::vector<std::vector<PaddleTensor>> requests(num);
+  for (auto &request : requests) {
+    PrepareInputs(&request, &data);
+  }
+  return requests;
+}
+
+// Run a request through ZeroCopyRun of its own predictor.
+static void RunAlone(PaddlePredictor *predictor,
+                     const std::vector<PaddleTensor> &inputs,
+                     std::vector<PaddleTensor> *outputs) {
+  ConvertPaddleTensorToZeroCopyTensor(predictor, inputs);
+  ASSERT_TRUE(predictor->ZeroCopyRun());
+  auto output_names = predictor->GetOutputNames();
+  outputs->resize(output_names.size());
+  for (size_t i = 0; i < output_names.size(); ++i) {
+    auto tensor = predictor->GetOutputTensor(output_names[i]);
+    ASSERT_EQ(tensor->type(), PaddleDType::FLOAT32);
+    auto &out = (*outputs)[i];
+    out.name = output_names[i];
+    out.shape = tensor->shape();
+    out.dtype = PaddleDType::FLOAT32;
+    out.lod = tensor->lod();
+    out.data.Resize(VecReduceToInt(out.shape) * sizeof(float));
+    tensor->copy_to_cpu(static_cast<float *>(out.data.data()));
+  }
+}
+
+static double Percentile(std::vector<double> *latencies, double p) {
+  if (latencies->empty()) return 0.;
+  std::sort(latencies->begin(), latencies->end());
+  size_t idx = static_cast<size_t>(p * (latencies->size() - 1));
+  return (*latencies)[idx];
+}
+
+TEST(Analyzer_seq_pool1_batching, compare) {
+  auto requests = LoadRequests(64);
+  auto predictor = CreateZeroCopyPredictor();
+  std::vector<std::vector<PaddleTensor>> refs(requests.size());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    RunAlone(predictor.get(), requests[i], &refs[i]);
+  }
+
+  BatchingConfig config;
+  config.max_batch_size = FLAGS_batching_max_batch_size;
+  config.max_wait_us = FLAGS_batching_max_wait_us;
+  BatchingPredictor batching(CreateZeroCopyPredictor(), config);
+  int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid] {
+      std::vector<PaddleTensor> outputs;
+      for (size_t i = tid; i < requests.size(); i += num_threads) {
+        ASSERT_TRUE(batching.Run(requests[i], &outputs));
+        CompareResult(outputs, refs[i]);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto stats = batching.GetStats();
+  EXPECT_EQ(stats.request_num, static_cast<int64_t>(requests.size()));
+  EXPECT_GT(stats.batch_num, 0);
+  EXPECT_LE(stats.batch_num, stats.request_num);
+}
+
+// Serve the same load with a clone per thread and with one batching front
+// end. Run with --gtest_also_run_disabled_tests.
+TEST(Analyzer_seq_pool1_batching, DISABLED_benchmark) {
+  auto requests = LoadRequests(256);
+  int num_threads = FLAGS_batching_clients;
+  int num_requests = FLAGS_batching_requests;
+
+  auto predictor = CreateZeroCopyPredictor();
+  std::vector<std::unique_ptr<PaddlePredictor>> clones;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    clones.emplace_back(predictor->Clone());
+  }
+  std::vector<std::vector<double>> clone_latencies(num_threads);
+  auto run_clients = [&](std::function<void(int, size_t)> run_one) {
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int tid = 0; tid < num_threads; ++tid) {
+      threads.emplace_back([&, tid] {
+        for (int i = 0; i < num_requests; ++i) {
+          run_one(tid, (tid + i * num_threads) % requests.size());
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  double clone_sec = run_clients([&](int tid, size_t idx) {
+    std::vector<PaddleTensor> outputs;
+    auto start = std::chrono::steady_clock::now();
+    RunAlone(clones[tid].get(), requests[idx], &outputs);
+    clone_latencies[tid].push_back(
+        std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+  });
+  std::vector<double> latencies;
+  for (auto &thread_latencies : clone_latencies) {
+    latencies.insert(latencies.end(), thread_latencies.begin(),
+                     thread_latencies.end());
+  }
+
+  BatchingConfig config;
+  config.max_batch_size = FLAGS_batching_max_batch_size;
+  config.max_wait_us = FLAGS_batching_max_wait_us;
+  BatchingPredictor batching(CreateZeroCopyPredictor(), config);
+  double batching_sec = run_clients([&](int tid, size_t idx) {
+    std::vector<PaddleTensor> outputs;
+    ASSERT_TRUE(batching.Run(requests[idx], &outputs));
+  });
+  auto stats = batching.GetStats();
+
+  double total = static_cast<double>(num_threads) * num_requests;
+  LOG(INFO) << num_threads << " clients, " << num_requests
+            << " requests each, batch size " << FLAGS_batch_size;
+  LOG(INFO) << "clones:   " << total / clone_sec
+            << " requests/s, p50 " << Percentile(&latencies, 0.5)
+            << " us, p99 " << Percentile(&latencies, 0.99) << " us";
+  LOG(INFO) << "batching: " << total / batching_sec << " requests/s, p50 "
+            << stats.latency_p50_us << " us, p99 " << stats.latency_p99_us
+            << " us, " << stats.batch_num << " batches of "
+            << stats.avg_batch_size << " samples on average";
+  std::stringstream hist;
+  for (size_t i = 0; i < stats.batch_size_hist.size(); ++i) {
+    if (stats.batch_size_hist[i] > 0) {
+      hist << i << ":" << stats.batch_size_hist[i] << " ";
+    }
+  }
+  LOG(INFO) << "batch size histogram: " << hist.str();
+  EXPECT_EQ(stats.request_num, static_cast<int64_t>(total));
+}
+
+}  // namespace seq_pool1_tester
+}  // namespace analysis
+}  // namespace inference
+}  // namespace paddle
@@ -17,6 +17,7 @@
 #include <gflags/gflags.h>
 
 #include <map>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -25,12 +26,15 @@
 #include "paddle/fluid/memory/allocation/allocator.h"
 #include "paddle/fluid/memory/allocation/allocator_strategy.h"
 #include "paddle/fluid/memory/allocation/auto_growth_best_fit_allocator.h"
+#include "paddle/fluid/memory/allocation/binned_auto_growth_best_fit_allocator.h"
 #include "paddle/fluid/memory/allocation/cpu_allocator.h"
 #include "paddle/fluid/memory/allocation/locked_allocator.h"
 #include "paddle/fluid/memory/allocation/naive_best_fit_allocator.h"
 #include "paddle/fluid/memory/allocation/retry_allocator.h"
+#include "paddle/fluid/memory/allocation/size_class_allocator.h"
 #include "paddle/fluid/platform/cpu_info.h"
 #include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/monitor.h"
 #include "paddle/fluid/platform/place.h"
 #ifdef PADDLE_WITH_CUDA
 #include "paddle/fluid/memory/allocation/cuda_allocator.h"
@@ -53,6 +57,18 @@ DEFINE_bool(use_system_allocator, false,
             "Whether to use system allocator to allocate CPU and GPU memory. "
             "Only used for unittests.");
 
+DEFINE_bool(cpu_allocator_use_huge_page, true,
+            "Whether the size_class CPU allocator advises its chunks to use "
+            "transparent huge pages.");
+
+DEFINE_bool(cpu_allocator_numa_aware, true,
+            "Whether the size_class CPU allocator keeps separate chunks for "
+            "each NUMA node and binds them to the node.");
+
+DEFINE_bool(allocator_stats, false,
+            "Whether to count the allocations and their sizes of every place "
+            "in the allocator.<place> stats of StatRegistry.");
+
 namespace paddle {
 namespace memory {
 namespace allocation {
@@ -65,7 +81,7 @@ class AllocatorFacadePrivate {
     auto strategy = GetAllocatorStrategy();
     switch (strategy) {
       case AllocatorStrategy::kNaiveBestFit: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #ifdef PADDLE_WITH_XPU
         for (int dev_id = 0; dev_id < platform::GetXPUDeviceCount(); ++dev_id) {
           InitNaiveBestFitXPUAllocator(platform::XPUPlace(dev_id));
@@ -82,7 +98,7 @@ class AllocatorFacadePrivate {
       }
 
       case AllocatorStrategy::kAutoGrowth: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #ifdef PADDLE_WITH_XPU
         for (int dev_id = 0; dev_id < platform::GetXPUDeviceCount(); ++dev_id) {
           InitNaiveBestFitXPUAllocator(platform::XPUPlace(dev_id));
@@ -98,8 +114,25 @@ class AllocatorFacadePrivate {
         break;
       }
 
+      case AllocatorStrategy::kBinnedAutoGrowth: {
+        InitCPUAllocator();
+#ifdef PADDLE_WITH_XPU
+        for (int dev_id = 0; dev_id < platform::GetXPUDeviceCount(); ++dev_id) {
+          InitNaiveBestFitXPUAllocator(platform::XPUPlace(dev_id));
+        }
+#endif
+#ifdef PADDLE_WITH_CUDA
+        for (int dev_id = 0; dev_id < platform::GetCUDADeviceCount();
+             ++dev_id) {
+          InitBinnedAutoGrowthCUDAAllocator(platform::CUDAPlace(dev_id));
+        }
+        InitNaiveBestFitCUDAPinnedAllocator();
+#endif
+        break;
+      }
+
       case AllocatorStrategy::kThreadLocal: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #ifdef PADDLE_WITH_XPU
         for (int dev_id = 0; dev_id < platform::GetXPUDeviceCount(); ++dev_id) {
           InitNaiveBestFitXPUAllocator(platform::XPUPlace(dev_id));
@@ -116,7 +149,7 @@ class AllocatorFacadePrivate {
       }
 
       case AllocatorStrategy::kSamplePool: {
-        InitNaiveBestFitCPUAllocator();
+        InitCPUAllocator();
 #ifdef PADDLE_WITH_XPU
         for (int dev_id = 0; dev_id < platform::GetXPUDeviceCount(); ++dev_id) {
           InitNaiveBestFitXPUAllocator(platform::XPUPlace(dev_id));
@@ -182,11 +215,27 @@ class AllocatorFacadePrivate {
 #endif
   }
 
+  void InitCPUAllocator() {
+    switch (GetCPUAllocatorStrategy()) {
+      case CPUAllocatorStrategy::kSizeClass:
+        InitSizeClassCPUAllocator();
+        break;
+      default:
+        InitNaiveBestFitCPUAllocator();
+        break;
+    }
+  }
+
   void InitNaiveBestFitCPUAllocator() {
     allocators_[platform::CPUPlace()] =
         std::make_shared<NaiveBestFitAllocator>(platform::CPUPlace());
   }
 
+  void InitSizeClassCPUAllocator() {
+    allocators_[platform::CPUPlace()] = std::make_shared<SizeClassAllocator>(
+        FLAGS_cpu_allocator_use_huge_page, FLAGS_cpu_allocator_numa_aware);
+  }
+
 #ifdef PADDLE_WITH_CUDA
   void InitNaiveBestFitCUDAPinnedAllocator() {
     allocators_[platform::CUDAPinnedPlace()] =
@@ -206,6 +255,11 @@ class AllocatorFacadePrivate {
     allocators_[p] = std::make_shared<AutoGrowthBestFitAllocator>(
         cuda_allocator, platform::GpuMinChunkSize());
   }
+  void InitBinnedAutoGrowthCUDAAllocator(platform::CUDAPlace p) {
+    auto cuda_allocator = std::make_shared<CUDAAllocator>(p);
+    allocators_[p] = std::make_shared<BinnedAutoGrowthBestFitAllocator>(
+        cuda_allocator, platform::GpuMinChunkSize());
+  }
   void InitSampleCUDAAllocator(platform::CUDAPlace p) {
     auto cuda_allocator = std::make_shared<CUDAAllocator>(p);
     allocators_[p] = std::make_shared<SampleAllocator>(cuda_allocator);
@@ -305,8 +359,38 @@ std::shared_ptr<Allocation> AllocatorFacade::AllocShared(
   return std::shared_ptr<Allocation>(Alloc(place, size));
 }
 
+struct PlaceAllocStats {
+  platform::StatCounter* count;
+  platform::StatCounter* bytes;
+  platform::StatHistogram* size;
+};
+
+// The stats are cached per thread, not to look them up by name on every
+// allocation.
+static const PlaceAllocStats& GetPlaceAllocStats(
+    const platform::Place& place) {
+  thread_local std::map<platform::Place, PlaceAllocStats> stats;
+  auto iter = stats.find(place);
+  if (iter == stats.end()) {
+    std::ostringstream os;
+    os << "allocator." << place;
+    const std::string prefix = os.str();
+    PlaceAllocStats place_stats = {STAT_COUNTER(prefix + ".alloc_count"),
+                                   STAT_COUNTER(prefix + ".alloc_bytes"),
+                                   STAT_HISTOGRAM(prefix + ".alloc_size")};
+    iter = stats.emplace(place, place_stats).first;
+  }
+  return iter->second;
+}
+
 AllocationPtr AllocatorFacade::Alloc(const platform::Place& place,
                                      size_t size) {
+  if (UNLIKELY(FLAGS_allocator_stats)) {
+    const PlaceAllocStats& stats = GetPlaceAllocStats(place);
+    stats.count->Add();
+    stats.bytes->Add(size);
+    stats.size->Observe(size);
+  }
   return m_->GetAllocator(place, size)->Allocate(size);
 }
 
@@ -18,6 +18,7 @@
 #include "paddle/fluid/platform/enforce.h"
 
 DECLARE_string(allocator_strategy);
+DECLARE_string(cpu_allocator_strategy);
 
 namespace paddle {
 namespace memory {
@@ -38,9 +39,13 @@ static AllocatorStrategy GetStrategyFromFlag() {
   if (FLAGS_allocator_strategy == "sample_pool") {
     return AllocatorStrategy::kSamplePool;
   }
+
+  if (FLAGS_allocator_strategy == "binned_auto_growth") {
+    return AllocatorStrategy::kBinnedAutoGrowth;
+  }
   PADDLE_THROW(platform::errors::InvalidArgument(
       "Unsupported allocator strategy: %s, condicates are naive_best_fit, "
-      "auto_growth or thread_local.",
+      "auto_growth, thread_local, sample_pool or binned_auto_growth.",
       FLAGS_allocator_strategy));
 }
 
@@ -49,6 +54,25 @@ AllocatorStrategy GetAllocatorStrategy() {
   return strategy;
 }
 
+static CPUAllocatorStrategy GetCPUStrategyFromFlag() {
+  if (FLAGS_cpu_allocator_strategy == "naive_best_fit") {
+    return CPUAllocatorStrategy::kNaiveBestFit;
+  }
+
+  if (FLAGS_cpu_allocator_strategy == "size_class") {
+    return CPUAllocatorStrategy::kSizeClass;
+  }
+  PADDLE_THROW(platform::errors::InvalidArgument(
+      "Unsupported CPU allocator strategy: %s, condicates are naive_best_fit "
+      "or size_class.",
+      FLAGS_cpu_allocator_strategy));
+}
+
+CPUAllocatorStrategy GetCPUAllocatorStrategy() {
+  static CPUAllocatorStrategy strategy = GetCPUStrategyFromFlag();
+  return strategy;
+}
+
 void UseAllocatorStrategyGFlag() {}
 }  // namespace allocation
 }  // namespace memory
@@ -22,11 +22,16 @@ enum class AllocatorStrategy {
   kNaiveBestFit,
   kAutoGrowth,
   kThreadLocal,
-  kSamplePool
+  kSamplePool,
+  kBinnedAutoGrowth
 };
 
 extern AllocatorStrategy GetAllocatorStrategy();
 
+enum class CPUAllocatorStrategy { kNaiveBestFit, kSizeClass };
+
+extern CPUAllocatorStrategy GetCPUAllocatorStrategy();
+
 // Do nothing, just make sure linker do not prune this file.
 extern void UseAllocatorStrategyGFlag();
 
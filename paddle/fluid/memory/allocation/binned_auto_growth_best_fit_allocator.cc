@@ -0,0 +1,354 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/binned_auto_growth_best_fit_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "gflags/gflags.h"
+#include "paddle/fluid/memory/allocation/aligned_allocator.h"
+
+DECLARE_bool(free_idle_chunk);
+DECLARE_bool(free_when_no_cache_hit);
+
+DEFINE_int64(auto_growth_cache_max_size, 256 << 10,
+             "Freed blocks not larger than this are kept in per-thread front "
+             "caches for reuse. This flag only works when "
+             "FLAGS_allocator_strategy=binned_auto_growth.");
+
+DEFINE_int64(auto_growth_cache_shard_bytes, 8 << 20,
+             "The maximum bytes kept by each of the front caches. This flag "
+             "only works when FLAGS_allocator_strategy=binned_auto_growth.");
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+static inline int Log2Floor(size_t value) {
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(value);
+#else
+  int log = 0;
+  while (value >>= 1) ++log;
+  return log;
+#endif
+}
+
+static inline int CountTrailingZeros(uint64_t value) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(value);
+#else
+  int count = 0;
+  while ((value & 1) == 0) {
+    value >>= 1;
+    ++count;
+  }
+  return count;
+#endif
+}
+
+static int LocalCacheShard() {
+  static std::atomic<int> next_shard{0};
+  static thread_local int shard =
+      next_shard.fetch_add(1) %
+      BinnedAutoGrowthBestFitAllocator::kCacheShards;
+  return shard;
+}
+
+constexpr int BinnedAutoGrowthBestFitAllocator::kCacheShards;
+constexpr int BinnedAutoGrowthBestFitAllocator::kNumBins;
+
+BinnedAutoGrowthBestFitAllocator::BinnedAutoGrowthBestFitAllocator(
+    const std::shared_ptr<Allocator> &underlying_allocator, size_t alignment,
+    size_t chunk_size)
+    : underlying_allocator_(
+          std::make_shared<AlignedAllocator>(underlying_allocator, alignment)),
+      alignment_(alignment),
+      chunk_size_(std::max(AlignedSize(chunk_size, alignment), alignment)) {
+  memset(bins_, 0, sizeof(bins_));
+  memset(bin_bitmap_, 0, sizeof(bin_bitmap_));
+}
+
+BinnedAutoGrowthBestFitAllocator::~BinnedAutoGrowthBestFitAllocator() {
+  for (auto &shard : cache_shards_) {
+    for (auto &pair : shard.blocks_) {
+      for (auto *allocation : pair.second) {
+        delete allocation;
+      }
+    }
+  }
+  for (auto &chunk : chunks_) {
+    for (Block *block = chunk.head_; block != nullptr;) {
+      Block *next = block->next_;
+      delete block;
+      block = next;
+    }
+  }
+  for (auto *block : spare_blocks_) {
+    delete block;
+  }
+}
+
+// Four bins for each power of two, blocks in bin i are always smaller than
+// the blocks in bin i + 1.
+int BinnedAutoGrowthBestFitAllocator::BinIndex(size_t size) {
+  if (size < 4) {
+    return static_cast<int>(size);
+  }
+  int log = Log2Floor(size);
+  return log * 4 + static_cast<int>((size >> (log - 2)) & 3);
+}
+
+Allocation *BinnedAutoGrowthBestFitAllocator::AllocateImpl(size_t size) {
+  size = AlignedSize(size, alignment_);
+
+  if (!FLAGS_free_idle_chunk &&
+      size <= static_cast<size_t>(FLAGS_auto_growth_cache_max_size)) {
+    auto &shard = cache_shards_[LocalCacheShard()];
+    std::lock_guard<std::mutex> guard(shard.mtx_);
+    auto iter = shard.blocks_.find(size);
+    if (iter != shard.blocks_.end() && !iter->second.empty()) {
+      auto *allocation = iter->second.back();
+      iter->second.pop_back();
+      shard.bytes_ -= size;
+      return allocation;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(mtx_);
+  return new BlockAllocation(AllocateBlock(size));
+}
+
+void BinnedAutoGrowthBestFitAllocator::FreeImpl(Allocation *allocation) {
+  auto *block_allocation = static_cast<BlockAllocation *>(allocation);
+  size_t size = block_allocation->block_->size_;
+
+  if (!FLAGS_free_idle_chunk &&
+      size <= static_cast<size_t>(FLAGS_auto_growth_cache_max_size)) {
+    auto &shard = cache_shards_[LocalCacheShard()];
+    std::lock_guard<std::mutex> guard(shard.mtx_);
+    if (shard.bytes_ + size <=
+        static_cast<size_t>(FLAGS_auto_growth_cache_shard_bytes)) {
+      shard.blocks_[size].push_back(block_allocation);
+      shard.bytes_ += size;
+      return;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(mtx_);
+  FreeBlock(block_allocation->block_);
+  delete block_allocation;
+
+  if (FLAGS_free_idle_chunk) {
+    FreeIdleChunks();
+  }
+}
+
+BinnedAutoGrowthBestFitAllocator::Block *
+BinnedAutoGrowthBestFitAllocator::AllocateChunk(size_t size) {
+  size_t realloc_size = std::max(size, chunk_size_);
+  chunks_.emplace_back(underlying_allocator_->Allocate(realloc_size));
+  auto *chunk = &chunks_.back();
+  Block *block = NewBlock();
+  block->ptr_ = reinterpret_cast<uint8_t *>(chunk->allocation_->ptr());
+  block->size_ = chunk->allocation_->size();
+  block->is_free_ = false;
+  block->chunk_ = chunk;
+  block->prev_ = nullptr;
+  block->next_ = nullptr;
+  chunk->head_ = block;
+  VLOG(2) << "Not found and reallocate " << block->size_ << ", and remaining "
+          << block->size_ - size;
+  return block;
+}
+
+BinnedAutoGrowthBestFitAllocator::Block *
+BinnedAutoGrowthBestFitAllocator::AllocateBlock(size_t size) {
+  Block *block = FindFreeBlock(size);
+  if (block == nullptr && FLAGS_free_when_no_cache_hit) {
+    FreeIdleChunks();
+    block = FindFreeBlock(size);
+  }
+  if (block == nullptr) {
+    try {
+      block = AllocateChunk(size);
+    } catch (BadAlloc &ex) {
+      if (FLAGS_free_when_no_cache_hit) throw ex;
+      FreeIdleChunks();
+      // the blocks given back by the front caches may fit now
+      block = FindFreeBlock(size);
+      if (block == nullptr) {
+        block = AllocateChunk(size);
+      }
+    }
+  }
+  if (block->is_free_) {
+    RemoveFreeBlock(block);
+  }
+
+  // Split the block and keep the free part at the lower address.
+  size_t remaining_size = block->size_ - size;
+  if (remaining_size > 0) {
+    Block *remaining = NewBlock();
+    remaining->ptr_ = block->ptr_;
+    remaining->size_ = remaining_size;
+    remaining->chunk_ = block->chunk_;
+    remaining->prev_ = block->prev_;
+    remaining->next_ = block;
+    if (block->prev_ != nullptr) {
+      block->prev_->next_ = remaining;
+    } else {
+      block->chunk_->head_ = remaining;
+    }
+    block->prev_ = remaining;
+    block->ptr_ += remaining_size;
+    block->size_ = size;
+    InsertFreeBlock(remaining);
+  }
+  block->is_free_ = false;
+  return block;
+}
+
+void BinnedAutoGrowthBestFitAllocator::FreeBlock(Block *block) {
+  Block *prev = block->prev_;
+  if (prev != nullptr && prev->is_free_) {
+    RemoveFreeBlock(prev);
+    prev->size_ += block->size_;
+    prev->next_ = block->next_;
+    if (block->next_ != nullptr) {
+      block->next_->prev_ = prev;
+    }
+    RecycleBlock(block);
+    block = prev;
+  }
+
+  Block *next = block->next_;
+  if (next != nullptr && next->is_free_) {
+    RemoveFreeBlock(next);
+    block->size_ += next->size_;
+    block->next_ = next->next_;
+    if (next->next_ != nullptr) {
+      next->next_->prev_ = block;
+    }
+    RecycleBlock(next);
+  }
+
+  InsertFreeBlock(block);
+}
+
+void BinnedAutoGrowthBestFitAllocator::FlushCaches() {
+  std::vector<BlockAllocation *> allocations;
+  for (auto &shard : cache_shards_) {
+    std::lock_guard<std::mutex> guard(shard.mtx_);
+    for (auto &pair : shard.blocks_) {
+      allocations.insert(allocations.end(), pair.second.begin(),
+                         pair.second.end());
+      pair.second.clear();
+    }
+    shard.bytes_ = 0;
+  }
+  for (auto *allocation : allocations) {
+    FreeBlock(allocation->block_);
+    delete allocation;
+  }
+}
+
+uint64_t BinnedAutoGrowthBestFitAllocator::FreeIdleChunks() {
+  FlushCaches();
+  uint64_t bytes = 0;
+  for (auto chunk_it = chunks_.begin(); chunk_it != chunks_.end();) {
+    Block *block = chunk_it->head_;
+    if (block->next_ == nullptr && block->is_free_) {
+      VLOG(2) << "Free chunk with size " << block->size_;
+      bytes += block->size_;
+      RemoveFreeBlock(block);
+      RecycleBlock(block);
+      chunk_it = chunks_.erase(chunk_it);
+    } else {
+      ++chunk_it;
+    }
+  }
+  return bytes;
+}
+
+BinnedAutoGrowthBestFitAllocator::Block *
+BinnedAutoGrowthBestFitAllocator::FindFreeBlock(size_t size) {
+  int bin = BinIndex(size);
+  // Blocks of the same bin may be smaller than size.
+  for (Block *block = bins_[bin]; block != nullptr; block = block->free_next_) {
+    if (block->size_ >= size) {
+      return block;
+    }
+  }
+  // Any block of a larger bin fits.
+  int start = bin + 1;
+  for (int word = start / 64; word < kNumBins / 64; ++word) {
+    uint64_t bits = bin_bitmap_[word];
+    if (word == start / 64) {
+      bits &= ~0ULL << (start % 64);
+    }
+    if (bits != 0) {
+      return bins_[word * 64 + CountTrailingZeros(bits)];
+    }
+  }
+  return nullptr;
+}
+
+void BinnedAutoGrowthBestFitAllocator::InsertFreeBlock(Block *block) {
+  int bin = BinIndex(block->size_);
+  block->is_free_ = true;
+  block->bin_ = bin;
+  block->free_prev_ = nullptr;
+  block->free_next_ = bins_[bin];
+  if (bins_[bin] != nullptr) {
+    bins_[bin]->free_prev_ = block;
+  }
+  bins_[bin] = block;
+  bin_bitmap_[bin / 64] |= 1ULL << (bin % 64);
+}
+
+void BinnedAutoGrowthBestFitAllocator::RemoveFreeBlock(Block *block) {
+  int bin = block->bin_;
+  if (block->free_prev_ != nullptr) {
+    block->free_prev_->free_next_ = block->free_next_;
+  } else {
+    bins_[bin] = block->free_next_;
+    if (bins_[bin] == nullptr) {
+      bin_bitmap_[bin / 64] &= ~(1ULL << (bin % 64));
+    }
+  }
+  if (block->free_next_ != nullptr) {
+    block->free_next_->free_prev_ = block->free_prev_;
+  }
+}
+
+BinnedAutoGrowthBestFitAllocator::Block *
+BinnedAutoGrowthBestFitAllocator::NewBlock() {
+  if (spare_blocks_.empty()) {
+    return new Block();
+  }
+  Block *block = spare_blocks_.back();
+  spare_blocks_.pop_back();
+  return block;
+}
+
+void BinnedAutoGrowthBestFitAllocator::RecycleBlock(Block *block) {
+  spare_blocks_.push_back(block);
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,138 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// Same growth and FreeIdleChunks behaviour as AutoGrowthBestFitAllocator,
+// with less work under the lock:
+//
+// * free blocks are kept in size bins (four per power of two) with a bitmap
+//   of non-empty bins, so a lookup is a short scan instead of a tree search;
+// * block headers are pooled structs linked intrusively to their neighbours
+//   and their bin, so splitting and merging allocate nothing;
+// * freed blocks of up to FLAGS_auto_growth_cache_max_size bytes are kept by
+//   exact size in one of kCacheShards front caches, picked by thread, and
+//   reused without taking the pool lock.
+//
+// Blocks held by the front caches are given back to the pool before idle
+// chunks are searched, so FreeIdleChunks frees the same chunks as the
+// unbinned allocator would.
+class BinnedAutoGrowthBestFitAllocator : public Allocator {
+ public:
+  static constexpr int kCacheShards = 16;
+
+  BinnedAutoGrowthBestFitAllocator(
+      const std::shared_ptr<Allocator> &underlying_allocator, size_t alignment,
+      size_t chunk_size = 0);
+
+  ~BinnedAutoGrowthBestFitAllocator();
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+ protected:
+  Allocation *AllocateImpl(size_t size) override;
+
+  void FreeImpl(Allocation *allocation) override;
+
+  uint64_t ReleaseImpl(const platform::Place &place) override {
+    std::lock_guard<std::mutex> guard(mtx_);
+    return FreeIdleChunks();
+  }
+
+ private:
+  static constexpr int kNumBins = 64 * 4;
+
+  struct Chunk;
+
+  struct Block {
+    uint8_t *ptr_;
+    size_t size_;
+    bool is_free_;
+    int bin_;
+    Chunk *chunk_;
+    // neighbours in address order inside the chunk
+    Block *prev_;
+    Block *next_;
+    // neighbours in the free list of bin_
+    Block *free_prev_;
+    Block *free_next_;
+  };
+
+  struct Chunk {
+    explicit Chunk(AllocationPtr allocation)
+        : allocation_(std::move(allocation)) {}
+
+    AllocationPtr allocation_;
+    Block *head_{nullptr};
+  };
+
+  struct BlockAllocation : public Allocation {
+    explicit BlockAllocation(Block *block)
+        : Allocation(block->ptr_, block->size_,
+                     block->chunk_->allocation_->place()),
+          block_(block) {}
+
+    Block *block_;
+  };
+
+  struct CacheShard {
+    std::mutex mtx_;
+    std::unordered_map<size_t, std::vector<BlockAllocation *>> blocks_;
+    size_t bytes_{0};
+  };
+
+  static int BinIndex(size_t size);
+
+  // All the following methods require mtx_ to be held.
+  Block *AllocateBlock(size_t size);
+  Block *AllocateChunk(size_t size);
+  void FreeBlock(Block *block);
+  uint64_t FreeIdleChunks();
+  void FlushCaches();
+
+  Block *FindFreeBlock(size_t size);
+  void InsertFreeBlock(Block *block);
+  void RemoveFreeBlock(Block *block);
+  Block *NewBlock();
+  void RecycleBlock(Block *block);
+
+  std::shared_ptr<Allocator> underlying_allocator_;
+  size_t alignment_;
+  size_t chunk_size_;
+
+  std::list<Chunk> chunks_;
+  Block *bins_[kNumBins];
+  uint64_t bin_bitmap_[kNumBins / 64];
+  std::vector<Block *> spare_blocks_;
+
+  CacheShard cache_shards_[kCacheShards];
+
+  mutable std::mutex mtx_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
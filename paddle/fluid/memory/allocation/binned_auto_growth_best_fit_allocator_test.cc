@@ -0,0 +1,217 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/binned_auto_growth_best_fit_allocator.h"
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/allocation/auto_growth_best_fit_allocator.h"
+
+DECLARE_bool(free_idle_chunk);
+DECLARE_bool(free_when_no_cache_hit);
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+class RecordedAllocator : public Allocator {
+ public:
+  bool IsAllocThreadSafe() const override { return true; }
+
+  size_t AllocatedSize() const { return allocated_size_; }
+
+ protected:
+  Allocation *AllocateImpl(size_t size) override {
+    allocated_size_ += size;
+    return new Allocation(malloc(size), size, platform::CPUPlace());
+  }
+
+  void FreeImpl(Allocation *allocation) {
+    allocated_size_ -= allocation->size();
+    free(allocation->ptr());
+    delete allocation;
+  }
+
+ private:
+  std::atomic<size_t> allocated_size_{0};
+};
+
+static void TestFreeIdleChunk(bool free_idle_chunk) {
+  FLAGS_free_idle_chunk = free_idle_chunk;
+  FLAGS_free_when_no_cache_hit = false;
+  auto recorded_allocator = std::make_shared<RecordedAllocator>();
+  size_t alignment = 4096;
+  size_t memory_size = 8192;
+  auto allocator = std::make_shared<BinnedAutoGrowthBestFitAllocator>(
+      recorded_allocator, alignment);
+
+  for (size_t i = 0; i < 10; ++i) {
+    auto allocation = allocator->Allocate(memory_size);
+    ASSERT_EQ(recorded_allocator->AllocatedSize(), memory_size + alignment);
+    allocation.reset();
+    if (free_idle_chunk) {
+      ASSERT_EQ(recorded_allocator->AllocatedSize(), 0UL);
+    } else {
+      ASSERT_EQ(recorded_allocator->AllocatedSize(), memory_size + alignment);
+    }
+    // the blocks kept by the front caches do not hold chunks on Release
+    uint64_t released = allocator->Release(platform::CPUPlace());
+    if (free_idle_chunk) {
+      ASSERT_EQ(released, 0UL);
+    } else {
+      ASSERT_GE(released, memory_size);
+    }
+    ASSERT_EQ(recorded_allocator->AllocatedSize(), 0UL);
+  }
+}
+
+TEST(BinnedAutoGrowthBestFitAllocator, FreeIdleChunk) {
+  TestFreeIdleChunk(true);
+  TestFreeIdleChunk(false);
+}
+
+TEST(BinnedAutoGrowthBestFitAllocator, SplitAndMerge) {
+  FLAGS_free_idle_chunk = false;
+  FLAGS_free_when_no_cache_hit = false;
+  auto recorded_allocator = std::make_shared<RecordedAllocator>();
+  size_t alignment = 256;
+  size_t chunk_size = 1 << 20;
+  auto allocator = std::make_shared<BinnedAutoGrowthBestFitAllocator>(
+      recorded_allocator, alignment, chunk_size);
+
+  std::vector<AllocationPtr> allocations;
+  for (size_t i = 1; i <= 64; ++i) {
+    allocations.emplace_back(allocator->Allocate(i * 1000));
+    ASSERT_EQ(allocations.back()->size(), AlignedSize(i * 1000, alignment));
+    memset(allocations.back()->ptr(), static_cast<int>(i),
+           allocations.back()->size());
+  }
+  // blocks do not overlap
+  for (size_t i = 0; i < allocations.size(); ++i) {
+    auto *data = static_cast<uint8_t *>(allocations[i]->ptr());
+    ASSERT_EQ(data[0], i + 1);
+    ASSERT_EQ(data[allocations[i]->size() - 1], i + 1);
+  }
+  // free every other block first so that the rest merge on both sides
+  for (size_t i = 0; i < allocations.size(); i += 2) {
+    allocations[i].reset();
+  }
+  for (size_t i = 1; i < allocations.size(); i += 2) {
+    allocations[i].reset();
+  }
+  // everything is merged back to whole chunks
+  allocator->Release(platform::CPUPlace());
+  ASSERT_EQ(recorded_allocator->AllocatedSize(), 0UL);
+
+  // switching to free_idle_chunk also gives back the cached blocks
+  for (size_t i = 1; i <= 64; ++i) {
+    allocator->Allocate(i * 1000).reset();
+  }
+  ASSERT_GT(recorded_allocator->AllocatedSize(), 0UL);
+  FLAGS_free_idle_chunk = true;
+  allocator->Allocate(chunk_size).reset();
+  ASSERT_EQ(recorded_allocator->AllocatedSize(), 0UL);
+  FLAGS_free_idle_chunk = false;
+}
+
+TEST(BinnedAutoGrowthBestFitAllocator, MultiThread) {
+  FLAGS_free_idle_chunk = false;
+  FLAGS_free_when_no_cache_hit = false;
+  auto recorded_allocator = std::make_shared<RecordedAllocator>();
+  auto allocator = std::make_shared<BinnedAutoGrowthBestFitAllocator>(
+      recorded_allocator, 256, 1 << 22);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 gen(t);
+      std::uniform_int_distribution<size_t> dist(1, 1 << 19);
+      std::vector<AllocationPtr> live;
+      for (int i = 0; i < 2000; ++i) {
+        auto allocation = allocator->Allocate(dist(gen));
+        memset(allocation->ptr(), t, allocation->size());
+        live.emplace_back(std::move(allocation));
+        if (live.size() > 16) {
+          size_t idx = dist(gen) % live.size();
+          auto *data = static_cast<uint8_t *>(live[idx]->ptr());
+          ASSERT_EQ(data[0], t);
+          ASSERT_EQ(data[live[idx]->size() - 1], t);
+          std::swap(live[idx], live.back());
+          live.pop_back();
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  allocator->Release(platform::CPUPlace());
+  ASSERT_EQ(recorded_allocator->AllocatedSize(), 0UL);
+}
+
+static double AllocFreeLoop(Allocator *allocator, int thread_num,
+                            int iterations) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([=] {
+      // the tensor sizes of a small network repeated every batch
+      const size_t sizes[] = {512 * 4,      512 * 64 * 4, 512 * 400 * 4,
+                              512 * 32 * 4, 64 * 64 * 4,  4096 * 4,
+                              512 * 2 * 4,  96};
+      std::vector<AllocationPtr> live;
+      for (int i = 0; i < iterations; ++i) {
+        for (size_t size : sizes) {
+          live.emplace_back(allocator->Allocate(size));
+        }
+        live.clear();
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(BinnedAutoGrowthBestFitAllocator, DISABLED_Benchmark) {
+  FLAGS_free_idle_chunk = false;
+  FLAGS_free_when_no_cache_hit = false;
+  int thread_num = 8;
+  int iterations = 5000;
+  auto underlying_allocator = std::make_shared<RecordedAllocator>();
+  AutoGrowthBestFitAllocator auto_growth(underlying_allocator, 256, 1 << 26);
+  BinnedAutoGrowthBestFitAllocator binned(underlying_allocator, 256, 1 << 26);
+  AllocFreeLoop(&auto_growth, thread_num, 1);
+  AllocFreeLoop(&binned, thread_num, 1);
+  double auto_growth_ms = AllocFreeLoop(&auto_growth, thread_num, iterations);
+  double binned_ms = AllocFreeLoop(&binned, thread_num, iterations);
+  LOG(INFO) << thread_num << " threads, auto_growth: " << auto_growth_ms
+            << " ms, binned_auto_growth: " << binned_ms << " ms";
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,516 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/size_class_allocator.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+namespace {
+
+constexpr size_t kAlignment = SizeClassAllocator::kAlignment;
+constexpr size_t kChunkSize = SizeClassAllocator::kChunkSize;
+constexpr size_t kMaxSmallSize = SizeClassAllocator::kMaxSmallSize;
+constexpr int kNumClasses = SizeClassAllocator::kNumClasses;
+constexpr int kMaxNumaNodes = SizeClassAllocator::kMaxNumaNodes;
+// Bytes moved between a thread cache and a depot at once.
+constexpr size_t kBatchBytes = 64UL << 10;
+constexpr size_t kMaxBatchCount = 64;
+
+// Classes are multiples of 64 bytes up to 1KB, then four classes for each
+// power of two up to kMaxSmallSize, so the internal waste is below 25%.
+struct SizeClassTable {
+  size_t class_size[kNumClasses];
+  size_t batch_count[kNumClasses];
+  // size class of (size + kAlignment - 1) / kAlignment
+  uint8_t class_of[kMaxSmallSize / kAlignment + 1];
+
+  SizeClassTable() {
+    int cls = 0;
+    for (size_t size = kAlignment; size <= 1024; size += kAlignment) {
+      class_size[cls++] = size;
+    }
+    for (size_t base = 1024; base < kMaxSmallSize; base *= 2) {
+      for (size_t step = 1; step <= 4; ++step) {
+        class_size[cls++] = base + step * base / 4;
+      }
+    }
+    PADDLE_ENFORCE_EQ(cls, kNumClasses,
+                      platform::errors::PreconditionNotMet(
+                          "Size class table has %d classes, expected %d.", cls,
+                          kNumClasses));
+    for (int i = 0; i < kNumClasses; ++i) {
+      batch_count[i] = std::min(
+          kMaxBatchCount, std::max<size_t>(2, kBatchBytes / class_size[i]));
+    }
+    cls = 0;
+    class_of[0] = 0;
+    for (size_t i = 1; i <= kMaxSmallSize / kAlignment; ++i) {
+      while (class_size[cls] < i * kAlignment) ++cls;
+      class_of[i] = static_cast<uint8_t>(cls);
+    }
+  }
+};
+
+const SizeClassTable &Table() {
+  static SizeClassTable table;
+  return table;
+}
+
+struct FreeBlock {
+  FreeBlock *next;
+  // Only valid for the first block of a batch.
+  std::atomic<FreeBlock *> next_batch;
+  size_t count;
+};
+
+struct ChunkHeader {
+  int node;
+};
+
+// Treiber stack of batches. The high 16 bits of the top word hold a tag that
+// is bumped on every update, so a batch popped and pushed back between the
+// load and the CAS of another thread can not be mistaken for the old top.
+// Blocks stay mapped while the heap is alive, so reading next_batch of a
+// batch that was just popped by someone else is harmless.
+class BatchStack {
+ public:
+  void Push(FreeBlock *batch) {
+    uint64_t old_top = top_.load(std::memory_order_relaxed);
+    uint64_t new_top;
+    do {
+      batch->next_batch.store(Pointer(old_top), std::memory_order_relaxed);
+      new_top = Pack(batch, old_top);
+    } while (!top_.compare_exchange_weak(old_top, new_top,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
+  FreeBlock *Pop() {
+    uint64_t old_top = top_.load(std::memory_order_acquire);
+    while (true) {
+      FreeBlock *batch = Pointer(old_top);
+      if (batch == nullptr) {
+        return nullptr;
+      }
+      uint64_t new_top =
+          Pack(batch->next_batch.load(std::memory_order_relaxed), old_top);
+      if (top_.compare_exchange_weak(old_top, new_top,
+                                     std::memory_order_acquire,
+                                     std::memory_order_acquire)) {
+        return batch;
+      }
+    }
+  }
+
+ private:
+  static constexpr uint64_t kPointerMask = (1ULL << 48) - 1;
+
+  static FreeBlock *Pointer(uint64_t top) {
+    return reinterpret_cast<FreeBlock *>(top & kPointerMask);
+  }
+
+  static uint64_t Pack(FreeBlock *batch, uint64_t old_top) {
+    return (reinterpret_cast<uint64_t>(batch) & kPointerMask) |
+           ((old_top & ~kPointerMask) + (1ULL << 48));
+  }
+
+  std::atomic<uint64_t> top_{0};
+};
+
+static_assert(sizeof(void *) == 8, "SizeClassAllocator needs 64-bit pointers");
+
+struct Arena {
+  BatchStack depot[kNumClasses];
+  std::mutex mutex;
+  char *cursor{nullptr};
+  char *limit{nullptr};
+  std::vector<char *> chunks;
+};
+
+static FreeBlock *LinkBatch(char *begin, size_t size, size_t count) {
+  for (size_t i = 0; i + 1 < count; ++i) {
+    reinterpret_cast<FreeBlock *>(begin + i * size)->next =
+        reinterpret_cast<FreeBlock *>(begin + (i + 1) * size);
+  }
+  reinterpret_cast<FreeBlock *>(begin + (count - 1) * size)->next = nullptr;
+  auto *head = reinterpret_cast<FreeBlock *>(begin);
+  head->count = count;
+  return head;
+}
+
+}  // namespace
+
+class ThreadCache;
+
+class SizeClassHeap : public std::enable_shared_from_this<SizeClassHeap> {
+ public:
+  SizeClassHeap(bool use_huge_page, bool numa_aware)
+      : use_huge_page_(use_huge_page), numa_aware_(numa_aware) {
+    for (auto &arena : arenas_) {
+      arena.reset(new Arena());
+    }
+  }
+
+  ~SizeClassHeap() {
+    for (auto &arena : arenas_) {
+      for (auto *chunk : arena->chunks) {
+#ifdef _WIN32
+        _aligned_free(chunk);
+#else
+        munmap(chunk, kChunkSize);
+#endif
+      }
+    }
+  }
+
+  void *Allocate(int size_class);
+  void Free(void *p, int size_class);
+
+  // Pop a batch of size_class blocks from the depot of node, carving a new
+  // one from the node's chunks if the depot is empty.
+  FreeBlock *Fetch(int node, int size_class) {
+    auto &arena = *arenas_[node];
+    FreeBlock *batch = arena.depot[size_class].Pop();
+    if (batch != nullptr) {
+      return batch;
+    }
+    size_t size = Table().class_size[size_class];
+    size_t count = Table().batch_count[size_class];
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    if (static_cast<size_t>(arena.limit - arena.cursor) < size) {
+      char *chunk = NewChunk(node);
+      arena.chunks.push_back(chunk);
+      arena.cursor = chunk + kAlignment;
+      arena.limit = chunk + kChunkSize;
+    }
+    count = std::min(count, (arena.limit - arena.cursor) / size);
+    batch = LinkBatch(arena.cursor, size, count);
+    arena.cursor += count * size;
+    return batch;
+  }
+
+  void Return(int node, int size_class, FreeBlock *batch, size_t count) {
+    batch->count = count;
+    arenas_[node]->depot[size_class].Push(batch);
+  }
+
+  int CurrentNode() const {
+#if defined(__linux__) && defined(SYS_getcpu)
+    if (numa_aware_) {
+      unsigned cpu = 0;
+      unsigned node = 0;
+      if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node % kMaxNumaNodes);
+      }
+    }
+#endif
+    return 0;
+  }
+
+  int NodeOf(void *p) const {
+    if (!numa_aware_) {
+      return 0;
+    }
+    auto chunk = reinterpret_cast<uintptr_t>(p) & ~(kChunkSize - 1);
+    return reinterpret_cast<ChunkHeader *>(chunk)->node;
+  }
+
+ private:
+  ThreadCache *LocalCache();
+
+  char *NewChunk(int node) {
+    char *chunk = nullptr;
+#ifdef _WIN32
+    chunk = static_cast<char *>(_aligned_malloc(kChunkSize, kChunkSize));
+    PADDLE_ENFORCE_NOT_NULL(
+        chunk, platform::errors::ResourceExhausted(
+                   "Fail to alloc a CPU memory chunk of %ld bytes.",
+                   kChunkSize));
+#else
+    // Map twice the size and trim it to a kChunkSize aligned range, so that
+    // the chunk of a block can be found by masking its address.
+    size_t map_size = 2 * kChunkSize;
+    void *raw = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    PADDLE_ENFORCE_NE(raw, MAP_FAILED,
+                      platform::errors::ResourceExhausted(
+                          "Fail to mmap a CPU memory chunk of %ld bytes.",
+                          map_size));
+    auto begin = reinterpret_cast<uintptr_t>(raw);
+    auto aligned = (begin + kChunkSize - 1) & ~(kChunkSize - 1);
+    if (aligned > begin) {
+      munmap(raw, aligned - begin);
+    }
+    if (begin + map_size > aligned + kChunkSize) {
+      munmap(reinterpret_cast<void *>(aligned + kChunkSize),
+             begin + map_size - aligned - kChunkSize);
+    }
+    chunk = reinterpret_cast<char *>(aligned);
+#ifdef MADV_HUGEPAGE
+    if (use_huge_page_ && madvise(chunk, kChunkSize, MADV_HUGEPAGE) != 0) {
+      VLOG(3) << "madvise(MADV_HUGEPAGE) failed, use normal pages";
+    }
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+    if (numa_aware_) {
+      // MPOL_PREFERRED, the kernel falls back to other nodes when the
+      // preferred one is out of memory.
+      constexpr int kMpolPreferred = 1;
+      unsigned long node_mask = 1UL << node;  // NOLINT
+      if (syscall(SYS_mbind, chunk, kChunkSize, kMpolPreferred, &node_mask,
+                  sizeof(node_mask) * 8, 0) != 0) {
+        VLOG(3) << "mbind to NUMA node " << node << " failed";
+      }
+    }
+#endif
+#endif
+    reinterpret_cast<ChunkHeader *>(chunk)->node = node;
+    return chunk;
+  }
+
+  bool use_huge_page_;
+  bool numa_aware_;
+  std::unique_ptr<Arena> arenas_[kMaxNumaNodes];
+};
+
+// Per-thread free lists of one heap. Blocks of the thread's own NUMA node are
+// reused directly; blocks of other nodes are gathered and sent back to their
+// node's depot in batches.
+class ThreadCache {
+ public:
+  explicit ThreadCache(std::shared_ptr<SizeClassHeap> heap)
+      : heap_(std::move(heap)), node_(heap_->CurrentNode()) {}
+
+  ~ThreadCache() {
+    for (int cls = 0; cls < kNumClasses; ++cls) {
+      Drain(&local_[cls], node_, cls);
+    }
+    for (int node = 0; node < kMaxNumaNodes; ++node) {
+      for (int cls = 0; cls < kNumClasses; ++cls) {
+        Drain(&remote_[node][cls], node, cls);
+      }
+    }
+  }
+
+  void *Allocate(int size_class) {
+    auto &list = local_[size_class];
+    if (list.head == nullptr) {
+      list.head = heap_->Fetch(node_, size_class);
+      list.count = list.head->count;
+    }
+    FreeBlock *block = list.head;
+    list.head = block->next;
+    --list.count;
+    return block;
+  }
+
+  void Free(void *p, int size_class) {
+    auto *block = static_cast<FreeBlock *>(p);
+    int node = heap_->NodeOf(p);
+    size_t batch_count = Table().batch_count[size_class];
+    if (node == node_) {
+      auto &list = local_[size_class];
+      block->next = list.head;
+      list.head = block;
+      // Keep up to two batches so that alternating alloc/free around a batch
+      // boundary does not go to the depot every time.
+      if (++list.count >= 2 * batch_count) {
+        FreeBlock *batch = list.head;
+        FreeBlock *last = batch;
+        for (size_t i = 1; i < batch_count; ++i) {
+          last = last->next;
+        }
+        list.head = last->next;
+        last->next = nullptr;
+        list.count -= batch_count;
+        heap_->Return(node_, size_class, batch, batch_count);
+      }
+    } else {
+      auto &list = remote_[node][size_class];
+      block->next = list.head;
+      list.head = block;
+      if (++list.count >= batch_count) {
+        Drain(&list, node, size_class);
+      }
+    }
+  }
+
+ private:
+  struct FreeList {
+    FreeBlock *head{nullptr};
+    size_t count{0};
+  };
+
+  void Drain(FreeList *list, int node, int size_class) {
+    if (list->head != nullptr) {
+      heap_->Return(node, size_class, list->head, list->count);
+      list->head = nullptr;
+      list->count = 0;
+    }
+  }
+
+  std::shared_ptr<SizeClassHeap> heap_;
+  int node_;
+  FreeList local_[kNumClasses];
+  FreeList remote_[kMaxNumaNodes][kNumClasses];
+};
+
+namespace {
+
+thread_local SizeClassHeap *tls_last_heap = nullptr;
+thread_local ThreadCache *tls_last_cache = nullptr;
+thread_local bool tls_cache_exited = false;
+
+// Owns the caches of a thread. Allocations made by thread_local destructors
+// that run after this one go to the depots directly.
+struct ThreadCacheMap {
+  std::unordered_map<SizeClassHeap *, std::unique_ptr<ThreadCache>> caches;
+
+  ~ThreadCacheMap() {
+    tls_cache_exited = true;
+    tls_last_heap = nullptr;
+    tls_last_cache = nullptr;
+    caches.clear();
+  }
+};
+
+}  // namespace
+
+ThreadCache *SizeClassHeap::LocalCache() {
+  if (tls_last_heap == this) {
+    return tls_last_cache;
+  }
+  if (tls_cache_exited) {
+    return nullptr;
+  }
+  static thread_local ThreadCacheMap cache_map;
+  // The cache keeps the heap alive, so the key can not be reused by another
+  // heap while the entry exists.
+  auto &cache = cache_map.caches[this];
+  if (cache == nullptr) {
+    cache.reset(new ThreadCache(shared_from_this()));
+  }
+  tls_last_heap = this;
+  tls_last_cache = cache.get();
+  return tls_last_cache;
+}
+
+void *SizeClassHeap::Allocate(int size_class) {
+  auto *cache = LocalCache();
+  if (LIKELY(cache != nullptr)) {
+    return cache->Allocate(size_class);
+  }
+  int node = CurrentNode();
+  FreeBlock *batch = Fetch(node, size_class);
+  if (batch->next != nullptr) {
+    Return(node, size_class, batch->next, batch->count - 1);
+  }
+  return batch;
+}
+
+void SizeClassHeap::Free(void *p, int size_class) {
+  auto *cache = LocalCache();
+  if (LIKELY(cache != nullptr)) {
+    cache->Free(p, size_class);
+    return;
+  }
+  auto *block = static_cast<FreeBlock *>(p);
+  block->next = nullptr;
+  Return(NodeOf(p), size_class, block, 1);
+}
+
+constexpr size_t SizeClassAllocator::kAlignment;
+constexpr size_t SizeClassAllocator::kChunkSize;
+constexpr size_t SizeClassAllocator::kMaxSmallSize;
+constexpr int SizeClassAllocator::kNumClasses;
+constexpr int SizeClassAllocator::kMaxNumaNodes;
+
+SizeClassAllocator::SizeClassAllocator(bool use_huge_page, bool numa_aware)
+    : heap_(std::make_shared<SizeClassHeap>(use_huge_page, numa_aware)) {
+  Table();
+}
+
+// The heap is released by the last thread cache that refers to it.
+SizeClassAllocator::~SizeClassAllocator() {}
+
+int SizeClassAllocator::SizeClass(size_t size) {
+  if (size > kMaxSmallSize) {
+    return -1;
+  }
+  return Table().class_of[(size + kAlignment - 1) / kAlignment];
+}
+
+size_t SizeClassAllocator::ClassSize(int size_class) {
+  return Table().class_size[size_class];
+}
+
+Allocation *SizeClassAllocator::AllocateImpl(size_t size) {
+  int size_class = SizeClass(size);
+  void *p = nullptr;
+  if (size_class >= 0) {
+    p = heap_->Allocate(size_class);
+  } else {
+#ifdef _WIN32
+    p = _aligned_malloc(size, CPUAllocator::kAlignment);
+    PADDLE_ENFORCE_NOT_NULL(
+        p, platform::errors::ResourceExhausted(
+               "Fail to alloc memory of %ld size.", size));
+#else
+    int error = posix_memalign(&p, CPUAllocator::kAlignment, size);
+    PADDLE_ENFORCE_EQ(
+        error, 0,
+        platform::errors::ResourceExhausted(
+            "Fail to alloc memory of %ld size, error code is %d.", size,
+            error));
+#endif
+  }
+  return new Allocation(p, size, platform::CPUPlace());
+}
+
+void SizeClassAllocator::FreeImpl(Allocation *allocation) {
+  int size_class = SizeClass(allocation->size());
+  if (size_class >= 0) {
+    heap_->Free(allocation->ptr(), size_class);
+  } else {
+#ifdef _WIN32
+    _aligned_free(allocation->ptr());
+#else
+    free(allocation->ptr());
+#endif
+  }
+  delete allocation;
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,68 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+class SizeClassHeap;
+
+// CPU allocator for op outputs and other short-lived tensors.
+//
+// Requests up to kMaxSmallSize bytes are rounded up to one of kNumClasses
+// size classes and served from a per-thread free list without any lock. A
+// thread refills or drains its lists in batches through a lock-free depot
+// per size class. The depot is refilled by carving kChunkSize chunks that are
+// mmap-ed at kChunkSize alignment and advised to use transparent huge pages.
+//
+// When numa_aware is set, every NUMA node owns its own depot and chunks, the
+// chunks are bound to that node, and blocks freed by a thread of another node
+// are sent back to the owner's depot instead of being reused remotely.
+//
+// Larger requests are passed to posix_memalign directly. Chunk memory is
+// never given back to the system while the allocator is in use.
+class SizeClassAllocator : public Allocator {
+ public:
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kChunkSize = 2UL << 20;
+  static constexpr size_t kMaxSmallSize = 256UL << 10;
+  static constexpr int kNumClasses = 48;
+  static constexpr int kMaxNumaNodes = 8;
+
+  SizeClassAllocator(bool use_huge_page, bool numa_aware);
+  ~SizeClassAllocator();
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+  // Return the size class of size, or -1 if size > kMaxSmallSize.
+  static int SizeClass(size_t size);
+  static size_t ClassSize(int size_class);
+
+ protected:
+  Allocation* AllocateImpl(size_t size) override;
+  void FreeImpl(Allocation* allocation) override;
+
+ private:
+  std::shared_ptr<SizeClassHeap> heap_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,172 @@
+// Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/size_class_allocator.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <deque>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/allocation/naive_best_fit_allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+TEST(SizeClassAllocator, SizeClass) {
+  ASSERT_EQ(SizeClassAllocator::SizeClass(1), 0);
+  ASSERT_EQ(SizeClassAllocator::ClassSize(0), 64UL);
+  ASSERT_EQ(SizeClassAllocator::SizeClass(65), 1);
+  ASSERT_EQ(SizeClassAllocator::ClassSize(SizeClassAllocator::SizeClass(1025)),
+            1280UL);
+  ASSERT_EQ(SizeClassAllocator::ClassSize(SizeClassAllocator::kNumClasses - 1),
+            SizeClassAllocator::kMaxSmallSize);
+  ASSERT_EQ(SizeClassAllocator::SizeClass(SizeClassAllocator::kMaxSmallSize),
+            SizeClassAllocator::kNumClasses - 1);
+  ASSERT_EQ(
+      SizeClassAllocator::SizeClass(SizeClassAllocator::kMaxSmallSize + 1),
+      -1);
+  for (size_t size = 1; size <= SizeClassAllocator::kMaxSmallSize;
+       size += 37) {
+    size_t class_size =
+        SizeClassAllocator::ClassSize(SizeClassAllocator::SizeClass(size));
+    ASSERT_GE(class_size, size);
+    ASSERT_LE(class_size, size + size / 4 + SizeClassAllocator::kAlignment);
+  }
+}
+
+TEST(SizeClassAllocator, AllocAndReuse) {
+  SizeClassAllocator allocator(true, true);
+  std::vector<AllocationPtr> allocations;
+  for (size_t size : {1UL, 64UL, 1000UL, 4097UL, 100000UL, 262144UL,
+                      262145UL, 8UL << 20}) {
+    auto allocation = allocator.Allocate(size);
+    ASSERT_NE(allocation->ptr(), nullptr);
+    ASSERT_EQ(allocation->size(), size);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(allocation->ptr()) %
+                  SizeClassAllocator::kAlignment,
+              0UL);
+    memset(allocation->ptr(), 1, size);
+    allocations.emplace_back(std::move(allocation));
+  }
+  void *p = allocations[2]->ptr();
+  allocations[2].reset();
+  // the thread cache gives the last freed block of a class back first
+  ASSERT_EQ(allocator.Allocate(1000)->ptr(), p);
+}
+
+// Tensors created by one thread and released by another, like the
+// variables passed between the reader and the trainer threads.
+TEST(SizeClassAllocator, CrossThreadFree) {
+  SizeClassAllocator allocator(true, true);
+  std::mutex mutex;
+  std::deque<AllocationPtr> queue;
+  bool done = false;
+  std::thread consumer([&] {
+    size_t freed = 0;
+    while (true) {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (queue.empty()) {
+        if (done) break;
+        lock.unlock();
+        std::this_thread::yield();
+        continue;
+      }
+      auto allocation = std::move(queue.front());
+      queue.pop_front();
+      lock.unlock();
+      auto *data = static_cast<uint8_t *>(allocation->ptr());
+      ASSERT_EQ(data[0], static_cast<uint8_t>(freed));
+      ASSERT_EQ(data[allocation->size() - 1], static_cast<uint8_t>(freed));
+      ++freed;
+    }
+    ASSERT_EQ(freed, 20000UL);
+  });
+  for (size_t i = 0; i < 20000; ++i) {
+    size_t size = 64 + (i * 7919) % 20000;
+    auto allocation = allocator.Allocate(size);
+    memset(allocation->ptr(), static_cast<int>(i & 0xff), size);
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.emplace_back(std::move(allocation));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  consumer.join();
+}
+
+// Every thread runs a chain of ops. An op allocates its output and a few
+// temporaries and its inputs are released after their last use, like the
+// eager deletion of a Hogwild worker.
+static double RunOpGraph(Allocator *allocator, int thread_num, int step_num) {
+  const std::vector<size_t> output_sizes = {
+      512 * 4,  512 * 11 * 4, 512 * 64 * 4, 512 * 4,  512 * 400 * 4,
+      512 * 4,  512 * 32 * 4, 128 * 4,      512 * 4,  64 * 64 * 4,
+      512 * 8,  96,           512 * 16 * 4, 4096 * 4, 512 * 2 * 4};
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&] {
+      for (int step = 0; step < step_num; ++step) {
+        std::deque<AllocationPtr> live;
+        for (size_t op = 0; op < output_sizes.size() * 4; ++op) {
+          size_t size = output_sizes[op % output_sizes.size()];
+          auto output = allocator->Allocate(size);
+          for (int i = 0; i < 3; ++i) {
+            auto tmp = allocator->Allocate(size / 2 + 64);
+            static_cast<char *>(tmp->ptr())[0] = 1;
+          }
+          static_cast<char *>(output->ptr())[0] = 1;
+          live.emplace_back(std::move(output));
+          if (live.size() > 3) {
+            live.pop_front();
+          }
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(SizeClassAllocator, DISABLED_OpGraphBenchmark) {
+  int thread_num = std::max(2U, std::thread::hardware_concurrency());
+  int step_num = 200;
+  NaiveBestFitAllocator naive_allocator{platform::CPUPlace()};
+  SizeClassAllocator size_class_allocator(true, true);
+  // warm up the chunks of both allocators
+  RunOpGraph(&naive_allocator, thread_num, 1);
+  RunOpGraph(&size_class_allocator, thread_num, 1);
+  double naive_ms = RunOpGraph(&naive_allocator, thread_num, step_num);
+  double size_class_ms =
+      RunOpGraph(&size_class_allocator, thread_num, step_num);
+  LOG(INFO) << thread_num << " threads, naive_best_fit: " << naive_ms
+            << " ms, size_class: " << size_class_ms << " ms";
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -106,6 +106,12 @@ class FusedEmbeddingSeqPoolOpMaker : public framework::OpProtoAndCheckerMaker {
                   "(boolean, default false) "
                   "Sparse update.")
         .SetDefault(false);
+    AddAttr<bool>("with_cvm",
+                  "(boolean, default false) "
+                  "Whether to apply the CVM transform of cvm_op with "
+                  "use_cvm=true to the pooled embeddings, the first two "
+                  "columns of W are show and click. For inference only.")
+        .SetDefault(false);
     AddAttr<bool>(framework::kAllKernelsMustComputeRuntimeShape,
                   "Skip calling InferShape() function in the runtime.")
         .SetDefault(true);
@@ -116,6 +116,42 @@ struct EmbeddingVSumFunctor {
 };
 #endif
 
+// Sum pools the embeddings of each sequence and applies the CVM transform to
+// them in one pass, the first two columns of W are show and click.
+template <typename T>
+struct EmbeddingVSumCVMFunctor {
+  void operator()(const framework::ExecutionContext &context,
+                  const LoDTensor *table_t, const LoDTensor *ids_t,
+                  LoDTensor *output_t) {
+    auto *table = table_t->data<T>();
+    int64_t table_height = table_t->dims()[0];
+    int64_t table_width = table_t->dims()[1];
+    int64_t out_width = output_t->dims()[1];
+    const int64_t *ids = ids_t->data<int64_t>();
+    auto ids_lod = ids_t->lod()[0];
+    int64_t idx_width = ids_t->numel() / ids_lod.back();
+    auto *output = output_t->mutable_data<T>(context.GetPlace());
+
+    PADDLE_ENFORCE_EQ(table_width * idx_width, out_width,
+                      platform::errors::InvalidArgument(
+                          "table_width * idx_width should be equal to "
+                          "out_width. But received table_width * idx_width "
+                          "= %s, out_width = %d.",
+                          table_width * idx_width, out_width));
+
+    jit::emb_seq_pool_cvm_attr_t attr(table_height, table_width, 0, idx_width,
+                                      out_width, true);
+    auto emb_seqpool_cvm = jit::KernelFuncs<jit::EmbSeqPoolCVMTuple<T>,
+                                            platform::CPUPlace>::Cache()
+                               .At(attr);
+    for (size_t i = 0; i != ids_lod.size() - 1; ++i) {
+      attr.index_height = ids_lod[i + 1] - ids_lod[i];
+      emb_seqpool_cvm(table, ids + ids_lod[i] * idx_width,
+                      output + i * out_width, &attr);
+    }
+  }
+};
+
 inline int FusedEmbeddingSeqPoolLastDim(const framework::DDim &table_dims,
                                         const framework::DDim &ids_dims) {
   int64_t last_dim = table_dims[1];
@@ -148,7 +184,14 @@ class FusedEmbeddingSeqPoolKernel : public framework::OpKernel<T> {
     // should be [seq_length, 1] -> [batch_size, last_dim]
     output_t->Resize({batch_size, last_dim});
 
-    if (combiner_type == "sum") {
+    if (combiner_type == "sum" && context.Attr<bool>("with_cvm")) {
+      PADDLE_ENFORCE_EQ(context.Attr<int64_t>("padding_idx"), kNoPadding,
+                        platform::errors::Unimplemented(
+                            "The padding_idx of fused_embedding_seq_pool is "
+                            "not supported with CVM."));
+      EmbeddingVSumCVMFunctor<T> functor;
+      functor(context, table_var, ids_t, output_t);
+    } else if (combiner_type == "sum") {
 #if defined(PADDLE_WITH_MKLML) && !defined(_WIN32) && !defined(__APPLE__) && \
     !defined(__OSX__)
       int64_t padding_idx = context.Attr<int64_t>("padding_idx");
@@ -196,6 +239,10 @@ template <typename T>
 class FusedEmbeddingSeqPoolGradKernel : public framework::OpKernel<T> {
  public:
   void Compute(const framework::ExecutionContext &context) const override {
+    PADDLE_ENFORCE_EQ(context.Attr<bool>("with_cvm"), false,
+                      platform::errors::Unimplemented(
+                          "The gradient of fused_embedding_seq_pool with CVM "
+                          "is not supported, it is for inference only."));
     auto *table_var = context.InputVar("W");
     DDim table_dim;
     if (table_var->IsType<LoDTensor>()) {
@@ -15,7 +15,10 @@
 #include "paddle/fluid/operators/fused/fusion_seqpool_concat_op.h"
 #include <string>
 #include <vector>
-#include "paddle/fluid/operators/jit/kernels.h"
+#include "gflags/gflags.h"
+#include "paddle/fluid/operators/math/sequence_pooling.h"
+
+DECLARE_int32(inner_op_parallelism);
 
 namespace paddle {
 namespace operators {
@@ -73,13 +76,14 @@ void FusionSeqPoolConcatOpMaker::Make() {
                        "(string, default 'SUM') some of the pooling "
                        "pooltype of SequencePoolOp.")
       .SetDefault("SUM")
-      .InEnum({"AVERAGE", "SUM", "SQRT"});
+      .InEnum({"AVERAGE", "SUM", "SQRT", "MAX", "LAST", "FIRST"});
   AddAttr<int>("axis",
                "The axis along which the input tensors will be concatenated. "
                "Only supports concat axis=1 yet.")
       .SetDefault(1);
   AddComment(R"DOC(
-Fusion Sequence Pool of pooltype(sum, average and sqrt) and Concat Operator.
+Fusion Sequence Pool of pooltype(sum, average, sqrt, max, last and first) and
+Concat Operator.
 )DOC");
 }
 
@@ -101,50 +105,20 @@ class FusionSeqPoolConcatKernel : public framework::OpKernel<T> {
       y_lod[0][i] = i;
     }
     out->set_lod(y_lod);
-    auto place = ctx.GetPlace();
-    T* y_data = out->mutable_data<T>(place);
-
-    int w = ins[0]->numel() / x0_dims[0];
-    PADDLE_ENFORCE_EQ(y_dims[1] % w, 0,
-                      platform::errors::InvalidArgument(
-                          "The output of dims[1] should be dividable of w, but "
-                          "dims[1] is %d, w is %d.",
-                          y_dims[1], w));
-    jit::seq_pool_attr_t attr(w, jit::SeqPoolType::kSum);
-    if (pooltype == "AVERAGE") {
-      attr.type = jit::SeqPoolType::kAvg;
-    } else if (pooltype == "SQRT") {
-      attr.type = jit::SeqPoolType::kSqrt;
-    }
-    auto seqpool =
-        jit::KernelFuncs<jit::SeqPoolTuple<T>, platform::CPUPlace>::Cache().At(
-            attr);
     size_t n = ins.size();
-    size_t dst_step_size = n * w;
     for (size_t i = 0; i < n; ++i) {
-      auto x_dims = ins[i]->dims();
-      auto x_lod = ins[i]->lod()[0];
-      const T* src = ins[i]->data<T>();
-      T* dst = y_data + i * w;
       PADDLE_ENFORCE_EQ(
-          static_cast<int>(ins[i]->numel() / x_dims[0]), w,
+          ins[i]->numel() / ins[i]->dims()[0], ins[0]->numel() / x0_dims[0],
           platform::errors::InvalidArgument(
               "Width of all inputs should be equal, but the width of the %d-th "
               "input %d is not equal to the previous %d",
-              i, static_cast<int>(ins[i]->numel() / x_dims[0]), w));
-      PADDLE_ENFORCE_EQ(
-          x_lod.size(), bs + 1,
-          platform::errors::InvalidArgument(
-              "Batchsize of all inputs should be equal, but the value of the "
-              "%d-th %d is not equal to the previous %d.",
-              i, x_lod.size(), bs + 1));
-      for (size_t j = 0; j < bs; ++j) {
-        attr.h = static_cast<int>(x_lod[j + 1] - x_lod[j]);
-        seqpool(src, dst, &attr);
-        dst += dst_step_size;
-        src += attr.h * attr.w;
-      }
+              i, ins[i]->numel() / ins[i]->dims()[0],
+              ins[0]->numel() / x0_dims[0]));
     }
+    math::MultiSeqPoolFunctor<T> pool;
+    pool(ctx.template device_context<platform::CPUDeviceContext>(), pooltype,
+         static_cast<T>(0), ins, out, {},
+         FLAGS_inner_op_parallelism);
   }
 };
 
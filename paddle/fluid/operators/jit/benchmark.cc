@@ -313,6 +313,37 @@ void BenchKernelEmbSeqPool() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelEmbSeqPoolCVM() {
+  using T = typename KernelTuple::data_type;
+  int64_t tbl_h = 1e4;
+  for (int tbl_w : {10, 16, 256}) {
+    Tensor table;
+    table.Resize({tbl_h, tbl_w});
+    RandomVec<T>(tbl_h * tbl_w, table.mutable_data<T>(PlaceType()), 0.f, 2.f);
+    const T* table_data = table.data<T>();
+    for (bool use_cvm : {true, false}) {
+      for (int idx_w : {1, 2, 10, 16}) {
+        for (int idx_h : {1, 2, 9, 13, 16}) {
+          int64_t out_w = (use_cvm ? tbl_w : tbl_w - 2) * idx_w;
+          jit::emb_seq_pool_cvm_attr_t attr(tbl_h, tbl_w, idx_h, idx_w, out_w,
+                                            use_cvm);
+          Tensor idx, out;
+          idx.Resize({idx_h, idx_w});
+          out.Resize({out_w});
+          RandomVec<int64_t>(idx_h * idx_w,
+                             idx.mutable_data<int64_t>(PlaceType()), 0,
+                             tbl_h - 1);
+          const int64_t* idx_data = idx.data<int64_t>();
+          T* o_data = out.mutable_data<T>(PlaceType());
+          BenchAllImpls<KernelTuple, PlaceType>(attr, table_data, idx_data,
+                                                o_data, &attr);
+        }
+      }
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void BenchKernelSgd() {
   using T = typename KernelTuple::data_type;
@@ -360,6 +391,80 @@ void BenchKernelSgd() {
   }
 }
 
+// The grad, rows, param and accumulators of the sparse optimizers, whose
+// selected rows are spread over the param.
+template <typename T, typename PlaceType>
+struct SparseOptData {
+  SparseOptData(int param_h, int w, int rows_size, int data_num)
+      : data(data_num) {
+    grad.Resize({rows_size, w});
+    RandomVec<T>(rows_size * w, grad.mutable_data<T>(PlaceType()), -2.f, 2.f);
+    for (auto& t : data) {
+      t.Resize({param_h, w});
+      // positive, as the squared accumulators
+      RandomVec<T>(param_h * w, t.mutable_data<T>(PlaceType()), 0.1f, 2.f);
+    }
+    for (int i = 0; i < rows_size; ++i) {
+      rows.push_back(static_cast<int64_t>(i) * param_h / rows_size);
+    }
+  }
+  T* Data(int i) { return data[i].mutable_data<T>(PlaceType()); }
+
+  Tensor grad;
+  std::vector<Tensor> data;
+  std::vector<int64_t> rows;
+};
+
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelAdam() {
+  using T = typename KernelTuple::data_type;
+  const T coefs[4] = {0.001, 0.9, 0.999, 1e-8};
+  const int param_h = 10000;
+  for (int w : {8, 16, 30, 64, 256}) {
+    for (int rows_size : {1, 64, 1024}) {
+      // only benchmark inplace
+      SparseOptData<T, PlaceType> d(param_h, w, rows_size, 3);
+      jit::opt_attr_t attr(param_h, w, rows_size);
+      BenchAllImpls<KernelTuple, PlaceType>(
+          attr, coefs, d.grad.template data<T>(), d.rows.data(), d.Data(0),
+          d.Data(1), d.Data(2), &attr);
+    }
+  }
+}
+
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelAdagrad() {
+  using T = typename KernelTuple::data_type;
+  const T coefs[2] = {0.001, 1e-6};
+  const int param_h = 10000;
+  for (int w : {8, 16, 30, 64, 256}) {
+    for (int rows_size : {1, 64, 1024}) {
+      SparseOptData<T, PlaceType> d(param_h, w, rows_size, 2);
+      jit::opt_attr_t attr(param_h, w, rows_size);
+      BenchAllImpls<KernelTuple, PlaceType>(attr, coefs,
+                                            d.grad.template data<T>(),
+                                            d.rows.data(), d.Data(0),
+                                            d.Data(1), &attr);
+    }
+  }
+}
+
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelFtrl() {
+  using T = typename KernelTuple::data_type;
+  const T coefs[3] = {0.001, 0.1, 0.1};
+  const int param_h = 10000;
+  for (int w : {8, 16, 30, 64, 256}) {
+    for (int rows_size : {1, 64, 1024}) {
+      SparseOptData<T, PlaceType> d(param_h, w, rows_size, 3);
+      jit::opt_attr_t attr(param_h, w, rows_size);
+      BenchAllImpls<KernelTuple, PlaceType>(
+          attr, coefs, d.grad.template data<T>(), d.rows.data(), d.Data(0),
+          d.Data(1), d.Data(2), &attr);
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void BenchKernelMatMul() {
   using T = typename KernelTuple::data_type;
@@ -554,9 +659,13 @@ BENCH_FP32_CPU(CRFDecoding);
 
 BENCH_FP32_CPU(SeqPool);
 BENCH_FP32_CPU(EmbSeqPool);
+BENCH_FP32_CPU(EmbSeqPoolCVM);
 BENCH_FP32_CPU(MatMul);
 BENCH_FP32_CPU(Softmax);
 BENCH_FP32_CPU(Sgd);
+BENCH_FP32_CPU(Adam);
+BENCH_FP32_CPU(Adagrad);
+BENCH_FP32_CPU(Ftrl);
 BENCH_FP32_CPU(VBroadcast);
 
 // Benchmark all jit kernels including jitcode, mkl and refer.
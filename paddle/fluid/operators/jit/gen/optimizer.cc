@@ -0,0 +1,217 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/gen/optimizer.h"
+
+#include <stddef.h>  // offsetof
+#include <memory>
+
+#include "paddle/fluid/operators/jit/registry.h"
+#include "paddle/fluid/platform/cpu_info.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace gen {
+
+// one, sign mask
+static const float opt_float_consts[] = {1.f, -0.f};
+
+void SparseOptJitCode::loadCoefs() {
+  mov(reg_tmp, reinterpret_cast<size_t>(opt_float_consts));
+  vbroadcastss(ymm_t(15), ptr[param_coefs]);  // lr
+  if (type_ == kAdam) {
+    vbroadcastss(ymm_t(14), ptr[param_coefs + sizeof(float)]);      // beta1
+    vbroadcastss(ymm_t(13), ptr[param_coefs + 2 * sizeof(float)]);  // beta2
+    vbroadcastss(ymm_t(10), ptr[param_coefs + 3 * sizeof(float)]);  // eps
+    vbroadcastss(ymm_t(12), ptr[reg_tmp]);
+    vbroadcastss(ymm_t(11), ptr[reg_tmp]);
+    vsubps(ymm_t(12), ymm_t(12), ymm_t(14));  // 1 - beta1
+    vsubps(ymm_t(11), ymm_t(11), ymm_t(13));  // 1 - beta2
+  } else if (type_ == kAdagrad) {
+    vbroadcastss(ymm_t(14), ptr[param_coefs + sizeof(float)]);  // eps
+  } else {
+    vbroadcastss(ymm_t(14), ptr[param_coefs + sizeof(float)]);      // l1
+    vbroadcastss(ymm_t(13), ptr[param_coefs + 2 * sizeof(float)]);  // l2
+    vaddps(ymm_t(13), ymm_t(13), ymm_t(13));                        // 2 * l2
+    vbroadcastss(ymm_t(12), ptr[reg_tmp + sizeof(float)]);          // sign
+  }
+}
+
+void SparseOptJitCode::blockCode() {
+  constexpr size_t block_size = sizeof(float) * YMM_FLOAT_BLOCK;
+  vmovups(ymm_t(0), ptr[param_grad]);
+  if (type_ == kAdam) {
+    // mom1 = beta1 * mom1 + (1 - beta1) * g
+    vmovups(ymm_t(1), ptr[reg_ptr_acc1_i]);
+    vmulps(ymm_t(1), ymm_t(1), ymm_t(14));
+    vmulps(ymm_t(2), ymm_t(0), ymm_t(12));
+    vaddps(ymm_t(1), ymm_t(1), ymm_t(2));
+    vmovups(ptr[reg_ptr_acc1_i], ymm_t(1));
+    // mom2 = beta2 * mom2 + (1 - beta2) * g * g
+    vmulps(ymm_t(2), ymm_t(0), ymm_t(0));
+    vmulps(ymm_t(2), ymm_t(2), ymm_t(11));
+    vmovups(ymm_t(3), ptr[reg_ptr_acc2_i]);
+    vmulps(ymm_t(3), ymm_t(3), ymm_t(13));
+    vaddps(ymm_t(3), ymm_t(3), ymm_t(2));
+    vmovups(ptr[reg_ptr_acc2_i], ymm_t(3));
+    // param -= lr * mom1 / (sqrt(mom2) + eps)
+    vsqrtps(ymm_t(3), ymm_t(3));
+    vaddps(ymm_t(3), ymm_t(3), ymm_t(10));
+    vmulps(ymm_t(1), ymm_t(1), ymm_t(15));
+    vdivps(ymm_t(1), ymm_t(1), ymm_t(3));
+    vmovups(ymm_t(2), ptr[reg_ptr_param_i]);
+    vsubps(ymm_t(2), ymm_t(2), ymm_t(1));
+    vmovups(ptr[reg_ptr_param_i], ymm_t(2));
+  } else if (type_ == kAdagrad) {
+    // moment += g * g
+    vmovups(ymm_t(1), ptr[reg_ptr_acc1_i]);
+    vmulps(ymm_t(2), ymm_t(0), ymm_t(0));
+    vaddps(ymm_t(1), ymm_t(1), ymm_t(2));
+    vmovups(ptr[reg_ptr_acc1_i], ymm_t(1));
+    // param -= lr * g / (sqrt(moment) + eps)
+    vsqrtps(ymm_t(1), ymm_t(1));
+    vaddps(ymm_t(1), ymm_t(1), ymm_t(14));
+    vmulps(ymm_t(0), ymm_t(0), ymm_t(15));
+    vdivps(ymm_t(0), ymm_t(0), ymm_t(1));
+    vmovups(ymm_t(2), ptr[reg_ptr_param_i]);
+    vsubps(ymm_t(2), ymm_t(2), ymm_t(0));
+    vmovups(ptr[reg_ptr_param_i], ymm_t(2));
+  } else {
+    // new_accum = squared_accum + g * g
+    vmovups(ymm_t(1), ptr[reg_ptr_acc1_i]);
+    vmulps(ymm_t(2), ymm_t(0), ymm_t(0));
+    vaddps(ymm_t(2), ymm_t(1), ymm_t(2));
+    vmovups(ptr[reg_ptr_acc1_i], ymm_t(2));
+    // linear_accum += g - (sqrt(new_accum) - sqrt(squared_accum)) / lr * param
+    vsqrtps(ymm_t(1), ymm_t(1));
+    vsqrtps(ymm_t(2), ymm_t(2));
+    vsubps(ymm_t(1), ymm_t(2), ymm_t(1));
+    vdivps(ymm_t(1), ymm_t(1), ymm_t(15));
+    vmovups(ymm_t(3), ptr[reg_ptr_param_i]);
+    vmulps(ymm_t(1), ymm_t(1), ymm_t(3));
+    vmovups(ymm_t(4), ptr[reg_ptr_acc2_i]);
+    vaddps(ymm_t(4), ymm_t(4), ymm_t(0));
+    vsubps(ymm_t(4), ymm_t(4), ymm_t(1));
+    vmovups(ptr[reg_ptr_acc2_i], ymm_t(4));
+    // x = sign(linear_accum) * l1 - linear_accum
+    vandps(ymm_t(5), ymm_t(4), ymm_t(12));
+    vorps(ymm_t(5), ymm_t(5), ymm_t(14));
+    vsubps(ymm_t(5), ymm_t(5), ymm_t(4));
+    // y = sqrt(new_accum) / lr + 2 * l2
+    vdivps(ymm_t(2), ymm_t(2), ymm_t(15));
+    vaddps(ymm_t(2), ymm_t(2), ymm_t(13));
+    // param = |linear_accum| > l1 ? x / y : 0
+    vdivps(ymm_t(5), ymm_t(5), ymm_t(2));
+    vandnps(ymm_t(6), ymm_t(12), ymm_t(4));
+    vcmpgtps(ymm_t(6), ymm_t(6), ymm_t(14));
+    vandps(ymm_t(5), ymm_t(5), ymm_t(6));
+    vmovups(ptr[reg_ptr_param_i], ymm_t(5));
+  }
+  add(param_grad, block_size);
+  add(reg_ptr_param_i, block_size);
+  add(reg_ptr_acc1_i, block_size);
+  if (type_ != kAdagrad) {
+    add(reg_ptr_acc2_i, block_size);
+  }
+}
+
+void SparseOptJitCode::genCode() {
+  preCode();
+  const int num_block = w_ / YMM_FLOAT_BLOCK;
+  const size_t width_size = w_ * sizeof(float);
+  loadCoefs();
+
+  // Adagrad has 6 arguments, the attr of Adam and FTRL is the 7th one on the
+  // stack, above the return address and the saved registers.
+  if (type_ == kAdagrad) {
+    mov(reg_tmp, param_acc2);
+  } else {
+    mov(reg_tmp, qword[rsp + (num_g_abi_regs + 1) * sizeof(int64_t)]);
+  }
+  mov(reg_ptr_rows_end,
+      qword[reg_tmp + offsetof(opt_attr_t, selected_rows_size)]);
+  lea(reg_ptr_rows_end,
+      ptr[param_rows + reg_ptr_rows_end * sizeof(int64_t)]);
+
+  Label l_next_row;
+  Label l_end;
+  cmp(param_rows, reg_ptr_rows_end);
+  jnb(l_end, T_NEAR);
+  L(l_next_row);
+  {
+    mov(rax, qword[param_rows]);
+    imul(rax, rax, width_size);
+    lea(reg_ptr_param_i, ptr[param_param + rax]);
+    lea(reg_ptr_acc1_i, ptr[param_acc1 + rax]);
+    if (type_ != kAdagrad) {
+      lea(reg_ptr_acc2_i, ptr[param_acc2 + rax]);
+    }
+
+    Label l_next_block;
+    mov(reg_block_num, num_block);
+    L(l_next_block);
+    {
+      blockCode();
+      dec(reg_block_num);
+      jnz(l_next_block, T_NEAR);
+    }
+
+    add(param_rows, sizeof(int64_t));
+    cmp(param_rows, reg_ptr_rows_end);
+    jb(l_next_row, T_NEAR);
+  }
+  L(l_end);
+  postCode();
+}
+
+#define DECLARE_OPT_CREATOR(name)                                          \
+  class name##Creator : public JitCodeCreator<opt_attr_t> {                \
+   public:                                                                 \
+    bool CanBeUsed(const opt_attr_t& attr) const override {                \
+      return platform::MayIUse(platform::avx) && attr.width > 0 &&         \
+             attr.width % YMM_FLOAT_BLOCK == 0 &&                          \
+             (k##name != kFtrl || attr.lr_power == -0.5f);                 \
+    }                                                                      \
+    size_t CodeSize(const opt_attr_t& attr) const override {               \
+      return 96 + 96 * 8;                                                  \
+    }                                                                      \
+    std::unique_ptr<GenBase> CreateJitCode(                                \
+        const opt_attr_t& attr) const override {                           \
+      PADDLE_ENFORCE_GE(attr.selected_rows_size, 0,                        \
+                        platform::errors::InvalidArgument(                 \
+                            "The attribute selected_rows_size of " #name   \
+                            " should be equal to or larger than 0. But "   \
+                            "selected_rows_size is %d.",                   \
+                            attr.selected_rows_size));                     \
+      return make_unique<SparseOptJitCode>(attr, k##name, CodeSize(attr)); \
+    }                                                                      \
+  }
+
+DECLARE_OPT_CREATOR(Adam);
+DECLARE_OPT_CREATOR(Adagrad);
+DECLARE_OPT_CREATOR(Ftrl);
+
+#undef DECLARE_OPT_CREATOR
+
+}  // namespace gen
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
+
+namespace gen = paddle::operators::jit::gen;
+
+REGISTER_JITKERNEL_GEN(kAdam, gen::AdamCreator);
+REGISTER_JITKERNEL_GEN(kAdagrad, gen::AdagradCreator);
+REGISTER_JITKERNEL_GEN(kFtrl, gen::FtrlCreator);
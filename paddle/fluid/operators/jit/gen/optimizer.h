@@ -0,0 +1,83 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#pragma once
+
+#include <string>
+
+#include "glog/logging.h"
+#include "paddle/fluid/operators/jit/gen/jitcode.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace gen {
+
+// The sparse Adam, Adagrad and FTRL, which update the selected rows of param
+// and its accumulators in place, one YMM block of a row at a time.
+// FTRL only supports lr_power == -0.5.
+class SparseOptJitCode : public JitCode {
+ public:
+  explicit SparseOptJitCode(const opt_attr_t& attr, KernelType type,
+                            size_t code_size = 256 * 1024,
+                            void* code_ptr = nullptr)
+      : JitCode(code_size, code_ptr), w_(attr.width), type_(type) {
+    if (!(type_ == kAdam || type_ == kAdagrad || type_ == kFtrl)) {
+      PADDLE_THROW(platform::errors::Unimplemented(
+          "Do not support sparse optimizer type: %d.", type_));
+    }
+    this->genCode();
+  }
+
+  std::string name() const override {
+    std::string base = "SparseOptJitCode";
+    if (type_ == kAdam) {
+      base += "_Adam";
+    } else if (type_ == kAdagrad) {
+      base += "_Adagrad";
+    } else {
+      base += "_Ftrl";
+    }
+    base += "_W" + std::to_string(w_);
+    return base;
+  }
+  void genCode() override;
+
+ private:
+  void loadCoefs();
+  void blockCode();
+
+  int w_;
+  KernelType type_;
+  reg64_t param_coefs{abi_param1};
+  reg64_t param_grad{abi_param2};
+  reg64_t param_rows{abi_param3};
+  reg64_t param_param{abi_param4};
+  reg64_t param_acc1{abi_param5};
+  // the second accumulator of Adam and FTRL, the attr of Adagrad
+  reg64_t param_acc2{abi_param6};
+
+  reg64_t reg_ptr_rows_end{r10};
+  reg64_t reg_ptr_param_i{r11};
+  reg64_t reg_ptr_acc1_i{r12};
+  reg64_t reg_ptr_acc2_i{r13};
+  reg64_t reg_block_num{r14};
+  reg64_t reg_tmp{r15};
+};
+
+}  // namespace gen
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
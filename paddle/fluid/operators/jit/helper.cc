@@ -64,7 +64,11 @@ const char* to_string(KernelType kt) {
     ONE_CASE(kStrideASum);
     ONE_CASE(kSoftmax);
     ONE_CASE(kEmbSeqPool);
+    ONE_CASE(kEmbSeqPoolCVM);
     ONE_CASE(kSgd);
+    ONE_CASE(kAdam);
+    ONE_CASE(kAdagrad);
+    ONE_CASE(kFtrl);
     default:
       PADDLE_THROW(platform::errors::Unimplemented(
           "JIT kernel do not support type: %d.", kt));
@@ -275,6 +275,15 @@ inline std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
+inline std::ostream& operator<<(std::ostream& os,
+                                const emb_seq_pool_cvm_attr_t& attr) {
+  os << "table_height[" << attr.table_height << "],table_width["
+     << attr.table_width << "],index_height[" << attr.index_height
+     << "],index_width[" << attr.index_width << "],output_width["
+     << attr.out_width << "],use_cvm[" << attr.use_cvm << "]";
+  return os;
+}
+
 inline std::ostream& operator<<(std::ostream& os, const sgd_attr_t& attr) {
   os << "param_height[" << attr.param_height << "],param_width["
      << attr.param_width << "],grad_height[" << attr.grad_height
@@ -283,6 +292,13 @@ inline std::ostream& operator<<(std::ostream& os, const sgd_attr_t& attr) {
   return os;
 }
 
+inline std::ostream& operator<<(std::ostream& os, const opt_attr_t& attr) {
+  os << "param_height[" << attr.param_height << "],width[" << attr.width
+     << "],selected_rows_size[" << attr.selected_rows_size << "],lr_power["
+     << attr.lr_power << "]";
+  return os;
+}
+
 inline std::ostream& operator<<(std::ostream& os, const matmul_attr_t& attr) {
   os << "M[" << attr.m << "],N[" << attr.n << "],K[" << attr.k << "]";
   return os;
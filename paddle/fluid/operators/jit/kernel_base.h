@@ -24,8 +24,12 @@ namespace jit {
 typedef enum {
   kNone = 0,
   // sort by alphabet
-  kCRFDecoding = 1,
-  kEmbSeqPool = 2,
+  kAdagrad = 1,
+  kAdam,
+  kCRFDecoding,
+  kEmbSeqPool,
+  kEmbSeqPoolCVM,
+  kFtrl,
   kGRUH1,
   kGRUHtPart1,
   kGRUHtPart2,
@@ -246,6 +250,36 @@ struct EmbSeqPoolTuple {
                             const emb_seq_pool_attr_t*);
 };
 
+// The sum pooled embeddings with the CVM transform of cvm_op, the first two
+// columns of table are show and click. With use_cvm, they are turned into
+// log(show + 1) and log(click + 1) - log(show + 1), otherwise they are
+// dropped from out.
+typedef struct emb_seq_pool_cvm_attr_s {
+  int64_t table_height, table_width;
+  int64_t index_height, index_width;
+  int64_t out_width;
+  bool use_cvm;
+  emb_seq_pool_cvm_attr_s() = default;
+  explicit emb_seq_pool_cvm_attr_s(int64_t tbl_height, int64_t tbl_width,
+                                   int64_t idx_height, int64_t idx_width,
+                                   int64_t output_width, bool cvm = true)
+      : table_height(tbl_height),
+        table_width(tbl_width),
+        index_height(idx_height),
+        index_width(idx_width),
+        out_width(output_width),
+        use_cvm(cvm) {}
+} emb_seq_pool_cvm_attr_t;
+
+template <typename T>
+struct EmbSeqPoolCVMTuple {
+  static constexpr KernelType kernel_type = kEmbSeqPoolCVM;
+  typedef T data_type;
+  typedef emb_seq_pool_cvm_attr_t attr_type;
+  typedef void (*func_type)(const T*, const int64_t*, T*,
+                            const emb_seq_pool_cvm_attr_t*);
+};
+
 typedef struct sgd_attr_s {
   int64_t param_height, param_width;
   int64_t grad_height, grad_width;
@@ -269,6 +303,54 @@ struct SgdTuple {
                             const sgd_attr_t*);
 };
 
+// The sparse optimizers update the selected rows of param and its
+// accumulators in place, in a single pass over each row.
+typedef struct opt_attr_s {
+  int64_t param_height, width;
+  int64_t selected_rows_size;
+  float lr_power{-0.5f};  // only used by kFtrl
+  opt_attr_s() = default;
+  explicit opt_attr_s(int64_t param_h, int64_t w, int64_t selected_rows_sz,
+                      float lr_pow = -0.5f)
+      : param_height(param_h),
+        width(w),
+        selected_rows_size(selected_rows_sz),
+        lr_power(lr_pow) {}
+} opt_attr_t;
+
+// coefs: lr_t, beta1, beta2, epsilon_t
+// grad, rows, param, moment1, moment2, attr
+template <typename T>
+struct AdamTuple {
+  static constexpr KernelType kernel_type = kAdam;
+  typedef T data_type;
+  typedef opt_attr_t attr_type;
+  typedef void (*func_type)(const T*, const T*, const int64_t*, T*, T*, T*,
+                            const opt_attr_t*);
+};
+
+// coefs: lr, epsilon
+// grad, rows, param, moment, attr
+template <typename T>
+struct AdagradTuple {
+  static constexpr KernelType kernel_type = kAdagrad;
+  typedef T data_type;
+  typedef opt_attr_t attr_type;
+  typedef void (*func_type)(const T*, const T*, const int64_t*, T*, T*,
+                            const opt_attr_t*);
+};
+
+// coefs: lr, l1, l2
+// grad, rows, param, squared_accumulator, linear_accumulator, attr
+template <typename T>
+struct FtrlTuple {
+  static constexpr KernelType kernel_type = kFtrl;
+  typedef T data_type;
+  typedef opt_attr_t attr_type;
+  typedef void (*func_type)(const T*, const T*, const int64_t*, T*, T*, T*,
+                            const opt_attr_t*);
+};
+
 typedef struct matmul_attr_s {
   int m, n, k;
   void* packed_weight{nullptr};
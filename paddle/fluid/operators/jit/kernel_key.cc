@@ -14,6 +14,7 @@
 
 #include "paddle/fluid/operators/jit/kernel_key.h"
 #include <xxhash.h>  // XXH64: 13.8 GB/s
+#include <cstring>
 #include "paddle/fluid/platform/enforce.h"
 
 namespace paddle {
@@ -59,11 +60,26 @@ int64_t JitCodeKey<emb_seq_pool_attr_t>(const emb_seq_pool_attr_t& attr) {
   return attr.table_width;
 }
 
+template <>
+int64_t JitCodeKey<emb_seq_pool_cvm_attr_t>(
+    const emb_seq_pool_cvm_attr_t& attr) {
+  int64_t keys[2] = {attr.table_width, static_cast<int64_t>(attr.use_cvm)};
+  return XXH64(keys, sizeof(int64_t) * 2, 0);
+}
+
 template <>
 int64_t JitCodeKey<sgd_attr_t>(const sgd_attr_t& attr) {
   return attr.grad_width;
 }
 
+template <>
+int64_t JitCodeKey<opt_attr_t>(const opt_attr_t& attr) {
+  // lr_power changes the code of kFtrl
+  int64_t keys[2] = {attr.width, 0};
+  memcpy(&keys[1], &attr.lr_power, sizeof(float));
+  return XXH64(keys, sizeof(int64_t) * 2, 0);
+}
+
 }  // namespace jit
 }  // namespace operators
 }  // namespace paddle
@@ -0,0 +1,107 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/more/intrinsic/embseqpool_cvm.h"
+#include <algorithm>
+#include <cmath>
+#include "paddle/fluid/operators/jit/registry.h"
+#include "paddle/fluid/platform/cpu_info.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+// Each group of up to kMaxRegs YMM blocks of an output item is summed over
+// all the index rows in registers and stored once, then show and click of
+// the item are transformed.
+void EmbSeqPoolCVM(const float* table, const int64_t* idx, float* out,
+                   const emb_seq_pool_cvm_attr_t* attr) {
+  constexpr int kMaxRegs = 8;
+  constexpr int block = YMM_FLOAT_BLOCK;
+  const int64_t cvm_offset = attr->use_cvm ? 0 : 2;
+  const int64_t item_width = attr->table_width - cvm_offset;
+  PADDLE_ENFORCE_EQ(
+      item_width * attr->index_width, attr->out_width,
+      platform::errors::InvalidArgument(
+          "The attribute (table_width - cvm_offset) * index_width of "
+          "EmbSeqPoolCVM should be equal to out_width. But it is %d and "
+          "out_width is %d.",
+          item_width * attr->index_width, attr->out_width));
+  const int64_t len = attr->index_height * attr->index_width;
+  for (int64_t i = 0; i < len; ++i) {
+    PADDLE_ENFORCE_EQ(
+        idx[i] >= 0 && idx[i] < attr->table_height, true,
+        platform::errors::InvalidArgument(
+            "The idx of EmbSeqPoolCVM should be in [0, table_height). But "
+            "%dth of idx is %d and table_height is %d.",
+            i, idx[i], attr->table_height));
+  }
+
+  const int64_t end = item_width - item_width % block;
+  __m256 acc[kMaxRegs];
+  for (int64_t w = 0; w < attr->index_width; ++w) {
+    float* o = out + w * item_width;
+    const float* src = table + cvm_offset;
+    int64_t j = 0;
+    while (j < end) {
+      int num_regs =
+          static_cast<int>(std::min<int64_t>(kMaxRegs, (end - j) / block));
+      for (int r = 0; r < num_regs; ++r) {
+        acc[r] = _mm256_setzero_ps();
+      }
+      for (int64_t h = 0; h < attr->index_height; ++h) {
+        const float* row =
+            src + idx[h * attr->index_width + w] * attr->table_width + j;
+        for (int r = 0; r < num_regs; ++r) {
+          acc[r] = _mm256_add_ps(acc[r], _mm256_loadu_ps(row + r * block));
+        }
+      }
+      for (int r = 0; r < num_regs; ++r) {
+        _mm256_storeu_ps(o + j + r * block, acc[r]);
+      }
+      j += num_regs * block;
+    }
+    for (; j < item_width; ++j) {
+      float sum = 0.f;
+      for (int64_t h = 0; h < attr->index_height; ++h) {
+        sum += src[idx[h * attr->index_width + w] * attr->table_width + j];
+      }
+      o[j] = sum;
+    }
+    if (attr->use_cvm) {
+      o[0] = std::log(o[0] + 1.f);
+      o[1] = std::log(o[1] + 1.f) - o[0];
+    }
+  }
+}
+
+bool EmbSeqPoolCVMKernel::CanBeUsed(
+    const emb_seq_pool_cvm_attr_t& attr) const {
+  return platform::MayIUse(platform::avx) &&
+         attr.table_width - (attr.use_cvm ? 0 : 2) >= YMM_FLOAT_BLOCK;
+}
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
+
+namespace intrinsic = paddle::operators::jit::more::intrinsic;
+
+REGISTER_JITKERNEL_MORE(kEmbSeqPoolCVM, intrinsic,
+                        intrinsic::EmbSeqPoolCVMKernel);
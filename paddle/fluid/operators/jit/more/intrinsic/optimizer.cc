@@ -0,0 +1,178 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/more/intrinsic/optimizer.h"
+#include <cmath>
+#include "paddle/fluid/operators/jit/refer/refer.h"
+#include "paddle/fluid/operators/jit/registry.h"
+#include "paddle/fluid/platform/cpu_info.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+void Adam(const float* coefs, const float* grad, const int64_t* rows,
+          float* param, float* mom1, float* mom2, const opt_attr_t* attr) {
+  refer::CheckOptRows("Adam", rows, attr);
+  const float lr = coefs[0], beta1 = coefs[1], beta2 = coefs[2],
+              eps = coefs[3];
+  const int64_t w = attr->width;
+  const int64_t end = w - w % YMM_FLOAT_BLOCK;
+  const __m256 lr_v = _mm256_set1_ps(lr);
+  const __m256 beta1_v = _mm256_set1_ps(beta1);
+  const __m256 beta2_v = _mm256_set1_ps(beta2);
+  const __m256 one_beta1_v = _mm256_set1_ps(1.f - beta1);
+  const __m256 one_beta2_v = _mm256_set1_ps(1.f - beta2);
+  const __m256 eps_v = _mm256_set1_ps(eps);
+  for (int64_t i = 0; i < attr->selected_rows_size; ++i) {
+    const float* g = grad + i * w;
+    float* p = param + rows[i] * w;
+    float* m1 = mom1 + rows[i] * w;
+    float* m2 = mom2 + rows[i] * w;
+    int64_t j = 0;
+    for (; j < end; j += YMM_FLOAT_BLOCK) {
+      __m256 g_v = _mm256_loadu_ps(g + j);
+      __m256 m1_v =
+          _mm256_add_ps(_mm256_mul_ps(beta1_v, _mm256_loadu_ps(m1 + j)),
+                        _mm256_mul_ps(one_beta1_v, g_v));
+      __m256 m2_v = _mm256_add_ps(
+          _mm256_mul_ps(beta2_v, _mm256_loadu_ps(m2 + j)),
+          _mm256_mul_ps(one_beta2_v, _mm256_mul_ps(g_v, g_v)));
+      __m256 p_v = _mm256_sub_ps(
+          _mm256_loadu_ps(p + j),
+          _mm256_div_ps(_mm256_mul_ps(lr_v, m1_v),
+                        _mm256_add_ps(_mm256_sqrt_ps(m2_v), eps_v)));
+      _mm256_storeu_ps(m1 + j, m1_v);
+      _mm256_storeu_ps(m2 + j, m2_v);
+      _mm256_storeu_ps(p + j, p_v);
+    }
+    for (; j < w; ++j) {
+      m1[j] = beta1 * m1[j] + (1.f - beta1) * g[j];
+      m2[j] = beta2 * m2[j] + (1.f - beta2) * g[j] * g[j];
+      p[j] -= lr * m1[j] / (std::sqrt(m2[j]) + eps);
+    }
+  }
+}
+
+void Adagrad(const float* coefs, const float* grad, const int64_t* rows,
+             float* param, float* moment, const opt_attr_t* attr) {
+  refer::CheckOptRows("Adagrad", rows, attr);
+  const float lr = coefs[0], eps = coefs[1];
+  const int64_t w = attr->width;
+  const int64_t end = w - w % YMM_FLOAT_BLOCK;
+  const __m256 lr_v = _mm256_set1_ps(lr);
+  const __m256 eps_v = _mm256_set1_ps(eps);
+  for (int64_t i = 0; i < attr->selected_rows_size; ++i) {
+    const float* g = grad + i * w;
+    float* p = param + rows[i] * w;
+    float* m = moment + rows[i] * w;
+    int64_t j = 0;
+    for (; j < end; j += YMM_FLOAT_BLOCK) {
+      __m256 g_v = _mm256_loadu_ps(g + j);
+      __m256 m_v =
+          _mm256_add_ps(_mm256_loadu_ps(m + j), _mm256_mul_ps(g_v, g_v));
+      __m256 p_v = _mm256_sub_ps(
+          _mm256_loadu_ps(p + j),
+          _mm256_div_ps(_mm256_mul_ps(lr_v, g_v),
+                        _mm256_add_ps(_mm256_sqrt_ps(m_v), eps_v)));
+      _mm256_storeu_ps(m + j, m_v);
+      _mm256_storeu_ps(p + j, p_v);
+    }
+    for (; j < w; ++j) {
+      m[j] += g[j] * g[j];
+      p[j] -= lr * g[j] / (std::sqrt(m[j]) + eps);
+    }
+  }
+}
+
+// only lr_power == -0.5, see FtrlKernel::CanBeUsed
+void Ftrl(const float* coefs, const float* grad, const int64_t* rows,
+          float* param, float* sq_accum, float* lin_accum,
+          const opt_attr_t* attr) {
+  refer::CheckOptRows("Ftrl", rows, attr);
+  const float lr = coefs[0], l1 = coefs[1], l2 = coefs[2];
+  const int64_t w = attr->width;
+  const int64_t end = w - w % YMM_FLOAT_BLOCK;
+  const __m256 lr_v = _mm256_set1_ps(lr);
+  const __m256 l1_v = _mm256_set1_ps(l1);
+  const __m256 two_l2_v = _mm256_set1_ps(2.f * l2);
+  const __m256 sign_v = _mm256_set1_ps(-0.f);
+  for (int64_t i = 0; i < attr->selected_rows_size; ++i) {
+    const float* g = grad + i * w;
+    float* p = param + rows[i] * w;
+    float* s = sq_accum + rows[i] * w;
+    float* lin = lin_accum + rows[i] * w;
+    int64_t j = 0;
+    for (; j < end; j += YMM_FLOAT_BLOCK) {
+      __m256 g_v = _mm256_loadu_ps(g + j);
+      __m256 s_v = _mm256_loadu_ps(s + j);
+      __m256 new_v = _mm256_add_ps(s_v, _mm256_mul_ps(g_v, g_v));
+      __m256 new_sqrt_v = _mm256_sqrt_ps(new_v);
+      __m256 lin_v = _mm256_sub_ps(
+          _mm256_add_ps(_mm256_loadu_ps(lin + j), g_v),
+          _mm256_mul_ps(
+              _mm256_div_ps(_mm256_sub_ps(new_sqrt_v, _mm256_sqrt_ps(s_v)),
+                            lr_v),
+              _mm256_loadu_ps(p + j)));
+      // (sign(lin) * l1 - lin) / (sqrt(new) / lr + 2 * l2) if |lin| > l1
+      __m256 x_v = _mm256_sub_ps(
+          _mm256_or_ps(l1_v, _mm256_and_ps(lin_v, sign_v)), lin_v);
+      __m256 y_v = _mm256_add_ps(_mm256_div_ps(new_sqrt_v, lr_v), two_l2_v);
+      __m256 mask_v =
+          _mm256_cmp_ps(_mm256_andnot_ps(sign_v, lin_v), l1_v, _CMP_GT_OQ);
+      _mm256_storeu_ps(p + j, _mm256_and_ps(_mm256_div_ps(x_v, y_v), mask_v));
+      _mm256_storeu_ps(lin + j, lin_v);
+      _mm256_storeu_ps(s + j, new_v);
+    }
+    for (; j < w; ++j) {
+      float new_accum = s[j] + g[j] * g[j];
+      float new_sqrt = std::sqrt(new_accum);
+      lin[j] += g[j] - (new_sqrt - std::sqrt(s[j])) / lr * p[j];
+      if (std::fabs(lin[j]) > l1) {
+        float l1_sign = lin[j] >= 0 ? l1 : -l1;
+        p[j] = (l1_sign - lin[j]) / (new_sqrt / lr + 2.f * l2);
+      } else {
+        p[j] = 0.f;
+      }
+      s[j] = new_accum;
+    }
+  }
+}
+
+bool AdamKernel::CanBeUsed(const opt_attr_t& attr) const {
+  return platform::MayIUse(platform::avx) && attr.width >= YMM_FLOAT_BLOCK;
+}
+
+bool AdagradKernel::CanBeUsed(const opt_attr_t& attr) const {
+  return platform::MayIUse(platform::avx) && attr.width >= YMM_FLOAT_BLOCK;
+}
+
+bool FtrlKernel::CanBeUsed(const opt_attr_t& attr) const {
+  return platform::MayIUse(platform::avx) && attr.width >= YMM_FLOAT_BLOCK &&
+         attr.lr_power == -0.5f;
+}
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
+
+namespace intrinsic = paddle::operators::jit::more::intrinsic;
+
+REGISTER_JITKERNEL_MORE(kAdam, intrinsic, intrinsic::AdamKernel);
+REGISTER_JITKERNEL_MORE(kAdagrad, intrinsic, intrinsic::AdagradKernel);
+REGISTER_JITKERNEL_MORE(kFtrl, intrinsic, intrinsic::FtrlKernel);
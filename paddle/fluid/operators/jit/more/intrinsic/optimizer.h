@@ -0,0 +1,61 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#pragma once
+
+#include "paddle/fluid/operators/jit/kernel_base.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+void Adam(const float* coefs, const float* grad, const int64_t* rows,
+          float* param, float* mom1, float* mom2, const opt_attr_t* attr);
+
+void Adagrad(const float* coefs, const float* grad, const int64_t* rows,
+             float* param, float* moment, const opt_attr_t* attr);
+
+void Ftrl(const float* coefs, const float* grad, const int64_t* rows,
+          float* param, float* sq_accum, float* lin_accum,
+          const opt_attr_t* attr);
+
+class AdamKernel : public KernelMore<AdamTuple<float>> {
+ public:
+  AdamKernel() { this->func = Adam; }
+  bool CanBeUsed(const typename AdamTuple<float>::attr_type&) const override;
+  const char* ImplType() const override { return "Intrinsic"; }
+};
+
+class AdagradKernel : public KernelMore<AdagradTuple<float>> {
+ public:
+  AdagradKernel() { this->func = Adagrad; }
+  bool CanBeUsed(
+      const typename AdagradTuple<float>::attr_type&) const override;
+  const char* ImplType() const override { return "Intrinsic"; }
+};
+
+class FtrlKernel : public KernelMore<FtrlTuple<float>> {
+ public:
+  FtrlKernel() { this->func = Ftrl; }
+  bool CanBeUsed(const typename FtrlTuple<float>::attr_type&) const override;
+  const char* ImplType() const override { return "Intrinsic"; }
+};
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
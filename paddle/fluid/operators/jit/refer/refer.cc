@@ -55,7 +55,11 @@ REGISTER_REFER_KERNEL(HSum);
 REGISTER_REFER_KERNEL(StrideASum);
 REGISTER_REFER_KERNEL(Softmax);
 REGISTER_REFER_KERNEL(EmbSeqPool);
+REGISTER_REFER_KERNEL(EmbSeqPoolCVM);
 REGISTER_REFER_KERNEL(Sgd);
+REGISTER_REFER_KERNEL(Adam);
+REGISTER_REFER_KERNEL(Adagrad);
+REGISTER_REFER_KERNEL(Ftrl);
 REGISTER_REFER_KERNEL(VBroadcast);
 
 #undef REGISTER_REFER_KERNEL
@@ -503,6 +503,58 @@ void EmbSeqPool(const T* table, const int64_t* idx, T* out,
   }
 }
 
+// embedding seq pool with the CVM transform
+// table is a matrix with (tbl_h, tbl_w), whose first two columns are show and
+// click
+// idx is a matrix with (idx_h, idx_w)
+// output is a vector with length (tbl_w - cvm_offset) * idx_w, where
+// cvm_offset is 0 with use_cvm and 2 without
+template <typename T>
+void EmbSeqPoolCVM(const T* table, const int64_t* idx, T* out,
+                   const emb_seq_pool_cvm_attr_t* attr) {
+  const int64_t cvm_offset = attr->use_cvm ? 0 : 2;
+  const int64_t item_width = attr->table_width - cvm_offset;
+  PADDLE_ENFORCE_GE(attr->table_width, 2,
+                    platform::errors::InvalidArgument(
+                        "The attribute table_width of EmbSeqPoolCVM should "
+                        "be at least 2 for show and click. But table_width "
+                        "is %d.",
+                        attr->table_width));
+  PADDLE_ENFORCE_EQ(
+      item_width * attr->index_width, attr->out_width,
+      platform::errors::InvalidArgument(
+          "The attribute (table_width - cvm_offset) * index_width of "
+          "EmbSeqPoolCVM should be equal to out_width. But it is %d and "
+          "out_width is %d.",
+          item_width * attr->index_width, attr->out_width));
+
+  for (int64_t w = 0; w < attr->index_width; ++w) {
+    T* o = out + w * item_width;
+    std::memset(o, 0, item_width * sizeof(T));
+    for (int64_t h = 0; h < attr->index_height; ++h) {
+      int64_t i = h * attr->index_width + w;
+      PADDLE_ENFORCE_LT(
+          idx[i], attr->table_height,
+          platform::errors::InvalidArgument(
+              "The idx shoud be lower than the attribute table_height of "
+              "EmbSeqPoolCVM. But %dth of idx is %d and table_height is %d.",
+              i, idx[i], attr->table_height));
+      PADDLE_ENFORCE_GE(idx[i], 0, platform::errors::InvalidArgument(
+                                       "The idx shoud be equal to or larger "
+                                       "than the 0. But %dth of idx is %d.",
+                                       i, idx[i]));
+      const T* row = table + idx[i] * attr->table_width + cvm_offset;
+      for (int64_t j = 0; j < item_width; ++j) {
+        o[j] += row[j];
+      }
+    }
+    if (attr->use_cvm) {
+      o[0] = std::log(o[0] + 1);
+      o[1] = std::log(o[1] + 1) - o[0];
+    }
+  }
+}
+
 // SGD algorithm:
 // lr is pointor of learning rate scalar
 // param is an input matrix with (param_h, param_w)
@@ -552,6 +604,117 @@ void Sgd(const T* lr, const T* param, const T* grad, const int64_t* rows,
   }
 }
 
+// Check the selected rows of the sparse optimizers.
+inline void CheckOptRows(const char* name, const int64_t* rows,
+                         const opt_attr_t* attr) {
+  for (int64_t i = 0; i < attr->selected_rows_size; ++i) {
+    PADDLE_ENFORCE_LT(rows[i], attr->param_height,
+                      platform::errors::InvalidArgument(
+                          "The rows of %s should be less than the attribute "
+                          "param_height. But %dth of rows is %d and "
+                          "param_height is %d.",
+                          name, i, rows[i], attr->param_height));
+    PADDLE_ENFORCE_GE(rows[i], 0, platform::errors::InvalidArgument(
+                                      "The rows of %s should be equal to or "
+                                      "larger than 0. But %dth of rows is %d.",
+                                      name, i, rows[i]));
+  }
+}
+
+// Sparse Adam algorithm, in place:
+// coefs is {lr_t, beta1, beta2, epsilon_t}, where lr_t and epsilon_t already
+// carry the bias correction of this step
+// grad is an input matrix with (selected_rows_size, width)
+// param, mom1 and mom2 are matrices with (param_height, width)
+// for each j of the selected row rows[i]:
+//   mom1 = beta1 * mom1 + (1 - beta1) * grad[i][j]
+//   mom2 = beta2 * mom2 + (1 - beta2) * grad[i][j]^2
+//   param -= lr_t * mom1 / (sqrt(mom2) + epsilon_t)
+template <typename T>
+void Adam(const T* coefs, const T* grad, const int64_t* rows, T* param,
+          T* mom1, T* mom2, const opt_attr_t* attr) {
+  CheckOptRows("Adam", rows, attr);
+  const T lr = coefs[0], beta1 = coefs[1], beta2 = coefs[2], eps = coefs[3];
+  const int64_t w = attr->width;
+  for (int64_t i = 0; i < attr->selected_rows_size; ++i) {
+    const T* g = grad + i * w;
+    T* p = param + rows[i] * w;
+    T* m1 = mom1 + rows[i] * w;
+    T* m2 = mom2 + rows[i] * w;
+    for (int64_t j = 0; j < w; ++j) {
+      m1[j] = beta1 * m1[j] + (1 - beta1) * g[j];
+      m2[j] = beta2 * m2[j] + (1 - beta2) * g[j] * g[j];
+      p[j] -= lr * m1[j] / (std::sqrt(m2[j]) + eps);
+    }
+  }
+}
+
+// Sparse Adagrad algorithm, in place:
+// coefs is {lr, epsilon}
+// for each j of the selected row rows[i]:
+//   moment += grad[i][j]^2
+//   param -= lr * grad[i][j] / (sqrt(moment) + epsilon)
+template <typename T>
+void Adagrad(const T* coefs, const T* grad, const int64_t* rows, T* param,
+             T* moment, const opt_attr_t* attr) {
+  CheckOptRows("Adagrad", rows, attr);
+  const T lr = coefs[0], eps = coefs[1];
+  const int64_t w = attr->width;
+  for (int64_t i = 0; i < attr->selected_rows_size; ++i) {
+    const T* g = grad + i * w;
+    T* p = param + rows[i] * w;
+    T* m = moment + rows[i] * w;
+    for (int64_t j = 0; j < w; ++j) {
+      m[j] += g[j] * g[j];
+      p[j] -= lr * g[j] / (std::sqrt(m[j]) + eps);
+    }
+  }
+}
+
+// Sparse FTRL algorithm, in place:
+// coefs is {lr, l1, l2}, lr_power is in attr
+// for each j of the selected row rows[i], with g = grad[i][j]:
+//   new_accum = squared_accum + g^2
+//   linear_accum += g - (new_accum^-lr_power - squared_accum^-lr_power)
+//                       / lr * param
+//   param = |linear_accum| > l1 ?
+//           (sign(linear_accum) * l1 - linear_accum) /
+//           (new_accum^-lr_power / lr + 2 * l2) : 0
+//   squared_accum = new_accum
+template <typename T>
+void Ftrl(const T* coefs, const T* grad, const int64_t* rows, T* param,
+          T* sq_accum, T* lin_accum, const opt_attr_t* attr) {
+  CheckOptRows("Ftrl", rows, attr);
+  const T lr = coefs[0], l1 = coefs[1], l2 = coefs[2];
+  const T lr_power = static_cast<T>(attr->lr_power);
+  const int64_t w = attr->width;
+  for (int64_t i = 0; i < attr->selected_rows_size; ++i) {
+    const T* g = grad + i * w;
+    T* p = param + rows[i] * w;
+    T* s = sq_accum + rows[i] * w;
+    T* lin = lin_accum + rows[i] * w;
+    for (int64_t j = 0; j < w; ++j) {
+      T new_accum = s[j] + g[j] * g[j];
+      T new_pow, old_pow;
+      if (lr_power == static_cast<T>(-0.5)) {
+        new_pow = std::sqrt(new_accum);
+        old_pow = std::sqrt(s[j]);
+      } else {
+        new_pow = std::pow(new_accum, -lr_power);
+        old_pow = std::pow(s[j], -lr_power);
+      }
+      lin[j] += g[j] - (new_pow - old_pow) / lr * p[j];
+      if (std::fabs(lin[j]) > l1) {
+        T l1_sign = lin[j] >= 0 ? l1 : -l1;
+        p[j] = (l1_sign - lin[j]) / (new_pow / lr + 2 * l2);
+      } else {
+        p[j] = static_cast<T>(0);
+      }
+      s[j] = new_accum;
+    }
+  }
+}
+
 #define DECLARE_REFER_KERNEL(name)                          \
   template <typename T>                                     \
   class name##Kernel : public ReferKernel<name##Tuple<T>> { \
@@ -603,7 +766,11 @@ DECLARE_REFER_KERNEL(SeqPool);
 DECLARE_REFER_KERNEL(MatMul);
 DECLARE_REFER_KERNEL(Softmax);
 DECLARE_REFER_KERNEL(EmbSeqPool);
+DECLARE_REFER_KERNEL(EmbSeqPoolCVM);
 DECLARE_REFER_KERNEL(Sgd);
+DECLARE_REFER_KERNEL(Adam);
+DECLARE_REFER_KERNEL(Adagrad);
+DECLARE_REFER_KERNEL(Ftrl);
 DECLARE_REFER_KERNEL(VBroadcast);
 
 #undef DECLARE_REFER_KERNEL
@@ -673,6 +673,63 @@ void TestKernelEmbSeqPool() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void TestKernelEmbSeqPoolCVM() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  int64_t tbl_h = 1e4;
+  auto test_sizes = TestSizes();
+  test_sizes.erase(std::remove(test_sizes.begin(), test_sizes.end(), 1000));
+  for (int tbl_w : test_sizes) {
+    if (tbl_w < 2) continue;
+    std::vector<T> table(tbl_h * tbl_w);
+    // show and click are counts, keep them positive
+    RandomVec<T>(tbl_h * tbl_w, table.data(), 0.f, 2.f);
+    const T* table_data = table.data();
+    for (bool use_cvm : {true, false}) {
+      int64_t item_w = use_cvm ? tbl_w : tbl_w - 2;
+      for (int idx_w : {1, 2, 10, 16}) {
+        for (int idx_h : {1, 2, 9, 13, 16}) {
+          auto ref = jit::GetReferFunc<KernelTuple>();
+          EXPECT_TRUE(ref != nullptr);
+          std::vector<int64_t> idx(idx_h * idx_w);
+          RandomVec<int64_t>(idx_h * idx_w, idx.data(), 0, tbl_h - 1);
+          int64_t out_w = item_w * idx_w;
+          std::vector<T> oref(out_w);
+          const int64_t* idx_data = idx.data();
+          T* o_data = oref.data();
+          jit::emb_seq_pool_cvm_attr_t attr(tbl_h, tbl_w, idx_h, idx_w, out_w,
+                                            use_cvm);
+          ref(table_data, idx_data, o_data, &attr);
+
+          auto verifier = [](const typename KernelTuple::func_type tgt,
+                             const std::vector<T>& table,
+                             const std::vector<int64_t>& idx,
+                             const std::vector<T>& oref,
+                             const typename KernelTuple::attr_type& attr) {
+            EXPECT_TRUE(tgt != nullptr);
+            EXPECT_EQ(table.size(), static_cast<size_t>(attr.table_height *
+                                                        attr.table_width));
+            EXPECT_EQ(idx.size(), static_cast<size_t>(attr.index_height *
+                                                      attr.index_width));
+            EXPECT_EQ(oref.size(), static_cast<size_t>(attr.out_width));
+            const T* table_data = table.data();
+            const int64_t* idx_data = idx.data();
+            const T* oref_data = oref.data();
+            int o_w = oref.size();
+            std::vector<T> out(o_w);
+            T* o_data = out.data();
+            tgt(table_data, idx_data, o_data, &attr);
+            ExpectEQ<T>(o_data, oref_data, o_w);
+          };
+          TestAllImpls<KernelTuple, PlaceType>(attr, verifier, table, idx, oref,
+                                               attr);
+        }
+      }
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void TestKernelMatMul() {
   using T = typename KernelTuple::data_type;
@@ -938,6 +995,114 @@ void TestKernelSgd() {
   }
 }
 
+// run a sparse optimizer kernel on param and its accumulators in data
+template <typename T>
+void RunSparseOpt(void (*func)(const T*, const T*, const int64_t*, T*, T*,
+                               const jit::opt_attr_t*),
+                  const T* coefs, const T* grad, const int64_t* rows,
+                  std::vector<std::vector<T>>* data,
+                  const jit::opt_attr_t* attr) {
+  func(coefs, grad, rows, (*data)[0].data(), (*data)[1].data(), attr);
+}
+
+template <typename T>
+void RunSparseOpt(void (*func)(const T*, const T*, const int64_t*, T*, T*, T*,
+                               const jit::opt_attr_t*),
+                  const T* coefs, const T* grad, const int64_t* rows,
+                  std::vector<std::vector<T>>* data,
+                  const jit::opt_attr_t* attr) {
+  func(coefs, grad, rows, (*data)[0].data(), (*data)[1].data(),
+       (*data)[2].data(), attr);
+}
+
+// data_lower are the lower bounds of param and the accumulators, the squared
+// accumulators should be positive
+template <typename KernelTuple, typename PlaceType>
+void TestKernelSparseOpt(const std::vector<typename KernelTuple::data_type>&
+                             coefs,
+                         const std::vector<typename KernelTuple::data_type>&
+                             data_lower,
+                         float lr_power = -0.5f) {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  const int param_h = 10;
+  for (int w : TestSizes()) {
+    for (int rows_size : {1, 4, param_h}) {
+      std::vector<int64_t> rows(param_h);
+      for (int i = 0; i < param_h; ++i) {
+        rows[i] = i;
+      }
+      std::random_shuffle(rows.begin(), rows.end());
+      rows.resize(rows_size);
+      std::vector<T> grad(rows_size * w);
+      RandomVec<T>(rows_size * w, grad.data());
+      std::vector<std::vector<T>> data(data_lower.size(),
+                                       std::vector<T>(param_h * w));
+      for (size_t i = 0; i < data.size(); ++i) {
+        RandomVec<T>(param_h * w, data[i].data(), data_lower[i]);
+      }
+
+      jit::opt_attr_t attr(param_h, w, rows_size, lr_power);
+      auto ref = jit::GetReferFunc<KernelTuple>();
+      EXPECT_TRUE(ref != nullptr);
+      std::vector<std::vector<T>> data_ref(data);
+      RunSparseOpt<T>(ref, coefs.data(), grad.data(), rows.data(), &data_ref,
+                      &attr);
+
+      auto verifier = [](const typename KernelTuple::func_type tgt,
+                         const std::vector<T>& coefs,
+                         const std::vector<T>& grad,
+                         const std::vector<int64_t>& rows,
+                         const std::vector<std::vector<T>>& data,
+                         const std::vector<std::vector<T>>& data_ref,
+                         const typename KernelTuple::attr_type& attr) {
+        EXPECT_TRUE(tgt != nullptr);
+        std::vector<std::vector<T>> data_tgt(data);
+        RunSparseOpt<T>(tgt, coefs.data(), grad.data(), rows.data(),
+                        &data_tgt, &attr);
+        // the rows not selected are not changed
+        for (size_t i = 0; i < data.size(); ++i) {
+          ExpectEQ<T>(data_tgt[i].data(), data_ref[i].data(),
+                      data_ref[i].size());
+        }
+      };
+      TestAllImpls<KernelTuple, PlaceType>(attr, verifier, coefs, grad, rows,
+                                           data, data_ref, attr);
+    }
+  }
+}
+
+template <typename KernelTuple, typename PlaceType>
+void TestKernelAdam() {
+  using T = typename KernelTuple::data_type;
+  // lr_t, beta1, beta2, epsilon_t; param, moment1, moment2
+  TestKernelSparseOpt<KernelTuple, PlaceType>(
+      {static_cast<T>(0.01), static_cast<T>(0.9), static_cast<T>(0.999),
+       static_cast<T>(1e-4)},
+      {static_cast<T>(-2), static_cast<T>(-2), static_cast<T>(0.1)});
+}
+
+template <typename KernelTuple, typename PlaceType>
+void TestKernelAdagrad() {
+  using T = typename KernelTuple::data_type;
+  // lr, epsilon; param, moment
+  TestKernelSparseOpt<KernelTuple, PlaceType>(
+      {static_cast<T>(0.01), static_cast<T>(1e-6)},
+      {static_cast<T>(-2), static_cast<T>(0.1)});
+}
+
+template <typename KernelTuple, typename PlaceType>
+void TestKernelFtrl() {
+  using T = typename KernelTuple::data_type;
+  // lr, l1, l2; param, squared_accumulator, linear_accumulator
+  for (float lr_power : {-0.5f, -0.25f}) {
+    TestKernelSparseOpt<KernelTuple, PlaceType>(
+        {static_cast<T>(0.1), static_cast<T>(0.5), static_cast<T>(0.1)},
+        {static_cast<T>(-2), static_cast<T>(0.1), static_cast<T>(-2)},
+        lr_power);
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void TestKernelVBroadcast() {
   using T = typename KernelTuple::data_type;
@@ -1147,8 +1312,10 @@ TEST(JITKernel_helper, attr) {
       << jit::to_string(jit::kVMul) << jit::to_string(jit::kVRelu)
       << jit::to_string(jit::kVScal) << jit::to_string(jit::kSgd)
       << jit::to_string(jit::kVSigmoid) << jit::to_string(jit::kVSquare)
-      << jit::to_string(jit::kVSub) << jit::to_string(jit::kVTanh);
-  EXPECT_EQ(out.str().size(), 234UL);
+      << jit::to_string(jit::kVSub) << jit::to_string(jit::kVTanh)
+      << jit::to_string(jit::kAdam) << jit::to_string(jit::kAdagrad)
+      << jit::to_string(jit::kFtrl) << jit::to_string(jit::kEmbSeqPoolCVM);
+  EXPECT_EQ(out.str().size(), 266UL);
 
   // SeqPoolTypes
   out.str("");
@@ -1178,10 +1345,18 @@ TEST(JITKernel_helper, attr) {
   out << jit::emb_seq_pool_attr_t(1, 2, 3, 4, 5, jit::SeqPoolType::kAvg);
   EXPECT_EQ(out.str().size(), 93UL);
 
+  out.str("");
+  out << jit::emb_seq_pool_cvm_attr_t(1, 2, 3, 4, 5, true);
+  EXPECT_EQ(out.str().size(), 88UL);
+
   out.str("");
   out << jit::sgd_attr_t(1, 2, 3, 4, 5);
   EXPECT_EQ(out.str().size(), 81UL);
 
+  out.str("");
+  out << jit::opt_attr_t(1, 2, 3);
+  EXPECT_EQ(out.str().size(), 61UL);
+
   out.str("");
   out << jit::matmul_attr_t(1, 2, 3);
   EXPECT_EQ(out.str().size(), 14UL);
@@ -1315,6 +1490,23 @@ TEST(JITKernel_key, sgd) {
   EXPECT_TRUE(key4 != key5);
 }
 
+TEST(JITKernel_key, opt) {
+  jit::opt_attr_t attr1(1, 8, 3);
+  jit::opt_attr_t attr2(9, 8, 7);
+  jit::opt_attr_t attr3(1, 16, 3);
+  jit::opt_attr_t attr4(1, 8, 3, -0.25f);
+
+  auto key1 = jit::JitCodeKey<jit::opt_attr_t>(attr1);
+  auto key2 = jit::JitCodeKey<jit::opt_attr_t>(attr2);
+  auto key3 = jit::JitCodeKey<jit::opt_attr_t>(attr3);
+  auto key4 = jit::JitCodeKey<jit::opt_attr_t>(attr4);
+
+  EXPECT_TRUE(key1 == key2);
+  EXPECT_TRUE(key1 != key3);
+  EXPECT_TRUE(key1 != key4);
+  EXPECT_TRUE(key3 != key4);
+}
+
 // test kernerls
 #define TestKernelVMul TestKernelXYZN
 #define TestKernelVAdd TestKernelXYZN
@@ -1380,9 +1572,13 @@ TEST_CPU_KERNEL(CRFDecoding);
 
 TEST_CPU_KERNEL(SeqPool);
 TEST_CPU_KERNEL(EmbSeqPool);
+TEST_CPU_KERNEL(EmbSeqPoolCVM);
 TEST_CPU_KERNEL(MatMul);
 TEST_CPU_KERNEL(Softmax);
 TEST_CPU_KERNEL(Sgd);
+TEST_CPU_KERNEL(Adam);
+TEST_CPU_KERNEL(Adagrad);
+TEST_CPU_KERNEL(Ftrl);
 TEST_CPU_KERNEL(VBroadcast);
 
 TEST_CPU_KERNEL(StrideASum);
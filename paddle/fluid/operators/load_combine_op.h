@@ -20,6 +20,7 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/data_type.h"
 #include "paddle/fluid/framework/data_type_transform.h"
+#include "paddle/fluid/framework/mmap_params.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/platform/device_context.h"
 
@@ -40,7 +41,10 @@ class LoadCombineOpKernel : public framework::OpKernel<T> {
                           "The number of variables to be loaded is %d, expect "
                           "it to be greater than 0.",
                           out_var_names.size()));
-    if (!model_from_memory) {
+    if (!model_from_memory &&
+        framework::MmapParamsFile::IsMmapParamsFile(filename)) {
+      LoadParamsFromMmap(ctx, place, filename, load_as_fp16, out_var_names);
+    } else if (!model_from_memory) {
       std::ifstream fin(filename, std::ios::binary);
       PADDLE_ENFORCE_EQ(
           static_cast<bool>(fin), true,
@@ -88,26 +92,7 @@ class LoadCombineOpKernel : public framework::OpKernel<T> {
       // Get data from fin to tensor
       DeserializeFromStream(*buffer, tensor, dev_ctx);
 
-      auto in_dtype = tensor->type();
-      auto out_dtype =
-          load_as_fp16 ? framework::proto::VarType::FP16 : in_dtype;
-
-      if (in_dtype != out_dtype) {
-        // convert to float16 tensor
-        auto in_kernel_type = framework::OpKernelType(in_dtype, place);
-        auto out_kernel_type = framework::OpKernelType(out_dtype, place);
-        framework::LoDTensor fp16_tensor;
-        // copy LoD info to the new tensor
-        fp16_tensor.set_lod(tensor->lod());
-        framework::TransDataType(in_kernel_type, out_kernel_type, *tensor,
-                                 &fp16_tensor);
-
-        // reset output tensor
-        out_vars[i]->Clear();
-        tensor = out_vars[i]->GetMutable<framework::LoDTensor>();
-        tensor->set_lod(fp16_tensor.lod());
-        tensor->ShareDataWith(fp16_tensor);
-      }
+      ConvertToFP16IfNeeded(place, load_as_fp16, out_vars[i]);
     }
     buffer->peek();
     PADDLE_ENFORCE_EQ(buffer->eof(), true,
@@ -115,6 +100,61 @@ class LoadCombineOpKernel : public framework::OpKernel<T> {
                           "Not allowed to load partial data via "
                           "load_combine_op, please use load_op instead."));
   }
+
+  // Like LoadParamsFromBuffer, the i-th saved tensor is loaded into the i-th
+  // output. CPU outputs alias the mapped payloads, the others are copied.
+  void LoadParamsFromMmap(const framework::ExecutionContext &context,
+                          const platform::Place &place,
+                          const std::string &filename, bool load_as_fp16,
+                          const std::vector<std::string> &out_var_names) const {
+    framework::MmapParamsFile file(filename);
+    PADDLE_ENFORCE_EQ(file.Names().size(), out_var_names.size(),
+                      platform::errors::Unavailable(
+                          "Not allowed to load partial data via "
+                          "load_combine_op, please use load_op instead."));
+    auto out_vars = context.MultiOutputVar("Out");
+    for (size_t i = 0; i < out_var_names.size(); i++) {
+      VLOG(4) << "mapping tensor: " << out_var_names[i];
+      PADDLE_ENFORCE_NOT_NULL(
+          out_vars[i], platform::errors::InvalidArgument(
+                           "The variable %s to be loaded cannot be found.",
+                           out_var_names[i]));
+      auto *tensor = out_vars[i]->GetMutable<framework::LoDTensor>();
+      if (platform::is_cpu_place(place)) {
+        file.Load(file.Names()[i], tensor);
+      } else {
+        framework::LoDTensor cpu_tensor;
+        file.Load(file.Names()[i], &cpu_tensor);
+        framework::TensorCopySync(cpu_tensor, place, tensor);
+        tensor->set_lod(cpu_tensor.lod());
+      }
+      ConvertToFP16IfNeeded(place, load_as_fp16, out_vars[i]);
+    }
+  }
+
+  void ConvertToFP16IfNeeded(const platform::Place &place, bool load_as_fp16,
+                             framework::Variable *var) const {
+    auto *tensor = var->GetMutable<framework::LoDTensor>();
+    auto in_dtype = tensor->type();
+    auto out_dtype = load_as_fp16 ? framework::proto::VarType::FP16 : in_dtype;
+
+    if (in_dtype != out_dtype) {
+      // convert to float16 tensor
+      auto in_kernel_type = framework::OpKernelType(in_dtype, place);
+      auto out_kernel_type = framework::OpKernelType(out_dtype, place);
+      framework::LoDTensor fp16_tensor;
+      // copy LoD info to the new tensor
+      fp16_tensor.set_lod(tensor->lod());
+      framework::TransDataType(in_kernel_type, out_kernel_type, *tensor,
+                               &fp16_tensor);
+
+      // reset output tensor
+      var->Clear();
+      tensor = var->GetMutable<framework::LoDTensor>();
+      tensor->set_lod(fp16_tensor.lod());
+      tensor->ShareDataWith(fp16_tensor);
+    }
+  }
 };
 
 }  // namespace operators
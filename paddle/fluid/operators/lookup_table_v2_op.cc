@@ -77,7 +77,9 @@ class LookupTableV2OpMaker : public framework::OpProtoAndCheckerMaker {
     AddInput("Ids",
              "An input with type int64 "
              "contains the ids to be looked up in W.");
-    AddOutput("Out", "The lookup results, which have the same type as W.");
+    AddOutput("Out",
+              "The lookup results, which have the same type as W unless "
+              "out_dtype is set.");
     AddAttr<bool>("is_sparse",
                   "(boolean, default false) "
                   "Sparse update.")
@@ -91,6 +93,12 @@ class LookupTableV2OpMaker : public framework::OpProtoAndCheckerMaker {
                      "Otherwise the given value indicates padding the output "
                      "with zeros whenever lookup encounters it in Ids.")
         .SetDefault(kNoPadding);
+    AddAttr<int>("out_dtype",
+                 "(int, default -1) "
+                 "The data type of Out, FP16 or BF16, to which the rows are "
+                 "converted in the lookup on CPU. It is the type of W if the "
+                 "value is -1. Only for inference with W a LoDTensor.")
+        .SetDefault(-1);
 
     // for parameter prefetch
     AddAttr<bool>("remote_prefetch", "").SetDefault(false);
@@ -163,6 +171,18 @@ class LookupTableV2OpGrad : public framework::OperatorWithKernel {
   }
 };
 
+// Out is of out_dtype if it is set, of the type of W otherwise.
+class LookupTableV2OpVarTypeInference : public framework::VarTypeInference {
+ public:
+  void operator()(framework::InferVarTypeContext* ctx) const override {
+    int out_dtype = BOOST_GET_CONST(int, ctx->GetAttr("out_dtype"));
+    if (out_dtype != -1) {
+      ctx->SetOutputDataType(
+          "Out", static_cast<framework::proto::VarType::Type>(out_dtype));
+    }
+  }
+};
+
 class LookupTableV2OpGradVarTypeInference : public framework::VarTypeInference {
  public:
   void operator()(framework::InferVarTypeContext* ctx) const override {
@@ -189,6 +209,7 @@ class LookupTableV2OpGradVarTypeInference : public framework::VarTypeInference {
 namespace ops = paddle::operators;
 REGISTER_OPERATOR(lookup_table_v2, ops::LookupTableV2Op,
                   ops::LookupTableV2OpMaker,
+                  ops::LookupTableV2OpVarTypeInference,
                   ops::LookupTableV2GradOpMaker<paddle::framework::OpDesc>,
                   ops::LookupTableV2GradOpMaker<paddle::imperative::OpBase>);
 
@@ -209,6 +230,12 @@ REGISTER_OP_VERSION(lookup_table_v2)
         paddle::framework::compatible::OpVersionDesc()
             .BugfixWithBehaviorChanged("lookup_table_v2 support input type "
                                        "`int64`; after support input type "
-                                       "`int32/int64`"));
+                                       "`int32/int64`"))
+    .AddCheckpoint(
+        R"ROC(Upgrade lookup_table_v2, add attribute [out_dtype].)ROC",
+        paddle::framework::compatible::OpVersionDesc().NewAttr(
+            "out_dtype",
+            "The data type of Out, FP16 or BF16, or the type of W if -1.",
+            -1));
 
 /* ========================================================================== */
@@ -81,6 +81,11 @@ class LookupTableV2CUDAKernel : public framework::OpKernel<T> {
     auto *ids_t = context.Input<LoDTensor>("Ids");
     auto *output_t = context.Output<LoDTensor>("Out");
     int64_t padding_idx = context.Attr<int64_t>("padding_idx");
+    PADDLE_ENFORCE_EQ(
+        !context.HasAttr("out_dtype") || context.Attr<int>("out_dtype") == -1,
+        true, platform::errors::Unimplemented(
+                  "The out_dtype of lookup_table_v2 is only supported on "
+                  "CPU."));
 
     auto id_name = context.InputNames("Ids").front();
     auto out_name = context.OutputNames("Out").front();
@@ -15,19 +15,27 @@ limitations under the License. */
 #pragma once
 
 #include <algorithm>
+#include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "gflags/gflags.h"
 #include "paddle/fluid/framework/eigen.h"
 #include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/selected_rows.h"
 #include "paddle/fluid/operators/math/blas.h"
+#include "paddle/fluid/operators/math/math_function.h"
+#include "paddle/fluid/platform/bfloat16.h"
+#include "paddle/fluid/platform/float16.h"
 
 #ifdef PADDLE_WITH_DISTRIBUTE
 #include "paddle/fluid/operators/distributed/parameter_prefetch.h"
 #endif
 
+DECLARE_int32(inner_op_parallelism);
+
 namespace paddle {
 namespace operators {
 
@@ -37,6 +45,114 @@ using SelectedRows = framework::SelectedRows;
 using DDim = framework::DDim;
 
 constexpr int64_t kNoPadding = -1;
+// The lookup prefetches the rows of the ids this far ahead.
+constexpr int64_t kLookupPrefetchDistance = 8;
+// The least number of values looked up by a thread.
+constexpr int64_t kMinLookupNumelPerThread = 1 << 16;
+
+inline int LookupThreadNum(int64_t numel) {
+  return static_cast<int>(std::max<int64_t>(
+      1, std::min<int64_t>(FLAGS_inner_op_parallelism,
+                           numel / kMinLookupNumelPerThread)));
+}
+
+inline void PrefetchLookupRow(const void *row, size_t bytes) {
+#if defined(__GNUC__) || defined(__clang__)
+  const char *begin = static_cast<const char *>(row);
+  for (size_t offset = 0; offset < bytes; offset += 64) {
+    __builtin_prefetch(begin + offset);
+  }
+#endif
+}
+
+template <typename T, typename OutT>
+inline void CopyLookupRow(const T *row, int64_t row_width, OutT *output) {
+  for (int64_t j = 0; j < row_width; ++j) {
+    output[j] = static_cast<OutT>(row[j]);
+  }
+}
+
+template <typename T>
+inline void CopyLookupRow(const T *row, int64_t row_width, T *output) {
+  memcpy(output, row, row_width * sizeof(T));
+}
+
+// Copy the rows of ids in table to output, as OutT, in chunks of ids on
+// several threads. The ids should be checked already. The rows of the ids
+// kLookupPrefetchDistance ahead are prefetched, since the lookup of a large
+// table waits on memory rather than on the copy.
+template <typename T, typename OutT>
+void LookupRows(const T *table, int64_t row_width, const int64_t *ids,
+                int64_t ids_numel, int64_t padding_idx, OutT *output,
+                int thread_num) {
+  math::ParallelForRows(
+      ids_numel, thread_num, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          if (i + kLookupPrefetchDistance < end &&
+              ids[i + kLookupPrefetchDistance] != padding_idx) {
+            PrefetchLookupRow(
+                table + ids[i + kLookupPrefetchDistance] * row_width,
+                row_width * sizeof(T));
+          }
+          if (padding_idx != kNoPadding && ids[i] == padding_idx) {
+            memset(output + i * row_width, 0, row_width * sizeof(OutT));
+          } else {
+            CopyLookupRow(table + ids[i] * row_width, row_width,
+                          output + i * row_width);
+          }
+        }
+      });
+}
+
+// The gradient of the table as SelectedRows of distinct sorted rows: the
+// positions of ids are sorted by id, and the rows of out_grad of the same id
+// are summed in the order of the positions. Paddings get no gradient.
+template <typename T>
+void LookupSparseGrad(const platform::CPUDeviceContext &context,
+                      const int64_t *ids, int64_t ids_num,
+                      int64_t padding_idx, const T *out_grad,
+                      int64_t row_width, SelectedRows *table_grad) {
+  std::vector<std::pair<int64_t, int64_t>> sorted;
+  sorted.reserve(ids_num);
+  for (int64_t i = 0; i < ids_num; ++i) {
+    if (padding_idx == kNoPadding || ids[i] != padding_idx) {
+      sorted.emplace_back(ids[i], i);
+    }
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  std::vector<int64_t> rows;
+  // The first position in sorted of every row, and the end.
+  std::vector<size_t> starts;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    if (i == 0 || sorted[i].first != sorted[i - 1].first) {
+      rows.push_back(sorted[i].first);
+      starts.push_back(i);
+    }
+  }
+  starts.push_back(sorted.size());
+
+  int64_t row_num = static_cast<int64_t>(rows.size());
+  table_grad->set_rows(rows);
+  auto *value = table_grad->mutable_value();
+  value->Resize({row_num, row_width});
+  T *value_data = value->mutable_data<T>(context.GetPlace());
+  math::ParallelForRows(
+      row_num, LookupThreadNum(ids_num * row_width),
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          T *dst = value_data + i * row_width;
+          memcpy(dst, out_grad + sorted[starts[i]].second * row_width,
+                 row_width * sizeof(T));
+          for (size_t k = starts[i] + 1; k < starts[i + 1]; ++k) {
+            const T *src = out_grad + sorted[k].second * row_width;
+            for (int64_t j = 0; j < row_width; ++j) {
+              dst[j] += src[j];
+            }
+          }
+        }
+      });
+}
 
 template <typename T>
 class LookupTableV2Kernel : public framework::OpKernel<T> {
@@ -47,17 +163,19 @@ class LookupTableV2Kernel : public framework::OpKernel<T> {
     auto *table_var = context.InputVar("W");
 
     int64_t padding_idx = context.Attr<int64_t>("padding_idx");
+    int out_dtype = context.Attr<int>("out_dtype");
     int64_t ids_numel = ids_t->numel();
 
-    std::vector<int64_t> ids;
-    ids.reserve(ids_numel);
-
+    std::vector<int64_t> ids_buffer;
+    const int64_t *ids = nullptr;
     if (ids_t->type() == framework::proto::VarType::INT32) {
+      ids_buffer.reserve(ids_numel);
       std::transform(ids_t->data<int>(), ids_t->data<int>() + ids_numel,
-                     std::back_inserter(ids),
+                     std::back_inserter(ids_buffer),
                      [&](int id) { return static_cast<int64_t>(id); });
+      ids = ids_buffer.data();
     } else {
-      framework::TensorToVector(*ids_t, &ids);
+      ids = ids_t->data<int64_t>();
     }
 
     if (table_var->IsType<LoDTensor>()) {
@@ -66,12 +184,9 @@ class LookupTableV2Kernel : public framework::OpKernel<T> {
       int64_t row_width = table_t->dims()[1];
 
       auto *table = table_t->data<T>();
-      auto *output = output_t->mutable_data<T>(context.GetPlace());
 
       for (int64_t i = 0; i < ids_numel; ++i) {
-        if (padding_idx != kNoPadding && ids[i] == padding_idx) {
-          memset(output + i * row_width, 0, row_width * sizeof(T));
-        } else {
+        if (padding_idx == kNoPadding || ids[i] != padding_idx) {
           PADDLE_ENFORCE_LT(
               ids[i], row_number,
               platform::errors::InvalidArgument(
@@ -86,11 +201,29 @@ class LookupTableV2Kernel : public framework::OpKernel<T> {
                   "expected >= 0 and < %ld, but got %ld. Please check input "
                   "value.",
                   row_number, ids[i]));
-          memcpy(output + i * row_width, table + ids[i] * row_width,
-                 row_width * sizeof(T));
         }
       }
+      int thread_num = LookupThreadNum(ids_numel * row_width);
+      if (out_dtype == framework::proto::VarType::FP16) {
+        LookupRows(table, row_width, ids, ids_numel, padding_idx,
+                   output_t->mutable_data<platform::float16>(
+                       context.GetPlace()),
+                   thread_num);
+      } else if (out_dtype == framework::proto::VarType::BF16) {
+        LookupRows(table, row_width, ids, ids_numel, padding_idx,
+                   output_t->mutable_data<platform::bfloat16>(
+                       context.GetPlace()),
+                   thread_num);
+      } else {
+        LookupRows(table, row_width, ids, ids_numel, padding_idx,
+                   output_t->mutable_data<T>(context.GetPlace()),
+                   thread_num);
+      }
     } else if (table_var->IsType<SelectedRows>()) {
+      PADDLE_ENFORCE_EQ(out_dtype, -1,
+                        platform::errors::Unimplemented(
+                            "The out_dtype of lookup_table_v2 is only "
+                            "supported when W is a LoDTensor."));
       const auto &table_t = table_var->Get<SelectedRows>();
       int64_t row_width = table_t.value().dims()[1];
       const auto *table = table_t.value().data<T>();
@@ -138,6 +271,11 @@ class LookupTableV2GradKernel : public framework::OpKernel<T> {
           "must be either LoDTensor or SelectedRows"));
     }
 
+    PADDLE_ENFORCE_EQ(
+        !context.HasAttr("out_dtype") || context.Attr<int>("out_dtype") == -1,
+        true, platform::errors::Unimplemented(
+                  "The gradient of lookup_table_v2 with out_dtype is not "
+                  "supported."));
     int64_t padding_idx = context.Attr<int64_t>("padding_idx");
     bool is_sparse = context.Attr<bool>("is_sparse");
     // Since paddings are not trainable and fixed in forward, the gradient of
@@ -159,30 +297,23 @@ class LookupTableV2GradKernel : public framework::OpKernel<T> {
         framework::TensorToVector(*ids_t, &ids);
       }
 
-      d_table->set_rows(ids);
-
-      auto *d_table_value = d_table->mutable_value();
-      d_table_value->Resize({ids_num, table_dim[1]});
-
-      d_table_value->mutable_data<T>(context.GetPlace());
-
-      d_table->set_height(table_dim[0]);
-
-      auto *d_output_data = d_output->data<T>();
-      auto *d_table_data = d_table_value->data<T>();
-
       auto d_output_dims = d_output->dims();
       auto d_output_dims_2d =
           framework::flatten_to_2d(d_output_dims, d_output_dims.size() - 1);
-      PADDLE_ENFORCE_EQ(d_table_value->dims(), d_output_dims_2d,
+      auto ids_dims_2d = framework::make_ddim({ids_num, table_dim[1]});
+      PADDLE_ENFORCE_EQ(ids_dims_2d, d_output_dims_2d,
                         platform::errors::InvalidArgument(
-                            "ShapeError: The shape of lookup_table@Grad and "
+                            "ShapeError: The shape of the rows of ids and "
                             "output@Grad should be same. "
-                            "But received lookup_table@Grad's shape = [%s], "
-                            "output@Grad's shape = [%s].",
-                            d_table_value->dims(), d_output_dims_2d));
-      memcpy(d_table_data, d_output_data, sizeof(T) * d_output->numel());
+                            "But received the shape of the rows of ids = "
+                            "[%s], output@Grad's shape = [%s].",
+                            ids_dims_2d, d_output_dims_2d));
 
+      d_table->set_height(table_dim[0]);
+      LookupSparseGrad(
+          context.template device_context<platform::CPUDeviceContext>(),
+          ids.data(), ids_num, padding_idx, d_output->data<T>(), table_dim[1],
+          d_table);
     } else {
       auto *ids_t = context.Input<LoDTensor>("Ids");
       auto *d_output = context.Input<LoDTensor>(framework::GradVarName("Out"));
@@ -0,0 +1,154 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+#include "paddle/fluid/operators/lookup_table_v2_op.h"
+
+#include <gtest/gtest.h>
+#include <chrono>  // NOLINT
+#include <map>
+#include <memory>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+DEFINE_int64(lookup_benchmark_max_vocab, 1000000,
+             "the largest vocabulary of the lookup benchmark, up to 1e8");
+
+static std::vector<int64_t> RandomIds(int64_t ids_num, int64_t vocab,
+                                      std::mt19937_64* rng) {
+  std::vector<int64_t> ids(ids_num);
+  for (auto& id : ids) {
+    id = (*rng)() % vocab;
+  }
+  return ids;
+}
+
+TEST(LookupTableV2, LookupRows) {
+  const int64_t vocab = 1000;
+  const int64_t width = 24;
+  const int64_t ids_num = 5000;
+  std::mt19937_64 rng(0);
+  std::vector<float> table(vocab * width);
+  for (size_t i = 0; i < table.size(); ++i) {
+    table[i] = static_cast<float>(i % 977) / 16.f;
+  }
+  std::vector<int64_t> ids = RandomIds(ids_num, vocab, &rng);
+  const int64_t padding_idx = ids[7];
+
+  std::vector<float> out(ids_num * width);
+  std::vector<float> parallel_out(ids_num * width);
+  std::vector<paddle::platform::float16> fp16_out(ids_num * width);
+  std::vector<paddle::platform::bfloat16> bf16_out(ids_num * width);
+  paddle::operators::LookupRows(table.data(), width, ids.data(), ids_num,
+                                padding_idx, out.data(), 1);
+  paddle::operators::LookupRows(table.data(), width, ids.data(), ids_num,
+                                padding_idx, parallel_out.data(), 4);
+  paddle::operators::LookupRows(table.data(), width, ids.data(), ids_num,
+                                padding_idx, fp16_out.data(), 4);
+  paddle::operators::LookupRows(table.data(), width, ids.data(), ids_num,
+                                padding_idx, bf16_out.data(), 4);
+  for (int64_t i = 0; i < ids_num; ++i) {
+    for (int64_t j = 0; j < width; ++j) {
+      float expected =
+          ids[i] == padding_idx ? 0.f : table[ids[i] * width + j];
+      EXPECT_EQ(out[i * width + j], expected);
+      EXPECT_EQ(parallel_out[i * width + j], expected);
+      EXPECT_EQ(static_cast<float>(fp16_out[i * width + j]),
+                static_cast<float>(paddle::platform::float16(expected)));
+      EXPECT_EQ(static_cast<float>(bf16_out[i * width + j]),
+                static_cast<float>(paddle::platform::bfloat16(expected)));
+    }
+  }
+}
+
+TEST(LookupTableV2, LookupSparseGrad) {
+  paddle::platform::CPUPlace cpu_place;
+  paddle::platform::CPUDeviceContext ctx(cpu_place);
+  const int64_t vocab = 300;
+  const int64_t width = 5;
+  const int64_t ids_num = 200000;
+  std::mt19937_64 rng(0);
+  std::vector<int64_t> ids = RandomIds(ids_num, vocab, &rng);
+  const int64_t padding_idx = ids[0];
+  std::vector<float> out_grad(ids_num * width);
+  for (size_t i = 0; i < out_grad.size(); ++i) {
+    out_grad[i] = static_cast<float>(rng() % 1000) / 8.f;
+  }
+  // The sums of the rows of every id in the order of the ids.
+  std::map<int64_t, std::vector<float>> expected;
+  for (int64_t i = 0; i < ids_num; ++i) {
+    if (ids[i] == padding_idx) continue;
+    auto& sum = expected[ids[i]];
+    sum.resize(width, 0.f);
+    for (int64_t j = 0; j < width; ++j) {
+      sum[j] += out_grad[i * width + j];
+    }
+  }
+
+  for (int thread_num : {0, 4}) {
+    FLAGS_inner_op_parallelism = thread_num;
+    paddle::framework::SelectedRows table_grad;
+    paddle::operators::LookupSparseGrad(ctx, ids.data(), ids_num, padding_idx,
+                                        out_grad.data(), width, &table_grad);
+    ASSERT_EQ(table_grad.rows().size(), expected.size());
+    const float* value = table_grad.value().data<float>();
+    size_t i = 0;
+    for (auto& item : expected) {
+      EXPECT_EQ(table_grad.rows()[i], item.first);
+      for (int64_t j = 0; j < width; ++j) {
+        EXPECT_EQ(value[i * width + j], item.second[j]);
+      }
+      ++i;
+    }
+  }
+  FLAGS_inner_op_parallelism = 0;
+}
+
+// The lookup of 1M ids in tables of 1M to 100M rows of width 16, by the
+// loop of memcpy without prefetching, and by LookupRows. Run with
+// --gtest_also_run_disabled_tests.
+TEST(LookupTableV2, DISABLED_Benchmark) {
+  const int64_t width = 16;
+  const int64_t ids_num = 1 << 20;
+  const int thread_num =
+      std::max(2, std::min(8, static_cast<int>(
+                                  std::thread::hardware_concurrency())));
+  std::mt19937_64 rng(0);
+  auto seconds_since = [](std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+  std::vector<float> out(ids_num * width);
+  for (int64_t vocab = 1000000; vocab <= FLAGS_lookup_benchmark_max_vocab;
+       vocab *= 10) {
+    std::unique_ptr<float[]> table(new float[vocab * width]());
+    std::vector<int64_t> ids = RandomIds(ids_num, vocab, &rng);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < ids_num; ++i) {
+      memcpy(out.data() + i * width, table.get() + ids[i] * width,
+             width * sizeof(float));
+    }
+    double memcpy_seconds = seconds_since(start);
+    for (int threads : {1, thread_num}) {
+      start = std::chrono::steady_clock::now();
+      paddle::operators::LookupRows(table.get(), width, ids.data(), ids_num,
+                                    paddle::operators::kNoPadding, out.data(),
+                                    threads);
+      LOG(INFO) << "vocab " << vocab << ", memcpy loop: " << memcpy_seconds
+                << " s, LookupRows on " << threads
+                << " threads: " << seconds_since(start) << " s";
+    }
+  }
+}
@@ -13,7 +13,9 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #pragma once
+#include <algorithm>
 #include <cmath>
+#include <future>  // NOLINT
 #include <memory>
 #include <vector>
 
@@ -21,6 +23,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/operator.h"
 #include "paddle/fluid/framework/tensor.h"
 #include "paddle/fluid/framework/tensor_util.h"
+#include "paddle/fluid/framework/threadpool.h"
 #include "paddle/fluid/platform/device_context.h"
 #include "paddle/fluid/platform/enforce.h"
 
@@ -28,6 +31,27 @@ namespace paddle {
 namespace operators {
 namespace math {
 
+// Call callback(begin, end) on thread_num ranges of [0, row_count), the
+// first one on the calling thread, the others by framework::Async.
+template <typename Callback>
+void ParallelForRows(int64_t row_count, int thread_num, Callback callback) {
+  if (thread_num <= 1 || row_count <= 1) {
+    callback(0, row_count);
+    return;
+  }
+  int64_t step = (row_count + thread_num - 1) / thread_num;
+  std::vector<std::future<void>> fs;
+  for (int64_t begin = step; begin < row_count; begin += step) {
+    int64_t end = std::min(begin + step, row_count);
+    fs.push_back(
+        framework::Async([&callback, begin, end]() { callback(begin, end); }));
+  }
+  callback(0, step);
+  for (auto& f : fs) {
+    f.get();
+  }
+}
+
 template <typename DeviceContext, typename T>
 struct TransposeNormal {
   // for dims >= 7 situation
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "paddle/fluid/operators/math/math_function.h"
+#include <algorithm>
 #include "gtest/gtest.h"
 #include "paddle/fluid/operators/math/blas.h"
 
@@ -286,3 +287,18 @@ TEST(math_function, gemm_warp) {
   GemmWarpTest<double>(8, 5, 6, 1.0, 0.0);
   GemmWarpTest<double>(8, 5, 6, 2.0, 1.0);
 }
+
+TEST(math_function, parallel_for_rows) {
+  for (int thread_num : {1, 3, 8}) {
+    for (int64_t row_count : {0, 1, 7, 1000}) {
+      std::vector<int> visits(row_count, 0);
+      paddle::operators::math::ParallelForRows(
+          row_count, thread_num, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+              ++visits[i];
+            }
+          });
+      EXPECT_EQ(std::count(visits.begin(), visits.end(), 1), row_count);
+    }
+  }
+}
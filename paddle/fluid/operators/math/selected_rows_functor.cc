@@ -13,12 +13,16 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include <algorithm>
+#include <cstdint>
 #include <set>
 #include <unordered_map>
 
+#include "gflags/gflags.h"
 #include "paddle/fluid/operators/math/blas.h"
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
 
+DECLARE_int32(selected_rows_merge_thread_num);
+
 namespace paddle {
 namespace operators {
 namespace math {
@@ -319,6 +323,221 @@ elementwise_add_to(const DeviceContext& ctx, BlasT<DeviceContext, T>* blas,
   }
 }
 
+// The least number of rows merged by a thread.
+constexpr size_t kMinMergeRowsPerThread = 1 << 14;
+// The number of rows of a partition, about, to dedup them in cache.
+constexpr size_t kMergePartitionRows = 1 << 12;
+
+template <typename T>
+void ParallelMergeAdd(const platform::CPUDeviceContext& context,
+                      const std::vector<const framework::SelectedRows*>& inputs,
+                      framework::SelectedRows* output, bool sorted_result,
+                      int thread_num) {
+  if (inputs.size() == 0) {
+    VLOG(3) << "no input! return";
+    return;
+  }
+  const framework::SelectedRows* has_value_input = nullptr;
+  for (auto* in : inputs) {
+    if (in->rows().size() > 0) {
+      has_value_input = in;
+      break;
+    }
+  }
+  if (has_value_input == nullptr) {
+    VLOG(3) << "no input has value! just return" << std::endl;
+    return;
+  }
+  auto input_width = has_value_input->value().dims()[1];
+  auto input_height = has_value_input->height();
+  framework::SelectedRows& out = *output;
+
+  // the rows of all inputs, and where the rows of every input begin
+  std::vector<int64_t> all_rows;
+  std::vector<size_t> input_offsets;
+  std::vector<const T*> input_data;
+  for (auto* input : inputs) {
+    if (input->rows().size() == 0) {
+      continue;
+    }
+    PADDLE_ENFORCE_EQ(input_width, input->value().dims()[1],
+                      platform::errors::InvalidArgument(
+                          "All inputs should have same "
+                          "dimension except for the first one."));
+    PADDLE_ENFORCE_EQ(input_height, input->height(),
+                      platform::errors::InvalidArgument(
+                          "All inputs should have same height."));
+    input_offsets.push_back(all_rows.size());
+    input_data.push_back(input->value().data<T>());
+    all_rows.insert(all_rows.end(), input->rows().begin(),
+                    input->rows().end());
+  }
+  const size_t row_num = all_rows.size();
+  auto row_data = [&](size_t pos) {
+    size_t i = std::upper_bound(input_offsets.begin(), input_offsets.end(),
+                                pos) -
+               input_offsets.begin() - 1;
+    return input_data[i] + (pos - input_offsets[i]) * input_width;
+  };
+
+  thread_num = static_cast<int>(std::max<int64_t>(
+      1, std::min<int64_t>(thread_num, row_num / kMinMergeRowsPerThread)));
+  // partition by the high bits of row - min_row, so that the partitions are
+  // ordered ranges of rows
+  auto minmax = std::minmax_element(all_rows.begin(), all_rows.end());
+  const int64_t min_row = *minmax.first;
+  uint64_t range = static_cast<uint64_t>(*minmax.second - min_row);
+  int range_bits = 0;
+  while (range_bits < 64 && (range >> range_bits) > 0) {
+    ++range_bits;
+  }
+  int part_bits = 0;
+  while (part_bits < 16 && ((row_num >> part_bits) > kMergePartitionRows ||
+                            (1 << part_bits) < thread_num)) {
+    ++part_bits;
+  }
+  const int shift = std::max(0, range_bits - part_bits);
+  const size_t part_num = static_cast<size_t>(1) << part_bits;
+  auto part_of = [min_row, shift](int64_t row) {
+    return static_cast<size_t>(static_cast<uint64_t>(row - min_row) >> shift);
+  };
+
+  // 1. count the rows of every partition in every chunk of the rows
+  const size_t chunk = (row_num + thread_num - 1) / thread_num;
+  std::vector<size_t> next(thread_num * part_num, 0);
+  ParallelForRows(thread_num, thread_num, [&](int64_t begin, int64_t end) {
+    for (int64_t t = begin; t < end; ++t) {
+      size_t* count = &next[t * part_num];
+      size_t chunk_end = std::min(row_num, (t + 1) * chunk);
+      for (size_t pos = t * chunk; pos < chunk_end; ++pos) {
+        ++count[part_of(all_rows[pos])];
+      }
+    }
+  });
+  // 2. scatter the rows into the partitions, the rows of a partition in the
+  // order of the chunks
+  std::vector<size_t> part_offsets(part_num + 1, 0);
+  size_t offset = 0;
+  for (size_t part = 0; part < part_num; ++part) {
+    part_offsets[part] = offset;
+    for (int t = 0; t < thread_num; ++t) {
+      size_t count = next[t * part_num + part];
+      next[t * part_num + part] = offset;
+      offset += count;
+    }
+  }
+  part_offsets[part_num] = offset;
+  std::vector<std::pair<int64_t, size_t>> entries(row_num);
+  ParallelForRows(thread_num, thread_num, [&](int64_t begin, int64_t end) {
+    for (int64_t t = begin; t < end; ++t) {
+      size_t* part_next = &next[t * part_num];
+      size_t chunk_end = std::min(row_num, (t + 1) * chunk);
+      for (size_t pos = t * chunk; pos < chunk_end; ++pos) {
+        entries[part_next[part_of(all_rows[pos])]++] =
+            std::make_pair(all_rows[pos], pos);
+      }
+    }
+  });
+  // 3. dedup the rows of every partition by an open addressing table that
+  // fits in cache, sort its rows, and replace the row of every entry by its
+  // rank in them
+  std::vector<int64_t> part_rows(row_num);
+  std::vector<size_t> merged_offsets(part_num + 1, 0);
+  ParallelForRows(part_num, thread_num, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> keys;
+    std::vector<uint32_t> ids;
+    std::vector<std::pair<int64_t, uint32_t>> sorted;
+    std::vector<uint32_t> ranks;
+    for (int64_t part = begin; part < end; ++part) {
+      const size_t part_begin = part_offsets[part];
+      const size_t part_size = part_offsets[part + 1] - part_begin;
+      if (part_size == 0) {
+        continue;
+      }
+      int bits = 1;
+      while ((static_cast<size_t>(1) << bits) < 2 * part_size) {
+        ++bits;
+      }
+      const size_t mask = (static_cast<size_t>(1) << bits) - 1;
+      keys.resize(mask + 1);
+      ids.assign(mask + 1, UINT32_MAX);
+      sorted.clear();
+      for (size_t k = part_begin; k < part_begin + part_size; ++k) {
+        int64_t row = entries[k].first;
+        uint64_t hash = static_cast<uint64_t>(row) * 0x9E3779B97F4A7C15ULL;
+        size_t slot = static_cast<size_t>(hash >> (64 - bits)) & mask;
+        while (ids[slot] != UINT32_MAX && keys[slot] != row) {
+          slot = (slot + 1) & mask;
+        }
+        if (ids[slot] == UINT32_MAX) {
+          keys[slot] = row;
+          ids[slot] = static_cast<uint32_t>(sorted.size());
+          sorted.emplace_back(row, ids[slot]);
+        }
+        entries[k].first = ids[slot];
+      }
+      std::sort(sorted.begin(), sorted.end());
+      ranks.resize(sorted.size());
+      for (size_t i = 0; i < sorted.size(); ++i) {
+        ranks[sorted[i].second] = static_cast<uint32_t>(i);
+        part_rows[part_begin + i] = sorted[i].first;
+      }
+      for (size_t k = part_begin; k < part_begin + part_size; ++k) {
+        entries[k].first = ranks[entries[k].first];
+      }
+      merged_offsets[part + 1] = sorted.size();
+    }
+  });
+  for (size_t part = 0; part < part_num; ++part) {
+    merged_offsets[part + 1] += merged_offsets[part];
+  }
+  const size_t merged_num = merged_offsets[part_num];
+
+  out.set_height(input_height);
+  out.mutable_value()->mutable_data<T>(
+      framework::make_ddim({static_cast<int64_t>(merged_num), input_width}),
+      context.GetPlace());
+  auto* out_data = out.mutable_value()->data<T>();
+
+  if (merged_num == row_num && !sorted_result) {
+    // no duplicated ids, just concat the result together
+    out.set_rows(all_rows);
+    for (size_t i = 0; i < input_data.size(); ++i) {
+      size_t end = i + 1 < input_offsets.size() ? input_offsets[i + 1]
+                                                : row_num;
+      std::copy(input_data[i],
+                input_data[i] + (end - input_offsets[i]) * input_width,
+                out_data + input_offsets[i] * input_width);
+    }
+    return;
+  }
+
+  // 4. add up the rows of every partition into its merged rows, in the order
+  // of the inputs
+  std::vector<int64_t> merge_rows(merged_num);
+  auto blas = math::GetBlas<platform::CPUDeviceContext, T>(context);
+  ParallelForRows(part_num, thread_num, [&](int64_t begin, int64_t end) {
+    for (int64_t part = begin; part < end; ++part) {
+      const size_t part_begin = part_offsets[part];
+      const size_t merged_begin = merged_offsets[part];
+      const size_t merged_size = merged_offsets[part + 1] - merged_begin;
+      std::copy(part_rows.begin() + part_begin,
+                part_rows.begin() + part_begin + merged_size,
+                merge_rows.begin() + merged_begin);
+      T* part_data = out_data + merged_begin * input_width;
+      std::fill(part_data, part_data + merged_size * input_width,
+                static_cast<T>(0));
+      for (size_t k = part_begin; k < part_offsets[part + 1]; ++k) {
+        elementwise_add_to<platform::CPUDeviceContext, T>(
+            context, &blas, static_cast<size_t>(input_width),
+            row_data(entries[k].second),
+            part_data + entries[k].first * input_width);
+      }
+    }
+  });
+  out.set_rows(merge_rows);
+}
+
 template <typename T>
 struct MergeAdd<platform::CPUDeviceContext, T> {
   framework::SelectedRows operator()(const platform::CPUDeviceContext& context,
@@ -342,104 +561,8 @@ struct MergeAdd<platform::CPUDeviceContext, T> {
                   const std::vector<const framework::SelectedRows*>& inputs,
                   framework::SelectedRows* output,
                   const bool sorted_result = false) {
-    if (inputs.size() == 0) {
-      VLOG(3) << "no input! return";
-      return;
-    }
-    const framework::SelectedRows* has_value_input = nullptr;
-    for (auto* in : inputs) {
-      if (in->rows().size() > 0) {
-        has_value_input = in;
-        break;
-      }
-    }
-    if (has_value_input == nullptr) {
-      VLOG(3) << "no input has value! just return" << std::endl;
-      return;
-    }
-    auto input_width = has_value_input->value().dims()[1];
-    auto input_height = has_value_input->height();
-    framework::SelectedRows& out = *output;
-    std::set<int64_t> merged_row_set;
-    size_t row_num = 0;
-    for (auto* input : inputs) {
-      if (input->rows().size() == 0) {
-        continue;
-      }
-      PADDLE_ENFORCE_EQ(input_width, input->value().dims()[1],
-                        platform::errors::InvalidArgument(
-                            "All inputs should have same "
-                            "dimension except for the first one."));
-      PADDLE_ENFORCE_EQ(input_height, input->height(),
-                        platform::errors::InvalidArgument(
-                            "All inputs should have same height."));
-      row_num += input->rows().size();
-      merged_row_set.insert(input->rows().begin(), input->rows().end());
-    }
-
-    out.set_height(input_height);
-    out.mutable_value()->mutable_data<T>(
-        framework::make_ddim(
-            {static_cast<int64_t>(merged_row_set.size()), input_width}),
-        context.GetPlace());
-    auto* out_data = out.mutable_value()->data<T>();
-
-    if (merged_row_set.size() == row_num && !sorted_result) {
-      // no duplicated ids, just concat the result together
-      std::vector<int64_t> merge_rows;
-      merge_rows.reserve(row_num);
-      // concat rows
-      for (auto* in : inputs) {
-        merge_rows.insert(merge_rows.end(), in->rows().begin(),
-                          in->rows().end());
-      }
-      out.set_rows(merge_rows);
-      auto in_place = inputs[0]->place();
-      auto out_place = out.place();
-      int64_t copied_numel = 0;
-      for (auto* in : inputs) {
-        auto* in_data = in->value().data<T>();
-        auto in_numel = in->rows().size() * input_width;
-        memory::Copy(BOOST_GET_CONST(platform::CPUPlace, out_place),
-                     out_data + copied_numel,
-                     BOOST_GET_CONST(platform::CPUPlace, in_place), in_data,
-                     in_numel * sizeof(T));
-        copied_numel += in_numel;
-      }
-    } else {
-      std::vector<int64_t> merge_rows(merged_row_set.begin(),
-                                      merged_row_set.end());
-
-      if (sorted_result) {
-        std::sort(merge_rows.begin(), merge_rows.end());
-      }
-
-      out.set_rows(merge_rows);
-
-      math::SetConstant<platform::CPUDeviceContext, T> constant_functor;
-      constant_functor(context, out.mutable_value(), 0.0);
-
-      std::unordered_map<int64_t, size_t> rows_to_id;
-      for (size_t i = 0; i < merge_rows.size(); ++i) {
-        rows_to_id[merge_rows[i]] = i;
-      }
-
-      auto blas = math::GetBlas<platform::CPUDeviceContext, T>(context);
-      for (auto* input : inputs) {
-        if (input->rows().size() == 0) {
-          continue;
-        }
-        auto* input_data = input->value().data<T>();
-        auto& input_rows = input->rows();
-
-        for (size_t i = 0; i < input_rows.size(); i++) {
-          size_t out_i = rows_to_id[input_rows[i]];
-          elementwise_add_to<platform::CPUDeviceContext, T>(
-              context, &blas, static_cast<size_t>(input_width),
-              &input_data[i * input_width], &out_data[out_i * input_width]);
-        }
-      }
-    }
+    ParallelMergeAdd<T>(context, inputs, output, sorted_result,
+                        FLAGS_selected_rows_merge_thread_num);
   }
 };
 
@@ -544,6 +667,23 @@ struct MergeAverage<platform::CPUDeviceContext, T> {
   }
 };
 
+template void ParallelMergeAdd<int>(
+    const platform::CPUDeviceContext&,
+    const std::vector<const framework::SelectedRows*>&,
+    framework::SelectedRows*, bool, int);
+template void ParallelMergeAdd<int64_t>(
+    const platform::CPUDeviceContext&,
+    const std::vector<const framework::SelectedRows*>&,
+    framework::SelectedRows*, bool, int);
+template void ParallelMergeAdd<float>(
+    const platform::CPUDeviceContext&,
+    const std::vector<const framework::SelectedRows*>&,
+    framework::SelectedRows*, bool, int);
+template void ParallelMergeAdd<double>(
+    const platform::CPUDeviceContext&,
+    const std::vector<const framework::SelectedRows*>&,
+    framework::SelectedRows*, bool, int);
+
 template struct MergeAdd<platform::CPUDeviceContext, int>;
 template struct MergeAdd<platform::CPUDeviceContext, int64_t>;
 template struct MergeAdd<platform::CPUDeviceContext, float>;
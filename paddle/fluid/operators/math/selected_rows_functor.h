@@ -93,6 +93,18 @@ struct MergeAdd {
                   const bool sorted_result = false);
 };
 
+// MergeAdd on CPU by thread_num threads, which MergeAdd calls with
+// FLAGS_selected_rows_merge_thread_num. The row ids are partitioned by their
+// high bits into ranges small enough to be deduped by a table in cache, and
+// every partition is deduped, sorted and added up by a thread. The rows are
+// added up in the order of the inputs, so the output does not depend on
+// thread_num.
+template <typename T>
+void ParallelMergeAdd(const platform::CPUDeviceContext& context,
+                      const std::vector<const framework::SelectedRows*>& inputs,
+                      framework::SelectedRows* output, bool sorted_result,
+                      int thread_num);
+
 template <typename DeviceContext, typename T>
 struct MergeAverage {
   framework::SelectedRows operator()(const DeviceContext& context,
@@ -14,7 +14,13 @@ limitations under the License. */
 
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <map>
 #include <memory>
+#include <random>
+#include <thread>  // NOLINT
+#include <unordered_map>
 #include <vector>
 #include "gtest/gtest.h"
 
@@ -556,3 +562,115 @@ TEST(selected_rows_functor, cpu_sum_to) {
   // row9: 2.0 + 3.0
   EXPECT_EQ(tensor1_data[9 * row_numel + 6], 5.0);
 }
+
+static void RandomSelectedRows(int64_t row_num, int64_t height,
+                               int64_t row_numel, std::mt19937* rng,
+                               paddle::framework::SelectedRows* input) {
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<int64_t> rows(row_num);
+  for (auto& row : rows) {
+    row = (*rng)() % height;
+  }
+  input->set_rows(rows);
+  input->set_height(height);
+  float* data = input->mutable_value()->mutable_data<float>(
+      paddle::framework::make_ddim({row_num, row_numel}),
+      paddle::platform::CPUPlace());
+  for (int64_t i = 0; i < row_num * row_numel; ++i) {
+    data[i] = dist(*rng);
+  }
+}
+
+TEST(selected_rows_functor, cpu_parallel_merge_add) {
+  paddle::platform::CPUPlace cpu_place;
+  paddle::platform::CPUDeviceContext ctx(cpu_place);
+  int64_t height = 30000;
+  int64_t row_numel = 9;
+  std::mt19937 rng(0);
+  std::vector<paddle::framework::SelectedRows> selected_rows(3);
+  std::vector<const paddle::framework::SelectedRows*> inputs;
+  // the sums of the rows in the order of the inputs
+  std::map<int64_t, std::vector<float>> expected;
+  for (auto& input : selected_rows) {
+    RandomSelectedRows(40000, height, row_numel, &rng, &input);
+    inputs.push_back(&input);
+    const float* data = input.value().data<float>();
+    for (size_t i = 0; i < input.rows().size(); ++i) {
+      auto& sum = expected[input.rows()[i]];
+      sum.resize(row_numel, 0.f);
+      for (int64_t j = 0; j < row_numel; ++j) {
+        sum[j] += data[i * row_numel + j];
+      }
+    }
+  }
+
+  for (int thread_num : {1, 3, 8}) {
+    paddle::framework::SelectedRows output;
+    paddle::operators::math::scatter::ParallelMergeAdd<float>(
+        ctx, inputs, &output, false, thread_num);
+    EXPECT_EQ(output.height(), height);
+    ASSERT_EQ(output.rows().size(), expected.size());
+    const float* out_data = output.value().data<float>();
+    size_t i = 0;
+    for (auto& item : expected) {
+      ASSERT_EQ(output.rows()[i], item.first);
+      for (int64_t j = 0; j < row_numel; ++j) {
+        ASSERT_EQ(out_data[i * row_numel + j], item.second[j]);
+      }
+      ++i;
+    }
+  }
+}
+
+// ParallelMergeAdd against a merge by a hash map of the rows, with 1M rows
+// of which 100%, 50%, 10% and 1% are distinct. Run with
+// --gtest_also_run_disabled_tests.
+TEST(selected_rows_functor, DISABLED_cpu_parallel_merge_add_benchmark) {
+  paddle::platform::CPUPlace cpu_place;
+  paddle::platform::CPUDeviceContext ctx(cpu_place);
+  const int64_t row_num = 1000000;
+  const int64_t row_numel = 16;
+  const int thread_num =
+      std::max(2, std::min(8, static_cast<int>(
+                                  std::thread::hardware_concurrency())));
+  std::mt19937 rng(0);
+  auto seconds_since = [](std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  for (double distinct : {1.0, 0.5, 0.1, 0.01}) {
+    paddle::framework::SelectedRows input;
+    RandomSelectedRows(row_num, static_cast<int64_t>(row_num * distinct),
+                       row_numel, &rng, &input);
+
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<int64_t, size_t> rows_to_id;
+    std::vector<float> hash_out;
+    const float* in_data = input.value().data<float>();
+    for (int64_t i = 0; i < row_num; ++i) {
+      auto iter = rows_to_id.emplace(input.rows()[i], rows_to_id.size());
+      if (iter.second) {
+        hash_out.resize(hash_out.size() + row_numel, 0.f);
+      }
+      float* out_row = &hash_out[iter.first->second * row_numel];
+      for (int64_t j = 0; j < row_numel; ++j) {
+        out_row[j] += in_data[i * row_numel + j];
+      }
+    }
+    double hash_seconds = seconds_since(start);
+
+    for (int threads : {1, thread_num}) {
+      start = std::chrono::steady_clock::now();
+      paddle::framework::SelectedRows output;
+      paddle::operators::math::scatter::ParallelMergeAdd<float>(
+          ctx, {&input}, &output, true, threads);
+      double seconds = seconds_since(start);
+      EXPECT_EQ(output.rows().size(), rows_to_id.size());
+      LOG(INFO) << distinct * 100 << "% distinct rows, hash map: "
+                << hash_seconds << " s, ParallelMergeAdd on " << threads
+                << " threads: " << seconds << " s";
+    }
+  }
+}
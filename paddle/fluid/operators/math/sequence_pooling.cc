@@ -12,10 +12,12 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
+#include <algorithm>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include "paddle/fluid/operators/jit/kernels.h"
-#include "paddle/fluid/operators/math/blas.h"
 #include "paddle/fluid/operators/math/math_function.h"
 #include "paddle/fluid/operators/math/sequence_pooling.h"
 
@@ -25,283 +27,161 @@ namespace math {
 
 using Tensor = framework::Tensor;
 using LoDTensor = framework::LoDTensor;
-template <typename T, int MajorType = Eigen::RowMajor,
-          typename IndexType = Eigen::DenseIndex>
-using EigenVector = framework::EigenVector<T, MajorType, IndexType>;
-template <typename T, int MajorType = Eigen::RowMajor,
-          typename IndexType = Eigen::DenseIndex>
-using EigenMatrix = framework::EigenMatrix<T, MajorType, IndexType>;
 
-template <typename T, bool is_test>
-class MaxSeqPoolFunctor {
- public:
-  void operator()(const platform::CPUDeviceContext& context,
-                  const framework::LoDTensor& input, T pad_value,
-                  framework::LoDTensor* output, framework::Tensor* index) {
-    auto in_dims = input.dims();
-    auto out_dims = output->dims();
-    auto idx_dims = index->dims();
-    PADDLE_ENFORCE_GT(in_dims.size(), 1,
-                      platform::errors::InvalidArgument(
-                          "The rank of input shall be greater than 1, but got "
-                          "the rank is %ld. Please check the input value",
-                          in_dims.size()));
-    PADDLE_ENFORCE_GT(out_dims.size(), 1,
-                      platform::errors::InvalidArgument(
-                          "The rank of output shall be greater than 1, but got "
-                          "the rank is %ld. Please check the input value",
-                          out_dims.size()));
-    for (int64_t i = 1; i < in_dims.size(); ++i) {
-      PADDLE_ENFORCE_EQ(
-          in_dims[i], out_dims[i],
-          platform::errors::InvalidArgument(
-              "The dimension of input and output shall be same. Expected %ld "
-              "== %ld, but got %ld != %ld. Please check the input value.",
-              in_dims[i], out_dims[i], in_dims[i], out_dims[i]));
-    }
-    PADDLE_ENFORCE_EQ(
-        idx_dims, out_dims,
-        platform::errors::InvalidArgument(
-            "The dimension of index and output shall be same. Expected %ld == "
-            "%ld, but got %ld != %ld. Please check the input value.",
-            idx_dims, out_dims, idx_dims, out_dims));
-
-    auto lod_level = input.lod().size();
-    auto starts = input.lod()[lod_level - 1];
-    const T* in_data = input.data<T>();
-    T* out_data = output->data<T>();
-    int* max_index = index->data<int>();
+// The least number of values pooled by a thread.
+constexpr int64_t kMinSeqPoolNumelPerThread = 1 << 15;
 
-    int64_t num_seq = out_dims[0];
-    int64_t dim = output->numel() / num_seq;
-    for (int64_t i = 0; i < num_seq; ++i) {
-      if (starts[i] == starts[i + 1]) {
-        for (int64_t k = 0; k < dim; ++k) {
-          out_data[i * dim + k] = pad_value;
-          max_index[i * dim + k] = -1;
-        }
-        continue;
-      }
-      for (int64_t k = 0; k < dim; ++k) {
-        out_data[i * dim + k] = in_data[starts[i] * dim + k];
-        max_index[i * dim + k] = starts[i];
-      }
-      for (size_t j = starts[i] + 1; j < starts[i + 1]; ++j) {
-        for (int64_t k = 0; k < dim; ++k) {
-          if (in_data[j * dim + k] > out_data[i * dim + k]) {
-            out_data[i * dim + k] = in_data[j * dim + k];
-            max_index[i * dim + k] = j;
-          }
-        }
-      }
-    }
-  }
-};
-// Instantisation of Max Sequence Pooling for test phase eg. no need to fill
-// index buffer
-template <typename T>
-class MaxSeqPoolFunctor<T, true> {
- public:
-  void operator()(const platform::CPUDeviceContext& context,
-                  const framework::LoDTensor& input, T pad_value,
-                  framework::LoDTensor* output, framework::Tensor* index) {
-    auto in_dims = input.dims();
-    auto out_dims = output->dims();
-    PADDLE_ENFORCE_GT(in_dims.size(), 1,
-                      platform::errors::InvalidArgument(
-                          "The rank of input shall be greater than 1, but got "
-                          "%ld <= 1. Please check the input value.",
-                          in_dims.size()));
-    PADDLE_ENFORCE_GT(out_dims.size(), 1,
-                      platform::errors::InvalidArgument(
-                          "The rank of output shall be greater than 1, but got "
-                          "%ld <= 1. Please check the input value.",
-                          out_dims.size()));
-    for (int64_t i = 1; i < in_dims.size(); ++i) {
-      PADDLE_ENFORCE_EQ(
-          in_dims[i], out_dims[i],
-          platform::errors::InvalidArgument(
-              "The dimension of input and output shall be same. Expected %ld "
-              "== %ld, but got %ld != %ld. Please check the input value.",
-              in_dims[i], out_dims[i], in_dims[i], out_dims[i]));
-    }
+static int SeqPoolThreadNum(int64_t numel, int thread_num) {
+  return static_cast<int>(std::max<int64_t>(
+      1, std::min<int64_t>(thread_num, numel / kMinSeqPoolNumelPerThread)));
+}
 
-    auto lod_level = input.lod().size();
-    auto starts = input.lod()[lod_level - 1];
-    const T* in_data = input.data<T>();
-    T* out_data = output->data<T>();
+// The width of the rows of a sequence tensor.
+static int64_t SeqWidth(const Tensor& tensor) {
+  auto dims = tensor.dims();
+  PADDLE_ENFORCE_GT(dims.size(), 1,
+                    platform::errors::InvalidArgument(
+                        "The rank of input shall be greater than 1, but got "
+                        "%ld <= 1. Please check the input value.",
+                        dims.size()));
+  return framework::product(framework::slice_ddim(dims, 1, dims.size()));
+}
 
-    int64_t num_seq = out_dims[0];
-    int64_t dim = output->numel() / num_seq;
-    for (int64_t i = 0; i < num_seq; ++i) {
-      if (starts[i] == starts[i + 1]) {
-        for (int64_t k = 0; k < dim; ++k) {
-          out_data[i * dim + k] = pad_value;
-        }
-        continue;
-      }
-      std::memcpy(&out_data[i * dim], &in_data[starts[i] * dim],
-                  dim * sizeof(T));
-      for (size_t j = starts[i] + 1; j < starts[i + 1]; ++j) {
-        for (int64_t k = 0; k < dim; ++k) {
-          if (in_data[j * dim + k] > out_data[i * dim + k]) {
-            out_data[i * dim + k] = in_data[j * dim + k];
-          }
-        }
-      }
-    }
-  }
-};
 template <typename T>
-class MaxSeqPoolGradFunctor {
- public:
-  void operator()(const platform::CPUDeviceContext& context,
-                  const framework::LoDTensor& out_grad,
-                  const framework::Tensor& index,
-                  framework::LoDTensor* in_grad) {
-    auto og_dims = out_grad.dims();
-    auto ig_dims = in_grad->dims();
-    auto idx_dims = index.dims();
-    PADDLE_ENFORCE_GT(og_dims.size(), 1,
-                      platform::errors::InvalidArgument(
-                          "The rank of output@Grad shall be greater than 1, "
-                          "but got %ld <= 1. Please check the input value.",
-                          og_dims.size()));
-    PADDLE_ENFORCE_GT(ig_dims.size(), 1,
+void MultiSeqPoolFunctor<T>::operator()(
+    const platform::CPUDeviceContext& context, const std::string& pooltype,
+    T pad_value, const std::vector<const LoDTensor*>& inputs, Tensor* output,
+    const std::vector<Tensor*>& index, int thread_num) {
+  PADDLE_ENFORCE_GT(inputs.size(), 0UL,
+                    platform::errors::InvalidArgument(
+                        "The sequence pooling needs at least one input."));
+  const size_t n = inputs.size();
+  const bool with_index = pooltype == "MAX" && !index.empty();
+  if (with_index) {
+    PADDLE_ENFORCE_EQ(index.size(), n,
                       platform::errors::InvalidArgument(
-                          "The rank of input@Grad shall be greater than 1, but "
-                          "got %ld <= 1. Please check the input value.",
-                          ig_dims.size()));
-    for (int64_t i = 1; i < og_dims.size(); ++i) {
-      PADDLE_ENFORCE_EQ(og_dims[i], ig_dims[i],
-                        platform::errors::InvalidArgument(
-                            "The dimension of input@Grad and output@Grad shall "
-                            "be same. Expected %ld == %ld, but got %ld != %ld. "
-                            "Please check the input value.",
-                            og_dims[i], ig_dims[i], og_dims[i], ig_dims[i]));
-    }
-    PADDLE_ENFORCE_EQ(
-        idx_dims, og_dims,
-        platform::errors::InvalidArgument(
-            "The dimension of index and output@Grad shall be same. Expected "
-            "%ld == %ld, but got %ld != %ld. Please check the input value.",
-            idx_dims, og_dims, idx_dims, og_dims));
-
-    const T* og_data = out_grad.data<T>();
-    const int* max_index = index.data<int>();
-    T* ig_data = in_grad->data<T>();
-
-    SetConstant<platform::CPUDeviceContext, T> set_zero;
-    set_zero(context, in_grad, static_cast<T>(0.0));
-    int64_t num_seq = og_dims[0];
-    int64_t dim = out_grad.numel() / num_seq;
-    for (int64_t i = 0; i < num_seq; ++i) {
-      for (int64_t j = 0; j < dim; ++j) {
-        int step_id = max_index[i * dim + j];
-        if (step_id == -1) continue;
-        ig_data[step_id * dim + j] = og_data[i * dim + j];
-      }
-    }
+                          "The MAX pooling of %d inputs needs %d index "
+                          "tensors, but got %d.",
+                          n, n, index.size()));
   }
-};
-
-template <typename T>
-class LastSeqPoolFunctor {
- public:
-  void operator()(const platform::CPUDeviceContext& context,
-                  const framework::LoDTensor& input, T pad_value,
-                  framework::LoDTensor* output) {
-    // Create pointers to input and output data
-    auto* in_data = input.data<T>();
-    auto* out_data = output->data<T>();
-
-    // Calculate the size of each item in sequence
-    int64_t item_size = input.numel() / input.dims()[0];
-    auto lod_level = input.lod().size();
-    auto lod = input.lod()[lod_level - 1];
-    int seq_num = static_cast<int>(lod.size()) - 1;
-    for (int i = 0; i < seq_num; ++i) {
-      // Calculate the length of each sequence
-      int64_t seq_len = static_cast<int64_t>(lod[i + 1] - lod[i]);
-      if (seq_len == 0) {
-        for (int j = 0; j < item_size; ++j) {
-          out_data[j] = pad_value;
-        }
-      } else {
-        // Point to the begin of next sequence
-        in_data += seq_len * item_size;
-        // Copy the last item of sequence to output
-        std::memcpy(out_data, (in_data - item_size), item_size * sizeof(T));
-      }
-      out_data += item_size;
-    }
+  jit::SeqPoolType type = jit::SeqPoolType::kNonePoolType;
+  if (pooltype == "SUM") {
+    type = jit::SeqPoolType::kSum;
+  } else if (pooltype == "AVERAGE") {
+    type = jit::SeqPoolType::kAvg;
+  } else if (pooltype == "SQRT") {
+    type = jit::SeqPoolType::kSqrt;
+  } else if (pooltype != "MAX" && pooltype != "LAST" && pooltype != "FIRST") {
+    PADDLE_THROW(platform::errors::InvalidArgument(
+        "unsupported pooling pooltype: %s. Only support \"AVERAGE\", "
+        "\"SUM\", \"SQRT\", \"MAX\", \"LAST\" and \"FIRST\"",
+        pooltype));
   }
-};
 
-template <typename T>
-class FirstSeqPoolFunctor {
- public:
-  void operator()(const platform::CPUDeviceContext& context,
-                  const framework::LoDTensor& input, T pad_value,
-                  framework::LoDTensor* output) {
-    // Create pointers to input and output data
-    auto* in_data = input.data<T>();
-    auto* out_data = output->data<T>();
-
-    // Calculate the size of each item in sequence
-    int64_t item_size = input.numel() / input.dims()[0];
-    auto lod_level = input.lod().size();
-    auto lod = input.lod()[lod_level - 1];
-    int seq_num = static_cast<int>(lod.size()) - 1;
-    for (int i = 0; i < seq_num; ++i) {
-      // Calculate the length of each sequence
-      int64_t seq_len = static_cast<int64_t>(lod[i + 1] - lod[i]);
-      if (seq_len == 0) {
-        for (int j = 0; j < item_size; ++j) {
-          out_data[j] = pad_value;
-        }
-      } else {
-        // Copy the first item of sequence to output
-        std::memcpy(out_data, in_data, item_size * sizeof(T));
-        // Point to the next sequence
-        in_data += seq_len * item_size;
-      }
-      out_data += item_size;
+  PADDLE_ENFORCE_GT(inputs[0]->lod().size(), 0UL,
+                    platform::errors::InvalidArgument(
+                        "The input of sequence pooling has no LoD."));
+  const int64_t seq_num =
+      static_cast<int64_t>(inputs[0]->lod().back().size()) - 1;
+  std::vector<const size_t*> starts(n);
+  std::vector<const T*> in_data(n);
+  std::vector<int*> index_data(n, nullptr);
+  std::vector<typename jit::SeqPoolTuple<T>::func_type> seqpools(n, nullptr);
+  // The columns of the pooled inputs in output.
+  std::vector<int64_t> cols(n + 1, 0);
+  int64_t numel = 0;
+  for (size_t j = 0; j < n; ++j) {
+    const auto& lod = inputs[j]->lod();
+    PADDLE_ENFORCE_EQ(
+        !lod.empty() && static_cast<int64_t>(lod.back().size()) == seq_num + 1,
+        true, platform::errors::InvalidArgument(
+                  "The batch size of all inputs should be %d, but the %d-th "
+                  "input is not.",
+                  seq_num, j));
+    int64_t width = SeqWidth(*inputs[j]);
+    starts[j] = lod.back().data();
+    in_data[j] = inputs[j]->data<T>();
+    cols[j + 1] = cols[j] + width;
+    numel += static_cast<int64_t>(lod.back().back()) * width;
+    if (with_index) {
+      PADDLE_ENFORCE_EQ(index[j]->numel(), seq_num * width,
+                        platform::errors::InvalidArgument(
+                            "The index of the %d-th input should have %d "
+                            "values, but got %d.",
+                            j, seq_num * width, index[j]->numel()));
+      index_data[j] = index[j]->data<int>();
     }
-  }
-};
-
-template <typename T>
-class SumSeqPoolGradFunctor {
- public:
-  void operator()(const platform::CPUDeviceContext& context,
-                  const framework::LoDTensor& out_grad,
-                  framework::LoDTensor* in_grad) {
-    auto lod_level = in_grad->lod().size();
-    auto lod = in_grad->lod()[lod_level - 1];
-    int64_t out_w = out_grad.numel() / out_grad.dims()[0];
-    int64_t in_w = in_grad->numel() / in_grad->dims()[0];
-    PADDLE_ENFORCE_EQ(in_w, out_w,
-                      platform::errors::InvalidArgument(
-                          "The feature size of input@Grad and output@Grad "
-                          "shall be same. Expected %ld == %ld, but got %ld != "
-                          "%ld. Please check the input value.",
-                          in_w, out_w, in_w, out_w));
-    const T* out_g_data = out_grad.data<T>();
-    T* in_g_data = in_grad->mutable_data<T>(context.GetPlace());
-    auto blas = math::GetBlas<platform::CPUDeviceContext, T>(context);
-    for (int i = 0; i < static_cast<int>(lod.size()) - 1; ++i) {
-      int64_t h = static_cast<int64_t>(lod[i + 1] - lod[i]);
-      if (h == 0) continue;
-      int64_t in_offset = lod[i] * in_w;
-      const T* out_pos = out_g_data + i * out_w;
-      T* in_pos = in_g_data + in_offset;
-      for (int r = 0; r != h; ++r) {
-        blas.VCOPY(in_w, out_pos, in_pos + r * in_w);
-      }
+    if (type != jit::SeqPoolType::kNonePoolType) {
+      jit::seq_pool_attr_t attr(static_cast<int>(width), type);
+      seqpools[j] =
+          jit::KernelFuncs<jit::SeqPoolTuple<T>, platform::CPUPlace>::Cache()
+              .At(attr);
     }
   }
-};
+  const int64_t out_width = cols[n];
+  const bool is_max = pooltype == "MAX";
+  const bool is_last = pooltype == "LAST";
+  PADDLE_ENFORCE_EQ(
+      output->dims()[0] == seq_num && output->numel() == seq_num * out_width,
+      true, platform::errors::InvalidArgument(
+                "The output of sequence pooling should have %d rows of width "
+                "%d, but got the dims [%s].",
+                seq_num, out_width, output->dims()));
+  T* out_data = output->mutable_data<T>(context.GetPlace());
+
+  // A chunk of sequences writes its own rows of output, input by input to
+  // read every input sequentially.
+  ParallelForRows(
+      seq_num, SeqPoolThreadNum(numel + seq_num * out_width, thread_num),
+      [&](int64_t begin, int64_t end) {
+        for (size_t j = 0; j < n; ++j) {
+          const int64_t w = cols[j + 1] - cols[j];
+          for (int64_t i = begin; i < end; ++i) {
+            const size_t seq_begin = starts[j][i];
+            const size_t seq_end = starts[j][i + 1];
+            const T* src = in_data[j] + seq_begin * w;
+            T* dst = out_data + i * out_width + cols[j];
+            int* max_index = with_index ? index_data[j] + i * w : nullptr;
+            if (seq_begin == seq_end) {
+              std::fill(dst, dst + w, pad_value);
+              if (max_index) {
+                std::fill(max_index, max_index + w, -1);
+              }
+            } else if (seqpools[j]) {
+              jit::seq_pool_attr_t attr(static_cast<int>(w), type,
+                                        static_cast<int>(seq_end - seq_begin));
+              seqpools[j](src, dst, &attr);
+            } else if (is_max) {
+              std::memcpy(dst, src, w * sizeof(T));
+              if (max_index) {
+                std::fill(max_index, max_index + w,
+                          static_cast<int>(seq_begin));
+              }
+              for (size_t r = seq_begin + 1; r < seq_end; ++r) {
+                src += w;
+                if (max_index) {
+                  for (int64_t k = 0; k < w; ++k) {
+                    if (src[k] > dst[k]) {
+                      dst[k] = src[k];
+                      max_index[k] = static_cast<int>(r);
+                    }
+                  }
+                } else {
+                  for (int64_t k = 0; k < w; ++k) {
+                    dst[k] = src[k] > dst[k] ? src[k] : dst[k];
+                  }
+                }
+              }
+            } else if (is_last) {
+              std::memcpy(dst, src + (seq_end - seq_begin - 1) * w,
+                          w * sizeof(T));
+            } else {
+              std::memcpy(dst, src, w * sizeof(T));
+            }
+          }
+        }
+      });
+}
 
 template <typename T>
 class SequencePoolFunctor<platform::CPUDeviceContext, T> {
@@ -315,84 +195,23 @@ class SequencePoolFunctor<platform::CPUDeviceContext, T> {
                   bool filter = false,
                   float show_coeff = 0.2,
                   float clk_coeff = 1,
-                  float threshold = 0.96) {
-    if (pooltype == "MAX") {
-      if (is_test) {
-        math::MaxSeqPoolFunctor<T, true> max_pool;
-        max_pool(context, input, pad_value, output, index);
-      } else {
-        math::MaxSeqPoolFunctor<T, false> max_pool;
-        max_pool(context, input, pad_value, output, index);
-      }
-      return;
-    }
-    if (pooltype == "LAST") {
-      math::LastSeqPoolFunctor<T> last_pool;
-      last_pool(context, input, pad_value, output);
-      return;
-    }
-    if (pooltype == "FIRST") {
-      math::FirstSeqPoolFunctor<T> first_pool;
-      first_pool(context, input, pad_value, output);
-      return;
-    }
-    auto lod_level = input.lod().size();
-    auto lod = input.lod()[lod_level - 1];
-    if (pooltype == "SUM") {
-      auto place = context.GetPlace();
+                  float threshold = 0.96,
+                  int thread_num = 1) {
+    std::vector<Tensor*> indexes;
+    if (pooltype == "MAX" && !is_test) {
+      PADDLE_ENFORCE_NOT_NULL(
+          index, platform::errors::InvalidArgument(
+                     "The MAX pooling for training needs the index output."));
       PADDLE_ENFORCE_EQ(
-          platform::is_cpu_place(place), true,
+          index->dims(), output->dims(),
           platform::errors::InvalidArgument(
-              "Sequence_pool should run on CPU Device when pooltype is SUM"));
-      const T* src = input.data<T>();
-      T* dst = output->mutable_data<T>(place);
-      jit::seq_pool_attr_t attr(
-          static_cast<int>(input.numel() / input.dims()[0]),
-          jit::SeqPoolType::kSum);
-      auto seqpool =
-          jit::KernelFuncs<jit::SeqPoolTuple<T>, platform::CPUPlace>::Cache()
-              .At(attr);
-      for (int i = 0; i < static_cast<int>(lod.size()) - 1; ++i) {
-        attr.h = static_cast<int>(lod[i + 1] - lod[i]);
-        if (attr.h == 0) {
-          for (int j = 0; j < attr.w; ++j) {
-            dst[j] = pad_value;
-          }
-        } else {
-          seqpool(src, dst, &attr);
-        }
-        dst += attr.w;
-        src += attr.h * attr.w;
-      }
-      return;
-    }
-    auto& place = *context.eigen_device();
-    for (int i = 0; i < static_cast<int>(lod.size()) - 1; ++i) {
-      Tensor out_t = output->Slice(i, i + 1);
-      int64_t w = input.numel() / input.dims()[0];
-      if (lod[i] == lod[i + 1]) {
-        for (int j = 0; j < w; ++j) {
-          out_t.data<T>()[j] = pad_value;
-        }
-        continue;
-      }
-      Tensor in_t =
-          input.Slice(static_cast<int>(lod[i]), static_cast<int>(lod[i + 1]));
-      int64_t h = static_cast<int64_t>(lod[i + 1] - lod[i]);
-      auto in_e = EigenMatrix<T>::From(in_t, framework::make_ddim({h, w}));
-      auto out_e = EigenVector<T>::Flatten(out_t);
-      if (pooltype == "AVERAGE") {
-        out_e.device(place) = in_e.mean(Eigen::array<int, 1>({{0}}));
-      } else if (pooltype == "SQRT") {
-        out_e.device(place) = in_e.sum(Eigen::array<int, 1>({{0}})) /
-                              std::sqrt(static_cast<T>(h));
-      } else {
-        PADDLE_THROW(platform::errors::InvalidArgument(
-            "unsupported pooling pooltype: %s. Only support \"AVERAGE\" and "
-            "\"SQRT\"",
-            pooltype));
-      }
+              "The dimension of index and output shall be same. Expected %ld "
+              "== %ld, but got %ld != %ld. Please check the input value.",
+              index->dims(), output->dims(), index->dims(), output->dims()));
+      indexes.push_back(index);
     }
+    MultiSeqPoolFunctor<T> pool;
+    pool(context, pooltype, pad_value, {&input}, output, indexes, thread_num);
   }
 };
 
@@ -404,56 +223,87 @@ class SequencePoolGradFunctor<platform::CPUDeviceContext, T> {
                   const framework::LoDTensor& out_grad,
                   framework::LoDTensor* in_grad,
                   /* max pool has index */
-                  const framework::Tensor* index = nullptr) {
+                  const framework::Tensor* index = nullptr,
+                  int thread_num = 1) {
+    const int64_t out_w = SeqWidth(out_grad);
+    const int64_t in_w = SeqWidth(*in_grad);
+    PADDLE_ENFORCE_EQ(in_w, out_w,
+                      platform::errors::InvalidArgument(
+                          "The feature size of input@Grad and output@Grad "
+                          "shall be same. Expected %ld == %ld, but got %ld != "
+                          "%ld. Please check the input value.",
+                          in_w, out_w, in_w, out_w));
+    const int* max_index = nullptr;
     if (pooltype == "MAX") {
-      math::MaxSeqPoolGradFunctor<T> max_pool_grad;
-      max_pool_grad(context, out_grad, *index, in_grad);
-      return;
+      PADDLE_ENFORCE_NOT_NULL(
+          index, platform::errors::InvalidArgument(
+                     "The MAX pooling gradient needs the index input."));
+      PADDLE_ENFORCE_EQ(
+          index->dims(), out_grad.dims(),
+          platform::errors::InvalidArgument(
+              "The dimension of index and output@Grad shall be same. Expected "
+              "%ld == %ld, but got %ld != %ld. Please check the input value.",
+              index->dims(), out_grad.dims(), index->dims(), out_grad.dims()));
+      max_index = index->data<int>();
+    } else if (pooltype != "SUM" && pooltype != "AVERAGE" &&
+               pooltype != "SQRT" && pooltype != "LAST" &&
+               pooltype != "FIRST") {
+      PADDLE_THROW(platform::errors::InvalidArgument(
+          "unsupported pooling pooltype: %s. Only support \"AVERAGE\", "
+          "\"SUM\", \"SQRT\", \"MAX\", \"LAST\" and \"FIRST\"",
+          pooltype));
     }
 
-    if (pooltype == "LAST" || pooltype == "FIRST") {
-      // set X@Grad be zero at first when pooltype is LAST/FIRST
+    if (pooltype == "MAX" || pooltype == "LAST" || pooltype == "FIRST") {
+      // set X@Grad be zero at first when pooltype is MAX/LAST/FIRST
       math::SetConstant<platform::CPUDeviceContext, T> functor;
       functor(context, in_grad, 0);
     }
-
-    if (pooltype == "SUM") {
-      math::SumSeqPoolGradFunctor<T> sum_pool_grad;
-      sum_pool_grad(context, out_grad, in_grad);
-      return;
-    }
-
-    auto lod_level = in_grad->lod().size();
-    auto lod = in_grad->lod()[lod_level - 1];
-    auto& place = *context.eigen_device();
-    for (int i = 0; i < static_cast<int>(lod.size()) - 1; ++i) {
-      if (lod[i] == lod[i + 1]) continue;
-      auto in_g_t = in_grad->Slice(static_cast<int>(lod[i]),
-                                   static_cast<int>(lod[i + 1]));
-      auto out_g_t = out_grad.Slice(i, i + 1);
-      int64_t h = static_cast<int64_t>(lod[i + 1] - lod[i]);
-      int64_t w = in_grad->numel() / in_grad->dims()[0];
-      auto in_g_e = EigenMatrix<T>::From(in_g_t, {h, w});
-      auto out_g_e = EigenMatrix<T>::From(out_g_t, {1, w});
-      auto out_g_e_v = EigenVector<T>::Flatten(out_g_t);
-      Eigen::DSizes<int, 2> bcast(h, 1);
-
-      if (pooltype == "AVERAGE") {
-        in_g_e.device(place) = (out_g_e / static_cast<T>(h)).broadcast(bcast);
-      } else if (pooltype == "SQRT") {
-        in_g_e.device(place) =
-            (out_g_e / std::sqrt(static_cast<T>(h))).broadcast(bcast);
-      } else if (pooltype == "LAST") {
-        in_g_e.chip(h - 1, 0).device(place) = out_g_e_v;
-      } else if (pooltype == "FIRST") {
-        in_g_e.chip(0, 0).device(place) = out_g_e_v;
-      } else {
-        PADDLE_THROW(platform::errors::InvalidArgument(
-            "unsupported pooling pooltype: %s. Only support \"AVERAGE\", "
-            "\"SQRT\", \"LAST\" and \"FIRST\"",
-            pooltype));
-      }
-    }
+    const auto& lod = in_grad->lod().back();
+    const bool is_last = pooltype == "LAST";
+    const bool is_first = pooltype == "FIRST";
+    const bool is_sum = pooltype == "SUM";
+    const bool is_average = pooltype == "AVERAGE";
+    const int64_t seq_num = static_cast<int64_t>(lod.size()) - 1;
+    const T* og_data = out_grad.data<T>();
+    T* ig_data = in_grad->mutable_data<T>(context.GetPlace());
+    // Every sequence writes the gradient of its own rows only.
+    ParallelForRows(
+        seq_num,
+        SeqPoolThreadNum(static_cast<int64_t>(lod.back()) * in_w, thread_num),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t h = static_cast<int64_t>(lod[i + 1] - lod[i]);
+            const T* og = og_data + i * out_w;
+            T* ig = ig_data + lod[i] * in_w;
+            if (h == 0) continue;
+            if (max_index) {
+              const int* idx = max_index + i * out_w;
+              for (int64_t k = 0; k < out_w; ++k) {
+                if (idx[k] == -1) continue;
+                ig_data[idx[k] * in_w + k] = og[k];
+              }
+            } else if (is_last) {
+              std::memcpy(ig + (h - 1) * in_w, og, in_w * sizeof(T));
+            } else if (is_first) {
+              std::memcpy(ig, og, in_w * sizeof(T));
+            } else if (is_sum) {
+              for (int64_t r = 0; r < h; ++r, ig += in_w) {
+                std::memcpy(ig, og, in_w * sizeof(T));
+              }
+            } else {
+              const T scale = is_average
+                                  ? static_cast<T>(1) / static_cast<T>(h)
+                                  : static_cast<T>(1) /
+                                        std::sqrt(static_cast<T>(h));
+              for (int64_t r = 0; r < h; ++r, ig += in_w) {
+                for (int64_t k = 0; k < in_w; ++k) {
+                  ig[k] = og[k] * scale;
+                }
+              }
+            }
+          }
+        });
   }
 };
 
@@ -461,6 +311,8 @@ template class SequencePoolFunctor<platform::CPUDeviceContext, float>;
 template class SequencePoolFunctor<platform::CPUDeviceContext, double>;
 template class SequencePoolGradFunctor<platform::CPUDeviceContext, float>;
 template class SequencePoolGradFunctor<platform::CPUDeviceContext, double>;
+template class MultiSeqPoolFunctor<float>;
+template class MultiSeqPoolFunctor<double>;
 
 }  // namespace math
 }  // namespace operators
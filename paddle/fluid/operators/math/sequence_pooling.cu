@@ -202,7 +202,8 @@ class SequencePoolFunctor<platform::CUDADeviceContext, T> {
                   bool filter = false,
                   float show_coeff = 0.2,
                   float clk_coeff = 1,
-                  float threshold = 0.96) {
+                  float threshold = 0.96,
+                  int thread_num = 1) {
     auto lod_level = input.lod().size();
     auto& lod = input.lod()[lod_level - 1];
     const size_t item_dim = output->numel() / output->dims()[0];
@@ -377,7 +378,8 @@ class SequencePoolGradFunctor<platform::CUDADeviceContext, T> {
                   const framework::LoDTensor& out_grad,
                   framework::LoDTensor* in_grad,
                   /* max pool has index */
-                  const framework::Tensor* index = nullptr) {
+                  const framework::Tensor* index = nullptr,
+                  int thread_num = 1) {
     auto lod_level = in_grad->lod().size();
     auto& lod = in_grad->lod()[lod_level - 1];
     if (in_grad->dims()[0] == 0) {
@@ -14,6 +14,7 @@ limitations under the License. */
 
 #pragma once
 #include <string>
+#include <vector>
 #include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/tensor.h"
 #include "paddle/fluid/platform/device_context.h"
@@ -30,7 +31,9 @@ class SequencePoolFunctor {
                   T pad_value, const framework::LoDTensor& input,
                   framework::LoDTensor* output, bool is_test = false,
                   framework::Tensor* index = nullptr, bool filter = false,
-                  float show_coeff = 0.2, float clk_coeff = 1.0, float threshold = 0.96);
+                  float show_coeff = 0.2, float clk_coeff = 1.0, float threshold = 0.96,
+                  /* the CPU functor pools on thread_num threads */
+                  int thread_num = 1);
 };
 
 template <typename DeviceContext, typename T>
@@ -40,7 +43,26 @@ class SequencePoolGradFunctor {
                   const framework::LoDTensor& out_grad,
                   framework::LoDTensor* in_grad,
                   /* max pool has index */
-                  const framework::Tensor* index = nullptr);
+                  const framework::Tensor* index = nullptr,
+                  /* the CPU functor pools on thread_num threads */
+                  int thread_num = 1);
+};
+
+// Pools the sequences of several LoD tensors of one batch on CPU: the
+// pooled sequence i of inputs[j] is written to row i of the j-th column block
+// of output, i.e. the pooled inputs are concatenated along axis 1. Chunks of
+// sequences are pooled on thread_num threads, SUM, AVERAGE and SQRT by the
+// jit SeqPool kernel. For MAX, index is empty or holds an index tensor of
+// every input, shaped as its pooled result.
+template <typename T>
+class MultiSeqPoolFunctor {
+ public:
+  void operator()(const platform::CPUDeviceContext& context,
+                  const std::string& pooltype, T pad_value,
+                  const std::vector<const framework::LoDTensor*>& inputs,
+                  framework::Tensor* output,
+                  const std::vector<framework::Tensor*>& index,
+                  int thread_num);
 };
 
 }  // namespace math
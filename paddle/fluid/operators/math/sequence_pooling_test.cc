@@ -14,6 +14,12 @@ limitations under the License. */
 
 #include "paddle/fluid/operators/math/sequence_pooling.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 template <typename DeviceContext, typename T>
@@ -124,6 +130,187 @@ TEST(SequencePoolingGrad, CPU_SUM) {
                                                                     lod2, 128);
 }
 
+// A slot of a batch of sequence_len sequences on average, some empty.
+static void RandomSlot(size_t batch_size, int sequence_len, int64_t width,
+                       std::mt19937 *rng,
+                       paddle::framework::LoDTensor *slot) {
+  std::uniform_int_distribution<int> len(0, 2 * sequence_len);
+  std::uniform_real_distribution<float> value(-1.f, 1.f);
+  paddle::framework::LoD lod(1, std::vector<size_t>(1, 0));
+  for (size_t i = 0; i < batch_size; ++i) {
+    lod[0].push_back(lod[0].back() + len(*rng));
+  }
+  slot->set_lod(lod);
+  float *data = slot->mutable_data<float>(
+      paddle::framework::make_ddim(
+          {static_cast<int64_t>(lod[0].back()), width}),
+      paddle::platform::CPUPlace());
+  for (int64_t i = 0; i < slot->numel(); ++i) {
+    data[i] = value(*rng);
+  }
+}
+
+TEST(MultiSeqPool, CPU) {
+  paddle::platform::CPUPlace place;
+  paddle::platform::CPUDeviceContext context(place);
+  std::mt19937 rng(0);
+  const size_t batch_size = 300;
+  const std::vector<int64_t> widths = {8, 5, 8};
+  std::vector<paddle::framework::LoDTensor> slots(widths.size());
+  std::vector<const paddle::framework::LoDTensor *> inputs;
+  for (size_t j = 0; j < slots.size(); ++j) {
+    RandomSlot(batch_size, 3, widths[j], &rng, &slots[j]);
+    inputs.push_back(&slots[j]);
+  }
+  const int64_t out_width = 21;
+  const float pad_value = 7.f;
+
+  for (std::string pooltype :
+       {"SUM", "AVERAGE", "SQRT", "MAX", "LAST", "FIRST"}) {
+    std::vector<paddle::framework::Tensor> outputs(2);
+    std::vector<paddle::framework::Tensor> indexes(2 * slots.size());
+    for (int t = 0; t < 2; ++t) {
+      outputs[t].mutable_data<float>(
+          paddle::framework::make_ddim(
+              {static_cast<int64_t>(batch_size), out_width}),
+          place);
+      std::vector<paddle::framework::Tensor *> index;
+      for (size_t j = 0; j < slots.size(); ++j) {
+        auto *idx = &indexes[t * slots.size() + j];
+        idx->mutable_data<int>(
+            paddle::framework::make_ddim(
+                {static_cast<int64_t>(batch_size), widths[j]}),
+            place);
+        index.push_back(idx);
+      }
+      paddle::operators::math::MultiSeqPoolFunctor<float> pool;
+      pool(context, pooltype, pad_value, inputs, &outputs[t],
+           pooltype == "MAX" ? index
+                             : std::vector<paddle::framework::Tensor *>(),
+           t == 0 ? 1 : 4);
+    }
+
+    const float *out = outputs[0].data<float>();
+    for (int64_t k = 0; k < outputs[0].numel(); ++k) {
+      EXPECT_EQ(out[k], outputs[1].data<float>()[k]);
+    }
+    int64_t col = 0;
+    for (size_t j = 0; j < slots.size(); ++j) {
+      const auto &lod = slots[j].lod()[0];
+      const float *in = slots[j].data<float>();
+      const int *max_index = indexes[j].data<int>();
+      const int64_t w = widths[j];
+      for (size_t i = 0; i < batch_size; ++i) {
+        const int64_t h = lod[i + 1] - lod[i];
+        for (int64_t k = 0; k < w; ++k) {
+          float expected = pad_value;
+          int expected_index = -1;
+          if (h > 0 && (pooltype == "LAST" || pooltype == "FIRST")) {
+            expected = in[(pooltype == "LAST" ? lod[i + 1] - 1 : lod[i]) * w +
+                          k];
+          } else if (h > 0 && pooltype == "MAX") {
+            expected = in[lod[i] * w + k];
+            expected_index = static_cast<int>(lod[i]);
+            for (size_t r = lod[i] + 1; r < lod[i + 1]; ++r) {
+              if (in[r * w + k] > expected) {
+                expected = in[r * w + k];
+                expected_index = static_cast<int>(r);
+              }
+            }
+            EXPECT_EQ(max_index[i * w + k], expected_index);
+          } else if (h > 0) {
+            expected = 0.f;
+            for (size_t r = lod[i]; r < lod[i + 1]; ++r) {
+              expected += in[r * w + k];
+            }
+            if (pooltype == "AVERAGE") {
+              expected /= h;
+            } else if (pooltype == "SQRT") {
+              expected /= std::sqrt(static_cast<float>(h));
+            }
+          }
+          EXPECT_NEAR(out[i * out_width + col + k], expected, 1e-5)
+              << pooltype << " of sequence " << i << " of slot " << j;
+        }
+      }
+      col += w;
+    }
+  }
+}
+
+// The pooling of 200 short slots of a batch one by one by
+// SequencePoolFunctor, against all of them in one MultiSeqPoolFunctor call.
+// Run with --gtest_also_run_disabled_tests.
+TEST(MultiSeqPool, DISABLED_CPUBenchmark) {
+  paddle::platform::CPUPlace place;
+  paddle::platform::CPUDeviceContext context(place);
+  std::mt19937 rng(0);
+  const size_t slot_num = 200;
+  const size_t batch_size = 2048;
+  const int64_t width = 16;
+  const int repeat = 10;
+  const int thread_num =
+      std::max(2, std::min(8, static_cast<int>(
+                                  std::thread::hardware_concurrency())));
+  std::vector<paddle::framework::LoDTensor> slots(slot_num);
+  std::vector<const paddle::framework::LoDTensor *> inputs;
+  for (auto &slot : slots) {
+    RandomSlot(batch_size, 2, width, &rng, &slot);
+    inputs.push_back(&slot);
+  }
+  auto seconds_since = [](std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  for (std::string pooltype : {"SUM", "AVERAGE", "MAX"}) {
+    std::vector<paddle::framework::LoDTensor> outs(slot_num);
+    std::vector<paddle::framework::Tensor> indexes(slot_num);
+    for (size_t j = 0; j < slot_num; ++j) {
+      auto dims = paddle::framework::make_ddim(
+          {static_cast<int64_t>(batch_size), width});
+      outs[j].mutable_data<float>(dims, place);
+      indexes[j].mutable_data<int>(dims, place);
+    }
+    auto start = std::chrono::steady_clock::now();
+    paddle::operators::math::SequencePoolFunctor<
+        paddle::platform::CPUDeviceContext, float>
+        pool;
+    for (int r = 0; r < repeat; ++r) {
+      for (size_t j = 0; j < slot_num; ++j) {
+        pool(context, pooltype, 0.f, slots[j], &outs[j], false, &indexes[j]);
+      }
+    }
+    double slot_seconds = seconds_since(start) / repeat;
+
+    paddle::framework::Tensor out;
+    out.mutable_data<float>(
+        paddle::framework::make_ddim(
+            {static_cast<int64_t>(batch_size),
+             static_cast<int64_t>(slot_num) * width}),
+        place);
+    std::vector<paddle::framework::Tensor *> index;
+    for (auto &idx : indexes) {
+      index.push_back(&idx);
+    }
+    for (int threads : {1, thread_num}) {
+      start = std::chrono::steady_clock::now();
+      paddle::operators::math::MultiSeqPoolFunctor<float> multi_pool;
+      for (int r = 0; r < repeat; ++r) {
+        multi_pool(context, pooltype, 0.f, inputs, &out,
+                   pooltype == "MAX"
+                       ? index
+                       : std::vector<paddle::framework::Tensor *>(),
+                   threads);
+      }
+      LOG(INFO) << pooltype << " of " << slot_num << " slots, one by one: "
+                << slot_seconds << " s, in one call on " << threads
+                << " threads: " << seconds_since(start) / repeat << " s";
+    }
+  }
+}
+
 #ifdef PADDLE_WITH_CUDA
 TEST(SequencePoolingGrad, CUDA_SUM) {
   auto place = paddle::platform::CUDAPlace(0);
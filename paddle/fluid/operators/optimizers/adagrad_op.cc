@@ -17,8 +17,10 @@ limitations under the License. */
 
 #include <cmath>
 
+#include "paddle/fluid/operators/jit/kernels.h"
 #include "paddle/fluid/operators/math/math_function.h"
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
+#include "paddle/fluid/operators/optimizers/sparse_row_update.h"
 
 namespace paddle {
 namespace operators {
@@ -116,30 +118,34 @@ struct SparseAdagradFunctor<platform::CPUDeviceContext, T> {
                   framework::Tensor* moment, framework::Tensor* param) {
     // 1. g_m.rows = set(g.rows)
     auto grad_width = grad.value().dims()[1];
-    math::scatter::MergeAdd<platform::CPUDeviceContext, T> merge_func;
-    auto grad_merge = merge_func(context, grad);
+    int thread_num = SparseUpdateThreadNum(grad.rows().size(), grad_width);
+    framework::SelectedRows grad_merge;
+    math::scatter::ParallelMergeAdd<T>(context, {&grad}, &grad_merge, false,
+                                       thread_num);
     auto& merge_rows = grad_merge.rows();
+    if (merge_rows.size() == 0) {
+      return;
+    }
     auto* grad_merge_data = grad_merge.mutable_value()->template data<T>();
 
-    // 2. m += g_m * g_m
-    auto grad_square =
-        SquareSelectedRows<platform::CPUDeviceContext, T>(context, grad_merge);
-
-    math::SelectedRowsAddToTensor<platform::CPUDeviceContext, T> functor;
-    functor(context, grad_square, moment);
-
-    // 3. update parameter
-    auto* lr = learning_rate.data<T>();
-    auto* param_data = param->data<T>();
-    auto* moment_data = moment->data<T>();
-
-    for (size_t i = 0; i < merge_rows.size(); i++) {
-      for (int64_t j = 0; j < grad_width; j++) {
-        param_data[merge_rows[i] * grad_width + j] -=
-            lr[0] * grad_merge_data[i * grad_width + j] /
-            (std::sqrt(moment_data[merge_rows[i] * grad_width + j]) + epsilon);
-      }
-    }
+    // 2. m += g_m * g_m, param -= lr * g_m / (sqrt(m) + epsilon), in a
+    // single pass over the merged rows, which are disjoint and updated by
+    // thread_num threads
+    T coefs[2] = {learning_rate.data<T>()[0], epsilon};
+    jit::opt_attr_t attr(param->dims()[0], grad_width,
+                         static_cast<int64_t>(merge_rows.size()));
+    auto adagrad =
+        jit::KernelFuncs<jit::AdagradTuple<T>, platform::CPUPlace>::Cache().At(
+            attr);
+    math::ParallelForRows(
+        static_cast<int64_t>(merge_rows.size()), thread_num,
+        [&](int64_t begin, int64_t end) {
+          jit::opt_attr_t range_attr(param->dims()[0], grad_width,
+                                     end - begin);
+          adagrad(coefs, grad_merge_data + begin * grad_width,
+                  merge_rows.data() + begin, param->data<T>(),
+                  moment->data<T>(), &range_attr);
+        });
   }
 };
 
@@ -16,12 +16,13 @@ limitations under the License. */
 #include <math.h>  // for sqrt in CPU and CUDA
 #include <Eigen/Dense>
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/threadpool.h"
+#include "paddle/fluid/operators/jit/kernels.h"
 #include "paddle/fluid/operators/math/algorithm.h"
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
+#include "paddle/fluid/operators/optimizers/sparse_row_update.h"
 #include "paddle/fluid/platform/for_range.h"
 
 namespace paddle {
@@ -475,16 +476,17 @@ class AdamOpKernel : public framework::OpKernel<T> {
         }
       }
 
+      int thread_num = SparseUpdateThreadNum(
+          cpu_rows.size(), grad->value().numel() / cpu_rows.size());
       framework::SelectedRows tmp_grad_merge;
       const framework::SelectedRows* grad_merge_ptr;
       if (is_strict_sorted) {
         grad_merge_ptr = grad;
       } else {
-        // merge duplicated rows if any.
-        // The rows of grad_merge have been sorted inside MergeAdd functor
-        scatter::MergeAdd<DeviceContext, T> merge_func;
-        merge_func(ctx.template device_context<DeviceContext>(), *grad,
-                   &tmp_grad_merge, true);
+        // merge duplicated rows if any, into sorted rows
+        scatter::ParallelMergeAdd<T>(
+            ctx.template device_context<platform::CPUDeviceContext>(), {grad},
+            &tmp_grad_merge, true, thread_num);
         grad_merge_ptr = &tmp_grad_merge;
       }
 
@@ -509,12 +511,39 @@ class AdamOpKernel : public framework::OpKernel<T> {
       if (lazy_mode) {
         VLOG(3) << "run cpu lazy mode";
         size_t row_count = grad_merge.rows().size();
-        std::vector<int64_t> cpu_rows(grad_merge.rows());
-        for (size_t row_index = 0; row_index < row_count; ++row_index) {
-          for (size_t offset = 0; offset < row_numel; ++offset) {
-            size_t i = cpu_rows[row_index] * row_numel + offset;
-            functor.adam_update(i, grad_data[row_index * row_numel + offset]);
-          }
+        if (param_out->data<T>() == param->data<T>() &&
+            mom1_out->data<T>() == mom1->data<T>() &&
+            mom2_out->data<T>() == mom2->data<T>()) {
+          // update the selected rows in place in a single pass
+          T b1_pow = beta1_pow->data<T>()[0];
+          T b2_pow = beta2_pow->data<T>()[0];
+          T coefs[4] = {lr->data<T>()[0] * sqrt(1 - b2_pow) / (1 - b1_pow),
+                        beta1, beta2, epsilon * sqrt(1 - b2_pow)};
+          jit::opt_attr_t attr(param->dims()[0], row_numel, row_count);
+          auto adam = jit::KernelFuncs<jit::AdamTuple<T>,
+                                       platform::CPUPlace>::Cache()
+                          .At(attr);
+          // the merged rows are disjoint, each thread updates a range
+          math::ParallelForRows(
+              row_count, thread_num, [&](int64_t begin, int64_t end) {
+                jit::opt_attr_t range_attr(param->dims()[0], row_numel,
+                                           end - begin);
+                adam(coefs, grad_data + begin * row_numel, rows + begin,
+                     param_out->data<T>(), mom1_out->data<T>(),
+                     mom2_out->data<T>(), &range_attr);
+              });
+        } else {
+          math::ParallelForRows(
+              row_count, thread_num, [&](int64_t begin, int64_t end) {
+                for (int64_t row_index = begin; row_index < end;
+                     ++row_index) {
+                  for (size_t offset = 0; offset < row_numel; ++offset) {
+                    size_t i = rows[row_index] * row_numel + offset;
+                    functor.adam_update(
+                        i, grad_data[row_index * row_numel + offset]);
+                  }
+                }
+              });
         }
       }
 #ifndef _WIN32
@@ -529,17 +558,15 @@ class AdamOpKernel : public framework::OpKernel<T> {
           VLOG(1) << "FLAGS_inner_op_parallelism " << FLAGS_inner_op_parallelism
                   << " is two large!";
         }
-        auto& grad_rows = grad_merge.rows();
-        std::unordered_map<size_t, int> row_id_to_grad_row_offset;
+        // the rows of grad_merge are sorted, each thread walks the rows in
+        // its range along with them
+        const int64_t* grad_rows_end = rows + grad_merge.rows().size();
         size_t param_row_count = param->numel() / row_numel;
         if (param_row_count < 1000) {
           VLOG(1) << "param_row_count should be larger then 1000 to use "
                      "multi thread, currently "
                   << param_row_count;
         }
-        for (size_t i = 0; i < grad_rows.size(); ++i) {
-          row_id_to_grad_row_offset[grad_rows[i]] = i;
-        }
         std::vector<std::future<void>> fs;
         int64_t line_in_each_thread =
             param_row_count / FLAGS_inner_op_parallelism + 1;
@@ -552,17 +579,19 @@ class AdamOpKernel : public framework::OpKernel<T> {
           if (end > static_cast<int64_t>(param_row_count)) {
             end = static_cast<int64_t>(param_row_count);
           }
-          fs.push_back(framework::Async([&functor, &row_id_to_grad_row_offset,
+          fs.push_back(framework::Async([&functor, rows, grad_rows_end,
                                          &grad_data, row_numel, start, end]() {
+            const int64_t* grad_row =
+                std::lower_bound(rows, grad_rows_end, start);
             for (int64_t row_id = start; row_id < end; ++row_id) {
-              auto iter = row_id_to_grad_row_offset.find(row_id);
-              if (iter != row_id_to_grad_row_offset.end()) {
+              if (grad_row != grad_rows_end && *grad_row == row_id) {
+                size_t grad_offset = (grad_row - rows) * row_numel;
                 for (size_t row_offset = 0U; row_offset < row_numel;
                      ++row_offset) {
-                  functor.adam_update(
-                      row_id * row_numel + row_offset,
-                      grad_data[iter->second * row_numel + row_offset]);
+                  functor.adam_update(row_id * row_numel + row_offset,
+                                      grad_data[grad_offset + row_offset]);
                 }
+                ++grad_row;
               } else {
                 for (size_t row_offset = 0U; row_offset < row_numel;
                      ++row_offset) {
@@ -15,7 +15,9 @@ limitations under the License. */
 #pragma once
 #include "paddle/fluid/framework/eigen.h"
 #include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/operators/jit/kernels.h"
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
+#include "paddle/fluid/operators/optimizers/sparse_row_update.h"
 #include "paddle/fluid/platform/for_range.h"
 
 namespace paddle {
@@ -185,6 +187,43 @@ class FTRLOpKernel : public framework::OpKernel<T> {
 
       framework::SelectedRows tmp_merged_grad;
       framework::SelectedRows* merged_grad = &tmp_merged_grad;
+
+      if (platform::is_cpu_place(ctx.GetPlace()) &&
+          param_out->data<T>() == param_in->data<T>() &&
+          sq_accum_out->data<T>() == sq_accum_in->data<T>()) {
+        auto row_numel = static_cast<int64_t>(grad->value().dims()[1]);
+        int thread_num = SparseUpdateThreadNum(grad->rows().size(), row_numel);
+        math::scatter::ParallelMergeAdd<T>(
+            static_cast<const platform::CPUDeviceContext&>(
+                ctx.device_context()),
+            {grad}, merged_grad, false, thread_num);
+        if (merged_grad->rows().size() == 0) {
+          return;
+        }
+        const int64_t* rows = merged_grad->rows().data();
+        const T* grad_data = merged_grad->value().data<T>();
+        auto row_height = static_cast<int64_t>(merged_grad->rows().size());
+
+        // update the selected rows in place in a single pass, the merged
+        // rows are disjoint and updated by thread_num threads
+        T coefs[3] = {lr_in->data<T>()[0], l1, l2};
+        jit::opt_attr_t attr(param_in->dims()[0], row_numel, row_height,
+                             static_cast<float>(lr_power));
+        auto ftrl =
+            jit::KernelFuncs<jit::FtrlTuple<T>, platform::CPUPlace>::Cache()
+                .At(attr);
+        math::ParallelForRows(
+            row_height, thread_num, [&](int64_t begin, int64_t end) {
+              jit::opt_attr_t range_attr(param_in->dims()[0], row_numel,
+                                         end - begin,
+                                         static_cast<float>(lr_power));
+              ftrl(coefs, grad_data + begin * row_numel, rows + begin,
+                   param_out->data<T>(), sq_accum_out->data<T>(),
+                   lin_accum_out->data<T>(), &range_attr);
+            });
+        return;
+      }
+
       math::scatter::MergeAdd<DeviceContext, T> merge_func;
       merge_func(ctx.template device_context<DeviceContext>(), *grad,
                  merged_grad);
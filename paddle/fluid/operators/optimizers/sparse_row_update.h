@@ -0,0 +1,44 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <algorithm>
+
+#include "gflags/gflags.h"
+#include "paddle/fluid/operators/math/selected_rows_functor.h"
+
+DECLARE_int32(inner_op_parallelism);
+
+namespace paddle {
+namespace operators {
+
+// Once the duplicated rows of a sparse gradient are merged by
+// math::scatter::ParallelMergeAdd, the optimizers update disjoint rows of the
+// parameter and its accumulators, so the merged rows are split into ranges
+// updated by different threads with math::ParallelForRows.
+
+// The least number of values updated by a thread.
+constexpr int64_t kMinSparseUpdateNumelPerThread = 1 << 16;
+
+// The number of threads to update row_count rows of width values, at most
+// FLAGS_inner_op_parallelism.
+inline int SparseUpdateThreadNum(int64_t row_count, int64_t width) {
+  int64_t thread_num = row_count * width / kMinSparseUpdateNumelPerThread;
+  thread_num = std::min<int64_t>(thread_num, FLAGS_inner_op_parallelism);
+  return static_cast<int>(std::max<int64_t>(thread_num, 1));
+}
+
+}  // namespace operators
+}  // namespace paddle
@@ -0,0 +1,140 @@
+/* Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/operators/optimizers/sparse_row_update.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "paddle/fluid/operators/jit/kernels.h"
+#include "paddle/fluid/operators/math/selected_rows_functor.h"
+
+namespace paddle {
+namespace operators {
+
+static void MakeGrad(int64_t row_num, int64_t height, int64_t width,
+                     framework::SelectedRows* grad) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<int64_t> rows(row_num);
+  for (auto& row : rows) {
+    row = rng() % height;
+  }
+  grad->set_rows(rows);
+  grad->set_height(height);
+  float* data = grad->mutable_value()->mutable_data<float>(
+      framework::make_ddim({row_num, width}), platform::CPUPlace());
+  for (int64_t i = 0; i < row_num * width; ++i) {
+    data[i] = dist(rng);
+  }
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// The adam update of ranges of the merged rows on several threads is the
+// update of all the rows on one thread.
+TEST(SparseRowUpdate, ParallelAdam) {
+  const int64_t height = 2000;
+  const int64_t width = 16;
+  framework::SelectedRows grad;
+  MakeGrad(20000, height, width, &grad);
+  platform::CPUPlace cpu_place;
+  platform::CPUDeviceContext ctx(cpu_place);
+  framework::SelectedRows merged;
+  math::scatter::MergeAdd<platform::CPUDeviceContext, float> merge_func;
+  merge_func(ctx, grad, &merged, true);
+  const float* grad_data = merged.value().data<float>();
+  const int64_t* rows = merged.rows().data();
+  const int64_t row_count = merged.rows().size();
+
+  float coefs[4] = {0.001f, 0.9f, 0.999f, 1e-8f};
+  jit::opt_attr_t attr(height, width, row_count);
+  auto adam =
+      jit::KernelFuncs<jit::AdamTuple<float>, platform::CPUPlace>::Cache().At(
+          attr);
+  std::vector<std::vector<float>> params(2);
+  std::vector<std::vector<float>> moments(4);
+  for (int t = 0; t < 2; ++t) {
+    params[t].assign(height * width, 0.5f);
+    moments[2 * t].assign(height * width, 0.1f);
+    moments[2 * t + 1].assign(height * width, 0.2f);
+  }
+  adam(coefs, grad_data, rows, params[0].data(), moments[0].data(),
+       moments[1].data(), &attr);
+  math::ParallelForRows(row_count, 4, [&](int64_t begin, int64_t end) {
+    jit::opt_attr_t range_attr(height, width, end - begin);
+    adam(coefs, grad_data + begin * width, rows + begin, params[1].data(),
+         moments[2].data(), moments[3].data(), &range_attr);
+  });
+  EXPECT_EQ(params[0], params[1]);
+  EXPECT_EQ(moments[0], moments[2]);
+  EXPECT_EQ(moments[1], moments[3]);
+}
+
+// The merge and the sparse adam update of a 1M-row grad, on one thread and
+// on several threads. Run with --gtest_also_run_disabled_tests.
+TEST(SparseRowUpdate, DISABLED_Benchmark) {
+  const int64_t row_num = 1000000;
+  const int64_t height = 4000000;
+  const int64_t width = 16;
+  const int thread_num =
+      std::max(2, std::min(8, static_cast<int>(
+                                  std::thread::hardware_concurrency())));
+  framework::SelectedRows grad;
+  MakeGrad(row_num, height, width, &grad);
+
+  std::vector<float> param(height * width, 0.5f);
+  std::vector<float> mom1(height * width, 0.f);
+  std::vector<float> mom2(height * width, 0.f);
+  float coefs[4] = {0.001f, 0.9f, 0.999f, 1e-8f};
+  jit::opt_attr_t attr(height, width, 0);
+  auto adam =
+      jit::KernelFuncs<jit::AdamTuple<float>, platform::CPUPlace>::Cache().At(
+          attr);
+  platform::CPUPlace cpu_place;
+  platform::CPUDeviceContext ctx(cpu_place);
+
+  for (int threads : {1, thread_num}) {
+    auto start = std::chrono::steady_clock::now();
+    framework::SelectedRows merged;
+    math::scatter::ParallelMergeAdd<float>(ctx, {&grad}, &merged, true,
+                                           threads);
+    double merge_seconds = SecondsSince(start);
+    const float* grad_data = merged.value().data<float>();
+    const int64_t* rows = merged.rows().data();
+    start = std::chrono::steady_clock::now();
+    math::ParallelForRows(merged.rows().size(), threads,
+                          [&](int64_t begin, int64_t end) {
+                            jit::opt_attr_t range_attr(height, width,
+                                                       end - begin);
+                            adam(coefs, grad_data + begin * width,
+                                 rows + begin, param.data(), mom1.data(),
+                                 mom2.data(), &range_attr);
+                          });
+    LOG(INFO) << row_num << " rows of width " << width << " on " << threads
+              << " threads, merge: " << merge_seconds
+              << " s, adam: " << SecondsSince(start) << " s";
+  }
+}
+
+}  // namespace operators
+}  // namespace paddle
@@ -75,6 +75,12 @@ to a file on disk.
                   "(boolean, default false)"
                   "If true, the variables will be saved to binary strings.")
         .SetDefault(false);
+    AddAttr<bool>("save_as_mmap",
+                  "(boolean, default false)"
+                  "If true, the variables will be saved with aligned "
+                  "payloads and an index, so that load_combine_op can "
+                  "memory map them instead of reading them.")
+        .SetDefault(false);
     AddOutput("Y",
               "(RAW, default empty)."
               "This output is used when saving variables to binary strings.")
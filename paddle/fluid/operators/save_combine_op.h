@@ -19,11 +19,14 @@ limitations under the License. */
 #include <numeric>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "paddle/fluid/framework/data_type.h"
 #include "paddle/fluid/framework/data_type_transform.h"
 #include "paddle/fluid/framework/framework.pb.h"
 #include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/framework/mmap_params.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/platform/device_context.h"
 #include "paddle/fluid/platform/port.h"
@@ -39,6 +42,7 @@ class SaveCombineOpKernel : public framework::OpKernel<T> {
     auto overwrite = ctx.Attr<bool>("overwrite");
     auto save_as_fp16 = ctx.Attr<bool>("save_as_fp16");
     auto save_to_memory = ctx.Attr<bool>("save_to_memory");
+    auto save_as_mmap = ctx.Attr<bool>("save_as_mmap");
     auto output = ctx.Output<std::string>("Y");
 
     bool is_present = FileExists(filename);
@@ -61,6 +65,8 @@ class SaveCombineOpKernel : public framework::OpKernel<T> {
     // get device context from pool
     platform::DeviceContextPool &pool = platform::DeviceContextPool::Instance();
     auto &dev_ctx = *pool.Get(place);
+    // The CPU tensors to save in the memory mapped format.
+    std::vector<framework::LoDTensor> mmap_tensors;
 
     for (size_t i = 0; i < inp_var_names.size(); i++) {
       PADDLE_ENFORCE_NOT_NULL(
@@ -92,11 +98,36 @@ class SaveCombineOpKernel : public framework::OpKernel<T> {
         // copy LoD info to the new tensor
         out.set_lod(tensor.lod());
         framework::TransDataType(in_kernel_type, out_kernel_type, tensor, &out);
-        framework::SerializeToStream(ss, out, dev_ctx);
+        if (save_as_mmap) {
+          mmap_tensors.emplace_back(std::move(out));
+        } else {
+          framework::SerializeToStream(ss, out, dev_ctx);
+        }
+      } else if (save_as_mmap) {
+        mmap_tensors.emplace_back(tensor);
       } else {
         framework::SerializeToStream(ss, tensor, dev_ctx);
       }
     }
+    if (save_as_mmap) {
+      PADDLE_ENFORCE_EQ(save_to_memory, false,
+                        platform::errors::InvalidArgument(
+                            "save_as_mmap cannot be used with save_to_memory "
+                            "in save_combine_op."));
+      std::vector<const framework::LoDTensor *> tensors;
+      for (auto &tensor : mmap_tensors) {
+        if (!platform::is_cpu_place(tensor.place())) {
+          framework::LoDTensor cpu_tensor;
+          framework::TensorCopySync(tensor, platform::CPUPlace(), &cpu_tensor);
+          cpu_tensor.set_lod(tensor.lod());
+          tensor = std::move(cpu_tensor);
+        }
+        tensors.push_back(&tensor);
+      }
+      MkDirRecursively(DirName(filename).c_str());
+      framework::MmapParamsFile::Save(filename, inp_var_names, tensors);
+      return;
+    }
     if (save_to_memory) {
       PADDLE_ENFORCE_NE(output, nullptr,
                         platform::errors::InvalidArgument(
@@ -344,3 +344,46 @@ TEST(SaveLoadTestWithCombineOp, CPU) {
     }
   }
 }
+
+// Save with save_as_mmap, load_combine_op maps the file instead of reading it
+TEST(SaveLoadCombineMmapOp, CPU) {
+  paddle::framework::Scope scope;
+  paddle::platform::CPUPlace place;
+
+  std::vector<int> lod1 = {0, 1, 2, 3, 10};
+  int numel1 = 100;
+  paddle::framework::LoD expect_lod1;
+  float* expect1 = CreateForSaveCombineOp<float, float>(
+      10, 10, lod1, "test_var1", place, &scope, &expect_lod1);
+
+  std::vector<int> lod2 = {0, 2, 5, 7};
+  int numel2 = 21;
+  paddle::framework::LoD expect_lod2;
+  int* expect2 = CreateForSaveCombineOp<int, int>(7, 3, lod2, "test_var2",
+                                                  place, &scope, &expect_lod2);
+
+  paddle::framework::AttributeMap save_attrs;
+  save_attrs.insert({"file_path", std::string("check_tensor_mmap.ls")});
+  save_attrs.insert({"save_as_mmap", true});
+  auto save_combine_op = paddle::framework::OpRegistry::CreateOp(
+      "save_combine", {{"X", {"test_var1", "test_var2"}}}, {}, save_attrs);
+  save_combine_op->Run(scope, place);
+
+  auto target1 = GeneratePlaceholderBeforeLoad("out_var1", &scope);
+  auto target2 = GeneratePlaceholderBeforeLoad("out_var2", &scope);
+  paddle::framework::AttributeMap load_attrs;
+  load_attrs.insert({"file_path", std::string("check_tensor_mmap.ls")});
+  auto load_combine_op = paddle::framework::OpRegistry::CreateOp(
+      "load_combine", {}, {{"Out", {"out_var1", "out_var2"}}}, load_attrs);
+  load_combine_op->Run(scope, place);
+
+  paddle::framework::LoD actual_lod1, actual_lod2;
+  float* actual1 =
+      GetValuesAfterLoadCombineOp<float>(target1, scope, &actual_lod1);
+  int* actual2 = GetValuesAfterLoadCombineOp<int>(target2, scope, &actual_lod2);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(actual1) % 64, 0UL);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(actual2) % 64, 0UL);
+  CheckValues<float, float>(expect1, actual1, expect_lod1, actual_lod1,
+                            numel1);
+  CheckValues<int, int>(expect2, actual2, expect_lod2, actual_lod2, numel2);
+}
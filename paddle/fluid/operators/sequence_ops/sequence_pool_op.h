@@ -14,11 +14,14 @@ limitations under the License. */
 
 #pragma once
 #include <string>
+#include "gflags/gflags.h"
 #include "paddle/fluid/framework/eigen.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/operators/math/math_function.h"
 #include "paddle/fluid/operators/math/sequence_pooling.h"
 
+DECLARE_int32(inner_op_parallelism);
+
 namespace paddle {
 namespace operators {
 
@@ -88,7 +91,7 @@ class SequencePoolKernel : public framework::OpKernel<T> {
     math::SequencePoolFunctor<DeviceContext, T> pool;
     pool(context.template device_context<DeviceContext>(), pooltype, pad_value,
          *in, out, is_test, index, need_filter, show_coeff, clk_coeff,
-         threshold);
+         threshold, FLAGS_inner_op_parallelism);
   }
 };
 
@@ -106,7 +109,7 @@ class SequencePoolGradKernel : public framework::OpKernel<T> {
     in_g->mutable_data<T>(context.GetPlace());
     math::SequencePoolGradFunctor<DeviceContext, T> pool;
     pool(context.template device_context<DeviceContext>(), pooltype, *out_g,
-         in_g, index);
+         in_g, index, FLAGS_inner_op_parallelism);
   }
 };
 
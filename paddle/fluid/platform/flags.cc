@@ -303,8 +303,8 @@ DEFINE_double(memory_fraction_of_eager_deletion, 1.0,
  * Allocator related FLAG
  * Name: FLAGS_allocator_strategy
  * Since Version: 1.2
- * Value Range: string, {naive_best_fit, auto_growth, thread_local},
- * default=auto_growth
+ * Value Range: string, {naive_best_fit, auto_growth, thread_local,
+ *              sample_pool, binned_auto_growth}, default=auto_growth
  * Example:
  * Note: For selecting allocator policy of PaddlePaddle.
  */
@@ -325,7 +325,26 @@ DEFINE_string(
     "size of models may be larger). auto_growth strategy would allocate "
     "GPU memory on demand, which allows users to start several Paddle jobs "
     "on the same GPU card but may lead to more memory fragmentation "
-    "(i.e., maximum batch size of models may be smaller).");
+    "(i.e., maximum batch size of models may be smaller). "
+    "binned_auto_growth is auto_growth with size-binned free lists and "
+    "per-thread caches of freed blocks, for many threads sharing a device.");
+
+/**
+ * Allocator related FLAG
+ * Name: FLAGS_cpu_allocator_strategy
+ * Since Version: 2.0
+ * Value Range: string, {naive_best_fit, size_class}, default=naive_best_fit
+ * Example: FLAGS_cpu_allocator_strategy=size_class
+ * Note: For selecting the CPU allocator policy, FLAGS_allocator_strategy only
+ *       changes the GPU side. size_class serves small requests from per-thread
+ *       size class caches over huge-page, NUMA-local chunks.
+ */
+DEFINE_string(cpu_allocator_strategy, "naive_best_fit",
+              "The CPU allocation strategy, enum in [naive_best_fit, "
+              "size_class]. naive_best_fit means the buddy allocator shared "
+              "by all threads. size_class means the thread-caching size class "
+              "allocator, which is faster for many small allocations from "
+              "many threads.");
 
 /**
  * Memory related FLAG
@@ -490,6 +509,20 @@ DEFINE_bool(padbox_dataset_disable_shuffle, false,
             "if true ,will disable data shuffle");
 DEFINE_int32(padbox_slotrecord_extend_dim, 0, "paddlebox pcoc extend dim");
 DEFINE_bool(padbox_auc_runner_mode, false, "auc runner mode");
+DEFINE_bool(padbox_auc_thread_local_hist, false,
+            "if true, auc collected in CPU is buffered per thread and added "
+            "to a shared table once for thousands of samples");
+DEFINE_int32(padbox_auc_merge_thread_num, 16,
+             "thread num to merge the per thread auc buffers");
+DEFINE_int32(padbox_auc_sketch_max_buckets, 65536,
+             "max non-empty buckets of the auc sketch of a metric using the "
+             "sketch backend");
+DEFINE_int32(padbox_uauc_sketch_max_buckets, 1024,
+             "max non-empty buckets of the auc sketch of a user in uauc");
+DEFINE_bool(padbox_input_table_perfect_hash, false,
+            "if true, the input table keeps a perfect hash of the 64 bit "
+            "hashes of the index keys, built once the index is loaded, "
+            "instead of a map of the key strings");
 DEFINE_bool(padbox_dataset_disable_polling, false,
             "if true ,will disable input file list polling");
 DEFINE_bool(padbox_dataset_enable_unrollinstance, false,
@@ -610,3 +643,39 @@ DEFINE_bool(enbale_slotpool_auto_clear, false,
             "slot pool enable auto clear, default false");
 DEFINE_bool(enable_ins_parser_add_file_path, false,
             "enable parser ins add path param, default false");
+
+/**
+ * Operator related FLAG
+ * Name: FLAGS_op_sampling_profiler
+ * Since Version: 2.0.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_op_sampling_profiler=true
+ * Note: Sample the latency of ops at a low rate into per thread histograms,
+ *       and report the count, mean, p50 and p99 of every op type
+ *       periodically. Cheap enough to leave on in production.
+ */
+DEFINE_bool(op_sampling_profiler, false,
+            "sample the latency of ops and report it periodically");
+DEFINE_int32(op_sampling_profiler_rate, 64,
+             "one of about this many op runs of a thread is sampled, at "
+             "least 1");
+DEFINE_int32(op_sampling_profiler_interval, 60,
+             "seconds between the reports of the op sampling profiler, "
+             "0 not to report in background");
+DEFINE_string(op_sampling_profiler_path, "",
+              "file to write the op sampling profiler reports to, replaced "
+              "by every report, the log if empty");
+
+/**
+ * Operator related FLAG
+ * Name: FLAGS_selected_rows_merge_thread_num
+ * Since Version: 2.0.0
+ * Value Range: int32, default=1
+ * Example: FLAGS_selected_rows_merge_thread_num=8
+ * Note: The number of threads MergeAdd uses to merge the duplicated rows of
+ *       SelectedRows on CPU, for the sparse gradients merged by the
+ *       communicator and merge_selected_rows. The output does not depend on
+ *       it.
+ */
+DEFINE_int32(selected_rows_merge_thread_num, 1,
+             "the number of threads to merge SelectedRows on CPU");
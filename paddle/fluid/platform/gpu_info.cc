@@ -340,7 +340,10 @@ static void RaiseNonOutOfMemoryError(cudaError_t *status) {
 class RecordedCudaMallocHelper {
  private:
   explicit RecordedCudaMallocHelper(int dev_id, uint64_t limit_size = 0)
-      : dev_id_(dev_id), limit_size_(limit_size) {
+      : dev_id_(dev_id),
+        limit_size_(limit_size),
+        mem_size_stat_(
+            STAT_GAUGE("gpu" + std::to_string(dev_id) + ".mem_size")) {
     if (NeedRecord()) {
       mtx_.reset(new std::mutex());
     }
@@ -387,8 +390,7 @@ class RecordedCudaMallocHelper {
       if (NeedRecord()) {
         cur_size_ += size;
       }
-      //      STAT_INT_ADD("STAT_gpu" + std::to_string(dev_id_) + "_mem_size",
-      //      size);
+      mem_size_stat_->Add(size);
       return cudaSuccess;
     } else {
       RaiseNonOutOfMemoryError(&result);
@@ -417,8 +419,7 @@ class RecordedCudaMallocHelper {
         std::lock_guard<std::mutex> guard(*mtx_);
         cur_size_ -= size;
       }
-      //      STAT_INT_SUB("STAT_gpu" + std::to_string(dev_id_) + "_mem_size",
-      //      size);
+      mem_size_stat_->Add(-static_cast<int64_t>(size));
     } else {
       cudaGetLastError();  // clear the error flag when cudaErrorCudartUnloading
     }
@@ -460,6 +461,7 @@ class RecordedCudaMallocHelper {
   const int dev_id_;
   const uint64_t limit_size_;
   uint64_t cur_size_{0};
+  StatGauge *mem_size_stat_;
 
   mutable std::unique_ptr<std::mutex> mtx_;
 
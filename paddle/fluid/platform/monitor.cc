@@ -13,10 +13,107 @@
 // limitations under the License.
 
 #include "paddle/fluid/platform/monitor.h"
+#include <algorithm>
+#include <limits>
+#include <sstream>
 #include <utility>
 
 namespace paddle {
-namespace platform {}  // namespace platform
+namespace platform {
+
+int64_t StatCounter::Get() const {
+  int64_t value = 0;
+  for (auto& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+int64_t StatCounter::Reset() {
+  int64_t value = 0;
+  for (auto& shard : shards_) {
+    value += shard.value.exchange(0, std::memory_order_relaxed);
+  }
+  return value;
+}
+
+int64_t StatHistogramSnapshot::Quantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  // q = 1 is the max, in the last non-empty bucket
+  int64_t rank = std::min(count - 1, static_cast<int64_t>(q * count));
+  int64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen > rank) {
+      return StatHistogram::BucketBound(i);
+    }
+  }
+  return StatHistogram::BucketBound(buckets.size() - 1);
+}
+
+constexpr int StatHistogram::kBucketNum;
+
+int StatHistogram::BucketIndex(int64_t value) {
+  int index = 0;
+  while (value > 0) {
+    value >>= 1;
+    ++index;
+  }
+  return index;
+}
+
+int64_t StatHistogram::BucketBound(int index) {
+  if (index <= 0) {
+    return 0;
+  }
+  if (index >= kBucketNum - 1) {
+    return std::numeric_limits<int64_t>::max();
+  }
+  return (int64_t(1) << index) - 1;
+}
+
+StatHistogram::Shard::Shard() {
+  for (auto& bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  sum.store(0, std::memory_order_relaxed);
+}
+
+StatHistogramSnapshot StatHistogram::Snapshot(bool reset) {
+  StatHistogramSnapshot snapshot;
+  snapshot.buckets.assign(kBucketNum, 0);
+  for (auto& shard : shards_) {
+    for (int i = 0; i < kBucketNum; ++i) {
+      auto& bucket = shard.buckets[i];
+      int64_t count = reset ? bucket.exchange(0, std::memory_order_relaxed)
+                            : bucket.load(std::memory_order_relaxed);
+      snapshot.buckets[i] += count;
+      snapshot.count += count;
+    }
+    snapshot.sum += reset ? shard.sum.exchange(0, std::memory_order_relaxed)
+                          : shard.sum.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+std::string StatSnapshot::ToString() const {
+  std::ostringstream os;
+  for (auto& kv : counters) {
+    os << kv.first << " " << kv.second << "\n";
+  }
+  for (auto& kv : gauges) {
+    os << kv.first << " " << kv.second << "\n";
+  }
+  for (auto& kv : histograms) {
+    os << kv.first << " " << kv.second.count << " " << kv.second.Mean() << " "
+       << kv.second.Quantile(0.5) << " " << kv.second.Quantile(0.99) << "\n";
+  }
+  return os.str();
+}
+
+}  // namespace platform
 }  // namespace paddle
 
 DEFINE_INT_STATUS(STAT_total_feasign_num_in_mem)
@@ -14,8 +14,10 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <stdio.h>
 #include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
@@ -66,6 +68,97 @@ class StatValue : public MonitorRegistrar {
   }
 };
 
+// The dynamic stats below are registered by name at runtime. Counters and
+// histograms split their value over kStatShardNum cache lines, every thread
+// adds to its own shard without contention and the reads sum the shards.
+constexpr int kStatShardNum = 16;
+
+// The shard of the current thread, assigned round robin.
+inline int StatShardIndex() {
+  static std::atomic<int> next{0};
+  thread_local int index =
+      next.fetch_add(1, std::memory_order_relaxed) % kStatShardNum;
+  return index;
+}
+
+struct StatShard {
+  std::atomic<int64_t> value{0};
+  char padding[64 - sizeof(std::atomic<int64_t>)];
+};
+
+class StatCounter {
+ public:
+  void Add(int64_t inc = 1) {
+    shards_[StatShardIndex()].value.fetch_add(inc, std::memory_order_relaxed);
+  }
+  int64_t Get() const;
+  // Returns the value before.
+  int64_t Reset();
+
+ private:
+  StatShard shards_[kStatShardNum];
+};
+
+// A value set as a whole, like the bytes in use, not sharded.
+class StatGauge {
+ public:
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t inc) { value_.fetch_add(inc, std::memory_order_relaxed); }
+  int64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+struct StatHistogramSnapshot {
+  int64_t count = 0;
+  int64_t sum = 0;
+  std::vector<int64_t> buckets;
+
+  double Mean() const {
+    return count > 0 ? static_cast<double>(sum) / count : 0;
+  }
+  // The upper bound of the bucket of the q quantile.
+  int64_t Quantile(double q) const;
+};
+
+// The distribution of int64 values, like latencies or sizes, in log2
+// buckets: bucket 0 holds the values <= 0 and bucket i those in
+// [2^(i-1), 2^i).
+class StatHistogram {
+ public:
+  static constexpr int kBucketNum = 64;
+
+  static int BucketIndex(int64_t value);
+  static int64_t BucketBound(int index);
+
+  void Observe(int64_t value) {
+    Shard& shard = shards_[StatShardIndex()];
+    shard.buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+  }
+  StatHistogramSnapshot Snapshot(bool reset = false);
+
+ private:
+  struct Shard {
+    Shard();
+    std::atomic<int64_t> buckets[kBucketNum];
+    std::atomic<int64_t> sum;
+    char padding[64 - (kBucketNum + 1) * sizeof(std::atomic<int64_t>) % 64];
+  };
+  Shard shards_[kStatShardNum];
+};
+
+struct StatSnapshot {
+  std::map<std::string, int64_t> counters;
+  std::map<std::string, int64_t> gauges;
+  std::map<std::string, StatHistogramSnapshot> histograms;
+
+  // A "name value" line for every counter and gauge, and a
+  // "name count mean p50 p99" line for every histogram.
+  std::string ToString() const;
+};
+
 template <typename T>
 struct ExportedStatValue {
   std::string key;
@@ -118,9 +211,54 @@ class StatRegistry {
     return stats;
   }
 
+  // The dynamic stats hold int64 values whatever T is, use them through
+  // StatRegistry<int64_t>. They are created on the first call of a name and
+  // live as long as the registry, cache the returned pointers on hot paths.
+  StatCounter* counter(const std::string& name) {
+    return GetOrCreate(&counters_, name);
+  }
+  StatGauge* gauge(const std::string& name) {
+    return GetOrCreate(&gauges_, name);
+  }
+  StatHistogram* histogram(const std::string& name) {
+    return GetOrCreate(&histograms_, name);
+  }
+
+  // The values of all dynamic stats, counters and histograms restart from 0
+  // if reset.
+  StatSnapshot snapshot(bool reset = false) {
+    StatSnapshot snapshot;
+    std::lock_guard<std::mutex> lg(mutex_);
+    for (const auto& kv : counters_) {
+      snapshot.counters[kv.first] =
+          reset ? kv.second->Reset() : kv.second->Get();
+    }
+    for (const auto& kv : gauges_) {
+      snapshot.gauges[kv.first] = kv.second->Get();
+    }
+    for (const auto& kv : histograms_) {
+      snapshot.histograms[kv.first] = kv.second->Snapshot(reset);
+    }
+    return snapshot;
+  }
+
  private:
+  template <typename S>
+  S* GetOrCreate(std::unordered_map<std::string, std::unique_ptr<S>>* stats,
+                 const std::string& name) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    auto& stat = (*stats)[name];
+    if (stat == nullptr) {
+      stat.reset(new S());
+    }
+    return stat.get();
+  }
+
   std::mutex mutex_;
   std::unordered_map<std::string, StatValue<T>*> stats_;
+  std::unordered_map<std::string, std::unique_ptr<StatCounter>> counters_;
+  std::unordered_map<std::string, std::unique_ptr<StatGauge>> gauges_;
+  std::unordered_map<std::string, std::unique_ptr<StatHistogram>> histograms_;
 };
 
 }  // namespace platform
@@ -140,6 +278,14 @@ class StatRegistry {
 #define STAT_FLOAT_SUB(item, t) \
   paddle::platform::StatRegistry<float>::Instance().get(item)->decrease(t)
 
+// Dynamic stats by string
+#define STAT_COUNTER(name) \
+  paddle::platform::StatRegistry<int64_t>::Instance().counter(name)
+#define STAT_GAUGE(name) \
+  paddle::platform::StatRegistry<int64_t>::Instance().gauge(name)
+#define STAT_HISTOGRAM(name) \
+  paddle::platform::StatRegistry<int64_t>::Instance().histogram(name)
+
 #define STAT_RESET(item, t) _##item.reset(t)
 #define STAT_GET(item) _##item.get()
 
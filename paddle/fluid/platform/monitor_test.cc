@@ -0,0 +1,107 @@
+//   Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/platform/monitor.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace platform {
+
+TEST(StatRegistry, Counter) {
+  StatCounter* counter = STAT_COUNTER("test.counter");
+  EXPECT_EQ(STAT_COUNTER("test.counter"), counter);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([] {
+      StatCounter* counter = STAT_COUNTER("test.counter");
+      for (int j = 0; j < 100000; ++j) {
+        counter->Add();
+      }
+      counter->Add(5);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter->Get(), 8 * 100005);
+  EXPECT_EQ(counter->Reset(), 8 * 100005);
+  EXPECT_EQ(counter->Get(), 0);
+}
+
+TEST(StatRegistry, Gauge) {
+  StatGauge* gauge = STAT_GAUGE("test.gauge");
+  gauge->Set(100);
+  gauge->Add(-30);
+  EXPECT_EQ(STAT_GAUGE("test.gauge")->Get(), 70);
+}
+
+TEST(StatRegistry, Histogram) {
+  for (int64_t value : {-1LL, 0LL, 1LL, 2LL, 3LL, 100LL, 1LL << 40,
+                        (1LL << 62) + 1, 0x7fffffffffffffffLL}) {
+    int index = StatHistogram::BucketIndex(value);
+    EXPECT_LT(index, StatHistogram::kBucketNum);
+    EXPECT_GE(StatHistogram::BucketBound(index), value);
+    if (index > 0) {
+      EXPECT_LT(StatHistogram::BucketBound(index - 1), value);
+    }
+  }
+
+  StatHistogram* histogram = STAT_HISTOGRAM("test.histogram");
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([histogram] {
+      for (int j = 0; j < 98; ++j) {
+        histogram->Observe(10);
+      }
+      histogram->Observe(1000);
+      histogram->Observe(1000);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  StatHistogramSnapshot snapshot = histogram->Snapshot();
+  EXPECT_EQ(snapshot.count, 400);
+  EXPECT_EQ(snapshot.sum, 4 * (98 * 10 + 2 * 1000));
+  EXPECT_EQ(snapshot.Quantile(0.5), 15);
+  EXPECT_EQ(snapshot.Quantile(0.99), 1023);
+  EXPECT_EQ(snapshot.Quantile(1.0), 1023);
+}
+
+TEST(StatRegistry, Snapshot) {
+  auto& registry = StatRegistry<int64_t>::Instance();
+  registry.counter("snapshot.counter")->Add(3);
+  registry.gauge("snapshot.gauge")->Set(7);
+  registry.histogram("snapshot.histogram")->Observe(4);
+
+  StatSnapshot snapshot = registry.snapshot(true);
+  EXPECT_EQ(snapshot.counters["snapshot.counter"], 3);
+  EXPECT_EQ(snapshot.gauges["snapshot.gauge"], 7);
+  EXPECT_EQ(snapshot.histograms["snapshot.histogram"].count, 1);
+  EXPECT_NE(snapshot.ToString().find("snapshot.counter 3\n"),
+            std::string::npos);
+
+  // Gauges keep their values after a reset.
+  snapshot = registry.snapshot();
+  EXPECT_EQ(snapshot.counters["snapshot.counter"], 0);
+  EXPECT_EQ(snapshot.gauges["snapshot.gauge"], 7);
+  EXPECT_EQ(snapshot.histograms["snapshot.histogram"].count, 0);
+}
+
+}  // namespace platform
+}  // namespace paddle
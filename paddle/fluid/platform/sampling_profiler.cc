@@ -0,0 +1,165 @@
+//   Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/platform/sampling_profiler.h"
+
+#include <stdio.h>
+#include <sstream>
+#include <unordered_map>
+
+#include "glog/logging.h"
+
+DECLARE_int32(op_sampling_profiler_interval);
+DECLARE_string(op_sampling_profiler_path);
+
+namespace paddle {
+namespace platform {
+
+OpSamplingProfiler& OpSamplingProfiler::Instance() {
+  static OpSamplingProfiler instance;
+  return instance;
+}
+
+OpSamplingProfiler::OpSamplingProfiler()
+    : start_ticks_(CycleClock()),
+      start_time_(std::chrono::steady_clock::now()) {
+  if (FLAGS_op_sampling_profiler_interval > 0) {
+    export_thread_ = std::thread([this] { ExportLoop(); });
+  }
+}
+
+OpSamplingProfiler::~OpSamplingProfiler() {
+  if (export_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(export_mutex_);
+      stop_ = true;
+    }
+    export_cv_.notify_all();
+    export_thread_.join();
+  }
+}
+
+StatHistogram* OpSamplingProfiler::TypeHistogram(const std::string& type) {
+  // Looked up without locking, the histograms live as long as the registry.
+  thread_local std::unordered_map<std::string, StatHistogram*> cache;
+  auto iter = cache.find(type);
+  if (iter != cache.end()) {
+    return iter->second;
+  }
+  StatHistogram* hist = STAT_HISTOGRAM("op_sampling." + type + ".ticks");
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    types_.emplace(type, hist);
+  }
+  cache.emplace(type, hist);
+  return hist;
+}
+
+void OpSamplingProfiler::Record(const std::string& type, uint64_t ticks) {
+  TypeHistogram(type)->Observe(static_cast<int64_t>(ticks));
+}
+
+OpSamplingProfiler::Snapshot OpSamplingProfiler::Collect() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Snapshot snapshot;
+  for (auto& item : types_) {
+    snapshot[item.first] = item.second->Snapshot();
+  }
+  return snapshot;
+}
+
+std::string OpSamplingProfiler::Report(bool interval) {
+  Snapshot snapshot = Collect();
+  Snapshot diff = snapshot;
+  {
+    std::lock_guard<std::mutex> lock(report_mutex_);
+    if (interval) {
+      for (auto& item : diff) {
+        auto last = last_report_.find(item.first);
+        if (last == last_report_.end()) {
+          continue;
+        }
+        for (size_t i = 0; i < item.second.buckets.size(); ++i) {
+          item.second.buckets[i] -= last->second.buckets[i];
+        }
+        item.second.count -= last->second.count;
+        item.second.sum -= last->second.sum;
+      }
+      last_report_.swap(snapshot);
+    }
+  }
+
+  double elapsed_us = std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - start_time_)
+                          .count();
+  double ticks_per_us =
+      elapsed_us > 0 ? (CycleClock() - start_ticks_) / elapsed_us : 1.0;
+  if (ticks_per_us <= 0) {
+    ticks_per_us = 1.0;
+  }
+
+  std::ostringstream os;
+  os << "# type count mean_us p50_us p99_us\n";
+  for (auto& item : diff) {
+    const StatHistogramSnapshot& hist = item.second;
+    if (hist.count == 0) {
+      continue;
+    }
+    os << item.first << " " << hist.count << " "
+       << hist.Mean() / ticks_per_us << " "
+       << hist.Quantile(0.5) / ticks_per_us << " "
+       << hist.Quantile(0.99) / ticks_per_us << "\n";
+  }
+  return os.str();
+}
+
+void OpSamplingProfiler::ExportLoop() {
+  std::unique_lock<std::mutex> lock(export_mutex_);
+  while (!stop_) {
+    export_cv_.wait_for(
+        lock, std::chrono::seconds(FLAGS_op_sampling_profiler_interval),
+        [this] { return stop_; });
+    if (stop_) {
+      break;
+    }
+    lock.unlock();
+    Export();
+    lock.lock();
+  }
+}
+
+void OpSamplingProfiler::Export() {
+  std::string report = Report(true);
+  const std::string& path = FLAGS_op_sampling_profiler_path;
+  if (path.empty()) {
+    LOG(INFO) << "op sampling profile:\n" << report;
+    return;
+  }
+  // Write then rename, so that readers never see a partial report.
+  std::string tmp_path = path + ".tmp";
+  FILE* fp = fopen(tmp_path.c_str(), "w");
+  if (fp == nullptr) {
+    LOG(WARNING) << "cannot open " << tmp_path << " to export op profile";
+    return;
+  }
+  size_t write_count = fwrite(report.data(), 1, report.size(), fp);
+  fclose(fp);
+  if (write_count != report.size() ||
+      rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "failed to export op profile to " << path;
+  }
+}
+
+}  // namespace platform
+}  // namespace paddle
@@ -0,0 +1,145 @@
+//   Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#include "gflags/gflags.h"
+#include "paddle/fluid/platform/monitor.h"
+
+DECLARE_bool(op_sampling_profiler);
+DECLARE_int32(op_sampling_profiler_rate);
+
+namespace paddle {
+namespace platform {
+
+// A cheap monotonic clock in ticks, the TSC on x86 and nanoseconds
+// elsewhere.
+inline uint64_t CycleClock() {
+#if defined(__x86_64__) || defined(_M_X64)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// Latency of op types sampled at a low rate, cheap enough to leave on in
+// production, unlike RecordEvent. The ticks of an op type are observed in the
+// stat histogram "op_sampling.<type>.ticks" of StatRegistry, that every
+// thread looks up once, a background thread reports the count, mean, p50 and
+// p99 of every op type in the last interval to
+// FLAGS_op_sampling_profiler_path, or to the log if it is empty, every
+// FLAGS_op_sampling_profiler_interval seconds.
+//
+// GPU kernels run asynchronously, their latency is that of the launch.
+class OpSamplingProfiler {
+ public:
+  static OpSamplingProfiler& Instance();
+
+  // Whether to time the current op, true about once in
+  // FLAGS_op_sampling_profiler_rate calls of a thread at random, so that
+  // ops in a loop are not always or never sampled. A rate below 1 is 1.
+  static bool Sample() {
+    if (!FLAGS_op_sampling_profiler) {
+      return false;
+    }
+    thread_local int64_t countdown = 0;
+    if (--countdown > 0) {
+      return false;
+    }
+    thread_local uint64_t seed =
+        reinterpret_cast<uintptr_t>(&countdown) | 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    const uint64_t rate = FLAGS_op_sampling_profiler_rate > 1
+                              ? FLAGS_op_sampling_profiler_rate
+                              : 1;
+    countdown = 1 + seed % (2 * rate);
+    return true;
+  }
+
+  void Record(const std::string& type, uint64_t ticks);
+
+  // Lines of "type count mean_us p50_us p99_us" sorted by type, of the
+  // samples since the last Report(true) if interval, or since the start.
+  std::string Report(bool interval);
+
+  ~OpSamplingProfiler();
+
+ private:
+  using Snapshot = std::map<std::string, StatHistogramSnapshot>;
+
+  OpSamplingProfiler();
+  StatHistogram* TypeHistogram(const std::string& type);
+  Snapshot Collect();
+  void ExportLoop();
+  void Export();
+
+  std::mutex mutex_;
+  // The histograms of the op types recorded.
+  std::unordered_map<std::string, StatHistogram*> types_;
+  std::mutex report_mutex_;
+  Snapshot last_report_;
+  // To convert ticks to microseconds.
+  uint64_t start_ticks_;
+  std::chrono::steady_clock::time_point start_time_;
+
+  std::mutex export_mutex_;
+  std::condition_variable export_cv_;
+  bool stop_ = false;
+  std::thread export_thread_;
+};
+
+// Times the scope in OpSamplingProfiler if sampled.
+class SampledOpTimer {
+ public:
+  explicit SampledOpTimer(const std::string& type)
+      : type_(OpSamplingProfiler::Sample() ? &type : nullptr) {
+    if (type_ != nullptr) {
+      start_ = CycleClock();
+    }
+  }
+  ~SampledOpTimer() {
+    if (type_ != nullptr) {
+      OpSamplingProfiler::Instance().Record(*type_, CycleClock() - start_);
+    }
+  }
+
+ private:
+  const std::string* type_;
+  uint64_t start_ = 0;
+};
+
+}  // namespace platform
+}  // namespace paddle
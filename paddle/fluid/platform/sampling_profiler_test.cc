@@ -0,0 +1,154 @@
+//   Copyright (c) 2020 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/platform/sampling_profiler.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+DECLARE_int32(op_sampling_profiler_interval);
+DECLARE_string(op_sampling_profiler_path);
+
+namespace paddle {
+namespace platform {
+
+struct ReportLine {
+  uint64_t count = 0;
+  double mean = 0;
+  double p50 = 0;
+  double p99 = 0;
+};
+
+static bool FindReportLine(const std::string& report, const std::string& type,
+                           ReportLine* line) {
+  std::istringstream is(report);
+  std::string text;
+  while (std::getline(is, text)) {
+    std::istringstream fields(text);
+    std::string name;
+    fields >> name;
+    if (name == type) {
+      fields >> line->count >> line->mean >> line->p50 >> line->p99;
+      return true;
+    }
+  }
+  return false;
+}
+
+// The first test, the flags are read when the profiler is created.
+TEST(OpSamplingProfiler, Export) {
+  FLAGS_op_sampling_profiler_interval = 1;
+  FLAGS_op_sampling_profiler_path = "./op_sampling_profile.txt";
+  std::remove(FLAGS_op_sampling_profiler_path.c_str());
+  OpSamplingProfiler::Instance().Record("export_op", 1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  std::ifstream is(FLAGS_op_sampling_profiler_path);
+  std::stringstream report;
+  report << is.rdbuf();
+  ReportLine line;
+  EXPECT_TRUE(FindReportLine(report.str(), "export_op", &line));
+  EXPECT_EQ(line.count, 1UL);
+  // Not to export during the other tests, after the pending export.
+  FLAGS_op_sampling_profiler_interval = 3600;
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+}
+
+TEST(OpSamplingProfiler, Report) {
+  auto& profiler = OpSamplingProfiler::Instance();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&profiler] {
+      for (int j = 0; j < 98; ++j) {
+        profiler.Record("report_op", 100);
+      }
+      profiler.Record("report_op", 100000);
+      profiler.Record("report_op", 100000);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // A live thread.
+  profiler.Record("report_op", 100);
+
+  ReportLine line;
+  ASSERT_TRUE(FindReportLine(profiler.Report(false), "report_op", &line));
+  EXPECT_EQ(line.count, 401UL);
+  double ratio =
+      static_cast<double>(
+          StatHistogram::BucketBound(StatHistogram::BucketIndex(100000))) /
+      StatHistogram::BucketBound(StatHistogram::BucketIndex(100));
+  EXPECT_NEAR(line.p99 / line.p50, ratio, ratio * 1e-3);
+
+  // Only the new samples are in the next interval.
+  profiler.Report(true);
+  EXPECT_FALSE(FindReportLine(profiler.Report(true), "report_op", &line));
+  profiler.Record("report_op", 100);
+  ASSERT_TRUE(FindReportLine(profiler.Report(true), "report_op", &line));
+  EXPECT_EQ(line.count, 1UL);
+}
+
+TEST(OpSamplingProfiler, Overhead) {
+  const std::string type = "overhead_op";
+  const int run_num = 10000000;
+  auto run = [&type] {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < run_num; ++i) {
+      SampledOpTimer timer(type);
+    }
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now() - start)
+               .count() /
+           run_num;
+  };
+  FLAGS_op_sampling_profiler = false;
+  double off_ns = run();
+  FLAGS_op_sampling_profiler = true;
+  double on_ns = run();
+  FLAGS_op_sampling_profiler = false;
+
+  ReportLine line;
+  ASSERT_TRUE(FindReportLine(OpSamplingProfiler::Instance().Report(false),
+                             type, &line));
+  EXPECT_GT(line.count, run_num / FLAGS_op_sampling_profiler_rate / 2);
+  EXPECT_LT(line.count, run_num / FLAGS_op_sampling_profiler_rate * 2);
+  LOG(INFO) << "per op overhead of the sampling profiler: " << off_ns
+            << " ns off, " << on_ns << " ns on";
+}
+
+TEST(OpSamplingProfiler, NonPositiveRate) {
+  int old_rate = FLAGS_op_sampling_profiler_rate;
+  FLAGS_op_sampling_profiler = true;
+  for (int rate : {0, -5}) {
+    FLAGS_op_sampling_profiler_rate = rate;
+    int sampled = 0;
+    for (int i = 0; i < 1000; ++i) {
+      sampled += OpSamplingProfiler::Sample();
+    }
+    // Sampled as with a rate of 1.
+    EXPECT_GE(sampled, 500);
+  }
+  FLAGS_op_sampling_profiler = false;
+  FLAGS_op_sampling_profiler_rate = old_rate;
+}
+
+}  // namespace platform
+}  // namespace paddle
@@ -91,6 +91,7 @@ void BindBoxWrapper(py::module* m) {
            py::arg("ignore_rank"), py::arg("bucket_size") = 1000000,
            py::arg("mode_collect_in_gpu") = false,
            py::arg("max_batch_size") = 0, py::arg("sample_scale_varnam") = "",
+           py::arg("use_sketch") = false, py::arg("uid_varname") = "",
            py::call_guard<py::gil_scoped_release>())
       .def("get_metric_msg", &framework::BoxWrapper::GetMetricMsg,
            py::call_guard<py::gil_scoped_release>())
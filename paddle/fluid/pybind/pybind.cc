@@ -1748,6 +1748,27 @@ All parameter, weight, gradient are variables in Paddle.
     }
     return stats_map;
   });
+  m.def("get_stat_snapshot",
+        [](bool reset) {
+          auto snapshot =
+              paddle::platform::StatRegistry<int64_t>::Instance().snapshot(
+                  reset);
+          std::unordered_map<std::string, double> stats_map;
+          for (const auto &kv : snapshot.counters) {
+            stats_map[kv.first] = kv.second;
+          }
+          for (const auto &kv : snapshot.gauges) {
+            stats_map[kv.first] = kv.second;
+          }
+          for (const auto &kv : snapshot.histograms) {
+            stats_map[kv.first + ".count"] = kv.second.count;
+            stats_map[kv.first + ".mean"] = kv.second.Mean();
+            stats_map[kv.first + ".p50"] = kv.second.Quantile(0.5);
+            stats_map[kv.first + ".p99"] = kv.second.Quantile(0.99);
+          }
+          return stats_map;
+        },
+        py::arg("reset") = false);
   m.def("run_cmd",
         [](const std::string &cmd, int time_out = -1,
            int sleep_inter = -1) -> const std::string {
@@ -187,6 +187,9 @@ def __bootstrap__():
         'fast_eager_deletion_mode',
         'memory_fraction_of_eager_deletion',
         'allocator_strategy',
+        'cpu_allocator_strategy',
+        'executor_memory_plan',
+        'device_worker_compiled_plan',
         'reader_queue_speed_test_mode',
         'print_sub_graph_dir',
         'pe_profile_fname',
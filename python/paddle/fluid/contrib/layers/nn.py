@@ -501,7 +501,8 @@ def fused_embedding_seq_pool(input,
                              padding_idx=None,
                              combiner='sum',
                              param_attr=None,
-                             dtype='float32'):
+                             dtype='float32',
+                             with_cvm=False):
     r"""
     **Embedding Sequence pool**
 
@@ -525,6 +526,10 @@ def fused_embedding_seq_pool(input,
         param_attr (ParamAttr): Parameters for this layer.
         dtype (np.dtype|core.VarDesc.VarType|str): The dtype refers to the data type of output
             tensor. It can be float32, float_16, int etc.
+        with_cvm (bool): Whether to apply the CVM transform of `continuous_value_model`
+            with `use_cvm=True` to the pooled embeddings, whose first two columns are
+            show and click. It is for inference only and does not support
+            :attr:`padding_idx`. Default: False.
     Returns:
         The sequence pooling variable which is a Tensor.
     Examples:
@@ -557,7 +562,8 @@ def fused_embedding_seq_pool(input,
         attrs={
             'is_sparse': is_sparse,
             'combiner': combiner,
-            'padding_idx': padding_idx
+            'padding_idx': padding_idx,
+            'with_cvm': with_cvm
         })
     return out
 
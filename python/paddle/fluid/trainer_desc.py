@@ -152,6 +152,12 @@ class TrainerDesc(object):
     def _set_dump_converter(self, converter):
         self.proto_desc.dump_converter = converter
 
+    def _set_dump_format(self, dump_format):
+        self.proto_desc.dump_format = dump_format
+
+    def _set_dump_file_max_bytes(self, dump_file_max_bytes):
+        self.proto_desc.dump_file_max_bytes = dump_file_max_bytes
+
     def _set_enable_random_dump(self, enable_random_dump):
         self.proto_desc.enable_random_dump = enable_random_dump
 